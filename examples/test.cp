@@ -22,10 +22,19 @@ int** get_ptr_ptr(int** p) {
     return p;
 }
 
+// the index is bounds checked with -fbounds-check, which splits the block inside the if
+int first_or_zero(int[] s) {
+    int t = 0;
+    if (s.len > 0) {
+        t = t + s[0];
+    }
+    return t;
+}
+
 int counter = 0;
 void increment() { counter = counter + 1; }
 
-int main(int argc, char[] *argv) {
+int main(int argc, char** argv) {
     print("Hello World!\n");
     print("This is a builtin!\n");
 
@@ -359,8 +368,43 @@ int main(int argc, char[] *argv) {
     if (sq != 25) { status = 44; }
     if (INCLUDE_TEST_VALUE != 50) { status = 45; }
 
+    // mixed width arithmetic follows C's usual arithmetic conversions
+    int narrow = 1;
+    long wide = 5000000000;
+    if (narrow + wide != 5000000001) { status = 46; }
+
+    byte small = 250;
+    if (small + 10 != 260 || 10 + small != 260) { status = 47; }
+
+    uint below = 4000000000;
+    if (!(below < wide)) { status = 48; }
+
+    ulong all_bits = 0xFFFFFFFFFFFFFFFF;
+    if (all_bits >> 60 != 15) { status = 49; }
+
+    // unsuffixed decimals are double, and float next to a float
+    double dd = 1.5;
+    dd = dd * 2.0;
+    double de = dd + 1.0;
+    if (de != 4.0) { status = 50; }
+
+    float fh = 2.0;
+    fh = fh * 1.5 - 0.5;
+    if (fh != 2.5) { status = 51; }
+
+    int[3] checked = {4, 5, 6};
+    if (first_or_zero(checked) != 4) { status = 52; }
+
+    int nested = 0;
+    if (nested == 0) {
+        if (nested > 2) { nested = 1; }
+        nested = nested + 2;
+    }
+    if (nested != 2) { status = 53; }
+
     float ff = 3.14;
     int xxx = (int)ff;
 
+    if (status != 0) { return status; }
     return xxx;
 }
\ No newline at end of file
@@ -15,6 +15,13 @@ typedef enum BinaryOp {
     BIN_DIV,
     BIN_MOD,
 
+    // bitwise
+    BIN_BIT_AND,
+    BIN_BIT_OR,
+    BIN_BIT_XOR,
+    BIN_SHL,
+    BIN_SHR,
+
     // comparison
     BIN_EQUAL,
     BIN_GREATER,
@@ -30,6 +37,11 @@ typedef enum BinaryOp {
     BIN_MUL_ASSIGN,
     BIN_DIV_ASSIGN,
     BIN_MOD_ASSIGN,
+    BIN_AND_ASSIGN,
+    BIN_OR_ASSIGN,
+    BIN_XOR_ASSIGN,
+    BIN_SHL_ASSIGN,
+    BIN_SHR_ASSIGN,
 
     // logical operators
     BIN_LOGICAL_AND,
@@ -37,6 +49,9 @@ typedef enum BinaryOp {
 } BinaryOp;
 
 // needs to match lexer
+// type parameters a generic function can declare, as in T max<T>(T a, T b)
+#define MAX_TYPE_PARAMS 8
+
 typedef enum TypeKind {
     TYPE_INT,
     TYPE_LONG,
@@ -45,13 +60,35 @@ typedef enum TypeKind {
     TYPE_DOUBLE,
     TYPE_STRING,
     TYPE_BOOLEAN,
-    TYPE_VOID
+    TYPE_VOID,
+    TYPE_UINT,
+    TYPE_ULONG,
+    TYPE_BYTE,
+
+    // simd vectors, lowered to <N x T>
+    TYPE_FLOAT4,
+    TYPE_FLOAT8,
+    TYPE_INT4,
+    TYPE_INT8,
+
+    // type parameters of a generic function are TYPE_PARAM + their index, replaced when it is instantiated
+    TYPE_PARAM,
+
+    // user defined structs are TYPE_STRUCT + their index in ProgramNode.structs, keep this last
+    TYPE_STRUCT = TYPE_PARAM + MAX_TYPE_PARAMS
 } TypeKind;
 
+// a concrete type standing in for a type parameter
+typedef struct TypeArg {
+    TypeKind type;
+    int pointer_level;
+} TypeArg;
+
 // needs to match lexer
 typedef enum UnaryOp {
     UNARY_NEG,
     UNARY_NOT,
+    UNARY_BIT_NOT,
     UNARY_DEREF,
     UNARY_ADDR_OF,
     UNARY_PRE_INC,
@@ -60,6 +97,53 @@ typedef enum UnaryOp {
     UNARY_POST_DEC,
 } UnaryOp;
 
+// calls the compiler lowers itself instead of calling a function
+typedef enum IntrinsicKind {
+    INTRINSIC_NONE,
+
+    // simd
+    INTRINSIC_SHUFFLE,
+    INTRINSIC_SELECT,
+    INTRINSIC_HSUM,
+    INTRINSIC_HMIN,
+    INTRINSIC_HMAX,
+    INTRINSIC_VLOAD,
+    INTRINSIC_VLOAD_ALIGNED,
+    INTRINSIC_VSTORE,
+    INTRINSIC_VSTORE_ALIGNED,
+
+    // branch hints
+    INTRINSIC_LIKELY,
+    INTRINSIC_UNLIKELY,
+
+    // bit manipulation
+    INTRINSIC_POPCOUNT,
+    INTRINSIC_CLZ,
+    INTRINSIC_CTZ,
+    INTRINSIC_BSWAP,
+    INTRINSIC_ROTL,
+    INTRINSIC_ROTR,
+    INTRINSIC_ADD_OVERFLOW,
+    INTRINSIC_SUB_OVERFLOW,
+    INTRINSIC_MUL_OVERFLOW,
+
+    // threads and atomics
+    INTRINSIC_SPAWN,
+    INTRINSIC_ATOMIC_LOAD,
+    INTRINSIC_ATOMIC_STORE,
+    INTRINSIC_ATOMIC_ADD,
+    INTRINSIC_ATOMIC_SUB,
+    INTRINSIC_ATOMIC_EXCHANGE,
+    INTRINSIC_CAS,
+    INTRINSIC_FENCE,
+} IntrinsicKind;
+
+typedef enum {
+    TAIL_CALL_NONE,
+    TAIL_CALL_TAIL,    // 'return f(...)', tail marked when the caller's frame does not escape
+    TAIL_CALL_BECOME,  // 'become f(...)', a loop for self recursion and a tail call otherwise
+} TailCallKind;
+
 typedef struct ExprNode {
     enum {
         EXPR_NUMBER,
@@ -70,10 +154,16 @@ typedef struct ExprNode {
         EXPR_CALL,
         EXPR_ARRAY_INDEX,
         EXPR_CAST,
+        EXPR_INIT_LIST,
+        EXPR_MEMBER,
+        EXPR_SLICE,
     } kind;
     SourceLocation location;
     TypeKind type;
     int pointer_level;
+    bool is_slice;  // pointer and length pair, pointer_level counts the pointer
+    const int *dims;  // extents of a multi-dimensional array or one of its rows, int[H][W] grid is {H, W} and grid[i] is {W}
+    int dim_count;
     union {
         char *text;
         struct {
@@ -89,6 +179,10 @@ typedef struct ExprNode {
             char *function_name;
             struct ExprNode **args;
             int arg_count;
+            IntrinsicKind intrinsic;
+            TailCallKind tail_call;  // resolved by semantic, except become which the parser sets
+            TypeArg *type_args;      // explicit max<int>(...), inferred from the arguments when there are none
+            int type_arg_count;
         } call;
         struct {
             struct ExprNode *array;
@@ -99,15 +193,62 @@ typedef struct ExprNode {
             int target_pointer_level;
             struct ExprNode *operand;
         } cast;
+        struct {
+            struct ExprNode **elements;
+            int count;
+        } init_list;
+        struct {
+            struct ExprNode *object;
+            char *field_name;
+            int field_index;       // declaration order, resolved by semantic
+            bool through_pointer;  // '->' instead of '.'
+            bool is_soa;           // object is an element of a soa array, resolved by semantic
+        } member;
+        struct {
+            struct ExprNode *object;  // slice, fixed array or pointer
+            struct ExprNode *start;   // nullptr for 0
+            struct ExprNode *end;     // nullptr for the length, required when slicing a pointer
+        } slice;
     };
 } ExprNode;
 
+struct StmtNode;
+
+// one case label and the statements up to the next label, control falls through into the next case
+typedef struct {
+    ExprNode *value;           // nullptr for default
+    long long constant;        // value of the label, resolved by semantic
+    struct StmtNode **stmts;
+    int count;
+    SourceLocation location;
+} SwitchCase;
+
+// reduce(+: sum) on a parallel for. every chunk accumulates into a private copy and the copies are combined at the end
+typedef struct {
+    BinaryOp op;  // BIN_ADD, BIN_MUL, BIN_BIT_AND, BIN_BIT_OR or BIN_BIT_XOR
+    char *name;
+    SourceLocation location;
+} Reduction;
+
+// #pragma hints on a for or while loop, 0 leaves the choice to llvm
+enum {
+    LOOP_HINT_OFF = -1,  // nounroll, novector, nointerleave
+    LOOP_HINT_ON = -2,   // a bare unroll unrolls fully, a bare vectorize lets llvm pick the width
+};
+
+typedef struct {
+    int unroll;      // unroll(N)
+    int vectorize;   // vectorize(width: N)
+    int interleave;  // interleave(N)
+} LoopHints;
+
 typedef struct StmtNode {
     enum {
         STMT_RETURN,
         STMT_IF,
         STMT_WHILE,
         STMT_FOR,
+        STMT_SWITCH,
         STMT_BREAK,
         STMT_CONTINUE,
         STMT_VAR_DECL,
@@ -128,13 +269,26 @@ typedef struct StmtNode {
         struct {
             ExprNode *condition;
             struct StmtNode *body;
+            LoopHints hints;
         } while_stmt;
         struct {
             struct StmtNode *init; // can be VarDecl or ExprStmt
             ExprNode *condition;   // can be NULL
             ExprNode *increment;   // can be NULL
             struct StmtNode *body;
+            bool is_parallel;
+            Reduction *reductions;
+            int reduction_count;
+            ExprNode *range;       // for (x in range) over a fixed array or slice, init, condition and increment are NULL
+            char *range_var;
+            bool is_ref;           // for (ref x in range), x is the element itself rather than a copy
+            LoopHints hints;
         } for_stmt;
+        struct {
+            ExprNode *value;
+            SwitchCase *cases;
+            int case_count;
+        } switch_stmt;
         struct {
             TypeKind type;
             int pointer_level;
@@ -142,6 +296,12 @@ typedef struct StmtNode {
             char *name;
             ExprNode *initializer;  // nullptr if no initializer
             int is_const;
+            bool is_soa;            // struct array stored one array per field
+            bool is_restrict;       // pointer does not alias any other restrict pointer
+            bool is_slice;          // T[] name, array_size is 0
+            int *dims;              // int[H][W] name is {H, W} with array_size H, nullptr below two dimensions
+            int dim_count;
+            int alignment;          // align(N), 0 keeps the natural alignment
         } var_decl;
         struct {
             ExprNode *expr;
@@ -171,6 +331,10 @@ typedef struct GlobalVarNode {
     char *name;
     ExprNode *initializer;
     bool is_const;
+    bool is_soa;
+    int *dims;  // as in var_decl
+    int dim_count;
+    int alignment;
     SourceLocation location;
 } GlobalVarNode;
 
@@ -181,16 +345,61 @@ typedef struct ParamNode {
     SourceLocation location;
     char *name;
     int is_const;
+    bool is_restrict;  // pointer is the only way to reach what it points at
+    bool is_slice;
+    int *dims;  // int[H][W] or int[][W], a pointer to rows of W. the outer extent is 0 when left out
+    int dim_count;
+    int alignment;  // align(N), what the pointer is promised to point at
 } ParamNode;
 
+typedef struct FieldNode {
+    TypeKind type;
+    int pointer_level;
+    int array_size;
+    char *name;
+    SourceLocation location;
+} FieldNode;
+
+// qualifiers written before 'struct'
+typedef enum StructAttribute {
+    STRUCT_ATTR_PACKED  = 1 << 0,  // no padding between fields, alignment 1
+    STRUCT_ATTR_REORDER = 1 << 1,  // fields are laid out by decreasing alignment to minimise padding
+} StructAttribute;
+
+typedef struct StructNode {
+    char *name;
+    FieldNode *fields;
+    int field_count;
+    int attributes;  // StructAttribute flags
+    int alignment;   // from align(N), 0 for the natural alignment
+    SourceLocation location;
+} StructNode;
+
+// qualifiers written before a function's return type
+typedef enum FunctionAttribute {
+    FUNC_ATTR_FASTMATH = 1 << 0,  // relaxed floating point semantics for this function only
+    FUNC_ATTR_INLINE = 1 << 1,         // inlining hint
+    FUNC_ATTR_ALWAYS_INLINE = 1 << 2,  // inlined into every caller, even at -O0
+    FUNC_ATTR_NOINLINE = 1 << 3,
+    FUNC_ATTR_HOT = 1 << 4,   // optimised harder and grouped in .text.hot
+    FUNC_ATTR_COLD = 1 << 5,  // rarely run, kept out of the way in .text.unlikely
+} FunctionAttribute;
+
 typedef struct FunctionNode {
     char *name;
     TypeKind return_type;
     int return_pointer_level;
+    bool returns_slice;
     SourceLocation location;
     ParamNode *params;
     int param_count;
     StmtNode *body;
+    int attributes;     // FunctionAttribute flags
+    bool is_exported;   // declared with 'export', always kept as a call graph root
+    bool is_reachable;  // set by callgraph_mark_reachable, unreachable functions are not emitted
+    bool has_self_become;  // set by semantic, codegen turns 'become' on itself into a loop
+    char **type_params;    // generic over these, only its instantiations are analysed and emitted
+    int type_param_count;
 } FunctionNode;
 
 typedef struct ProgramNode {
@@ -198,6 +407,8 @@ typedef struct ProgramNode {
     int function_count;
     GlobalVarNode **globals;
     int global_count;
+    StructNode **structs;
+    int struct_count;
 } ProgramNode;
 
 #endif //C__AST_H
\ No newline at end of file
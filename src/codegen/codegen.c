@@ -5,6 +5,9 @@
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
 #include <llvm-c/Analysis.h>
+#include <llvm-c/DebugInfo.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +21,7 @@ typedef struct {
     TypeKind type;
     int pointer_level;
     int array_size;
+    LLVMMetadataRef alias_scope;  // restrict locals only
 } CodegenSymbol;
 
 static CodegenSymbol *local_vars = NULL;
@@ -28,10 +32,18 @@ static CodegenSymbol *global_vars = NULL;
 static int global_var_count = 0;
 static int global_var_capacity = 0;
 
+static const ProgramNode *current_program = NULL;
+static const FunctionNode *current_function = NULL;
+static LLVMValueRef current_sret = NULL;  // where a struct returned in memory is written
+
 static LLVMBasicBlockRef current_break_target = NULL;
 static LLVMBasicBlockRef current_continue_target = NULL;
 
 static LLVMValueRef codegen_expression(const ExprNode* expr);
+static LLVMValueRef codegen_global_string(const char *text);
+static void release_string_temps(void);
+static LLVMTypeRef struct_llvm_type(TypeKind type);
+static LLVMMetadataRef debug_struct_type(TypeKind type);
 
 static void add_local_var(const char *name, const LLVMValueRef value,  const LLVMTypeRef llvm_type, const TypeKind type, const int pointer_level, int array_size) {
     if (local_var_count >= local_var_capacity) {
@@ -45,6 +57,7 @@ static void add_local_var(const char *name, const LLVMValueRef value,  const LLV
     local_vars[local_var_count].llvm_type = llvm_type;
     local_vars[local_var_count].pointer_level = pointer_level;
     local_vars[local_var_count].array_size = array_size;
+    local_vars[local_var_count].alias_scope = NULL;
     local_var_count++;
 }
 
@@ -60,6 +73,7 @@ static void add_global_var(const char *name, const LLVMValueRef value, const LLV
     global_vars[global_var_count].llvm_type = llvm_type;
     global_vars[global_var_count].pointer_level = pointer_level;
     global_vars[global_var_count].array_size = array_size;
+    global_vars[global_var_count].alias_scope = NULL;
     global_var_count++;
 }
 
@@ -106,6 +120,21 @@ static CodegenSymbol* lookup_var_full(const char *name) {
     return sym;
 }
 
+// drops the innermost variable with that name when the loop declaring it ends
+static void remove_local_var(const char *name) {
+    for (int i = local_var_count - 1; i >= 0; i--) {
+        if (strcmp(local_vars[i].name, name) == 0) {
+            free(local_vars[i].name);
+            // Shift remaining variables down
+            for (int j = i; j < local_var_count - 1; j++) {
+                local_vars[j] = local_vars[j + 1];
+            }
+            local_var_count--;
+            return;
+        }
+    }
+}
+
 static void clear_local_vars(void) {
     for (int i = 0; i < local_var_count; i++) {
         free(local_vars[i].name);
@@ -117,17 +146,112 @@ static LLVMModuleRef module;
 static LLVMBuilderRef builder;
 static LLVMContextRef context;
 
+static CodegenOptions options;
+
+// debug info state, only used with -g
+typedef struct {
+    const char *filename;
+    LLVMMetadataRef file;
+} DebugFile;
+
+static LLVMDIBuilderRef di_builder = NULL;
+static LLVMMetadataRef di_compile_unit = NULL;
+static LLVMMetadataRef di_scope = NULL;  // innermost subprogram or lexical block
+static DebugFile *di_files = NULL;
+static int di_file_count = 0;
+static int di_file_capacity = 0;
+
+// profiling state. with -fprofile-generate every function gets a counter array laid out as
+// [entry, branch 0 false, branch 0 true, branch 1 false, ...], with -fprofile-use the same
+// layout is read back from the profile and turned into branch weights
+typedef struct {
+    char *name;
+    LLVMValueRef counters;
+    int count;
+} ProfileCounters;
+
+typedef struct {
+    char *name;
+    unsigned long long *counts;
+    int count;
+} ProfileRecord;
+
+static ProfileCounters *prof_functions = NULL;
+static int prof_function_count = 0;
+static int prof_function_capacity = 0;
+
+static ProfileRecord *prof_records = NULL;
+static int prof_record_count = 0;
+
+static LLVMValueRef prof_counters = NULL;           // counter array of the function being generated
+static const ProfileRecord *prof_record = NULL;     // loaded profile of the function being generated
+static int prof_branch_site = 0;                    // next branch site in the function being generated
+
+// floating point relaxation of the function being generated, from -ffast-math/-ffp-contract or 'fastmath'
+static bool fn_fast_math = false;
+static bool fn_fp_contract = false;
+
+// tail calls of the function being generated. they are marked once the whole body is known, because
+// 'tail' is only allowed when no local's address can reach the callee
+typedef struct {
+    LLVMValueRef call;
+    TailCallKind kind;
+} TailCall;
+
+static TailCall *tail_calls = NULL;
+static int tail_call_count = 0;
+static int tail_call_capacity = 0;
+
+static LLVMValueRef *param_slots = NULL;           // parameter storage, rewritten by 'become' on the function itself
+static LLVMBasicBlockRef tail_loop_block = NULL;   // where 'become' on the function itself jumps back to
+
+// allocas all go at the top of the entry block, where mem2reg can promote them and code that runs
+// more than once (loops, 'become' on the function itself) doesn't grow the stack
+static LLVMValueRef build_entry_alloca(LLVMTypeRef type, const char *name) {
+    LLVMBasicBlockRef entry = LLVMGetEntryBasicBlock(LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder)));
+    LLVMBuilderRef entry_builder = LLVMCreateBuilderInContext(context);
+
+    LLVMValueRef first = LLVMGetFirstInstruction(entry);
+    if (first) {
+        LLVMPositionBuilderBefore(entry_builder, first);
+    } else {
+        LLVMPositionBuilderAtEnd(entry_builder, entry);
+    }
+
+    LLVMValueRef alloca = LLVMBuildAlloca(entry_builder, type, name);
+    LLVMDisposeBuilder(entry_builder);
+    return alloca;
+}
+
+// DWARF base type encodings
+#define DW_ATE_BOOLEAN     0x02
+#define DW_ATE_FLOAT       0x04
+#define DW_ATE_SIGNED      0x05
+#define DW_ATE_SIGNED_CHAR 0x06
+#define DW_ATE_UNSIGNED    0x08
+
 static LLVMTypeRef get_llvm_type(const TypeKind type) {
     switch (type) {
         case TYPE_INT:     return LLVMInt32TypeInContext(context);
         case TYPE_LONG:    return LLVMInt64TypeInContext(context);
         case TYPE_CHAR:    return LLVMInt8TypeInContext(context);
+        case TYPE_UINT:    return LLVMInt32TypeInContext(context);
+        case TYPE_ULONG:   return LLVMInt64TypeInContext(context);
+        case TYPE_BYTE:    return LLVMInt8TypeInContext(context);
         case TYPE_FLOAT:   return LLVMFloatTypeInContext(context);
         case TYPE_DOUBLE:  return LLVMDoubleTypeInContext(context);
         case TYPE_BOOLEAN: return LLVMInt1TypeInContext(context);
         case TYPE_VOID:    return LLVMVoidTypeInContext(context);
         case TYPE_STRING:  return LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+        case TYPE_FLOAT4:
+        case TYPE_FLOAT8:
+        case TYPE_INT4:
+        case TYPE_INT8:    return LLVMVectorType(get_llvm_type(vector_element_type(type)), vector_lane_count(type));
         default: {
+            if (is_struct_type(type)) {
+                return struct_llvm_type(type);
+            }
+
             fprintf(stderr, "Unsupported type in codegen\n");
             exit(1);
         }
@@ -135,7 +259,8 @@ static LLVMTypeRef get_llvm_type(const TypeKind type) {
 }
 
 static LLVMTypeRef get_llvm_type_with_pointers(const TypeKind kind, int pointer_level) {
-    LLVMTypeRef base_type = get_llvm_type(kind);
+    // void* is an i8* like in c, llvm has no pointers to void
+    LLVMTypeRef base_type = kind == TYPE_VOID && pointer_level > 0 ? LLVMInt8TypeInContext(context) : get_llvm_type(kind);
     for (int i = 0; i < pointer_level; i++) {
         base_type = LLVMPointerType(base_type, 0);
     }
@@ -143,247 +268,2509 @@ static LLVMTypeRef get_llvm_type_with_pointers(const TypeKind kind, int pointer_
     return base_type;
 }
 
-static LLVMValueRef convert_to_type(LLVMValueRef value, TypeKind from_type, TypeKind to_type) {
-    if (from_type == to_type) return value;
+// T[] is { T*, i64 }, which the C ABI passes and returns in two registers like a struct of a pointer and a long.
+// pointer_level is the slice's own, it counts the pointer
+static LLVMTypeRef slice_llvm_type(const TypeKind type, const int pointer_level) {
+    LLVMTypeRef fields[2] = { get_llvm_type_with_pointers(type, pointer_level), LLVMInt64TypeInContext(context) };
+    return LLVMStructTypeInContext(context, fields, 2, 0);
+}
 
-    LLVMTypeRef from_llvm = get_llvm_type(from_type);
-    LLVMTypeRef to_llvm = get_llvm_type(to_type);
+static LLVMTypeRef get_llvm_value_type(const TypeKind type, const int pointer_level, const bool is_slice) {
+    return is_slice ? slice_llvm_type(type, pointer_level) : get_llvm_type_with_pointers(type, pointer_level);
+}
 
-    // Both are integers of different sizes
-    if ((from_type == TYPE_INT || from_type == TYPE_LONG || from_type == TYPE_CHAR) &&
-        (to_type == TYPE_INT || to_type == TYPE_LONG || to_type == TYPE_CHAR)) {
+// [H x [W x T]] for int[H][W], rows are laid out one after another
+static LLVMTypeRef nested_array_type(LLVMTypeRef element_type, const int *dims, const int dim_count) {
+    LLVMTypeRef type = element_type;
+    for (int i = dim_count - 1; i >= 0; i--) {
+        type = LLVMArrayType(type, dims[i]);
+    }
 
-        unsigned from_bits = LLVMGetIntTypeWidth(from_llvm);
-        unsigned to_bits = LLVMGetIntTypeWidth(to_llvm);
+    return type;
+}
 
-        if (from_bits < to_bits) {
-            return LLVMBuildSExt(builder, value, to_llvm, "sext");
-        } else if (from_bits > to_bits) {
-            return LLVMBuildTrunc(builder, value, to_llvm, "trunc");
-        }
+static LLVMValueRef nested_array_constant(LLVMTypeRef element_type, const int *dims, const int dim_count, LLVMValueRef *values) {
+    if (dim_count == 1) return LLVMConstArray(element_type, values, dims[0]);
+
+    int stride = 1;
+    for (int i = 1; i < dim_count; i++) {
+        stride *= dims[i];
     }
 
-    return value;
-}
+    LLVMValueRef *rows = malloc(sizeof(LLVMValueRef) * dims[0]);
+    for (int i = 0; i < dims[0]; i++) {
+        rows[i] = nested_array_constant(element_type, dims + 1, dim_count - 1, values + i * stride);
+    }
 
-static void codegen_declare_builtins(void) {
-    LLVMTypeRef void_t = LLVMVoidTypeInContext(context);
-    LLVMTypeRef i32_t = LLVMInt32TypeInContext(context);
-    LLVMTypeRef float_t = LLVMFloatTypeInContext(context);
-    LLVMTypeRef bool_t = LLVMInt1TypeInContext(context);
-    LLVMTypeRef i8_t = LLVMInt8TypeInContext(context);
-    LLVMTypeRef str_t = LLVMPointerType(i8_t, 0);
-    LLVMTypeRef void_ptr_t = LLVMPointerType(i8_t, 0);
+    LLVMValueRef result = LLVMConstArray(nested_array_type(element_type, dims + 1, dim_count - 1), rows, dims[0]);
+    free(rows);
+    return result;
+}
 
-    LLVMTypeRef input_type = LLVMFunctionType(str_t, NULL, 0, 0);
-    LLVMValueRef input_func = LLVMAddFunction(module, "__cplus_input_", input_type);
-    add_global_var("__cplus_input_", input_func, input_type, TYPE_STRING, 0, 0);
+// int[][W] is a [W x T]*, pointer_level counts one pointer per dimension
+static LLVMTypeRef param_llvm_type(const ParamNode *param) {
+    if (param->dim_count == 0) return get_llvm_value_type(param->type, param->pointer_level, param->is_slice);
 
-    LLVMTypeRef print_args[] = { str_t };
-    LLVMTypeRef print_type = LLVMFunctionType(void_t, print_args, 1, 0);
-    LLVMValueRef print_func = LLVMAddFunction(module, "__cplus_print_", print_type);
-    add_global_var("__cplus_print_", print_func, print_type, TYPE_VOID, 0, 0);
+    LLVMTypeRef element_type = get_llvm_type_with_pointers(param->type, param->pointer_level - param->dim_count);
+    return LLVMPointerType(nested_array_type(element_type, param->dims + 1, param->dim_count - 1), 0);
+}
 
-    LLVMTypeRef to_int_args[] = { str_t };
-    LLVMTypeRef to_int_type = LLVMFunctionType(i32_t, to_int_args, 1, 0);
-    LLVMValueRef to_int_func = LLVMAddFunction(module, "__cplus_to_int_", to_int_type);
-    add_global_var("__cplus_to_int_", to_int_func, to_int_type, TYPE_INT, 0, 0);
+// llvm layout of each struct, built on first use
+typedef struct {
+    LLVMTypeRef type;
+    int *slots;  // slots[i] is the llvm element index of field i, they differ for reorder structs
+    LLVMMetadataRef debug;
+} StructLayout;
 
-    LLVMTypeRef to_float_args[] = { str_t };
-    LLVMTypeRef to_float_type = LLVMFunctionType(float_t, to_float_args, 1, 0);
-    LLVMValueRef to_float_func = LLVMAddFunction(module, "__cplus_to_float_", to_float_type);
-    add_global_var("__cplus_to_float_", to_float_func, to_float_type, TYPE_FLOAT, 0, 0);
+static StructLayout *struct_layouts = NULL;
 
-    LLVMTypeRef i2s_args[] = { i32_t };
-    LLVMTypeRef i2s_type = LLVMFunctionType(str_t, i2s_args, 1, 0);
-    LLVMValueRef i2s_func = LLVMAddFunction(module, "__cplus_int_to_string_", i2s_type);
-    add_global_var("__cplus_int_to_string_", i2s_func, i2s_type, TYPE_STRING, 0, 0);
+static LLVMTypeRef get_llvm_field_type(const FieldNode *field) {
+    LLVMTypeRef type = get_llvm_type_with_pointers(field->type, field->pointer_level);
+    return field->array_size > 0 ? LLVMArrayType(type, field->array_size) : type;
+}
 
-    LLVMTypeRef f2s_args[] = { float_t };
-    LLVMTypeRef f2s_type = LLVMFunctionType(str_t, f2s_args, 1, 0);
-    LLVMValueRef f2s_func = LLVMAddFunction(module, "__cplus_float_to_string_", f2s_type);
-    add_global_var("__cplus_float_to_string_", f2s_func, f2s_type, TYPE_STRING, 0, 0);
+static const StructLayout* struct_layout(const TypeKind type) {
+    StructLayout *layout = &struct_layouts[type - TYPE_STRUCT];
+    if (layout->type) return layout;
 
-    LLVMTypeRef concat_args[] = { str_t, str_t };
-    LLVMTypeRef concat_type = LLVMFunctionType(str_t, concat_args, 2, 0);
-    LLVMValueRef concat_func = LLVMAddFunction(module, "__cplus_str_concat", concat_type);
-    add_global_var("__cplus_str_concat", concat_func, concat_type, TYPE_STRING, 0, 0);
+    const StructNode *def = struct_type_def(type);
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+    const bool packed = (def->attributes & STRUCT_ATTR_PACKED) != 0;
 
-    LLVMTypeRef strcmp_args[] = { str_t, str_t };
-    LLVMTypeRef strcmp_type = LLVMFunctionType(bool_t, strcmp_args, 2, 0);
-    LLVMValueRef strcmp_func = LLVMAddFunction(module, "__cplus_strcmp_", strcmp_type);
-    add_global_var("__cplus_strcmp_", strcmp_func, strcmp_type, TYPE_BOOLEAN, 0, 0);
+    // named before the body is set so fields can point back at the struct
+    layout->type = LLVMStructCreateNamed(context, def->name);
+    layout->slots = malloc(sizeof(int) * def->field_count);
 
-    LLVMTypeRef substr_args[] = { str_t, i32_t, i32_t };
-    LLVMTypeRef substr_type = LLVMFunctionType(str_t, substr_args, 3, 0);
-    LLVMValueRef substr_func = LLVMAddFunction(module, "__cplus_substr_", substr_type);
-    add_global_var("__cplus_substr_", substr_func, substr_type, TYPE_STRING, 0, 0);
+    LLVMTypeRef *field_types = malloc(sizeof(LLVMTypeRef) * def->field_count);
+    int *order = malloc(sizeof(int) * def->field_count);
+    for (int i = 0; i < def->field_count; i++) {
+        field_types[i] = get_llvm_field_type(&def->fields[i]);
+        order[i] = i;
+    }
 
-    LLVMTypeRef char_at_args[] = { str_t, i32_t };
-    LLVMTypeRef char_at_type = LLVMFunctionType(i8_t, char_at_args, 2, 0);
-    LLVMValueRef char_at_func = LLVMAddFunction(module, "__cplus_char_at_", char_at_type);
-    add_global_var("__cplus_char_at_", char_at_func, char_at_type, TYPE_CHAR, 0, 0);
+    // stable insertion sort by decreasing alignment, so smaller fields fill in behind larger ones
+    if (def->attributes & STRUCT_ATTR_REORDER) {
+        for (int i = 1; i < def->field_count; i++) {
+            const int field = order[i];
+            const unsigned align = LLVMABIAlignmentOfType(data_layout, field_types[field]);
+            int j = i;
+            while (j > 0 && LLVMABIAlignmentOfType(data_layout, field_types[order[j - 1]]) < align) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = field;
+        }
+    }
 
-    LLVMTypeRef rand_type = LLVMFunctionType(i32_t, NULL, 0, 0);
-    LLVMValueRef rand_func = LLVMAddFunction(module, "__cplus_random_", rand_type);
-    add_global_var("__cplus_random_", rand_func, rand_type, TYPE_INT, 0, 0);
+    LLVMTypeRef *elements = malloc(sizeof(LLVMTypeRef) * (def->field_count + 1));
+    for (int i = 0; i < def->field_count; i++) {
+        elements[i] = field_types[order[i]];
+        layout->slots[order[i]] = i;
+    }
 
-    LLVMTypeRef time_type = LLVMFunctionType(i32_t, NULL, 0, 0);
-    LLVMValueRef time_func = LLVMAddFunction(module, "__cplus_time_", time_type);
-    add_global_var("__cplus_time_", time_func, time_type, TYPE_INT, 0, 0);
+    // align(N) rounds the size up too, so every element of an array of them stays aligned
+    int element_count = def->field_count;
+    if (def->alignment > 0) {
+        const unsigned long long size = LLVMABISizeOfType(data_layout, LLVMStructTypeInContext(context, elements, element_count, packed));
+        const unsigned long long padding = (def->alignment - size % def->alignment) % def->alignment;
+        if (padding > 0) {
+            elements[element_count++] = LLVMArrayType(LLVMInt8TypeInContext(context), padding);
+        }
+    }
 
-    LLVMTypeRef seed_args[] = { i32_t };
-    LLVMTypeRef seed_type = LLVMFunctionType(void_t, seed_args, 1, 0);
-    LLVMValueRef seed_func = LLVMAddFunction(module, "__cplus_seed_", seed_type);
-    add_global_var("__cplus_seed_", seed_func, seed_type, TYPE_VOID, 0, 0);
+    LLVMStructSetBody(layout->type, elements, element_count, packed);
 
-    LLVMTypeRef sqrt_args[] = { float_t };
-    LLVMTypeRef sqrt_type = LLVMFunctionType(float_t, sqrt_args, 1, 0);
-    LLVMValueRef sqrt_func = LLVMAddFunction(module, "__cplus_sqrt_", sqrt_type);
-    add_global_var("__cplus_sqrt_", sqrt_func, sqrt_type, TYPE_FLOAT, 0, 0);
+    free(elements);
+    free(order);
+    free(field_types);
+    return layout;
+}
 
-    LLVMTypeRef pow_args[] = { float_t, float_t };
-    LLVMTypeRef pow_type = LLVMFunctionType(float_t, pow_args, 2, 0);
-    LLVMValueRef pow_func = LLVMAddFunction(module, "__cplus_pow_", pow_type);
-    add_global_var("__cplus_pow_", pow_func, pow_type, TYPE_FLOAT, 0, 0);
+static LLVMTypeRef struct_llvm_type(const TypeKind type) {
+    return struct_layout(type)->type;
+}
 
-    LLVMTypeRef sys_args[] = { str_t };
-    LLVMTypeRef sys_type = LLVMFunctionType(i32_t, sys_args, 1, 0);
-    LLVMValueRef sys_func = LLVMAddFunction(module, "__cplus_system_", sys_type);
-    add_global_var("__cplus_system_", sys_func, sys_type, TYPE_INT, 0, 0);
+// storage for a struct gets at least its align(N), arrays of them included
+static void set_storage_alignment(LLVMValueRef storage, const TypeKind type, const int pointer_level) {
+    if (!is_struct_type(type) || pointer_level > 0) return;
 
-    LLVMTypeRef panic_args[] = { str_t };
-    LLVMTypeRef panic_type = LLVMFunctionType(void_t, panic_args, 1, 0);
-    LLVMValueRef panic_func = LLVMAddFunction(module, "__cplus_panic_", panic_type);
-    add_global_var("__cplus_panic_", panic_func, panic_type, TYPE_VOID, 0, 0);
+    const StructNode *def = struct_type_def(type);
+    if (def->alignment > (int)LLVMABIAlignmentOfType(LLVMGetModuleDataLayout(module), struct_llvm_type(type))) {
+        LLVMSetAlignment(storage, def->alignment);
+    }
+}
 
-    LLVMTypeRef memcpy_args[] = { void_ptr_t, void_ptr_t, i32_t };
-    LLVMTypeRef memcpy_type = LLVMFunctionType(void_t, memcpy_args, 3, 0);
-    LLVMValueRef memcpy_func = LLVMAddFunction(module, "__cplus_memcpy_", memcpy_type);
-    add_global_var("__cplus_memcpy_", memcpy_func, memcpy_type, TYPE_VOID, 0, 0);
+// align(N) on a declaration only ever raises the alignment
+static void set_declared_alignment(LLVMValueRef storage, const int alignment) {
+    if (alignment > (int)LLVMGetAlignment(storage)) {
+        LLVMSetAlignment(storage, alignment);
+    }
+}
 
-    LLVMTypeRef memset_args[] = { void_ptr_t, i32_t, i32_t };
-    LLVMTypeRef memset_type = LLVMFunctionType(void_t, memset_args, 3, 0);
-    LLVMValueRef memset_func = LLVMAddFunction(module, "__cplus_memset_", memset_type);
-    add_global_var("__cplus_memset_", memset_func, memset_type, TYPE_VOID, 0, 0);
+static LLVMValueRef build_struct_slot(const TypeKind type, const char *name) {
+    LLVMValueRef slot = build_entry_alloca(struct_llvm_type(type), name);
+    set_storage_alignment(slot, type, 0);
+    return slot;
+}
 
-    LLVMTypeRef realloc_args[] = { void_ptr_t, i32_t };
-    LLVMTypeRef realloc_type = LLVMFunctionType(void_ptr_t, realloc_args, 2, 0);
-    LLVMValueRef realloc_func = LLVMAddFunction(module, "__cplus_realloc_", realloc_type);
+// soa Type[N] is a struct of N-element arrays, one per field in declaration order
+static LLVMTypeRef soa_llvm_type(const TypeKind type, const int array_size) {
+    const StructNode *def = struct_type_def(type);
+    LLVMTypeRef *arrays = malloc(sizeof(LLVMTypeRef) * def->field_count);
+    for (int i = 0; i < def->field_count; i++) {
+        arrays[i] = LLVMArrayType(get_llvm_field_type(&def->fields[i]), array_size);
+    }
 
-    add_global_var("__cplus_realloc_", realloc_func, realloc_type, TYPE_VOID, 1, 0);
+    LLVMTypeRef soa_type = LLVMStructTypeInContext(context, arrays, def->field_count, 0);
+    free(arrays);
+    return soa_type;
 }
 
-static LLVMValueRef codegen_lvalue_address(const ExprNode *expr) {
-    if (expr->kind == EXPR_VAR) {
-        const LLVMValueRef var = lookup_var(expr->text);
-        if (!var) {
-            fprintf(stderr, "Codegen error: Undefined variable '%s'\n", expr->text);
-            exit(1);
-        }
-        return var;
+// fields of packed structs can sit at any offset, so accesses through them only assume byte alignment
+static bool is_packed_member(const ExprNode *expr) {
+    if (expr->kind != EXPR_MEMBER) return false;
+
+    if (struct_type_def(expr->member.object->type)->attributes & STRUCT_ATTR_PACKED) {
+        return true;
     }
-    else if (expr->kind == EXPR_UNARY && expr->unary.op == UNARY_DEREF) {
-        return codegen_expression(expr->unary.operand);
+
+    return !expr->member.through_pointer && is_packed_member(expr->member.object);
+}
+
+static LLVMValueRef mark_packed_access(LLVMValueRef access, const ExprNode *lvalue) {
+    if (is_packed_member(lvalue)) {
+        LLVMSetAlignment(access, 1);
     }
-    else if (expr->kind == EXPR_ARRAY_INDEX) {
-        const ExprNode *array_expr = expr->array_index.array;
-        const ExprNode *index_expr = expr->array_index.index;
 
-        LLVMValueRef array_ptr;
-        if (array_expr->kind == EXPR_VAR) {
-            array_ptr = lookup_var(array_expr->text);
-        } else {
-            array_ptr = codegen_expression(array_expr);
-        }
+    return access;
+}
 
-        LLVMValueRef index_val = codegen_expression(index_expr);
+// restrict locals of the current function. each one gets an alias scope in a per-function domain, and
+// accesses through it are tagged with that scope and as noalias with the scopes of all the others.
+// restrict parameters use the noalias attribute instead, see add_param_attributes
+typedef struct {
+    const StmtNode *decl;
+    LLVMMetadataRef scope;
+} RestrictScope;
+
+static RestrictScope *restrict_scopes = NULL;
+static int restrict_scope_count = 0;
+static int restrict_scope_capacity = 0;
+
+// scope domains and scopes are distinct nodes that refer to themselves as the first operand
+static LLVMMetadataRef alias_scope_node(LLVMMetadataRef domain, const char *name) {
+    LLVMMetadataRef self = LLVMTemporaryMDNode(context, NULL, 0);
+    LLVMMetadataRef operands[3] = { self };
+    unsigned count = 1;
+
+    if (domain) operands[count++] = domain;
+    operands[count++] = LLVMMDStringInContext2(context, name, strlen(name));
+
+    LLVMMetadataRef node = LLVMMDNodeInContext2(context, operands, count);
+    LLVMMetadataReplaceAllUsesWith(self, node);
+    return node;
+}
 
-        CodegenSymbol *sym = NULL;
-        if (array_expr->kind == EXPR_VAR) {
-            sym = lookup_var_full(array_expr->text);
-        }
+static void collect_restrict_locals(const StmtNode *stmt) {
+    if (!stmt) return;
 
-        if (sym && sym->array_size > 0) {
-            LLVMTypeRef base_element_type = get_llvm_type_with_pointers(sym->type, sym->pointer_level - 1);
-            LLVMTypeRef array_type = LLVMArrayType(base_element_type, sym->array_size);
-            LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), index_val };
-            return LLVMBuildGEP2(builder, array_type, array_ptr, indices, 2, "arrayaddr");
-        } else {
-            LLVMTypeRef element_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
-            if (array_expr->kind == EXPR_VAR) {
-                LLVMTypeRef ptr_type = get_llvm_type_with_pointers(array_expr->type, array_expr->pointer_level);
-                array_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
+    switch (stmt->kind) {
+        case STMT_VAR_DECL:
+            if (stmt->var_decl.is_restrict) {
+                if (restrict_scope_count >= restrict_scope_capacity) {
+                    restrict_scope_capacity = restrict_scope_capacity == 0 ? 4 : restrict_scope_capacity * 2;
+                    restrict_scopes = realloc(restrict_scopes, sizeof(RestrictScope) * restrict_scope_capacity);
+                }
+                restrict_scopes[restrict_scope_count++] = (RestrictScope){ stmt, NULL };
             }
-
-            return LLVMBuildGEP2(builder, element_type, array_ptr, &index_val, 1, "arrayaddr");
-        }
+            break;
+        case STMT_IF:
+            collect_restrict_locals(stmt->if_stmt.then_stmt);
+            collect_restrict_locals(stmt->if_stmt.else_stmt);
+            break;
+        case STMT_WHILE:
+            collect_restrict_locals(stmt->while_stmt.body);
+            break;
+        case STMT_FOR:
+            collect_restrict_locals(stmt->for_stmt.init);
+            collect_restrict_locals(stmt->for_stmt.body);
+            break;
+        case STMT_SWITCH:
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    collect_restrict_locals(stmt->switch_stmt.cases[i].stmts[j]);
+                }
+            }
+            break;
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                collect_restrict_locals(stmt->compound.stmts[i]);
+            }
+            break;
+        default:
+            break;
     }
+}
 
-    fprintf(stderr, "Expression is not an lvalue\n");
-    exit(1);
+// scopes are made up front so an access can name restrict locals declared after it
+static void restrict_begin_function(const FunctionNode *func) {
+    restrict_scope_count = 0;
+    collect_restrict_locals(func->body);
+    if (restrict_scope_count == 0) return;
+
+    LLVMMetadataRef domain = alias_scope_node(NULL, func->name);
+    for (int i = 0; i < restrict_scope_count; i++) {
+        char name[256];
+        snprintf(name, sizeof(name), "%s: %s", func->name, restrict_scopes[i].decl->var_decl.name);
+        restrict_scopes[i].scope = alias_scope_node(domain, name);
+    }
 }
 
-static LLVMValueRef codegen_expression(const ExprNode* expr) {
-    if (!expr) {
-        fprintf(stderr, "Error: null expression in codegen\n");
-        exit(1);
+static LLVMMetadataRef restrict_scope_of(const StmtNode *decl) {
+    for (int i = 0; i < restrict_scope_count; i++) {
+        if (restrict_scopes[i].decl == decl) return restrict_scopes[i].scope;
     }
-    switch (expr->kind) {
-        case EXPR_NUMBER: {
-            if (expr->type == TYPE_FLOAT) {
-                float value = atof(expr->text);
-                return LLVMConstReal(LLVMFloatTypeInContext(context), value);
-            }
 
-            if (expr->type == TYPE_DOUBLE) {
-                double value = atof(expr->text);
-                return LLVMConstReal(LLVMDoubleTypeInContext(context), value);
-            }
+    return NULL;
+}
 
-            if (expr->type == TYPE_CHAR) {
-                const int value = atoi(expr->text);
-                return LLVMConstInt(LLVMInt8TypeInContext(context), value, 0);
-            }
+// p[i], *p, *(p + i) and p->field where p is a restrict local
+static const CodegenSymbol* restrict_base(const ExprNode *lvalue) {
+    const ExprNode *base = NULL;
+    if (lvalue->kind == EXPR_ARRAY_INDEX) {
+        base = lvalue->array_index.array;
+    } else if (lvalue->kind == EXPR_UNARY && lvalue->unary.op == UNARY_DEREF) {
+        base = lvalue->unary.operand;
+    } else if (lvalue->kind == EXPR_MEMBER && lvalue->member.through_pointer) {
+        base = lvalue->member.object;
+    }
 
-            if (expr->type == TYPE_LONG) {
-                const long value = atol(expr->text);
-                return LLVMConstInt(LLVMInt64TypeInContext(context), value, 0);
-            }
+    if (base && base->kind == EXPR_BINOP && (base->binop.op == BIN_ADD || base->binop.op == BIN_SUB)) {
+        base = base->binop.left;
+    }
 
-            const int value = atoi(expr->text);
-            return LLVMConstInt(LLVMInt32TypeInContext(context), value, 0);
-        }
-        case EXPR_STRING_LITERAL: {
-            // create a global string constant
-            LLVMValueRef str_const = LLVMBuildGlobalStringPtr(builder, expr->text, "strtmp");
-            return str_const;
-        }
-        case EXPR_VAR: {
-            CodegenSymbol *sym = lookup_var_full(expr->text);
+    if (!base || base->kind != EXPR_VAR) return NULL;
 
-            if (!sym) {
-                fprintf(stderr, "Codegen error: undefined variable '%s'\n", expr->text);
-                exit(1);
-            }
+    const CodegenSymbol *sym = lookup_var_full(base->text);
+    return sym && sym->alias_scope ? sym : NULL;
+}
 
-            LLVMValueRef var = sym->value;
+static LLVMValueRef mark_restrict_access(LLVMValueRef access, const ExprNode *lvalue) {
+    const CodegenSymbol *sym = restrict_base(lvalue);
+    if (!sym) return access;
 
-            // If it is a stack array, decay to pointer to first element
-            if (sym->array_size > 0) {
-                LLVMTypeRef element_type = get_llvm_type_with_pointers(sym->type, sym->pointer_level - 1);
-                LLVMTypeRef array_type = LLVMArrayType(element_type, sym->array_size);
+    LLVMMetadataRef own = sym->alias_scope;
+    LLVMSetMetadata(access, LLVMGetMDKindIDInContext(context, "alias.scope", strlen("alias.scope")),
+                    LLVMMetadataAsValue(context, LLVMMDNodeInContext2(context, &own, 1)));
 
-                LLVMValueRef indices[2];
-                indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
-                indices[1] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+    LLVMMetadataRef *others = malloc(sizeof(LLVMMetadataRef) * restrict_scope_count);
+    int other_count = 0;
+    for (int i = 0; i < restrict_scope_count; i++) {
+        if (restrict_scopes[i].scope != own) others[other_count++] = restrict_scopes[i].scope;
+    }
+
+    if (other_count > 0) {
+        LLVMSetMetadata(access, LLVMGetMDKindIDInContext(context, "noalias", strlen("noalias")),
+                        LLVMMetadataAsValue(context, LLVMMDNodeInContext2(context, others, other_count)));
+    }
+
+    free(others);
+    return access;
+}
+
+// everything about a load or store that depends on how its lvalue was reached
+static LLVMValueRef mark_access(LLVMValueRef access, const ExprNode *lvalue) {
+    return mark_restrict_access(mark_packed_access(access, lvalue), lvalue);
+}
+
+// x86-64 sysv: structs of up to 16 bytes travel as one or two eightbytes in integer or sse registers, anything
+// larger (or with unaligned packed fields) goes through memory, byval for parameters and sret for return values
+typedef struct {
+    bool in_memory;
+    LLVMTypeRef parts[2];
+    int part_count;
+} StructAbi;
+
+// classes: 0 nothing yet, 1 sse, 2 integer. integer wins when an eightbyte mixes both
+static void classify_eightbytes(LLVMTypeRef type, const unsigned long long offset, int classes[2], bool doubles[2], bool high_floats[2], bool *in_memory) {
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+
+    switch (LLVMGetTypeKind(type)) {
+        case LLVMStructTypeKind: {
+            const unsigned count = LLVMCountStructElementTypes(type);
+            for (unsigned i = 0; i < count; i++) {
+                LLVMTypeRef element = LLVMStructGetTypeAtIndex(type, i);
+                const unsigned long long element_offset = offset + LLVMOffsetOfElement(data_layout, type, i);
+                if (element_offset % LLVMABIAlignmentOfType(data_layout, element) != 0) {
+                    *in_memory = true;
+                }
+
+                classify_eightbytes(element, element_offset, classes, doubles, high_floats, in_memory);
+            }
+            break;
+        }
+        case LLVMArrayTypeKind: {
+            LLVMTypeRef element = LLVMGetElementType(type);
+            const unsigned long long size = LLVMABISizeOfType(data_layout, element);
+            for (unsigned i = 0; i < LLVMGetArrayLength(type); i++) {
+                classify_eightbytes(element, offset + i * size, classes, doubles, high_floats, in_memory);
+            }
+            break;
+        }
+        case LLVMFloatTypeKind:
+        case LLVMDoubleTypeKind: {
+            const int eightbyte = (int)(offset / 8);
+            if (classes[eightbyte] == 0) classes[eightbyte] = 1;
+            if (LLVMGetTypeKind(type) == LLVMDoubleTypeKind) doubles[eightbyte] = true;
+            if (offset % 8 >= 4) high_floats[eightbyte] = true;
+            break;
+        }
+        case LLVMVectorTypeKind: {
+            // vector fields need the sseup class, keep it simple and pass those in memory
+            *in_memory = true;
+            break;
+        }
+        default: {
+            classes[offset / 8] = 2;
+            break;
+        }
+    }
+}
+
+static StructAbi struct_abi(const TypeKind type) {
+    StructAbi abi = { .in_memory = false, .part_count = 0 };
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+    LLVMTypeRef llvm_type = struct_llvm_type(type);
+    const unsigned long long size = LLVMABISizeOfType(data_layout, llvm_type);
+
+    // over-aligned structs carry tail padding that classification would mistake for data
+    if (size > 16 || struct_type_def(type)->alignment > (int)LLVMABIAlignmentOfType(data_layout, llvm_type)) {
+        abi.in_memory = true;
+        return abi;
+    }
+
+    int classes[2] = { 0, 0 };
+    bool doubles[2] = { false, false };
+    bool high_floats[2] = { false, false };
+    classify_eightbytes(llvm_type, 0, classes, doubles, high_floats, &abi.in_memory);
+    if (abi.in_memory) return abi;
+
+    abi.part_count = (int)((size + 7) / 8);
+    for (int i = 0; i < abi.part_count; i++) {
+        const unsigned long long bytes = size - i * 8 < 8 ? size - i * 8 : 8;
+
+        if (classes[i] == 1) {
+            if (doubles[i]) abi.parts[i] = LLVMDoubleTypeInContext(context);
+            else if (high_floats[i]) abi.parts[i] = LLVMVectorType(LLVMFloatTypeInContext(context), 2);
+            else abi.parts[i] = LLVMFloatTypeInContext(context);
+        } else {
+            abi.parts[i] = LLVMIntTypeInContext(context, bytes * 8);
+        }
+    }
+
+    return abi;
+}
+
+static LLVMTypeRef struct_abi_register_type(const StructAbi *abi) {
+    if (abi->part_count == 1) return abi->parts[0];
+    return LLVMStructTypeInContext(context, (LLVMTypeRef*)abi->parts, abi->part_count, 0);
+}
+
+static bool is_struct_value(const TypeKind type, const int pointer_level) {
+    return is_struct_type(type) && pointer_level == 0;
+}
+
+// reinterprets a value as another type of similar size through a stack slot big enough for both
+static LLVMValueRef coerce_through_memory(LLVMValueRef value, LLVMTypeRef to_type) {
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+    LLVMTypeRef from_type = LLVMTypeOf(value);
+    LLVMTypeRef slot_type = LLVMABISizeOfType(data_layout, from_type) >= LLVMABISizeOfType(data_layout, to_type) ? from_type : to_type;
+
+    LLVMValueRef slot = build_entry_alloca(slot_type, "coerce");
+    const unsigned from_align = LLVMABIAlignmentOfType(data_layout, from_type);
+    const unsigned to_align = LLVMABIAlignmentOfType(data_layout, to_type);
+    LLVMSetAlignment(slot, from_align > to_align ? from_align : to_align);
+
+    LLVMBuildStore(builder, value, LLVMBuildBitCast(builder, slot, LLVMPointerType(from_type, 0), ""));
+    return LLVMBuildLoad2(builder, to_type, LLVMBuildBitCast(builder, slot, LLVMPointerType(to_type, 0), ""), "coerced");
+}
+
+static bool function_passes_structs(const FunctionNode *func) {
+    if (is_struct_value(func->return_type, func->return_pointer_level)) return true;
+
+    for (int i = 0; i < func->param_count; i++) {
+        if (is_struct_value(func->params[i].type, func->params[i].pointer_level)) return true;
+    }
+
+    return false;
+}
+
+// the llvm signature of a function once struct parameters and return values are lowered
+static LLVMTypeRef function_llvm_type(const FunctionNode *func) {
+    LLVMTypeRef *param_types = malloc(sizeof(LLVMTypeRef) * (func->param_count * 2 + 1));
+    int count = 0;
+
+    LLVMTypeRef ret_type = get_llvm_value_type(func->return_type, func->return_pointer_level, func->returns_slice);
+    if (is_struct_value(func->return_type, func->return_pointer_level)) {
+        const StructAbi abi = struct_abi(func->return_type);
+        if (abi.in_memory) {
+            param_types[count++] = LLVMPointerType(ret_type, 0);
+            ret_type = LLVMVoidTypeInContext(context);
+        } else {
+            ret_type = struct_abi_register_type(&abi);
+        }
+    }
+
+    for (int i = 0; i < func->param_count; i++) {
+        const ParamNode *param = &func->params[i];
+        LLVMTypeRef param_type = param_llvm_type(param);
+
+        if (!is_struct_value(param->type, param->pointer_level)) {
+            param_types[count++] = param_type;
+            continue;
+        }
+
+        const StructAbi abi = struct_abi(param->type);
+        if (abi.in_memory) {
+            param_types[count++] = LLVMPointerType(param_type, 0);
+        } else {
+            for (int j = 0; j < abi.part_count; j++) {
+                param_types[count++] = abi.parts[j];
+            }
+        }
+    }
+
+    LLVMTypeRef func_type = LLVMFunctionType(ret_type, param_types, count, 0);
+    free(param_types);
+    return func_type;
+}
+
+static void add_abi_attribute(LLVMValueRef value, const bool is_call, const unsigned index, const char *name, LLVMTypeRef type, const unsigned long long int_value) {
+    const unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name));
+    LLVMAttributeRef attribute = type ? LLVMCreateTypeAttribute(context, kind, type) : LLVMCreateEnumAttribute(context, kind, int_value);
+
+    if (is_call) {
+        LLVMAddCallSiteAttribute(value, index, attribute);
+    } else {
+        LLVMAddAttributeAtIndex(value, index, attribute);
+    }
+}
+
+// sret and byval markers, on the function and again on each call to it, and noalias on restrict pointers and align on aligned ones
+static void add_param_attributes(LLVMValueRef value, const FunctionNode *func, const bool is_call) {
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+    unsigned index = 1;  // attribute index 0 is the return value
+
+    if (is_struct_value(func->return_type, func->return_pointer_level) && struct_abi(func->return_type).in_memory) {
+        add_abi_attribute(value, is_call, index, "sret", struct_llvm_type(func->return_type), 0);
+        add_abi_attribute(value, is_call, index, "noalias", NULL, 0);
+        index++;
+    }
+
+    for (int i = 0; i < func->param_count; i++) {
+        const ParamNode *param = &func->params[i];
+        if (!is_struct_value(param->type, param->pointer_level)) {
+            if (param->is_restrict && !is_call) {
+                add_abi_attribute(value, is_call, index, "noalias", NULL, 0);
+            }
+
+            // align(N) pointers let the optimizer use aligned vector loads and stores through them
+            if (param->alignment > 0 && param->pointer_level > 0 && !param->is_slice && !is_call) {
+                add_abi_attribute(value, is_call, index, "align", NULL, param->alignment);
+            }
+            index++;
+            continue;
+        }
+
+        const StructAbi abi = struct_abi(param->type);
+        if (!abi.in_memory) {
+            index += abi.part_count;
+            continue;
+        }
+
+        LLVMTypeRef struct_type = struct_llvm_type(param->type);
+        const unsigned natural = LLVMABIAlignmentOfType(data_layout, struct_type);
+        const unsigned alignment = (unsigned)struct_type_def(param->type)->alignment;
+        const unsigned byval_alignment = alignment > natural ? alignment : (natural < 8 ? 8 : natural);
+        add_abi_attribute(value, is_call, index, "byval", struct_type, 0);
+        add_abi_attribute(value, is_call, index, "align", NULL, byval_alignment);
+        index++;
+    }
+}
+
+// inlining and placement qualifiers. hot and cold functions go in the sections the linker groups together,
+// so cold error paths dont share cache lines and pages with the code that runs all the time
+static void add_function_attributes(LLVMValueRef llvm_func, const FunctionNode *func) {
+    static const struct {
+        FunctionAttribute flag;
+        const char *kind;
+    } attributes[] = {
+        {FUNC_ATTR_INLINE, "inlinehint"},
+        {FUNC_ATTR_ALWAYS_INLINE, "alwaysinline"},
+        {FUNC_ATTR_NOINLINE, "noinline"},
+        {FUNC_ATTR_HOT, "hot"},
+        {FUNC_ATTR_COLD, "cold"},
+    };
+
+    for (size_t i = 0; i < sizeof(attributes) / sizeof(attributes[0]); i++) {
+        if (func->attributes & attributes[i].flag) {
+            add_abi_attribute(llvm_func, false, LLVMAttributeFunctionIndex, attributes[i].kind, NULL, 0);
+        }
+    }
+
+    if (func->attributes & FUNC_ATTR_HOT) {
+        LLVMSetSection(llvm_func, ".text.hot");
+    } else if (func->attributes & FUNC_ATTR_COLD) {
+        LLVMSetSection(llvm_func, ".text.unlikely");
+    }
+}
+
+static LLVMMetadataRef debug_file(const char *filename) {
+    if (!filename) filename = options.source_file;
+
+    for (int i = 0; i < di_file_count; i++) {
+        if (strcmp(di_files[i].filename, filename) == 0) {
+            return di_files[i].file;
+        }
+    }
+
+    // split into directory and file name
+    const char *base = strrchr(filename, '/');
+    const char *name = base ? base + 1 : filename;
+    const size_t dir_len = base ? (size_t)(base - filename) : 1;
+    const char *dir = base ? filename : ".";
+
+    if (di_file_count >= di_file_capacity) {
+        di_file_capacity = di_file_capacity == 0 ? 8 : di_file_capacity * 2;
+        di_files = realloc(di_files, sizeof(DebugFile) * di_file_capacity);
+    }
+
+    di_files[di_file_count].filename = strdup(filename);
+    di_files[di_file_count].file = LLVMDIBuilderCreateFile(di_builder, name, strlen(name), dir, dir_len);
+    return di_files[di_file_count++].file;
+}
+
+static LLVMMetadataRef debug_type(const TypeKind type, const int pointer_level) {
+    if (type == TYPE_STRING) {
+        return LLVMDIBuilderCreatePointerType(di_builder, debug_type(TYPE_CHAR, pointer_level), 64, 0, 0, "string", 6);
+    }
+
+    if (pointer_level > 0) {
+        return LLVMDIBuilderCreatePointerType(di_builder, debug_type(type, pointer_level - 1), 64, 0, 0, NULL, 0);
+    }
+
+    if (is_vector_type(type)) {
+        const int lanes = vector_lane_count(type);
+        LLVMMetadataRef subrange = LLVMDIBuilderGetOrCreateSubrange(di_builder, 0, lanes);
+        return LLVMDIBuilderCreateVectorType(di_builder, lanes * 32, lanes * 4 * 8, debug_type(vector_element_type(type), 0), &subrange, 1);
+    }
+
+    if (is_struct_type(type)) {
+        return debug_struct_type(type);
+    }
+
+    switch (type) {
+        case TYPE_INT:     return LLVMDIBuilderCreateBasicType(di_builder, "int", 3, 32, DW_ATE_SIGNED, LLVMDIFlagZero);
+        case TYPE_LONG:    return LLVMDIBuilderCreateBasicType(di_builder, "long", 4, 64, DW_ATE_SIGNED, LLVMDIFlagZero);
+        case TYPE_CHAR:    return LLVMDIBuilderCreateBasicType(di_builder, "char", 4, 8, DW_ATE_SIGNED_CHAR, LLVMDIFlagZero);
+        case TYPE_UINT:    return LLVMDIBuilderCreateBasicType(di_builder, "uint", 4, 32, DW_ATE_UNSIGNED, LLVMDIFlagZero);
+        case TYPE_ULONG:   return LLVMDIBuilderCreateBasicType(di_builder, "ulong", 5, 64, DW_ATE_UNSIGNED, LLVMDIFlagZero);
+        case TYPE_BYTE:    return LLVMDIBuilderCreateBasicType(di_builder, "byte", 4, 8, DW_ATE_UNSIGNED, LLVMDIFlagZero);
+        case TYPE_FLOAT:   return LLVMDIBuilderCreateBasicType(di_builder, "float", 5, 32, DW_ATE_FLOAT, LLVMDIFlagZero);
+        case TYPE_DOUBLE:  return LLVMDIBuilderCreateBasicType(di_builder, "double", 6, 64, DW_ATE_FLOAT, LLVMDIFlagZero);
+        case TYPE_BOOLEAN: return LLVMDIBuilderCreateBasicType(di_builder, "bool", 4, 8, DW_ATE_BOOLEAN, LLVMDIFlagZero);
+        default:           return NULL;  // void
+    }
+}
+
+static LLVMMetadataRef debug_array_type(const TypeKind type, const int pointer_level, const int array_size, LLVMTypeRef llvm_type) {
+    LLVMMetadataRef subrange = LLVMDIBuilderGetOrCreateSubrange(di_builder, 0, array_size);
+    const uint64_t size_bits = LLVMSizeOfTypeInBits(LLVMGetModuleDataLayout(module), llvm_type);
+    return LLVMDIBuilderCreateArrayType(di_builder, size_bits, 0, debug_type(type, pointer_level), &subrange, 1);
+}
+
+// one subrange per dimension, outermost first
+static LLVMMetadataRef debug_nested_array_type(const TypeKind type, const int pointer_level, const int *dims, const int dim_count, LLVMTypeRef llvm_type) {
+    LLVMMetadataRef *subranges = malloc(sizeof(LLVMMetadataRef) * dim_count);
+    for (int i = 0; i < dim_count; i++) {
+        subranges[i] = LLVMDIBuilderGetOrCreateSubrange(di_builder, 0, dims[i]);
+    }
+
+    const uint64_t size_bits = LLVMSizeOfTypeInBits(LLVMGetModuleDataLayout(module), llvm_type);
+    LLVMMetadataRef array_type = LLVMDIBuilderCreateArrayType(di_builder, size_bits, 0, debug_type(type, pointer_level), subranges, dim_count);
+    free(subranges);
+    return array_type;
+}
+
+static LLVMMetadataRef debug_slice_type(const TypeKind type, const int pointer_level) {
+    LLVMMetadataRef file = debug_file(NULL);
+    LLVMMetadataRef members[2] = {
+        LLVMDIBuilderCreateMemberType(di_builder, di_compile_unit, "ptr", 3, file, 0, 64, 0, 0, LLVMDIFlagZero, debug_type(type, pointer_level)),
+        LLVMDIBuilderCreateMemberType(di_builder, di_compile_unit, "len", 3, file, 0, 64, 0, 64, LLVMDIFlagZero, debug_type(TYPE_LONG, 0)),
+    };
+
+    return LLVMDIBuilderCreateStructType(di_builder, di_compile_unit, "slice", 5, file, 0, 128, 64, LLVMDIFlagZero, NULL, members, 2, 0, NULL, "", 0);
+}
+
+static LLVMMetadataRef debug_struct_type(const TypeKind type) {
+    StructLayout *layout = &struct_layouts[type - TYPE_STRUCT];
+    if (layout->debug) return layout->debug;
+
+    const StructNode *def = struct_type_def(type);
+    LLVMTargetDataRef data_layout = LLVMGetModuleDataLayout(module);
+    LLVMTypeRef llvm_type = struct_llvm_type(type);
+    LLVMMetadataRef file = debug_file(def->location.filename);
+    const size_t name_len = strlen(def->name);
+
+    // placeholder first, so a field pointing back at the struct finds it
+    layout->debug = LLVMDIBuilderCreateReplaceableCompositeType(di_builder, 0x13 /* DW_TAG_structure_type */, def->name, name_len,
+                                                                di_compile_unit, file, def->location.line, 0, 0, 0, LLVMDIFlagFwdDecl, "", 0);
+    LLVMMetadataRef placeholder = layout->debug;
+
+    LLVMMetadataRef *members = malloc(sizeof(LLVMMetadataRef) * def->field_count);
+    for (int i = 0; i < def->field_count; i++) {
+        const FieldNode *field = &def->fields[i];
+        LLVMTypeRef field_type = get_llvm_field_type(field);
+        LLVMMetadataRef member_type = field->array_size > 0
+            ? debug_array_type(field->type, field->pointer_level, field->array_size, field_type)
+            : debug_type(field->type, field->pointer_level);
+
+        members[i] = LLVMDIBuilderCreateMemberType(di_builder, placeholder, field->name, strlen(field->name), file, field->location.line,
+                                                   LLVMSizeOfTypeInBits(data_layout, field_type), 0,
+                                                   LLVMOffsetOfElement(data_layout, llvm_type, layout->slots[i]) * 8,
+                                                   LLVMDIFlagZero, member_type);
+    }
+
+    layout->debug = LLVMDIBuilderCreateStructType(di_builder, di_compile_unit, def->name, name_len, file, def->location.line,
+                                                  LLVMSizeOfTypeInBits(data_layout, llvm_type), LLVMABIAlignmentOfType(data_layout, llvm_type) * 8,
+                                                  LLVMDIFlagZero, NULL, members, def->field_count, 0, NULL, "", 0);
+    LLVMMetadataReplaceAllUsesWith(placeholder, layout->debug);
+
+    free(members);
+    return layout->debug;
+}
+
+// every instruction built after this gets attributed to loc, until the next call
+static void debug_set_location(const SourceLocation loc) {
+    if (!di_builder || !di_scope) return;
+
+    LLVMMetadataRef location = LLVMDIBuilderCreateDebugLocation(context, loc.line, loc.column, di_scope, NULL);
+    LLVMSetCurrentDebugLocation2(builder, location);
+}
+
+static void debug_declare_variable(LLVMValueRef storage, const char *name, LLVMMetadataRef type, const SourceLocation loc, const int arg_no) {
+    if (!di_builder || !di_scope) return;
+
+    LLVMMetadataRef file = debug_file(loc.filename);
+    LLVMMetadataRef var;
+    if (arg_no > 0) {
+        var = LLVMDIBuilderCreateParameterVariable(di_builder, di_scope, name, strlen(name), arg_no, file, loc.line, type, 1, LLVMDIFlagZero);
+    } else {
+        var = LLVMDIBuilderCreateAutoVariable(di_builder, di_scope, name, strlen(name), file, loc.line, type, 1, LLVMDIFlagZero, 0);
+    }
+
+    LLVMMetadataRef location = LLVMDIBuilderCreateDebugLocation(context, loc.line, loc.column, di_scope, NULL);
+    LLVMDIBuilderInsertDeclareAtEnd(di_builder, storage, var, LLVMDIBuilderCreateExpression(di_builder, NULL, 0), location, LLVMGetInsertBlock(builder));
+}
+
+// the profile file is plain text, one line per function: "<name> <counter count> <counters...>".
+// records of the same function from several runs are summed, mismatching layouts are dropped
+static void profile_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: cannot open profile '%s'\n", path);
+        exit(1);
+    }
+
+    char name[512];
+    int count;
+    while (fscanf(file, "%511s %d", name, &count) == 2) {
+        if (count <= 0) continue;
+
+        unsigned long long *counts = malloc(sizeof(unsigned long long) * count);
+        for (int i = 0; i < count; i++) {
+            if (fscanf(file, "%llu", &counts[i]) != 1) {
+                fprintf(stderr, "Error: truncated profile record for '%s' in '%s'\n", name, path);
+                exit(1);
+            }
+        }
+
+        ProfileRecord *existing = NULL;
+        for (int i = 0; i < prof_record_count; i++) {
+            if (strcmp(prof_records[i].name, name) == 0) {
+                existing = &prof_records[i];
+                break;
+            }
+        }
+
+        if (!existing) {
+            prof_records = realloc(prof_records, sizeof(ProfileRecord) * (prof_record_count + 1));
+            prof_records[prof_record_count++] = (ProfileRecord){ strdup(name), counts, count };
+            continue;
+        }
+
+        if (existing->count == count) {
+            for (int i = 0; i < count; i++) {
+                existing->counts[i] += counts[i];
+            }
+        } else {
+            fprintf(stderr, "Warning: profile for '%s' has an inconsistent layout, ignoring it\n", name);
+            existing->count = 0;
+        }
+
+        free(counts);
+    }
+
+    fclose(file);
+}
+
+static const ProfileRecord* profile_lookup(const char *name, const int count) {
+    for (int i = 0; i < prof_record_count; i++) {
+        if (strcmp(prof_records[i].name, name) == 0) {
+            // a different layout means the source changed since the profile was collected
+            return prof_records[i].count == count ? &prof_records[i] : NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static int count_branch_sites(const StmtNode *stmt) {
+    if (!stmt) return 0;
+
+    switch (stmt->kind) {
+        case STMT_IF:
+            return 1 + count_branch_sites(stmt->if_stmt.then_stmt) + count_branch_sites(stmt->if_stmt.else_stmt);
+        case STMT_WHILE:
+            return 1 + count_branch_sites(stmt->while_stmt.body);
+        case STMT_FOR:
+            return (stmt->for_stmt.condition || stmt->for_stmt.range ? 1 : 0) + count_branch_sites(stmt->for_stmt.body);
+        case STMT_SWITCH: {
+            int count = 0;
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    count += count_branch_sites(stmt->switch_stmt.cases[i].stmts[j]);
+                }
+            }
+            return count;
+        }
+        case STMT_COMPOUND: {
+            int count = 0;
+            for (int i = 0; i < stmt->compound.count; i++) {
+                count += count_branch_sites(stmt->compound.stmts[i]);
+            }
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+static void profile_increment(LLVMValueRef index) {
+    LLVMTypeRef i64_t = LLVMInt64TypeInContext(context);
+
+    LLVMValueRef indices[2];
+    indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+    indices[1] = index;
+
+    LLVMValueRef counter = LLVMBuildInBoundsGEP2(builder, LLVMGlobalGetValueType(prof_counters), prof_counters, indices, 2, "prof_counter");
+    LLVMValueRef value = LLVMBuildLoad2(builder, i64_t, counter, "prof_count");
+    LLVMBuildStore(builder, LLVMBuildAdd(builder, value, LLVMConstInt(i64_t, 1, 0), "prof_inc"), counter);
+}
+
+static LLVMValueRef profile_metadata(const char *kind, const unsigned long long *values, const int count, LLVMTypeRef value_type) {
+    LLVMMetadataRef *operands = malloc(sizeof(LLVMMetadataRef) * (count + 1));
+    operands[0] = LLVMMDStringInContext2(context, kind, strlen(kind));
+    for (int i = 0; i < count; i++) {
+        operands[i + 1] = LLVMValueAsMetadata(LLVMConstInt(value_type, values[i], 0));
+    }
+
+    LLVMMetadataRef node = LLVMMDNodeInContext2(context, operands, count + 1);
+    free(operands);
+    return LLVMMetadataAsValue(context, node);
+}
+
+// +1 when the condition is wrapped in likely(), -1 for unlikely(), 0 otherwise
+static int branch_hint(const ExprNode *cond) {
+    if (!cond || cond->kind != EXPR_CALL) return 0;
+    if (cond->call.intrinsic == INTRINSIC_LIKELY) return 1;
+    if (cond->call.intrinsic == INTRINSIC_UNLIKELY) return -1;
+    return 0;
+}
+
+// all conditional branches of the language go through here, so they can be counted and weighted.
+// a collected profile beats a likely/unlikely hint, the hint uses the same 2000:1 split as clang
+static LLVMValueRef build_cond_br(LLVMValueRef cond, const ExprNode *cond_expr, LLVMBasicBlockRef then_block, LLVMBasicBlockRef else_block) {
+    const int site = prof_branch_site++;
+    release_string_temps();
+
+    if (prof_counters) {
+        LLVMTypeRef i32_t = LLVMInt32TypeInContext(context);
+        LLVMValueRef taken = LLVMBuildZExt(builder, cond, i32_t, "prof_taken");
+        profile_increment(LLVMBuildAdd(builder, taken, LLVMConstInt(i32_t, 1 + 2 * site, 0), "prof_index"));
+    }
+
+    LLVMValueRef branch = LLVMBuildCondBr(builder, cond, then_block, else_block);
+
+    if (prof_record) {
+        // weights are in successor order and have to fit in 32 bits
+        unsigned long long weights[2] = { prof_record->counts[2 + 2 * site], prof_record->counts[1 + 2 * site] };
+        for (int i = 0; i < 2; i++) {
+            if (weights[i] > UINT32_MAX) weights[i] = UINT32_MAX;
+        }
+
+        LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(context, "prof", 4),
+                        profile_metadata("branch_weights", weights, 2, LLVMInt32TypeInContext(context)));
+    } else if (branch_hint(cond_expr) != 0) {
+        const unsigned long long weights[2] = { branch_hint(cond_expr) > 0 ? 2000 : 1, branch_hint(cond_expr) > 0 ? 1 : 2000 };
+        LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(context, "prof", 4),
+                        profile_metadata("branch_weights", weights, 2, LLVMInt32TypeInContext(context)));
+    }
+
+    return branch;
+}
+
+static void profile_begin_function(const FunctionNode *func, LLVMValueRef llvm_func) {
+    prof_branch_site = 0;
+    prof_counters = NULL;
+    prof_record = NULL;
+
+    const int count = 1 + 2 * count_branch_sites(func->body);
+
+    if (options.profile_generate) {
+        char name[256];
+        snprintf(name, sizeof(name), "__cplus_prof_%s", func->name);
+
+        LLVMTypeRef counters_type = LLVMArrayType(LLVMInt64TypeInContext(context), count);
+        prof_counters = LLVMAddGlobal(module, counters_type, name);
+        LLVMSetInitializer(prof_counters, LLVMConstNull(counters_type));
+        LLVMSetLinkage(prof_counters, LLVMPrivateLinkage);
+
+        if (prof_function_count >= prof_function_capacity) {
+            prof_function_capacity = prof_function_capacity == 0 ? 16 : prof_function_capacity * 2;
+            prof_functions = realloc(prof_functions, sizeof(ProfileCounters) * prof_function_capacity);
+        }
+
+        prof_functions[prof_function_count++] = (ProfileCounters){ strdup(func->name), prof_counters, count };
+        profile_increment(LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0));
+    }
+
+    if (options.profile_use) {
+        prof_record = profile_lookup(func->name, count);
+        if (prof_record) {
+            LLVMGlobalSetMetadata(llvm_func, LLVMGetMDKindIDInContext(context, "prof", 4),
+                                  LLVMValueAsMetadata(profile_metadata("function_entry_count", prof_record->counts, 1, LLVMInt64TypeInContext(context))));
+        }
+    }
+}
+
+// a module constructor that hands every counter array to the runtime, which writes them out at exit
+static void profile_emit_registration(void) {
+    if (prof_function_count == 0) return;
+
+    LLVMTypeRef void_t = LLVMVoidTypeInContext(context);
+    LLVMTypeRef i32_t = LLVMInt32TypeInContext(context);
+    LLVMTypeRef i8_ptr_t = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+    LLVMTypeRef i64_ptr_t = LLVMPointerType(LLVMInt64TypeInContext(context), 0);
+
+    LLVMTypeRef register_args[] = { i8_ptr_t, i64_ptr_t, i32_t };
+    LLVMTypeRef register_type = LLVMFunctionType(void_t, register_args, 3, 0);
+    LLVMValueRef register_func = LLVMAddFunction(module, "__cplus_prof_register_", register_type);
+
+    LLVMTypeRef init_type = LLVMFunctionType(void_t, NULL, 0, 0);
+    LLVMValueRef init_func = LLVMAddFunction(module, "__cplus_prof_init", init_type);
+    LLVMSetLinkage(init_func, LLVMInternalLinkage);
+
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlockInContext(context, init_func, "entry"));
+    for (int i = 0; i < prof_function_count; i++) {
+        LLVMValueRef args[] = {
+            codegen_global_string(prof_functions[i].name),
+            LLVMConstBitCast(prof_functions[i].counters, i64_ptr_t),
+            LLVMConstInt(i32_t, prof_functions[i].count, 0),
+        };
+        LLVMBuildCall2(builder, register_type, register_func, args, 3, "");
+    }
+    LLVMBuildRetVoid(builder);
+
+    LLVMTypeRef ctor_fields[] = { i32_t, LLVMPointerType(init_type, 0), i8_ptr_t };
+    LLVMTypeRef ctor_type = LLVMStructTypeInContext(context, ctor_fields, 3, 0);
+    LLVMValueRef ctor_values[] = { LLVMConstInt(i32_t, 65535, 0), init_func, LLVMConstNull(i8_ptr_t) };
+    LLVMValueRef ctor = LLVMConstNamedStruct(ctor_type, ctor_values, 3);
+
+    LLVMValueRef ctors = LLVMAddGlobal(module, LLVMArrayType(ctor_type, 1), "llvm.global_ctors");
+    LLVMSetInitializer(ctors, LLVMConstArray(ctor_type, &ctor, 1));
+    LLVMSetLinkage(ctors, LLVMAppendingLinkage);
+}
+
+static void fast_math_begin_function(const FunctionNode *func, LLVMValueRef llvm_func) {
+    fn_fast_math = options.fast_math || (func->attributes & FUNC_ATTR_FASTMATH);
+    fn_fp_contract = options.fp_contract || fn_fast_math;
+
+    if (!fn_fast_math) return;
+
+    // the C API can't set per-instruction fast-math flags, so relax the whole function instead
+    static const char *fast_math_attributes[] = {
+        "unsafe-fp-math", "no-nans-fp-math", "no-infs-fp-math", "no-signed-zeros-fp-math",
+        "approx-func-fp-math", "no-trapping-math",
+    };
+
+    for (size_t i = 0; i < sizeof(fast_math_attributes) / sizeof(fast_math_attributes[0]); i++) {
+        const char *kind = fast_math_attributes[i];
+        LLVMAttributeRef attr = LLVMCreateStringAttribute(context, kind, strlen(kind), "true", 4);
+        LLVMAddAttributeAtIndex(llvm_func, LLVMAttributeFunctionIndex, attr);
+    }
+}
+
+// one '!{!"name", value}' operand of a loop id, or '!{!"name"}' when value is NULL
+static LLVMMetadataRef loop_property(const char *name, LLVMValueRef value) {
+    LLVMMetadataRef operands[] = {
+        LLVMMDStringInContext2(context, name, strlen(name)),
+        value ? LLVMValueAsMetadata(value) : NULL,
+    };
+
+    return LLVMMDNodeInContext2(context, operands, value ? 2 : 1);
+}
+
+static bool is_fp_accumulator(const ExprNode *expr) {
+    return expr->kind == EXPR_VAR && expr->pointer_level == 0 && (expr->type == TYPE_FLOAT || expr->type == TYPE_DOUBLE);
+}
+
+// sum += x or sum = sum * x on a float or double variable somewhere in a loop body
+static bool has_fp_reduction(const StmtNode *stmt) {
+    if (!stmt) return false;
+
+    switch (stmt->kind) {
+        case STMT_EXPR: {
+            const ExprNode *expr = stmt->expr_stmt.expr;
+            if (expr->kind != EXPR_BINOP || !is_fp_accumulator(expr->binop.left)) return false;
+
+            switch (expr->binop.op) {
+                case BIN_ADD_ASSIGN:
+                case BIN_SUB_ASSIGN:
+                case BIN_MUL_ASSIGN: return true;
+                case BIN_ASSIGN: {
+                    const ExprNode *value = expr->binop.right;
+                    return value->kind == EXPR_BINOP && (value->binop.op == BIN_ADD || value->binop.op == BIN_SUB || value->binop.op == BIN_MUL) &&
+                           value->binop.left->kind == EXPR_VAR && strcmp(value->binop.left->text, expr->binop.left->text) == 0;
+                }
+                default: return false;
+            }
+        }
+        case STMT_COMPOUND: {
+            for (int i = 0; i < stmt->compound.count; i++) {
+                if (has_fp_reduction(stmt->compound.stmts[i])) return true;
+            }
+            return false;
+        }
+        case STMT_IF: return has_fp_reduction(stmt->if_stmt.then_stmt) || has_fp_reduction(stmt->if_stmt.else_stmt);
+        case STMT_WHILE: return has_fp_reduction(stmt->while_stmt.body);
+        case STMT_FOR: return has_fp_reduction(stmt->for_stmt.body);
+        case STMT_SWITCH: {
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                const SwitchCase *c = &stmt->switch_stmt.cases[i];
+                for (int j = 0; j < c->count; j++) {
+                    if (has_fp_reduction(c->stmts[j])) return true;
+                }
+            }
+            return false;
+        }
+        default: return false;
+    }
+}
+
+// attaches llvm.loop metadata to the back edge of a loop, from the loop's #pragma hints. the C API can't mark
+// single instructions reassociable, so in fast-math functions loops with a floating point reduction are also
+// flagged for the vectoriser, which then reorders the reduction. other loops are left to llvm's cost model
+static void mark_loop_latch(LLVMValueRef branch, const LoopHints *hints, const StmtNode *body) {
+    LLVMTypeRef i1_type = LLVMInt1TypeInContext(context);
+    LLVMTypeRef i32_type = LLVMInt32TypeInContext(context);
+
+    // the self reference plus at most one vectorize, width, interleave and unroll property
+    LLVMMetadataRef operands[5];
+    int count = 1;
+
+    if (hints->vectorize == LOOP_HINT_OFF) {
+        operands[count++] = loop_property("llvm.loop.vectorize.enable", LLVMConstInt(i1_type, 0, 0));
+    } else if (hints->vectorize != 0 || (fn_fast_math && has_fp_reduction(body))) {
+        operands[count++] = loop_property("llvm.loop.vectorize.enable", LLVMConstInt(i1_type, 1, 0));
+    }
+
+    if (hints->vectorize > 0) {
+        operands[count++] = loop_property("llvm.loop.vectorize.width", LLVMConstInt(i32_type, hints->vectorize, 0));
+    }
+
+    // an interleave count of 1 is how llvm spells no interleaving
+    if (hints->interleave != 0) {
+        const int interleave = hints->interleave == LOOP_HINT_OFF ? 1 : hints->interleave;
+        operands[count++] = loop_property("llvm.loop.interleave.count", LLVMConstInt(i32_type, interleave, 0));
+    }
+
+    if (hints->unroll == LOOP_HINT_OFF) {
+        operands[count++] = loop_property("llvm.loop.unroll.disable", NULL);
+    } else if (hints->unroll == LOOP_HINT_ON) {
+        operands[count++] = loop_property("llvm.loop.unroll.full", NULL);
+    } else if (hints->unroll > 0) {
+        operands[count++] = loop_property("llvm.loop.unroll.count", LLVMConstInt(i32_type, hints->unroll, 0));
+    }
+
+    if (count == 1) return;
+
+    // loop ids are distinct nodes that refer to themselves as the first operand
+    LLVMMetadataRef self = LLVMTemporaryMDNode(context, NULL, 0);
+    operands[0] = self;
+    LLVMMetadataRef loop_id = LLVMMDNodeInContext2(context, operands, count);
+    LLVMMetadataReplaceAllUsesWith(self, loop_id);
+
+    LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(context, "llvm.loop", strlen("llvm.loop")), LLVMMetadataAsValue(context, loop_id));
+}
+
+// bitwise ops and shifts, shared by the plain and compound forms. right shifts are logical on
+// unsigned operands and arithmetic otherwise
+static LLVMValueRef build_bitwise(const BinaryOp op, LLVMValueRef left, LLVMValueRef right, const bool is_unsigned) {
+    switch (op) {
+        case BIN_BIT_AND:
+        case BIN_AND_ASSIGN: return LLVMBuildAnd(builder, left, right, "andtmp");
+        case BIN_BIT_OR:
+        case BIN_OR_ASSIGN:  return LLVMBuildOr(builder, left, right, "ortmp");
+        case BIN_BIT_XOR:
+        case BIN_XOR_ASSIGN: return LLVMBuildXor(builder, left, right, "xortmp");
+        case BIN_SHL:
+        case BIN_SHL_ASSIGN: return LLVMBuildShl(builder, left, right, "shltmp");
+        case BIN_SHR:
+        case BIN_SHR_ASSIGN: {
+            if (is_unsigned) {
+                return LLVMBuildLShr(builder, left, right, "shrtmp");
+            }
+            return LLVMBuildAShr(builder, left, right, "shrtmp");
+        }
+        default: {
+            fprintf(stderr, "Unsupported bitwise operator\n");
+            exit(1);
+        }
+    }
+}
+
+// folds an fmul that was just built for this expression into a*b+c (or a*b-c, c-a*b) as llvm.fmuladd,
+// which becomes a single fma on targets that have one. returns NULL when there's nothing to contract
+static LLVMValueRef build_fp_contract(LLVMValueRef left, LLVMValueRef right, const bool is_sub) {
+    if (!fn_fp_contract) return NULL;
+
+    LLVMValueRef mul = NULL;
+    LLVMValueRef addend = NULL;
+    bool negate_product = false;
+
+    if (LLVMIsAInstruction(left) && LLVMGetInstructionOpcode(left) == LLVMFMul && !LLVMGetFirstUse(left)) {
+        mul = left;
+        addend = is_sub ? LLVMBuildFNeg(builder, right, "negtmp") : right;
+    } else if (LLVMIsAInstruction(right) && LLVMGetInstructionOpcode(right) == LLVMFMul && !LLVMGetFirstUse(right)) {
+        mul = right;
+        addend = left;
+        negate_product = is_sub;
+    } else {
+        return NULL;
+    }
+
+    LLVMTypeRef type = LLVMTypeOf(mul);
+    if (LLVMTypeOf(addend) != type) return NULL;
+
+    LLVMValueRef a = LLVMGetOperand(mul, 0);
+    LLVMValueRef b = LLVMGetOperand(mul, 1);
+    if (negate_product) {
+        a = LLVMBuildFNeg(builder, a, "negtmp");
+    }
+
+    const unsigned id = LLVMLookupIntrinsicID("llvm.fmuladd", strlen("llvm.fmuladd"));
+    LLVMValueRef fmuladd = LLVMGetIntrinsicDeclaration(module, id, &type, 1);
+    LLVMTypeRef fmuladd_type = LLVMIntrinsicGetType(context, id, &type, 1);
+
+    LLVMValueRef args[] = { a, b, addend };
+    LLVMValueRef result = LLVMBuildCall2(builder, fmuladd_type, fmuladd, args, 3, "fmatmp");
+    LLVMInstructionEraseFromParent(mul);
+    return result;
+}
+
+// element-wise op on two vectors of the same type. compound assignment ops lower like their plain form
+static LLVMValueRef build_vector_binop(const BinaryOp op, LLVMValueRef left, LLVMValueRef right, const TypeKind vec_type) {
+    const bool is_float = is_floating_type(vector_element_type(vec_type));
+    LLVMValueRef cmp = NULL;
+
+    switch (op) {
+        case BIN_ADD:
+        case BIN_ADD_ASSIGN: {
+            if (!is_float) return LLVMBuildAdd(builder, left, right, "vaddtmp");
+
+            LLVMValueRef contracted = build_fp_contract(left, right, false);
+            return contracted ? contracted : LLVMBuildFAdd(builder, left, right, "vaddtmp");
+        }
+        case BIN_SUB:
+        case BIN_SUB_ASSIGN: {
+            if (!is_float) return LLVMBuildSub(builder, left, right, "vsubtmp");
+
+            LLVMValueRef contracted = build_fp_contract(left, right, true);
+            return contracted ? contracted : LLVMBuildFSub(builder, left, right, "vsubtmp");
+        }
+        case BIN_MUL:
+        case BIN_MUL_ASSIGN: return is_float ? LLVMBuildFMul(builder, left, right, "vmultmp") : LLVMBuildMul(builder, left, right, "vmultmp");
+        case BIN_DIV:
+        case BIN_DIV_ASSIGN: return is_float ? LLVMBuildFDiv(builder, left, right, "vdivtmp") : LLVMBuildSDiv(builder, left, right, "vdivtmp");
+        case BIN_MOD:
+        case BIN_MOD_ASSIGN: return is_float ? LLVMBuildFRem(builder, left, right, "vremtmp") : LLVMBuildSRem(builder, left, right, "vremtmp");
+        case BIN_EQUAL:      cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealOEQ, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntEQ, left, right, "vcmp"); break;
+        case BIN_NOT_EQUAL:  cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealUNE, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntNE, left, right, "vcmp"); break;
+        case BIN_LESS:       cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealOLT, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntSLT, left, right, "vcmp"); break;
+        case BIN_GREATER:    cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealOGT, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntSGT, left, right, "vcmp"); break;
+        case BIN_LESS_EQ:    cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealOLE, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntSLE, left, right, "vcmp"); break;
+        case BIN_GREATER_EQ: cmp = is_float ? LLVMBuildFCmp(builder, LLVMRealOGE, left, right, "vcmp") : LLVMBuildICmp(builder, LLVMIntSGE, left, right, "vcmp"); break;
+        default:             return build_bitwise(op, left, right, false);
+    }
+
+    // <N x i1> widened to an all-ones / all-zeros int lane
+    return LLVMBuildSExt(builder, cmp, get_llvm_type(vector_mask_type(vec_type)), "vmask");
+}
+
+// broadcasts a scalar (already of the lane type) into every lane
+static LLVMValueRef build_splat(LLVMValueRef scalar, const TypeKind vec_type) {
+    LLVMTypeRef vec_llvm = get_llvm_type(vec_type);
+    LLVMTypeRef mask_type = LLVMVectorType(LLVMInt32TypeInContext(context), vector_lane_count(vec_type));
+
+    LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+    LLVMValueRef single = LLVMBuildInsertElement(builder, LLVMGetUndef(vec_llvm), scalar, zero, "splatinsert");
+    return LLVMBuildShuffleVector(builder, single, LLVMGetUndef(vec_llvm), LLVMConstNull(mask_type), "splat");
+}
+
+static LLVMValueRef convert_to_type(LLVMValueRef value, TypeKind from_type, TypeKind to_type) {
+    if (from_type == to_type) return value;
+
+    LLVMTypeRef from_llvm = get_llvm_type(from_type);
+    LLVMTypeRef to_llvm = get_llvm_type(to_type);
+
+    if (is_vector_type(to_type)) {
+        if (!is_vector_type(from_type)) {
+            return build_splat(convert_to_type(value, from_type, vector_element_type(to_type)), to_type);
+        }
+
+        // lane counts match (checked in semantic), only the lane type changes
+        if (is_floating_type(vector_element_type(from_type)) && is_integer_type(vector_element_type(to_type))) {
+            return LLVMBuildFPToSI(builder, value, to_llvm, "ftoi");
+        }
+
+        if (is_integer_type(vector_element_type(from_type)) && is_floating_type(vector_element_type(to_type))) {
+            return LLVMBuildSIToFP(builder, value, to_llvm, "itof");
+        }
+
+        return value;
+    }
+
+    // Both are integers of different sizes, widening follows the source signedness
+    if (is_integer_type(from_type) && is_integer_type(to_type)) {
+        unsigned from_bits = LLVMGetIntTypeWidth(from_llvm);
+        unsigned to_bits = LLVMGetIntTypeWidth(to_llvm);
+
+        if (from_bits < to_bits) {
+            if (is_unsigned_type(from_type)) {
+                return LLVMBuildZExt(builder, value, to_llvm, "zext");
+            }
+            return LLVMBuildSExt(builder, value, to_llvm, "sext");
+        } else if (from_bits > to_bits) {
+            return LLVMBuildTrunc(builder, value, to_llvm, "trunc");
+        }
+
+        return value;
+    }
+
+    if (is_integer_type(from_type) && is_floating_type(to_type)) {
+        if (is_unsigned_type(from_type)) {
+            return LLVMBuildUIToFP(builder, value, to_llvm, "itof");
+        }
+        return LLVMBuildSIToFP(builder, value, to_llvm, "itof");
+    }
+
+    if (is_floating_type(from_type) && is_integer_type(to_type)) {
+        if (is_unsigned_type(to_type)) {
+            return LLVMBuildFPToUI(builder, value, to_llvm, "ftoi");
+        }
+        return LLVMBuildFPToSI(builder, value, to_llvm, "ftoi");
+    }
+
+    if (is_floating_type(from_type) && is_floating_type(to_type)) {
+        if (to_type == TYPE_DOUBLE) {
+            return LLVMBuildFPExt(builder, value, to_llvm, "fpext");
+        }
+
+        return LLVMBuildFPTrunc(builder, value, to_llvm, "fptrunc");
+    }
+
+    return value;
+}
+
+// literals are laid out like runtime strings, a {refs, length, capacity} header then the characters. a count
+// of -1 tells the runtime the string lives in the binary. the value points at the characters
+static LLVMValueRef codegen_global_string(const char *text) {
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+    const size_t length = strlen(text);
+
+    LLVMValueRef fields[] = {
+        LLVMConstInt(i64_type, -1, 1),
+        LLVMConstInt(i64_type, length, 0),
+        LLVMConstInt(i64_type, 0, 0),
+        LLVMConstStringInContext(context, text, length, 0),
+    };
+    LLVMValueRef str = LLVMConstStructInContext(context, fields, 4, 0);
+
+    LLVMValueRef global = LLVMAddGlobal(module, LLVMTypeOf(str), ".str");
+    LLVMSetInitializer(global, str);
+    LLVMSetGlobalConstant(global, 1);
+    LLVMSetLinkage(global, LLVMPrivateLinkage);
+    LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr);
+
+    LLVMValueRef indices[3];
+    indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+    indices[1] = LLVMConstInt(LLVMInt32TypeInContext(context), 3, 0);
+    indices[2] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+
+    return LLVMConstInBoundsGEP2(LLVMTypeOf(str), global, indices, 3);
+}
+
+// reads the length from the header in front of the characters, a null string reads the empty literal's
+static LLVMValueRef string_length(LLVMValueRef string) {
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+
+    LLVMValueRef chars = LLVMBuildSelect(builder, LLVMBuildIsNull(builder, string, "isnull"), codegen_global_string(""), string, "chars");
+    LLVMValueRef header = LLVMBuildBitCast(builder, chars, LLVMPointerType(i64_type, 0), "header");
+    LLVMValueRef offset = LLVMConstInt(i64_type, -2, 1);
+    LLVMValueRef length = LLVMBuildInBoundsGEP2(builder, i64_type, header, &offset, 1, "lengthptr");
+    return LLVMBuildLoad2(builder, i64_type, length, "length");
+}
+
+static LLVMValueRef build_string_equals(LLVMValueRef left, LLVMValueRef right) {
+    CodegenSymbol *sym = lookup_global_var_full("__cplus_strcmp_");
+    if (!sym) {
+        fprintf(stderr, "Codegen Error: __cplus_strcmp_ not found (symbol missing)\n");
+        exit(1);
+    }
+
+    LLVMValueRef args[] = { left, right };
+    return LLVMBuildCall2(builder, sym->llvm_type, sym->value, args, 2, "streq");
+}
+
+// strings are reference counted. calls, concatenations and char* copies hand the statement a reference
+// of its own, which moves into whatever stores the value or is released when the statement ends.
+// loading a variable only borrows its reference
+static LLVMValueRef *string_temps = NULL;
+static int string_temp_count = 0;
+static int string_temp_capacity = 0;
+
+// locals and parameters holding a reference, released in front of every ret of the function
+static LLVMValueRef *string_slots = NULL;
+static int string_slot_count = 0;
+static int string_slot_capacity = 0;
+
+typedef struct {
+    LLVMValueRef ret;
+    LLVMValueRef moved;  // the local the return value came from, its reference goes to the caller
+} StringExit;
+
+static StringExit *string_exits = NULL;
+static int string_exit_count = 0;
+static int string_exit_capacity = 0;
+
+static bool is_string_expr(const ExprNode *expr) {
+    return expr->type == TYPE_STRING && expr->pointer_level == 0 && !expr->is_slice && expr->dim_count == 0;
+}
+
+// literals are never counted and null holds nothing, so neither needs a call
+static void string_refcount(const char *runtime_name, LLVMValueRef string) {
+    if (LLVMIsConstant(string)) return;
+
+    LLVMValueRef func = LLVMGetNamedFunction(module, runtime_name);
+    LLVMBuildCall2(builder, LLVMGlobalGetValueType(func), func, &string, 1, "");
+}
+
+static LLVMValueRef owned_string(LLVMValueRef string) {
+    if (LLVMIsConstant(string)) return string;
+
+    if (string_temp_count >= string_temp_capacity) {
+        string_temp_capacity = string_temp_capacity == 0 ? 8 : string_temp_capacity * 2;
+        string_temps = realloc(string_temps, sizeof(LLVMValueRef) * string_temp_capacity);
+    }
+
+    string_temps[string_temp_count++] = string;
+    return string;
+}
+
+// a reference for something that keeps the string: a temporary's is moved, a borrowed string is retained
+static LLVMValueRef take_string(LLVMValueRef string) {
+    for (int i = string_temp_count - 1; i >= 0; i--) {
+        if (string_temps[i] == string) {
+            string_temps[i] = string_temps[--string_temp_count];
+            return string;
+        }
+    }
+
+    string_refcount("__cplus_string_retain_", string);
+    return string;
+}
+
+static void release_string_temps(void) {
+    for (int i = 0; i < string_temp_count; i++) {
+        string_refcount("__cplus_string_release_", string_temps[i]);
+    }
+
+    string_temp_count = 0;
+}
+
+static bool is_string_slot(LLVMValueRef slot) {
+    for (int i = 0; i < string_slot_count; i++) {
+        if (string_slots[i] == slot) return true;
+    }
+
+    return false;
+}
+
+// starts null in the entry block, so every ret can release it whether or not it was assigned on the way
+static void add_string_slot(LLVMValueRef slot) {
+    if (is_string_slot(slot)) return;
+
+    if (string_slot_count >= string_slot_capacity) {
+        string_slot_capacity = string_slot_capacity == 0 ? 8 : string_slot_capacity * 2;
+        string_slots = realloc(string_slots, sizeof(LLVMValueRef) * string_slot_capacity);
+    }
+
+    string_slots[string_slot_count++] = slot;
+
+    LLVMBuilderRef entry_builder = LLVMCreateBuilderInContext(context);
+    LLVMValueRef next = LLVMGetNextInstruction(slot);
+    if (next) {
+        LLVMPositionBuilderBefore(entry_builder, next);
+    } else {
+        LLVMPositionBuilderAtEnd(entry_builder, LLVMGetInstructionParent(slot));
+    }
+
+    LLVMBuildStore(entry_builder, LLVMConstNull(LLVMGetAllocatedType(slot)), slot);
+    LLVMDisposeBuilder(entry_builder);
+}
+
+static void add_string_exit(LLVMValueRef ret, LLVMValueRef moved) {
+    if (string_exit_count >= string_exit_capacity) {
+        string_exit_capacity = string_exit_capacity == 0 ? 8 : string_exit_capacity * 2;
+        string_exits = realloc(string_exits, sizeof(StringExit) * string_exit_capacity);
+    }
+
+    string_exits[string_exit_count++] = (StringExit){ ret, moved };
+}
+
+// stores a string into a slot holding a reference. the old one is released after the store, so s = s is safe
+static void store_owned_string(LLVMValueRef string, LLVMValueRef slot) {
+    LLVMValueRef old = LLVMBuildLoad2(builder, LLVMTypeOf(string), slot, "oldstr");
+    LLVMBuildStore(builder, take_string(string), slot);
+    string_refcount("__cplus_string_release_", old);
+}
+
+// a declaration that runs again, in a loop or after 'become' on the function itself, replaces the string it held
+static void init_string_local(LLVMValueRef string, LLVMValueRef slot, const bool redeclared) {
+    if (redeclared || current_continue_target || tail_loop_block) {
+        store_owned_string(string, slot);
+    } else {
+        LLVMBuildStore(builder, take_string(string), slot);
+    }
+}
+
+// the slots from first on let go of their strings at the exits from first_exit on, then are forgotten
+static void release_string_slots(const int first_slot, const int first_exit) {
+    LLVMTypeRef str_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+
+    for (int i = first_exit; i < string_exit_count; i++) {
+        LLVMPositionBuilderBefore(builder, string_exits[i].ret);
+        LLVMSetCurrentDebugLocation2(builder, LLVMInstructionGetDebugLoc(string_exits[i].ret));
+
+        for (int j = first_slot; j < string_slot_count; j++) {
+            if (string_slots[j] == string_exits[i].moved) continue;
+            string_refcount("__cplus_string_release_", LLVMBuildLoad2(builder, str_type, string_slots[j], "ownedstr"));
+        }
+    }
+
+    string_slot_count = first_slot;
+    string_exit_count = first_exit;
+}
+
+static LLVMValueRef build_string_concat(LLVMValueRef left, LLVMValueRef right) {
+    CodegenSymbol *sym = lookup_global_var_full("__cplus_str_concat");
+    if (!sym) {
+        fprintf(stderr, "Codegen Error: __cplus_str_concat not found (symbol missing)\n");
+        exit(1);
+    }
+
+    LLVMValueRef args[] = { left, right };
+    return owned_string(LLVMBuildCall2(builder, sym->llvm_type, sym->value, args, 2, "concat_res"));
+}
+
+// folds literal initializers into an LLVM constant of the given type, NULL if the expression isn't constant
+static LLVMValueRef codegen_constant(const ExprNode *expr, const TypeKind type, const int pointer_level) {
+    LLVMTypeRef llvm_type = get_llvm_type_with_pointers(type, pointer_level);
+
+    // struct fields from an initializer list, missing or non-constant fields are zero
+    if (is_struct_value(type, pointer_level)) {
+        if (expr->kind != EXPR_INIT_LIST) return NULL;
+
+        const StructNode *def = struct_type_def(type);
+        const StructLayout *layout = struct_layout(type);
+        const unsigned slot_count = LLVMCountStructElementTypes(layout->type);
+        LLVMValueRef *values = malloc(sizeof(LLVMValueRef) * slot_count);
+
+        for (unsigned i = 0; i < slot_count; i++) {
+            values[i] = LLVMConstNull(LLVMStructGetTypeAtIndex(layout->type, i));
+        }
+
+        for (int i = 0; i < expr->init_list.count && i < def->field_count; i++) {
+            const FieldNode *field = &def->fields[i];
+            LLVMValueRef value = field->array_size > 0 ? NULL : codegen_constant(expr->init_list.elements[i], field->type, field->pointer_level);
+            if (value) values[layout->slots[i]] = value;
+        }
+
+        LLVMValueRef result = LLVMConstNamedStruct(layout->type, values, slot_count);
+        free(values);
+        return result;
+    }
+
+    // vector lanes from an initializer list (missing or non-constant lanes are zero) or one splat scalar
+    if (is_vector_type(type) && pointer_level == 0) {
+        const int lanes = vector_lane_count(type);
+        LLVMValueRef values[8];
+
+        for (int i = 0; i < lanes; i++) {
+            const ExprNode *element = expr;
+            if (expr->kind == EXPR_INIT_LIST) {
+                element = i < expr->init_list.count ? expr->init_list.elements[i] : NULL;
+            }
+
+            values[i] = element ? codegen_constant(element, vector_element_type(type), 0) : NULL;
+            if (!values[i]) {
+                values[i] = LLVMConstNull(get_llvm_type(vector_element_type(type)));
+            }
+        }
+
+        return LLVMConstVector(values, lanes);
+    }
+
+    if (expr->kind == EXPR_STRING_LITERAL) {
+        if (type == TYPE_STRING || (type == TYPE_CHAR && pointer_level == 1)) {
+            return codegen_global_string(expr->text);
+        }
+
+        return NULL;
+    }
+
+    bool negate = false;
+    if (expr->kind == EXPR_UNARY && expr->unary.op == UNARY_NEG) {
+        negate = true;
+        expr = expr->unary.operand;
+    }
+
+    if (expr->kind != EXPR_NUMBER || type == TYPE_STRING) {
+        return NULL;
+    }
+
+    if (pointer_level > 0) {
+        const long long address = strtoll(expr->text, NULL, 10);
+        return LLVMConstIntToPtr(LLVMConstInt(LLVMInt64TypeInContext(context), address, 0), llvm_type);
+    }
+
+    if (is_floating_type(type)) {
+        const double value = atof(expr->text);
+        return LLVMConstReal(llvm_type, negate ? -value : value);
+    }
+
+    // parsed unsigned so ulong constants above the long range keep their bits, semantic checked they fit the type
+    unsigned long long value = is_floating_type(expr->type) ? (unsigned long long)(long long)atof(expr->text) : strtoull(expr->text, NULL, 10);
+    if (negate) value = -value;
+    if (type == TYPE_BOOLEAN) value = value != 0;
+
+    return LLVMConstInt(llvm_type, value, !is_unsigned_type(type));
+}
+
+// returns the byte every element is made of (so the array can be memset), or -1
+static int constant_splat_byte(LLVMValueRef *values, const int count) {
+    int splat = -1;
+
+    for (int i = 0; i < count; i++) {
+        if (LLVMIsNull(values[i])) {
+            if (splat > 0) return -1;
+            splat = 0;
+            continue;
+        }
+
+        if (LLVMGetTypeKind(LLVMTypeOf(values[i])) != LLVMIntegerTypeKind) {
+            return -1;
+        }
+
+        const unsigned width = LLVMGetIntTypeWidth(LLVMTypeOf(values[i]));
+        if (width % 8 != 0) {
+            return -1;
+        }
+
+        const unsigned long long bits = LLVMConstIntGetZExtValue(values[i]);
+        const int byte = (int)(bits & 0xFF);
+        for (unsigned shift = 8; shift < width; shift += 8) {
+            if ((int)((bits >> shift) & 0xFF) != byte) return -1;
+        }
+
+        if (splat != -1 && splat != byte) return -1;
+        splat = byte;
+    }
+
+    return splat;
+}
+
+// fills a stack array from an initializer list. constant data is emitted as a single memset when every
+// byte is the same, otherwise as a memcpy from a private constant, then any runtime elements are stored
+// array_type may be nested, the elements are then its flattened rows
+static void codegen_array_initializer(LLVMValueRef array_ptr, LLVMTypeRef array_type, const char *name, const TypeKind type, const int pointer_level, const int array_size, const ExprNode *init) {
+    LLVMTypeRef element_type = get_llvm_type_with_pointers(type, pointer_level);
+    LLVMTypeRef flat_type = LLVMArrayType(element_type, array_size);
+    LLVMValueRef *values = malloc(sizeof(LLVMValueRef) * array_size);
+    bool *is_runtime = calloc(array_size, sizeof(bool));
+
+    for (int i = 0; i < array_size; i++) {
+        values[i] = NULL;
+
+        if (i < init->init_list.count && init->init_list.elements[i]) {
+            values[i] = codegen_constant(init->init_list.elements[i], type, pointer_level);
+            is_runtime[i] = values[i] == NULL;
+        }
+
+        if (!values[i]) {
+            values[i] = LLVMConstNull(element_type);
+        }
+    }
+
+    LLVMValueRef size = LLVMSizeOf(array_type);
+    const unsigned align = LLVMGetAlignment(array_ptr);
+    const int splat = constant_splat_byte(values, array_size);
+
+    if (splat >= 0) {
+        LLVMBuildMemSet(builder, array_ptr, LLVMConstInt(LLVMInt8TypeInContext(context), splat, 0), size, align);
+    } else {
+        char const_name[256];
+        snprintf(const_name, sizeof(const_name), "__const.%s", name);
+
+        LLVMValueRef data = LLVMAddGlobal(module, flat_type, const_name);
+        LLVMSetInitializer(data, LLVMConstArray(element_type, values, array_size));
+        LLVMSetGlobalConstant(data, 1);
+        LLVMSetLinkage(data, LLVMPrivateLinkage);
+        LLVMSetUnnamedAddress(data, LLVMGlobalUnnamedAddr);
+        LLVMSetAlignment(data, align);
+
+        LLVMBuildMemCpy(builder, array_ptr, align, data, align, size);
+    }
+
+    LLVMValueRef flat_ptr = array_ptr;
+    if (flat_type != array_type) {
+        flat_ptr = LLVMBuildBitCast(builder, array_ptr, LLVMPointerType(flat_type, 0), "flat");
+    }
+
+    for (int i = 0; i < init->init_list.count && i < array_size; i++) {
+        if (!is_runtime[i]) continue;
+
+        const ExprNode *element = init->init_list.elements[i];
+        LLVMValueRef value = codegen_expression(element);
+        if (pointer_level == 0) {
+            value = convert_to_type(value, element->type, type);
+        }
+        if (is_string_expr(element)) {
+            value = take_string(value);
+        }
+
+        LLVMValueRef indices[2];
+        indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+        indices[1] = LLVMConstInt(LLVMInt32TypeInContext(context), i, 0);
+        LLVMValueRef element_ptr = LLVMBuildGEP2(builder, flat_type, flat_ptr, indices, 2, "initelem");
+        LLVMBuildStore(builder, value, element_ptr);
+    }
+
+    free(values);
+    free(is_runtime);
+}
+
+static void codegen_declare_builtins(void) {
+    LLVMTypeRef void_t = LLVMVoidTypeInContext(context);
+    LLVMTypeRef i32_t = LLVMInt32TypeInContext(context);
+    LLVMTypeRef i64_t = LLVMInt64TypeInContext(context);
+    LLVMTypeRef float_t = LLVMFloatTypeInContext(context);
+    LLVMTypeRef bool_t = LLVMInt1TypeInContext(context);
+    LLVMTypeRef i8_t = LLVMInt8TypeInContext(context);
+    LLVMTypeRef str_t = LLVMPointerType(i8_t, 0);
+    LLVMTypeRef void_ptr_t = LLVMPointerType(i8_t, 0);
+
+    LLVMTypeRef input_type = LLVMFunctionType(str_t, NULL, 0, 0);
+    LLVMValueRef input_func = LLVMAddFunction(module, "__cplus_input_", input_type);
+    add_global_var("__cplus_input_", input_func, input_type, TYPE_STRING, 0, 0);
+
+    LLVMTypeRef print_args[] = { str_t };
+    LLVMTypeRef print_type = LLVMFunctionType(void_t, print_args, 1, 0);
+    LLVMValueRef print_func = LLVMAddFunction(module, "__cplus_print_", print_type);
+    add_global_var("__cplus_print_", print_func, print_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef to_int_args[] = { str_t };
+    LLVMTypeRef to_int_type = LLVMFunctionType(i32_t, to_int_args, 1, 0);
+    LLVMValueRef to_int_func = LLVMAddFunction(module, "__cplus_to_int_", to_int_type);
+    add_global_var("__cplus_to_int_", to_int_func, to_int_type, TYPE_INT, 0, 0);
+
+    LLVMTypeRef to_float_args[] = { str_t };
+    LLVMTypeRef to_float_type = LLVMFunctionType(float_t, to_float_args, 1, 0);
+    LLVMValueRef to_float_func = LLVMAddFunction(module, "__cplus_to_float_", to_float_type);
+    add_global_var("__cplus_to_float_", to_float_func, to_float_type, TYPE_FLOAT, 0, 0);
+
+    LLVMTypeRef i2s_args[] = { i32_t };
+    LLVMTypeRef i2s_type = LLVMFunctionType(str_t, i2s_args, 1, 0);
+    LLVMValueRef i2s_func = LLVMAddFunction(module, "__cplus_int_to_string_", i2s_type);
+    add_global_var("__cplus_int_to_string_", i2s_func, i2s_type, TYPE_STRING, 0, 0);
+
+    LLVMTypeRef f2s_args[] = { float_t };
+    LLVMTypeRef f2s_type = LLVMFunctionType(str_t, f2s_args, 1, 0);
+    LLVMValueRef f2s_func = LLVMAddFunction(module, "__cplus_float_to_string_", f2s_type);
+    add_global_var("__cplus_float_to_string_", f2s_func, f2s_type, TYPE_STRING, 0, 0);
+
+    LLVMTypeRef concat_args[] = { str_t, str_t };
+    LLVMTypeRef concat_type = LLVMFunctionType(str_t, concat_args, 2, 0);
+    LLVMValueRef concat_func = LLVMAddFunction(module, "__cplus_str_concat", concat_type);
+    add_global_var("__cplus_str_concat", concat_func, concat_type, TYPE_STRING, 0, 0);
+
+    LLVMTypeRef strcmp_args[] = { str_t, str_t };
+    LLVMTypeRef strcmp_type = LLVMFunctionType(bool_t, strcmp_args, 2, 0);
+    LLVMValueRef strcmp_func = LLVMAddFunction(module, "__cplus_strcmp_", strcmp_type);
+    add_global_var("__cplus_strcmp_", strcmp_func, strcmp_type, TYPE_BOOLEAN, 0, 0);
+
+    LLVMTypeRef substr_args[] = { str_t, i32_t, i32_t };
+    LLVMTypeRef substr_type = LLVMFunctionType(str_t, substr_args, 3, 0);
+    LLVMValueRef substr_func = LLVMAddFunction(module, "__cplus_substr_", substr_type);
+    add_global_var("__cplus_substr_", substr_func, substr_type, TYPE_STRING, 0, 0);
+
+    LLVMTypeRef char_at_args[] = { str_t, i32_t };
+    LLVMTypeRef char_at_type = LLVMFunctionType(i8_t, char_at_args, 2, 0);
+    LLVMValueRef char_at_func = LLVMAddFunction(module, "__cplus_char_at_", char_at_type);
+    add_global_var("__cplus_char_at_", char_at_func, char_at_type, TYPE_CHAR, 0, 0);
+
+    LLVMTypeRef rand_type = LLVMFunctionType(i32_t, NULL, 0, 0);
+    LLVMValueRef rand_func = LLVMAddFunction(module, "__cplus_random_", rand_type);
+    add_global_var("__cplus_random_", rand_func, rand_type, TYPE_INT, 0, 0);
+
+    LLVMTypeRef time_type = LLVMFunctionType(i32_t, NULL, 0, 0);
+    LLVMValueRef time_func = LLVMAddFunction(module, "__cplus_time_", time_type);
+    add_global_var("__cplus_time_", time_func, time_type, TYPE_INT, 0, 0);
+
+    LLVMTypeRef seed_args[] = { i32_t };
+    LLVMTypeRef seed_type = LLVMFunctionType(void_t, seed_args, 1, 0);
+    LLVMValueRef seed_func = LLVMAddFunction(module, "__cplus_seed_", seed_type);
+    add_global_var("__cplus_seed_", seed_func, seed_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef sqrt_args[] = { float_t };
+    LLVMTypeRef sqrt_type = LLVMFunctionType(float_t, sqrt_args, 1, 0);
+    LLVMValueRef sqrt_func = LLVMAddFunction(module, "__cplus_sqrt_", sqrt_type);
+    add_global_var("__cplus_sqrt_", sqrt_func, sqrt_type, TYPE_FLOAT, 0, 0);
+
+    LLVMTypeRef pow_args[] = { float_t, float_t };
+    LLVMTypeRef pow_type = LLVMFunctionType(float_t, pow_args, 2, 0);
+    LLVMValueRef pow_func = LLVMAddFunction(module, "__cplus_pow_", pow_type);
+    add_global_var("__cplus_pow_", pow_func, pow_type, TYPE_FLOAT, 0, 0);
+
+    LLVMTypeRef sys_args[] = { str_t };
+    LLVMTypeRef sys_type = LLVMFunctionType(i32_t, sys_args, 1, 0);
+    LLVMValueRef sys_func = LLVMAddFunction(module, "__cplus_system_", sys_type);
+    add_global_var("__cplus_system_", sys_func, sys_type, TYPE_INT, 0, 0);
+
+    LLVMTypeRef panic_args[] = { str_t };
+    LLVMTypeRef panic_type = LLVMFunctionType(void_t, panic_args, 1, 0);
+    LLVMValueRef panic_func = LLVMAddFunction(module, "__cplus_panic_", panic_type);
+    // panic never returns, so whatever branch leads to it is treated as cold
+    add_abi_attribute(panic_func, false, LLVMAttributeFunctionIndex, "cold", NULL, 0);
+    add_abi_attribute(panic_func, false, LLVMAttributeFunctionIndex, "noreturn", NULL, 0);
+    add_global_var("__cplus_panic_", panic_func, panic_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef memcpy_args[] = { void_ptr_t, void_ptr_t, i32_t };
+    LLVMTypeRef memcpy_type = LLVMFunctionType(void_t, memcpy_args, 3, 0);
+    LLVMValueRef memcpy_func = LLVMAddFunction(module, "__cplus_memcpy_", memcpy_type);
+    add_global_var("__cplus_memcpy_", memcpy_func, memcpy_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef memset_args[] = { void_ptr_t, i32_t, i32_t };
+    LLVMTypeRef memset_type = LLVMFunctionType(void_t, memset_args, 3, 0);
+    LLVMValueRef memset_func = LLVMAddFunction(module, "__cplus_memset_", memset_type);
+    add_global_var("__cplus_memset_", memset_func, memset_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef realloc_args[] = { void_ptr_t, i32_t };
+    LLVMTypeRef realloc_type = LLVMFunctionType(void_ptr_t, realloc_args, 2, 0);
+    LLVMValueRef realloc_func = LLVMAddFunction(module, "__cplus_realloc_", realloc_type);
+
+    add_global_var("__cplus_realloc_", realloc_func, realloc_type, TYPE_VOID, 1, 0);
+
+    LLVMTypeRef aligned_alloc_args[] = { i32_t, i32_t };
+    LLVMTypeRef aligned_alloc_type = LLVMFunctionType(void_ptr_t, aligned_alloc_args, 2, 0);
+    LLVMValueRef aligned_alloc_func = LLVMAddFunction(module, "__cplus_aligned_alloc_", aligned_alloc_type);
+    add_abi_attribute(aligned_alloc_func, false, LLVMAttributeReturnIndex, "noalias", NULL, 0);
+    add_global_var("__cplus_aligned_alloc_", aligned_alloc_func, aligned_alloc_type, TYPE_VOID, 1, 0);
+
+    // spawn is only reached through the intrinsic, which passes it a thread entry function
+    LLVMTypeRef entry_type = LLVMPointerType(LLVMFunctionType(void_ptr_t, &void_ptr_t, 1, 0), 0);
+    LLVMTypeRef spawn_args[] = { entry_type, void_ptr_t };
+    LLVMAddFunction(module, "__cplus_spawn_", LLVMFunctionType(i64_t, spawn_args, 2, 0));
+
+    LLVMTypeRef join_type = LLVMFunctionType(void_t, &i64_t, 1, 0);
+    LLVMValueRef join_func = LLVMAddFunction(module, "__cplus_join_", join_type);
+    add_global_var("__cplus_join_", join_func, join_type, TYPE_VOID, 0, 0);
+
+    LLVMTypeRef mutex_new_type = LLVMFunctionType(i64_t, NULL, 0, 0);
+    LLVMValueRef mutex_new_func = LLVMAddFunction(module, "__cplus_mutex_new_", mutex_new_type);
+    add_global_var("__cplus_mutex_new_", mutex_new_func, mutex_new_type, TYPE_LONG, 0, 0);
+
+    LLVMTypeRef mutex_type = LLVMFunctionType(void_t, &i64_t, 1, 0);
+    LLVMValueRef lock_func = LLVMAddFunction(module, "__cplus_mutex_lock_", mutex_type);
+    add_global_var("__cplus_mutex_lock_", lock_func, mutex_type, TYPE_VOID, 0, 0);
+
+    LLVMValueRef unlock_func = LLVMAddFunction(module, "__cplus_mutex_unlock_", mutex_type);
+    add_global_var("__cplus_mutex_unlock_", unlock_func, mutex_type, TYPE_VOID, 0, 0);
+
+    LLVMValueRef mutex_free_func = LLVMAddFunction(module, "__cplus_mutex_free_", mutex_type);
+    add_global_var("__cplus_mutex_free_", mutex_free_func, mutex_type, TYPE_VOID, 0, 0);
+
+    // parallel for bodies are run by the runtime pool, reductions combine under its lock
+    LLVMTypeRef body_args[] = { void_ptr_t, i64_t, i64_t };
+    LLVMTypeRef parallel_args[] = { LLVMPointerType(LLVMFunctionType(void_t, body_args, 3, 0), 0), void_ptr_t, i64_t, i64_t };
+    LLVMAddFunction(module, "__cplus_parallel_for_", LLVMFunctionType(void_t, parallel_args, 4, 0));
+    LLVMAddFunction(module, "__cplus_parallel_lock_", LLVMFunctionType(void_t, NULL, 0, 0));
+    LLVMAddFunction(module, "__cplus_parallel_unlock_", LLVMFunctionType(void_t, NULL, 0, 0));
+
+    // char* to string conversions, inserted by semantic, and the reference counts of strings
+    LLVMTypeRef string_from_args[] = { str_t };
+    LLVMAddFunction(module, "__cplus_string_from_", LLVMFunctionType(str_t, string_from_args, 1, 0));
+    LLVMAddFunction(module, "__cplus_string_retain_", LLVMFunctionType(void_t, string_from_args, 1, 0));
+    LLVMAddFunction(module, "__cplus_string_release_", LLVMFunctionType(void_t, string_from_args, 1, 0));
+    LLVMTypeRef append_args[] = { str_t, str_t };
+    LLVMAddFunction(module, "__cplus_string_append_", LLVMFunctionType(str_t, append_args, 2, 0));
+
+    // failed -fbounds-check checks land here with the index and the length
+    LLVMTypeRef bounds_args[] = { i64_t, i64_t };
+    LLVMValueRef bounds_func = LLVMAddFunction(module, "__cplus_bounds_fail_", LLVMFunctionType(void_t, bounds_args, 2, 0));
+    add_abi_attribute(bounds_func, false, LLVMAttributeFunctionIndex, "cold", NULL, 0);
+    add_abi_attribute(bounds_func, false, LLVMAttributeFunctionIndex, "noreturn", NULL, 0);
+}
+
+// s[i] inside a for loop that keeps i within s, see loop_proves_bounds
+typedef struct {
+    const char *index;
+    const char *slice;
+} BoundsProof;
+
+static BoundsProof *bounds_proofs = NULL;
+static int bounds_proof_count = 0;
+static int bounds_proof_capacity = 0;
+
+static bool bounds_proven(const ExprNode *slice, const ExprNode *index) {
+    if (slice->kind != EXPR_VAR || index->kind != EXPR_VAR) return false;
+
+    for (int i = 0; i < bounds_proof_count; i++) {
+        if (strcmp(bounds_proofs[i].slice, slice->text) == 0 && strcmp(bounds_proofs[i].index, index->text) == 0) return true;
+    }
+
+    return false;
+}
+
+// -fbounds-check, control only carries on when in_bounds holds
+static void build_bounds_check(LLVMValueRef in_bounds, LLVMValueRef index, LLVMValueRef length) {
+    LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMBasicBlockRef fail_block = LLVMAppendBasicBlockInContext(context, func, "bounds_fail");
+    LLVMBasicBlockRef ok_block = LLVMAppendBasicBlockInContext(context, func, "bounds_ok");
+
+    LLVMValueRef branch = LLVMBuildCondBr(builder, in_bounds, ok_block, fail_block);
+    const unsigned long long weights[2] = { 2000, 1 };
+    LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(context, "prof", 4),
+                    profile_metadata("branch_weights", weights, 2, LLVMInt32TypeInContext(context)));
+
+    LLVMPositionBuilderAtEnd(builder, fail_block);
+    LLVMValueRef fail_func = LLVMGetNamedFunction(module, "__cplus_bounds_fail_");
+    LLVMValueRef args[] = { index, length };
+    LLVMBuildCall2(builder, LLVMGlobalGetValueType(fail_func), fail_func, args, 2, "");
+    LLVMBuildUnreachable(builder);
+
+    LLVMPositionBuilderAtEnd(builder, ok_block);
+}
+
+// address of s[i], checked against the length unless the enclosing loop already proved it
+static LLVMValueRef slice_element_address(const ExprNode *expr) {
+    const ExprNode *slice_expr = expr->array_index.array;
+    const ExprNode *index_expr = expr->array_index.index;
+
+    LLVMValueRef slice = codegen_expression(slice_expr);
+    LLVMValueRef elements = LLVMBuildExtractValue(builder, slice, 0, "sliceptr");
+    LLVMValueRef index = convert_to_type(codegen_expression(index_expr), index_expr->type, TYPE_LONG);
+
+    if (options.bounds_check && !bounds_proven(slice_expr, index_expr)) {
+        // unsigned, so a negative index fails as well
+        LLVMValueRef length = LLVMBuildExtractValue(builder, slice, 1, "slicelen");
+        build_bounds_check(LLVMBuildICmp(builder, LLVMIntULT, index, length, "inbounds"), index, length);
+    }
+
+    return LLVMBuildGEP2(builder, get_llvm_type_with_pointers(expr->type, expr->pointer_level), elements, &index, 1, "sliceaddr");
+}
+
+// length of a fixed array, 0 for anything else
+static int fixed_array_size(const ExprNode *expr) {
+    if (expr->dim_count > 0) {
+        return expr->dim_count == 1 ? expr->dims[0] : 0;
+    }
+
+    if (expr->kind == EXPR_VAR) {
+        const CodegenSymbol *sym = lookup_var_full(expr->text);
+        return sym ? sym->array_size : 0;
+    }
+
+    if (expr->kind == EXPR_MEMBER && is_struct_type(expr->member.object->type) && !expr->member.object->is_slice) {
+        return struct_type_def(expr->member.object->type)->fields[expr->member.field_index].array_size;
+    }
+
+    return 0;
+}
+
+// s[start:end] of a slice, a fixed array or a pointer
+static LLVMValueRef codegen_slice(const ExprNode *expr) {
+    const ExprNode *object = expr->slice.object;
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+
+    LLVMValueRef elements;
+    LLVMValueRef length = NULL;
+    if (object->is_slice) {
+        LLVMValueRef slice = codegen_expression(object);
+        elements = LLVMBuildExtractValue(builder, slice, 0, "sliceptr");
+        length = LLVMBuildExtractValue(builder, slice, 1, "slicelen");
+    } else {
+        // fixed arrays decay to their first element, a pointer has no length and always comes with an end
+        elements = codegen_expression(object);
+        const int array_size = fixed_array_size(object);
+        if (array_size > 0) {
+            length = LLVMConstInt(i64_type, array_size, 0);
+        }
+    }
+
+    const ExprNode *start_expr = expr->slice.start;
+    const ExprNode *end_expr = expr->slice.end;
+    LLVMValueRef start = start_expr ? convert_to_type(codegen_expression(start_expr), start_expr->type, TYPE_LONG) : LLVMConstInt(i64_type, 0, 0);
+    LLVMValueRef end = end_expr ? convert_to_type(codegen_expression(end_expr), end_expr->type, TYPE_LONG) : length;
+
+    if (options.bounds_check && length && (start_expr || end_expr)) {
+        build_bounds_check(LLVMBuildICmp(builder, LLVMIntULE, end, length, "inbounds"), end, length);
+        build_bounds_check(LLVMBuildICmp(builder, LLVMIntULE, start, end, "inbounds"), start, end);
+    }
+
+    if (start_expr) {
+        elements = LLVMBuildGEP2(builder, get_llvm_type_with_pointers(expr->type, expr->pointer_level - 1), elements, &start, 1, "slicestart");
+    }
+
+    LLVMValueRef result = LLVMBuildInsertValue(builder, LLVMGetUndef(slice_llvm_type(expr->type, expr->pointer_level)), elements, 0, "");
+    return LLVMBuildInsertValue(builder, result, start_expr ? LLVMBuildSub(builder, end, start, "slicelen") : end, 1, "slice");
+}
+
+// a slice's elements have no parameter to carry an align attribute, so the promise goes through llvm.assume
+static void assume_aligned(LLVMValueRef pointer, const int alignment) {
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+    LLVMValueRef address = LLVMBuildPtrToInt(builder, pointer, i64_type, "addr");
+    LLVMValueRef low_bits = LLVMBuildAnd(builder, address, LLVMConstInt(i64_type, alignment - 1, 0), "lowbits");
+    LLVMValueRef aligned = LLVMBuildICmp(builder, LLVMIntEQ, low_bits, LLVMConstInt(i64_type, 0, 0), "aligned");
+
+    const unsigned id = LLVMLookupIntrinsicID("llvm.assume", strlen("llvm.assume"));
+    LLVMBuildCall2(builder, LLVMIntrinsicGetType(context, id, NULL, 0), LLVMGetIntrinsicDeclaration(module, id, NULL, 0), &aligned, 1, "");
+}
+
+// grid[i][j] as one gep over the whole array, a row stops early and decays to its first element
+static LLVMValueRef multi_dim_address(const ExprNode *expr) {
+    const ExprNode *root = expr;
+    int index_count = 0;
+    while (root->kind == EXPR_ARRAY_INDEX && root->array_index.array->dim_count > 0) {
+        root = root->array_index.array;
+        index_count++;
+    }
+
+    const CodegenSymbol *sym = lookup_var_full(root->text);
+    if (root->kind != EXPR_VAR || !sym) {
+        fprintf(stderr, "Codegen error: multi-dimensional array is not a variable\n");
+        exit(1);
+    }
+
+    // arrays start with a 0 to step into the storage, parameters already point at the first row
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+    const bool is_array = sym->array_size > 0;
+    LLVMValueRef *indices = malloc(sizeof(LLVMValueRef) * (root->dim_count + 2));
+    int count = 0;
+    if (is_array) {
+        indices[count++] = LLVMConstInt(i64_type, 0, 0);
+    }
+
+    count += index_count;
+    const ExprNode *node = expr;
+    for (int i = count - 1; node != root; i--, node = node->array_index.array) {
+        const ExprNode *index_expr = node->array_index.index;
+        indices[i] = convert_to_type(codegen_expression(index_expr), index_expr->type, TYPE_LONG);
+    }
+
+    if (options.bounds_check) {
+        for (int i = 0; i < index_count; i++) {
+            if (root->dims[i] <= 0) continue;
+
+            LLVMValueRef index = indices[count - index_count + i];
+            LLVMValueRef length = LLVMConstInt(i64_type, root->dims[i], 0);
+            build_bounds_check(LLVMBuildICmp(builder, LLVMIntULT, index, length, "inbounds"), index, length);
+        }
+    }
+
+    for (int i = 0; i < expr->dim_count; i++) {
+        indices[count++] = LLVMConstInt(i64_type, 0, 0);
+    }
+
+    LLVMValueRef base = sym->value;
+    LLVMTypeRef base_type = sym->llvm_type;
+    if (!is_array) {
+        base = LLVMBuildLoad2(builder, sym->llvm_type, sym->value, "rows");
+        base_type = LLVMGetElementType(sym->llvm_type);
+    }
+
+    LLVMValueRef address = LLVMBuildGEP2(builder, base_type, base, indices, count, expr->dim_count > 0 ? "row" : "gridaddr");
+    free(indices);
+    return address;
+}
+
+static LLVMValueRef codegen_lvalue_address(const ExprNode *expr);
+
+static LLVMValueRef codegen_member_address(const ExprNode *expr) {
+    const ExprNode *object = expr->member.object;
+
+    // soa[i].field is element i of the field's array
+    if (expr->member.is_soa) {
+        const CodegenSymbol *sym = lookup_var_full(object->array_index.array->text);
+        LLVMValueRef indices[3] = {
+            LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0),
+            LLVMConstInt(LLVMInt32TypeInContext(context), expr->member.field_index, 0),
+            codegen_expression(object->array_index.index)
+        };
+        return LLVMBuildGEP2(builder, sym->llvm_type, sym->value, indices, 3, expr->member.field_name);
+    }
+
+    LLVMValueRef base;
+    if (expr->member.through_pointer) {
+        base = codegen_expression(object);
+    } else if (object->kind == EXPR_VAR || object->kind == EXPR_ARRAY_INDEX || object->kind == EXPR_MEMBER ||
+               (object->kind == EXPR_UNARY && object->unary.op == UNARY_DEREF)) {
+        base = codegen_lvalue_address(object);
+    } else {
+        // struct rvalues (call results and the like) are spilled so the field can be addressed
+        base = build_struct_slot(object->type, "tmpstruct");
+        LLVMBuildStore(builder, codegen_expression(object), base);
+    }
+
+    const StructLayout *layout = struct_layout(object->type);
+    return LLVMBuildStructGEP2(builder, layout->type, base, layout->slots[expr->member.field_index], expr->member.field_name);
+}
+
+static LLVMValueRef codegen_lvalue_address(const ExprNode *expr) {
+    if (expr->kind == EXPR_VAR) {
+        const LLVMValueRef var = lookup_var(expr->text);
+        if (!var) {
+            fprintf(stderr, "Codegen error: Undefined variable '%s'\n", expr->text);
+            exit(1);
+        }
+        return var;
+    }
+    else if (expr->kind == EXPR_UNARY && expr->unary.op == UNARY_DEREF) {
+        return codegen_expression(expr->unary.operand);
+    }
+    else if (expr->kind == EXPR_MEMBER) {
+        return codegen_member_address(expr);
+    }
+    else if (expr->kind == EXPR_ARRAY_INDEX) {
+        const ExprNode *array_expr = expr->array_index.array;
+        const ExprNode *index_expr = expr->array_index.index;
+
+        if (array_expr->is_slice) {
+            return slice_element_address(expr);
+        }
+
+        if (array_expr->dim_count > 0) {
+            return multi_dim_address(expr);
+        }
+
+        // vector lane, addressed as an element of the vector's storage
+        if (is_vector_type(array_expr->type) && array_expr->pointer_level == 0) {
+            LLVMTypeRef lane_type = get_llvm_type(expr->type);
+            LLVMValueRef vec_ptr = codegen_lvalue_address(array_expr);
+            LLVMValueRef lanes = LLVMBuildBitCast(builder, vec_ptr, LLVMPointerType(lane_type, 0), "lanes");
+            LLVMValueRef index_val = codegen_expression(index_expr);
+            return LLVMBuildGEP2(builder, lane_type, lanes, &index_val, 1, "laneaddr");
+        }
+
+        LLVMValueRef array_ptr;
+        if (array_expr->kind == EXPR_VAR) {
+            array_ptr = lookup_var(array_expr->text);
+        } else {
+            array_ptr = codegen_expression(array_expr);
+        }
+
+        LLVMValueRef index_val = codegen_expression(index_expr);
+
+        CodegenSymbol *sym = NULL;
+        if (array_expr->kind == EXPR_VAR) {
+            sym = lookup_var_full(array_expr->text);
+        }
+
+        if (sym && sym->array_size > 0) {
+            LLVMTypeRef base_element_type = get_llvm_type_with_pointers(sym->type, sym->pointer_level - 1);
+            LLVMTypeRef array_type = LLVMArrayType(base_element_type, sym->array_size);
+            LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), index_val };
+            return LLVMBuildGEP2(builder, array_type, array_ptr, indices, 2, "arrayaddr");
+        } else {
+            LLVMTypeRef element_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
+            if (array_expr->kind == EXPR_VAR) {
+                LLVMTypeRef ptr_type = get_llvm_type_with_pointers(array_expr->type, array_expr->pointer_level);
+                array_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
+            }
+
+            return LLVMBuildGEP2(builder, element_type, array_ptr, &index_val, 1, "arrayaddr");
+        }
+    }
+
+    fprintf(stderr, "Expression is not an lvalue\n");
+    exit(1);
+}
+
+static LLVMValueRef build_intrinsic_call(const char *name, LLVMTypeRef overload, LLVMValueRef *args, const int arg_count, const char *value_name) {
+    const unsigned id = LLVMLookupIntrinsicID(name, strlen(name));
+    LLVMValueRef func = LLVMGetIntrinsicDeclaration(module, id, &overload, 1);
+    LLVMTypeRef func_type = LLVMIntrinsicGetType(context, id, &overload, 1);
+    return LLVMBuildCall2(builder, func_type, func, args, arg_count, value_name);
+}
+
+// pairwise tree of lane adds, so a float4 sum is two shuffle+add steps rather than a serial chain
+static LLVMValueRef build_horizontal_sum(LLVMValueRef vec, const TypeKind vec_type) {
+    const bool is_float = is_floating_type(vector_element_type(vec_type));
+    LLVMTypeRef i32_type = LLVMInt32TypeInContext(context);
+
+    for (int width = vector_lane_count(vec_type) / 2; width >= 1; width /= 2) {
+        LLVMValueRef mask[8];
+        for (int i = 0; i < vector_lane_count(vec_type); i++) {
+            mask[i] = i < width ? LLVMConstInt(i32_type, i + width, 0) : LLVMGetUndef(i32_type);
+        }
+
+        LLVMValueRef upper = LLVMBuildShuffleVector(builder, vec, LLVMGetUndef(LLVMTypeOf(vec)), LLVMConstVector(mask, vector_lane_count(vec_type)), "hsumhalf");
+        vec = is_float ? LLVMBuildFAdd(builder, vec, upper, "hsumtmp") : LLVMBuildAdd(builder, vec, upper, "hsumtmp");
+    }
+
+    return LLVMBuildExtractElement(builder, vec, LLVMConstInt(i32_type, 0, 0), "hsum");
+}
+
+// the memory order argument at index, seq_cst when it is left out
+static LLVMAtomicOrdering memory_order(const ExprNode *call, const int index) {
+    if (index >= call->call.arg_count) return LLVMAtomicOrderingSequentiallyConsistent;
+
+    switch (atoi(call->call.args[index]->text)) {
+        case 0: return LLVMAtomicOrderingMonotonic;
+        case 1: return LLVMAtomicOrderingAcquire;
+        case 2: return LLVMAtomicOrderingRelease;
+        case 3: return LLVMAtomicOrderingAcquireRelease;
+        default: return LLVMAtomicOrderingSequentiallyConsistent;
+    }
+}
+
+// atomics need the pointer typed as the value they operate on
+static LLVMValueRef atomic_pointer(const ExprNode *ptr_expr) {
+    LLVMValueRef ptr = codegen_expression(ptr_expr);
+    return LLVMBuildBitCast(builder, ptr, LLVMPointerType(get_llvm_type(ptr_expr->type), 0), "atomicptr");
+}
+
+// pthreads calls a void *(*)(void *), so each spawned function gets an entry that unpacks the argument and calls it
+static LLVMValueRef thread_entry(const char *name) {
+    char entry_name[256];
+    snprintf(entry_name, sizeof(entry_name), "__cplus_thread_%s", name);
+
+    LLVMValueRef entry = LLVMGetNamedFunction(module, entry_name);
+    if (entry) return entry;
+
+    LLVMTypeRef i8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+    LLVMValueRef target = LLVMGetNamedFunction(module, name);
+    LLVMTypeRef target_type = LLVMGlobalGetValueType(target);
+
+    entry = LLVMAddFunction(module, entry_name, LLVMFunctionType(i8_ptr_type, &i8_ptr_type, 1, 0));
+    LLVMSetLinkage(entry, LLVMInternalLinkage);
+
+    LLVMBuilderRef entry_builder = LLVMCreateBuilderInContext(context);
+    LLVMPositionBuilderAtEnd(entry_builder, LLVMAppendBasicBlockInContext(context, entry, "entry"));
+
+    LLVMValueRef arg = NULL;
+    const unsigned param_count = LLVMCountParamTypes(target_type);
+    if (param_count == 1) {
+        LLVMTypeRef param_type;
+        LLVMGetParamTypes(target_type, &param_type);
+
+        arg = LLVMGetParam(entry, 0);
+        arg = LLVMGetTypeKind(param_type) == LLVMPointerTypeKind ? LLVMBuildBitCast(entry_builder, arg, param_type, "threadarg")
+                                                                  : LLVMBuildPtrToInt(entry_builder, arg, param_type, "threadarg");
+    }
+
+    LLVMBuildCall2(entry_builder, target_type, target, &arg, param_count, "");
+    LLVMBuildRet(entry_builder, LLVMConstNull(i8_ptr_type));
+    LLVMDisposeBuilder(entry_builder);
+    return entry;
+}
+
+static LLVMValueRef codegen_intrinsic_call(const ExprNode *expr) {
+    ExprNode **args = expr->call.args;
+    const TypeKind vec_type = expr->call.arg_count > 0 ? args[0]->type : TYPE_VOID;
+    LLVMTypeRef i32_type = LLVMInt32TypeInContext(context);
+
+    switch (expr->call.intrinsic) {
+        case INTRINSIC_SHUFFLE: {
+            const int lanes = vector_lane_count(vec_type);
+            const int sources = expr->call.arg_count - lanes;
+
+            LLVMValueRef first = codegen_expression(args[0]);
+            LLVMValueRef second = sources == 2 ? codegen_expression(args[1]) : LLVMGetUndef(LLVMTypeOf(first));
+
+            LLVMValueRef mask[8];
+            for (int i = 0; i < lanes; i++) {
+                mask[i] = LLVMConstInt(i32_type, strtoull(args[sources + i]->text, NULL, 10), 0);
+            }
+
+            return LLVMBuildShuffleVector(builder, first, second, LLVMConstVector(mask, lanes), "shuffle");
+        }
+        case INTRINSIC_SELECT: {
+            LLVMValueRef mask = codegen_expression(args[0]);
+            LLVMValueRef if_set = codegen_expression(args[1]);
+            LLVMValueRef if_clear = convert_to_type(codegen_expression(args[2]), args[2]->type, args[1]->type);
+
+            LLVMValueRef cond = LLVMBuildICmp(builder, LLVMIntNE, mask, LLVMConstNull(LLVMTypeOf(mask)), "selmask");
+            return LLVMBuildSelect(builder, cond, if_set, if_clear, "select");
+        }
+        case INTRINSIC_HSUM: {
+            return build_horizontal_sum(codegen_expression(args[0]), vec_type);
+        }
+        case INTRINSIC_HMIN:
+        case INTRINSIC_HMAX: {
+            const bool is_float = is_floating_type(vector_element_type(vec_type));
+            const bool is_min = expr->call.intrinsic == INTRINSIC_HMIN;
+
+            const char *name = is_float ? (is_min ? "llvm.vector.reduce.fmin" : "llvm.vector.reduce.fmax")
+                                        : (is_min ? "llvm.vector.reduce.smin" : "llvm.vector.reduce.smax");
+
+            LLVMValueRef vec = codegen_expression(args[0]);
+            return build_intrinsic_call(name, LLVMTypeOf(vec), &vec, 1, is_min ? "hmin" : "hmax");
+        }
+        case INTRINSIC_VLOAD:
+        case INTRINSIC_VLOAD_ALIGNED: {
+            LLVMValueRef ptr = codegen_expression(args[0]);
+            LLVMValueRef load = LLVMBuildLoad2(builder, get_llvm_type(vec_type), ptr, "vload");
+
+            // unaligned loads only assume the alignment of a single lane
+            LLVMSetAlignment(load, expr->call.intrinsic == INTRINSIC_VLOAD_ALIGNED ? vector_lane_count(vec_type) * 4 : 4);
+            return load;
+        }
+        case INTRINSIC_VSTORE:
+        case INTRINSIC_VSTORE_ALIGNED: {
+            LLVMValueRef ptr = codegen_expression(args[0]);
+            LLVMValueRef value = convert_to_type(codegen_expression(args[1]), args[1]->type, vec_type);
+
+            LLVMValueRef store = LLVMBuildStore(builder, value, ptr);
+            LLVMSetAlignment(store, expr->call.intrinsic == INTRINSIC_VSTORE_ALIGNED ? vector_lane_count(vec_type) * 4 : 4);
+            return store;
+        }
+        case INTRINSIC_LIKELY:
+        case INTRINSIC_UNLIKELY: {
+            LLVMTypeRef i1_type = LLVMInt1TypeInContext(context);
+            LLVMValueRef cond = codegen_expression(args[0]);
+            if (LLVMTypeOf(cond) != i1_type) {
+                cond = LLVMBuildICmp(builder, LLVMIntNE, cond, LLVMConstNull(LLVMTypeOf(cond)), "hintcond");
+            }
+
+            LLVMValueRef expect_args[2] = { cond, LLVMConstInt(i1_type, expr->call.intrinsic == INTRINSIC_LIKELY, 0) };
+            return build_intrinsic_call("llvm.expect", i1_type, expect_args, 2, "expect");
+        }
+        case INTRINSIC_POPCOUNT:
+        case INTRINSIC_BSWAP: {
+            LLVMValueRef value = codegen_expression(args[0]);
+            const bool is_popcount = expr->call.intrinsic == INTRINSIC_POPCOUNT;
+            return build_intrinsic_call(is_popcount ? "llvm.ctpop" : "llvm.bswap", LLVMTypeOf(value), &value, 1, is_popcount ? "popcount" : "bswap");
+        }
+        case INTRINSIC_CLZ:
+        case INTRINSIC_CTZ: {
+            // zero is not poison, clz(0) and ctz(0) give the bit width
+            const bool is_clz = expr->call.intrinsic == INTRINSIC_CLZ;
+            LLVMValueRef count_args[2] = { codegen_expression(args[0]), LLVMConstInt(LLVMInt1TypeInContext(context), 0, 0) };
+            return build_intrinsic_call(is_clz ? "llvm.ctlz" : "llvm.cttz", LLVMTypeOf(count_args[0]), count_args, 2, is_clz ? "clz" : "ctz");
+        }
+        case INTRINSIC_ROTL:
+        case INTRINSIC_ROTR: {
+            // a rotate is a funnel shift of the value with itself
+            const bool is_left = expr->call.intrinsic == INTRINSIC_ROTL;
+            LLVMValueRef value = codegen_expression(args[0]);
+            LLVMValueRef amount = convert_to_type(codegen_expression(args[1]), args[1]->type, args[0]->type);
+
+            LLVMValueRef shift_args[3] = { value, value, amount };
+            return build_intrinsic_call(is_left ? "llvm.fshl" : "llvm.fshr", LLVMTypeOf(value), shift_args, 3, is_left ? "rotl" : "rotr");
+        }
+        case INTRINSIC_ADD_OVERFLOW:
+        case INTRINSIC_SUB_OVERFLOW:
+        case INTRINSIC_MUL_OVERFLOW: {
+            // the operation is done in the result's type and its signedness
+            const TypeKind result_type = args[2]->type;
+            const bool is_unsigned = is_unsigned_type(result_type);
+
+            const char *name;
+            switch (expr->call.intrinsic) {
+                case INTRINSIC_ADD_OVERFLOW: name = is_unsigned ? "llvm.uadd.with.overflow" : "llvm.sadd.with.overflow"; break;
+                case INTRINSIC_SUB_OVERFLOW: name = is_unsigned ? "llvm.usub.with.overflow" : "llvm.ssub.with.overflow"; break;
+                default:                     name = is_unsigned ? "llvm.umul.with.overflow" : "llvm.smul.with.overflow"; break;
+            }
+
+            LLVMValueRef operands[2] = {
+                convert_to_type(codegen_expression(args[0]), args[0]->type, result_type),
+                convert_to_type(codegen_expression(args[1]), args[1]->type, result_type),
+            };
+            LLVMValueRef out = codegen_expression(args[2]);
+
+            LLVMValueRef pair = build_intrinsic_call(name, get_llvm_type(result_type), operands, 2, "ovftmp");
+            LLVMBuildStore(builder, LLVMBuildExtractValue(builder, pair, 0, "ovfresult"), out);
+            return LLVMBuildExtractValue(builder, pair, 1, "overflow");
+        }
+        case INTRINSIC_SPAWN: {
+            LLVMTypeRef i8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+            LLVMValueRef arg = LLVMConstNull(i8_ptr_type);
+
+            // the argument travels through pthreads as a void*, the entry function turns it back
+            if (expr->call.arg_count == 2) {
+                arg = codegen_expression(args[1]);
+                if (args[1]->pointer_level > 0) {
+                    arg = LLVMBuildBitCast(builder, arg, i8_ptr_type, "spawnarg");
+                } else {
+                    LLVMTypeRef param_type;
+                    LLVMGetParamTypes(LLVMGlobalGetValueType(LLVMGetNamedFunction(module, args[0]->text)), &param_type);
+                    arg = LLVMBuildIntToPtr(builder, LLVMBuildIntCast2(builder, arg, param_type, !is_unsigned_type(args[1]->type), "spawncast"), i8_ptr_type, "spawnarg");
+                }
+            }
+
+            LLVMValueRef spawn_func = LLVMGetNamedFunction(module, "__cplus_spawn_");
+            LLVMValueRef spawn_args[2] = { thread_entry(args[0]->text), arg };
+            return LLVMBuildCall2(builder, LLVMGlobalGetValueType(spawn_func), spawn_func, spawn_args, 2, "thread");
+        }
+        case INTRINSIC_ATOMIC_LOAD: {
+            LLVMTypeRef value_type = get_llvm_type(args[0]->type);
+            LLVMValueRef load = LLVMBuildLoad2(builder, value_type, atomic_pointer(args[0]), "atomicload");
+            LLVMSetOrdering(load, memory_order(expr, 1));
+            LLVMSetAlignment(load, LLVMGetIntTypeWidth(value_type) / 8);
+            return load;
+        }
+        case INTRINSIC_ATOMIC_STORE: {
+            LLVMTypeRef value_type = get_llvm_type(args[0]->type);
+            LLVMValueRef ptr = atomic_pointer(args[0]);
+            LLVMValueRef value = convert_to_type(codegen_expression(args[1]), args[1]->type, args[0]->type);
+
+            LLVMValueRef store = LLVMBuildStore(builder, value, ptr);
+            LLVMSetOrdering(store, memory_order(expr, 2));
+            LLVMSetAlignment(store, LLVMGetIntTypeWidth(value_type) / 8);
+            return store;
+        }
+        case INTRINSIC_ATOMIC_ADD:
+        case INTRINSIC_ATOMIC_SUB:
+        case INTRINSIC_ATOMIC_EXCHANGE: {
+            LLVMAtomicRMWBinOp op = LLVMAtomicRMWBinOpXchg;
+            if (expr->call.intrinsic == INTRINSIC_ATOMIC_ADD) op = LLVMAtomicRMWBinOpAdd;
+            if (expr->call.intrinsic == INTRINSIC_ATOMIC_SUB) op = LLVMAtomicRMWBinOpSub;
+
+            LLVMValueRef ptr = atomic_pointer(args[0]);
+            LLVMValueRef value = convert_to_type(codegen_expression(args[1]), args[1]->type, args[0]->type);
+            return LLVMBuildAtomicRMW(builder, op, ptr, value, memory_order(expr, 2), 0);
+        }
+        case INTRINSIC_CAS: {
+            // a failed compare only loads, so it cannot have release semantics
+            const LLVMAtomicOrdering success = memory_order(expr, 3);
+            LLVMAtomicOrdering failure = success;
+            if (success == LLVMAtomicOrderingRelease) failure = LLVMAtomicOrderingMonotonic;
+            if (success == LLVMAtomicOrderingAcquireRelease) failure = LLVMAtomicOrderingAcquire;
+
+            LLVMValueRef ptr = atomic_pointer(args[0]);
+            LLVMValueRef expected = convert_to_type(codegen_expression(args[1]), args[1]->type, args[0]->type);
+            LLVMValueRef desired = convert_to_type(codegen_expression(args[2]), args[2]->type, args[0]->type);
+
+            LLVMValueRef pair = LLVMBuildAtomicCmpXchg(builder, ptr, expected, desired, success, failure, 0);
+            return LLVMBuildExtractValue(builder, pair, 1, "cas");
+        }
+        case INTRINSIC_FENCE: {
+            return LLVMBuildFence(builder, memory_order(expr, 0), 0, "");
+        }
+        default: {
+            fprintf(stderr, "Codegen error: unsupported intrinsic '%s'\n", expr->call.function_name);
+            exit(1);
+        }
+    }
+}
+
+static const FunctionNode* find_function(const char *name) {
+    for (int i = 0; i < current_program->function_count; i++) {
+        if (strcmp(current_program->functions[i]->name, name) == 0) {
+            return current_program->functions[i];
+        }
+    }
+
+    return NULL;
+}
+
+// a call to a function taking or returning structs by value, lowered the same way as its signature
+static LLVMValueRef codegen_struct_abi_call(const FunctionNode *callee, LLVMValueRef func, LLVMTypeRef func_type, const ExprNode *expr) {
+    LLVMValueRef *args = malloc(sizeof(LLVMValueRef) * (expr->call.arg_count * 2 + 1));
+    int count = 0;
+
+    const bool returns_struct = is_struct_value(callee->return_type, callee->return_pointer_level);
+    LLVMValueRef result_slot = NULL;
+    if (returns_struct && struct_abi(callee->return_type).in_memory) {
+        result_slot = build_struct_slot(callee->return_type, "sret");
+        args[count++] = result_slot;
+    }
+
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        const ParamNode *param = &callee->params[i];
+        LLVMValueRef value = codegen_expression(expr->call.args[i]);
+
+        if (!is_struct_value(param->type, param->pointer_level)) {
+            if (param->pointer_level == 0 && expr->call.args[i]->pointer_level == 0 && is_numeric_type(expr->call.args[i]->type)) {
+                value = convert_to_type(value, expr->call.args[i]->type, param->type);
+            }
+
+            args[count++] = value;
+            continue;
+        }
+
+        const StructAbi abi = struct_abi(param->type);
+        if (abi.in_memory) {
+            // the callee gets its own copy through byval, this slot only has to hold the value
+            LLVMValueRef slot = build_struct_slot(param->type, "byval");
+            LLVMBuildStore(builder, value, slot);
+            args[count++] = slot;
+        } else if (abi.part_count == 1) {
+            args[count++] = coerce_through_memory(value, abi.parts[0]);
+        } else {
+            LLVMValueRef parts = coerce_through_memory(value, struct_abi_register_type(&abi));
+            for (int j = 0; j < abi.part_count; j++) {
+                args[count++] = LLVMBuildExtractValue(builder, parts, j, "part");
+            }
+        }
+    }
+
+    const bool returns_void = LLVMGetTypeKind(LLVMGetReturnType(func_type)) == LLVMVoidTypeKind;
+
+    debug_set_location(expr->location);
+    LLVMValueRef call = LLVMBuildCall2(builder, func_type, func, args, count, returns_void ? "" : "calltmp");
+    add_param_attributes(call, callee, true);
+    free(args);
+
+    if (!returns_struct) return is_string_expr(expr) ? owned_string(call) : call;
+    if (result_slot) return LLVMBuildLoad2(builder, struct_llvm_type(callee->return_type), result_slot, "sretval");
+    return coerce_through_memory(call, struct_llvm_type(callee->return_type));
+}
+
+// s += x. a local in a loop is appended to in place: the runtime grows its string with spare capacity and only
+// copies it when something else holds a reference, so the string is always ready to be read. anywhere else
+// it is an ordinary concatenation
+static LLVMValueRef codegen_string_append(const ExprNode *expr) {
+    LLVMValueRef piece = codegen_expression(expr->binop.right);
+    LLVMValueRef target = codegen_lvalue_address(expr->binop.left);
+    LLVMTypeRef str_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+
+    if (is_string_slot(target) && (current_continue_target || tail_loop_block)) {
+        // the append takes over the variable's reference and hands back the one for the result
+        LLVMValueRef func = LLVMGetNamedFunction(module, "__cplus_string_append_");
+        LLVMValueRef args[] = { LLVMBuildLoad2(builder, str_type, target, "appendto"), piece };
+        LLVMValueRef result = LLVMBuildCall2(builder, LLVMGlobalGetValueType(func), func, args, 2, "appended");
+        LLVMBuildStore(builder, result, target);
+        return result;
+    }
+
+    LLVMValueRef result = build_string_concat(LLVMBuildLoad2(builder, str_type, target, "loadlhs"), piece);
+    if (is_string_slot(target) || LLVMIsAGlobalVariable(target)) {
+        store_owned_string(result, target);
+    } else {
+        mark_access(LLVMBuildStore(builder, take_string(result), target), expr->binop.left);
+    }
+    return result;
+}
+
+static LLVMValueRef codegen_expression(const ExprNode* expr) {
+    if (!expr) {
+        fprintf(stderr, "Error: null expression in codegen\n");
+        exit(1);
+    }
+    switch (expr->kind) {
+        case EXPR_NUMBER: {
+            if (expr->type == TYPE_FLOAT) {
+                float value = atof(expr->text);
+                return LLVMConstReal(LLVMFloatTypeInContext(context), value);
+            }
+
+            if (expr->type == TYPE_DOUBLE) {
+                double value = atof(expr->text);
+                return LLVMConstReal(LLVMDoubleTypeInContext(context), value);
+            }
+
+            if (expr->type == TYPE_CHAR) {
+                const int value = atoi(expr->text);
+                return LLVMConstInt(LLVMInt8TypeInContext(context), value, 0);
+            }
+
+            if (expr->type == TYPE_LONG || expr->type == TYPE_ULONG) {
+                const unsigned long long value = strtoull(expr->text, NULL, 10);
+                return LLVMConstInt(LLVMInt64TypeInContext(context), value, 0);
+            }
+
+            const unsigned long long value = strtoull(expr->text, NULL, 10);
+            return LLVMConstInt(LLVMInt32TypeInContext(context), value, 0);
+        }
+        case EXPR_STRING_LITERAL: {
+            return codegen_global_string(expr->text);
+        }
+        case EXPR_VAR: {
+            CodegenSymbol *sym = lookup_var_full(expr->text);
+
+            if (!sym) {
+                fprintf(stderr, "Codegen error: undefined variable '%s'\n", expr->text);
+                exit(1);
+            }
+
+            LLVMValueRef var = sym->value;
+
+            // a multi-dimensional array decays to a pointer to its first row
+            if (expr->dim_count > 0) {
+                if (sym->array_size <= 0) {
+                    return LLVMBuildLoad2(builder, sym->llvm_type, var, "rows");
+                }
+
+                LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0) };
+                return LLVMBuildGEP2(builder, sym->llvm_type, var, indices, 2, "arraydecay");
+            }
+
+            // If it is a stack array, decay to pointer to first element
+            if (sym->array_size > 0) {
+                LLVMTypeRef element_type = get_llvm_type_with_pointers(sym->type, sym->pointer_level - 1);
+                LLVMTypeRef array_type = LLVMArrayType(element_type, sym->array_size);
+
+                LLVMValueRef indices[2];
+                indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
+                indices[1] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
 
                 return LLVMBuildGEP2(builder, array_type, var, indices, 2, "arraydecay");
             }
 
             // Normal variable: Load with the correct type including pointer level
-            LLVMTypeRef var_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
-            return LLVMBuildLoad2(builder, var_type, var, "loadtmp");
+            LLVMTypeRef var_type = get_llvm_value_type(expr->type, expr->pointer_level, expr->is_slice);
+            LLVMValueRef value = LLVMBuildLoad2(builder, var_type, var, "loadtmp");
+
+            // a call made while the string is in use may reassign a global, so the statement keeps it alive
+            if (is_string_expr(expr) && LLVMIsAGlobalVariable(var)) {
+                string_refcount("__cplus_string_retain_", value);
+                owned_string(value);
+            }
+
+            return value;
         }
         case EXPR_BINOP: {
             if (!expr->binop.left) {
@@ -395,19 +2782,44 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                 exit(1);
             }
 
-            if (expr->binop.op == BIN_ADD_ASSIGN || expr->binop.op == BIN_SUB_ASSIGN || expr->binop.op == BIN_MUL_ASSIGN || expr->binop.op == BIN_DIV_ASSIGN) {
+            if (expr->binop.op == BIN_ADD_ASSIGN && is_string_expr(expr->binop.left)) {
+                return codegen_string_append(expr);
+            }
+
+            if (is_assignment_op(expr->binop.op) && expr->binop.op != BIN_ASSIGN) {
+                const TypeKind lhs_kind = expr->binop.left->type;
 
                 LLVMValueRef lhs_ptr = codegen_lvalue_address(expr->binop.left);
                 LLVMTypeRef lhs_type = get_llvm_type_with_pointers(expr->binop.left->type, expr->binop.left->pointer_level);
-                LLVMValueRef lhs_val = LLVMBuildLoad2(builder, lhs_type, lhs_ptr, "loadlhs");
+                LLVMValueRef lhs_val = mark_access(LLVMBuildLoad2(builder, lhs_type, lhs_ptr, "loadlhs"), expr->binop.left);
                 LLVMValueRef rhs_val = codegen_expression(expr->binop.right);
                 LLVMValueRef result = NULL;
 
+                // scalars are computed in their common type like the plain operators and narrowed back on the store
+                TypeKind op_type = lhs_kind;
+                if (expr->binop.left->pointer_level == 0 && expr->binop.right->pointer_level == 0 &&
+                    is_numeric_type(lhs_kind) && is_numeric_type(expr->binop.right->type)) {
+                    const bool is_shift = expr->binop.op == BIN_SHL_ASSIGN || expr->binop.op == BIN_SHR_ASSIGN;
+                    op_type = is_shift ? promote_integer_type(lhs_kind) : arithmetic_common_type(lhs_kind, expr->binop.right->type);
+                    lhs_val = convert_to_type(lhs_val, lhs_kind, op_type);
+                    rhs_val = convert_to_type(rhs_val, expr->binop.right->type, op_type);
+                } else if (expr->binop.left->pointer_level == 0 && expr->binop.right->pointer_level == 0 &&
+                           (is_numeric_type(expr->binop.right->type) || is_vector_type(expr->binop.right->type))) {
+                    rhs_val = convert_to_type(rhs_val, expr->binop.right->type, lhs_kind);
+                }
+
+                if (is_vector_type(lhs_kind)) {
+                    result = build_vector_binop(expr->binop.op, lhs_val, rhs_val, lhs_kind);
+                    mark_access(LLVMBuildStore(builder, result, lhs_ptr), expr->binop.left);
+                    return result;
+                }
+
                 if (expr->binop.op == BIN_ADD_ASSIGN) {
                      if (expr->binop.left->pointer_level > 0) {
                          result = LLVMBuildGEP2(builder, LLVMInt8TypeInContext(context), lhs_val, &rhs_val, 1, "padd");
-                     } else if (is_floating_type(expr->binop.left->type)) {
-                         result = LLVMBuildFAdd(builder, lhs_val, rhs_val, "fadd");
+                     } else if (is_floating_type(op_type)) {
+                         result = build_fp_contract(lhs_val, rhs_val, false);
+                         if (!result) result = LLVMBuildFAdd(builder, lhs_val, rhs_val, "fadd");
                      } else {
                          result = LLVMBuildAdd(builder, lhs_val, rhs_val, "add");
                      }
@@ -416,74 +2828,95 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                      if (expr->binop.left->pointer_level > 0) {
                          LLVMValueRef neg_rhs = LLVMBuildNeg(builder, rhs_val, "neg");
                          result = LLVMBuildGEP2(builder, LLVMInt8TypeInContext(context), lhs_val, &neg_rhs, 1, "psub");
-                     } else if (is_floating_type(expr->binop.left->type)) {
-                         result = LLVMBuildFSub(builder, lhs_val, rhs_val, "fsub");
+                     } else if (is_floating_type(op_type)) {
+                         result = build_fp_contract(lhs_val, rhs_val, true);
+                         if (!result) result = LLVMBuildFSub(builder, lhs_val, rhs_val, "fsub");
                      } else {
                          result = LLVMBuildSub(builder, lhs_val, rhs_val, "sub");
                      }
                 }
                 else if (expr->binop.op == BIN_MUL_ASSIGN) {
-                     if (is_floating_type(expr->binop.left->type)) result = LLVMBuildFMul(builder, lhs_val, rhs_val, "fmul");
+                     if (is_floating_type(op_type)) result = LLVMBuildFMul(builder, lhs_val, rhs_val, "fmul");
                      else result = LLVMBuildMul(builder, lhs_val, rhs_val, "mul");
                 }
                 else if (expr->binop.op == BIN_DIV_ASSIGN) {
-                     if (is_floating_type(expr->binop.left->type)) result = LLVMBuildFDiv(builder, lhs_val, rhs_val, "fdiv");
+                     if (is_floating_type(op_type)) result = LLVMBuildFDiv(builder, lhs_val, rhs_val, "fdiv");
+                     else if (is_unsigned_type(op_type)) result = LLVMBuildUDiv(builder, lhs_val, rhs_val, "div");
                      else result = LLVMBuildSDiv(builder, lhs_val, rhs_val, "div");
                 }
+                else if (expr->binop.op == BIN_MOD_ASSIGN) {
+                     if (is_floating_type(op_type)) result = LLVMBuildFRem(builder, lhs_val, rhs_val, "frem");
+                     else if (is_unsigned_type(op_type)) result = LLVMBuildURem(builder, lhs_val, rhs_val, "rem");
+                     else result = LLVMBuildSRem(builder, lhs_val, rhs_val, "rem");
+                }
+                else {
+                     result = build_bitwise(expr->binop.op, lhs_val, rhs_val, is_unsigned_type(op_type));
+                }
 
-                LLVMBuildStore(builder, result, lhs_ptr);
+                if (expr->binop.left->pointer_level == 0) {
+                    result = convert_to_type(result, op_type, lhs_kind);
+                }
+
+                mark_access(LLVMBuildStore(builder, result, lhs_ptr), expr->binop.left);
                 return result;
             }
 
-            LLVMValueRef left = codegen_expression(expr->binop.left);
-            LLVMValueRef right = codegen_expression(expr->binop.right);
-
-            if (expr->binop.op == BIN_EQUAL || expr->binop.op == BIN_NOT_EQUAL ||
-                expr->binop.op == BIN_LESS || expr->binop.op == BIN_GREATER ||
-                expr->binop.op == BIN_LESS_EQ || expr->binop.op == BIN_GREATER_EQ) {
-
-                TypeKind left_type = expr->binop.left->type;
-                TypeKind right_type = expr->binop.right->type;
+            if (expr->binop.op == BIN_ASSIGN) {
+                LLVMValueRef rhs_val = codegen_expression(expr->binop.right);
+                LLVMValueRef lhs_ptr = codegen_lvalue_address(expr->binop.left);
 
-                if (left_type != right_type) {
-                    // Char/Int
-                    if (left_type == TYPE_CHAR && right_type == TYPE_INT) {
-                        left = convert_to_type(left, TYPE_CHAR, TYPE_INT);
-                    } else if (left_type == TYPE_INT && right_type == TYPE_CHAR) {
-                        right = convert_to_type(right, TYPE_CHAR, TYPE_INT);
+                // variables let go of the string they held. fields, elements and pointees may never have been
+                // initialized, so their old string is left alone
+                if (is_string_expr(expr->binop.left)) {
+                    if (is_string_slot(lhs_ptr) || LLVMIsAGlobalVariable(lhs_ptr)) {
+                        store_owned_string(rhs_val, lhs_ptr);
+                    } else {
+                        mark_access(LLVMBuildStore(builder, take_string(rhs_val), lhs_ptr), expr->binop.left);
                     }
+                    return rhs_val;
+                }
 
-                    // Int/Long
-                    else if (left_type == TYPE_INT && right_type == TYPE_LONG) {
-                        left = convert_to_type(left, TYPE_INT, TYPE_LONG);
-                    } else if (left_type == TYPE_LONG && right_type == TYPE_INT) {
-                        right = convert_to_type(right, TYPE_INT, TYPE_LONG);
-                    }
-                    // Char/Long
-                    else if (left_type == TYPE_CHAR && right_type == TYPE_LONG) {
-                        left = convert_to_type(left, TYPE_CHAR, TYPE_LONG);
-                    } else if (left_type == TYPE_LONG && right_type == TYPE_CHAR) {
-                        right = convert_to_type(right, TYPE_CHAR, TYPE_LONG);
-                    }
+                if (expr->binop.left->pointer_level == 0 && expr->binop.right->pointer_level == 0 &&
+                    (is_numeric_type(expr->binop.right->type) || is_vector_type(expr->binop.right->type))) {
+                    rhs_val = convert_to_type(rhs_val, expr->binop.right->type, expr->binop.left->type);
                 }
+
+                mark_access(LLVMBuildStore(builder, rhs_val, lhs_ptr), expr->binop.left);
+                return rhs_val;
+            }
+
+            LLVMValueRef left = codegen_expression(expr->binop.left);
+            LLVMValueRef right = codegen_expression(expr->binop.right);
+
+            if (is_vector_type(expr->binop.left->type) || is_vector_type(expr->binop.right->type)) {
+                const TypeKind vec_type = is_vector_type(expr->binop.left->type) ? expr->binop.left->type : expr->binop.right->type;
+                left = convert_to_type(left, expr->binop.left->type, vec_type);
+                right = convert_to_type(right, expr->binop.right->type, vec_type);
+                return build_vector_binop(expr->binop.op, left, right, vec_type);
+            }
+
+            const TypeKind left_kind = expr->binop.left->type;
+            const TypeKind right_kind = expr->binop.right->type;
+            const bool numeric_operands = is_numeric_type(left_kind) && is_numeric_type(right_kind) &&
+                                          expr->binop.left->pointer_level == 0 && expr->binop.right->pointer_level == 0;
+
+            // both sides are brought to their common type first (see arithmetic_common_type), a shift keeps the
+            // promoted type of its left side
+            TypeKind common = left_kind;
+            if (numeric_operands && (is_arithmetic_op(expr->binop.op) || is_bitwise_op(expr->binop.op) || is_comparison_op(expr->binop.op))) {
+                const bool is_shift = expr->binop.op == BIN_SHL || expr->binop.op == BIN_SHR;
+                common = is_shift ? promote_integer_type(left_kind) : arithmetic_common_type(left_kind, right_kind);
+                left = convert_to_type(left, left_kind, common);
+                right = convert_to_type(right, right_kind, common);
             }
+            const bool is_unsigned = numeric_operands && is_unsigned_type(common);
 
             switch (expr->binop.op) {
                 case BIN_ADD: {
                     bool l_is_str = (expr->binop.left->type == TYPE_STRING) || (expr->binop.left->type == TYPE_CHAR && expr->binop.left->pointer_level == 1);
                     bool r_is_str = (expr->binop.right->type == TYPE_STRING) || (expr->binop.right->type == TYPE_CHAR && expr->binop.right->pointer_level == 1);
                     if (l_is_str && r_is_str) {
-                        CodegenSymbol *sym = lookup_global_var_full("__cplus_str_concat");
-                        if (!sym) {
-                            fprintf(stderr, "Codegen Error: __cplus_str_concat not found (symbol missing)\n");
-                            exit(1);
-                        }
-
-                        LLVMValueRef func = sym->value;
-                        LLVMTypeRef func_type = sym->llvm_type; // Use the stored type!
-
-                        LLVMValueRef args[] = { left, right };
-                        return LLVMBuildCall2(builder, func_type, func, args, 2, "concat_res");
+                        return build_string_concat(left, right);
                     }
 
 
@@ -512,6 +2945,9 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                             right = LLVMBuildSIToFP(builder, right, target_type, "itof");
                         }
 
+                        LLVMValueRef contracted = build_fp_contract(left, right, false);
+                        if (contracted) return contracted;
+
                         return LLVMBuildFAdd(builder, left, right, "addtmp");
                     }
 
@@ -536,6 +2972,9 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                             LLVMTypeRef target_type = LLVMTypeOf(left);
                             right = LLVMBuildSIToFP(builder, right, target_type, "itof");
                         }
+                        LLVMValueRef contracted = build_fp_contract(left, right, true);
+                        if (contracted) return contracted;
+
                         return LLVMBuildFSub(builder, left, right, "subtmp");
                     }
 
@@ -581,80 +3020,29 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         return LLVMBuildFDiv(builder, left, right, "divtmp");
                     }
 
+                    if (is_unsigned) {
+                        return LLVMBuildUDiv(builder, left, right, "divtmp");
+                    }
+
                     return LLVMBuildSDiv(builder, left, right, "divtmp");
                 }
-                case BIN_ASSIGN: {
-                    LLVMValueRef rhs_val = codegen_expression(expr->binop.right);
-                    LLVMValueRef lhs_ptr;
-
-                    if (expr->binop.left->kind == EXPR_VAR) {
-                        // Assigning to a variable: x = 5
-                        lhs_ptr = lookup_var(expr->binop.left->text);
-
-                        if (!lhs_ptr) {
-                            fprintf(stderr, "Assignment to undefined variable '%s'\n", expr->binop.left->text);
-                            exit(1);
-                        }
-                    } else if (expr->binop.left->kind == EXPR_UNARY && expr->binop.left->unary.op == UNARY_DEREF) {
-                        // Dereferenced pointer assignment: *ptr = value
-                        // Just get the pointer value (don't load from it)
-                        lhs_ptr = codegen_expression(expr->binop.left->unary.operand);
-                    } else if (expr->binop.left->kind == EXPR_ARRAY_INDEX) {
-                        // Array element assignment: arr[i] = value
-                        // We need to compute the element pointer without loading the value
-
-                        ExprNode *array_expr = expr->binop.left->array_index.array;
-                        ExprNode *index_expr = expr->binop.left->array_index.index;
-
-                        LLVMValueRef array_ptr;
-
-                        if (array_expr->kind == EXPR_VAR) {
-                            array_ptr = lookup_var(array_expr->text);
-
-                            if (!array_ptr) {
-                                fprintf(stderr, "Codegen error: undefined array variable '%s'\n", array_expr->text);
-                                exit(1);
-                            }
-                        } else {
-                            array_ptr = codegen_expression(array_expr);
-                        }
-
-                        LLVMValueRef index_val = codegen_expression(index_expr);
-
-                        LLVMTypeRef element_type = get_llvm_type_with_pointers(
-                            expr->binop.left->type,
-                            expr->binop.left->pointer_level
-                        );
-
-                        // Check if this is an actual array or a pointer
-                        CodegenSymbol *sym = NULL;
-                        if (array_expr->kind == EXPR_VAR) {
-                            sym = lookup_var_full(array_expr->text);
-                        }
+                case BIN_MOD: {
+                    if (is_floating_type(common)) {
+                        return LLVMBuildFRem(builder, left, right, "remtmp");
+                    }
 
-                        if (sym && sym->array_size > 0) {
-                            // Actual array - use two-index GEP
-                            // Reconstruct array type [Size x ElementType]
-                            LLVMTypeRef base_element_type = get_llvm_type_with_pointers(sym->type, sym->pointer_level - 1);
-                            LLVMTypeRef array_type = LLVMArrayType(base_element_type, sym->array_size);
-
-                            LLVMValueRef indices[2];
-                            indices[0] = LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0);
-                            indices[1] = index_val;
-                            lhs_ptr = LLVMBuildGEP2(builder, array_type, array_ptr, indices, 2, "arrayidx");
-                        } else {
-                            // Pointer - load then single-index GEP
-                            LLVMTypeRef ptr_type = get_llvm_type_with_pointers(array_expr->type, array_expr->pointer_level);
-                            LLVMValueRef loaded_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
-                            lhs_ptr = LLVMBuildGEP2(builder, element_type, loaded_ptr, &index_val, 1, "arrayidx");
-                        }
-                    } else {
-                        fprintf(stderr, "Invalid lvalue in assignment\n");
-                        exit(1);
+                    if (is_unsigned) {
+                        return LLVMBuildURem(builder, left, right, "remtmp");
                     }
 
-                    LLVMBuildStore(builder, rhs_val, lhs_ptr);
-                    return rhs_val;
+                    return LLVMBuildSRem(builder, left, right, "remtmp");
+                }
+                case BIN_BIT_AND:
+                case BIN_BIT_OR:
+                case BIN_BIT_XOR:
+                case BIN_SHL:
+                case BIN_SHR: {
+                    return build_bitwise(expr->binop.op, left, right, is_unsigned);
                 }
                 case BIN_LESS: {
                     LLVMTypeRef left_type = LLVMTypeOf(left);
@@ -662,7 +3050,7 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         return LLVMBuildFCmp(builder, LLVMRealOLT, left, right, "cmptmp");
                     }
 
-                    return LLVMBuildICmp(builder, LLVMIntSLT, left, right, "cmptmp");
+                    return LLVMBuildICmp(builder, is_unsigned ? LLVMIntULT : LLVMIntSLT, left, right, "cmptmp");
                 }
                 case BIN_GREATER: {
                     LLVMTypeRef left_type = LLVMTypeOf(left);
@@ -670,7 +3058,7 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         return LLVMBuildFCmp(builder, LLVMRealOGT, left, right, "cmptmp");
                     }
 
-                    return LLVMBuildICmp(builder, LLVMIntSGT, left, right, "cmptmp");
+                    return LLVMBuildICmp(builder, is_unsigned ? LLVMIntUGT : LLVMIntSGT, left, right, "cmptmp");
                 }
                 case BIN_LESS_EQ: {
                     LLVMTypeRef left_type = LLVMTypeOf(left);
@@ -678,7 +3066,7 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         return LLVMBuildFCmp(builder, LLVMRealOLE, left, right, "cmptmp");
                     }
 
-                    return LLVMBuildICmp(builder, LLVMIntSLE, left, right, "cmptmp");
+                    return LLVMBuildICmp(builder, is_unsigned ? LLVMIntULE : LLVMIntSLE, left, right, "cmptmp");
                 }
                 case BIN_GREATER_EQ: {
                     LLVMTypeRef left_type = LLVMTypeOf(left);
@@ -686,24 +3074,14 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         return LLVMBuildFCmp(builder, LLVMRealOGE, left, right, "cmptmp");
                     }
 
-                    return LLVMBuildICmp(builder, LLVMIntSGE, left, right, "cmptmp");
+                    return LLVMBuildICmp(builder, is_unsigned ? LLVMIntUGE : LLVMIntSGE, left, right, "cmptmp");
                 }
                 case BIN_EQUAL: {
                     bool l_str = (expr->binop.left->type == TYPE_STRING || (expr->binop.left->type == TYPE_CHAR && expr->binop.left->pointer_level == 1));
                     bool r_str = (expr->binop.right->type == TYPE_STRING || (expr->binop.right->type == TYPE_CHAR && expr->binop.right->pointer_level == 1));
 
                     if (l_str && r_str) {
-                        CodegenSymbol *sym = lookup_global_var_full("__cplus_strcmp_");
-                        if (!sym) {
-                            fprintf(stderr, "Codegen Error: __cplus_strcmp_ not found (symbol missing)\n");
-                            exit(1);
-                        }
-
-                        LLVMValueRef func = sym->value;
-                        LLVMTypeRef func_type = sym->llvm_type; // Use the stored type!
-
-                        LLVMValueRef args[] = { left, right };
-                        return LLVMBuildCall2(builder, func_type, func, args, 2, "streq");
+                        return build_string_equals(left, right);
                     }
 
                     LLVMTypeRef left_type = LLVMTypeOf(left);
@@ -714,6 +3092,11 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                     return LLVMBuildICmp(builder, LLVMIntEQ, left, right, "cmptmp");
                 }
                 case BIN_NOT_EQUAL: {
+                    // semantic made both sides strings when either one was
+                    if (expr->binop.left->type == TYPE_STRING && expr->binop.right->type == TYPE_STRING) {
+                        return LLVMBuildNot(builder, build_string_equals(left, right), "strne");
+                    }
+
                     LLVMTypeRef left_type = LLVMTypeOf(left);
                     if (LLVMGetTypeKind(left_type) == LLVMFloatTypeKind || LLVMGetTypeKind(left_type) == LLVMDoubleTypeKind) {
                         return LLVMBuildFCmp(builder, LLVMRealONE, left, right, "neqtmp");
@@ -744,11 +3127,13 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                 LLVMValueRef ptr = codegen_lvalue_address(expr->unary.operand);
                 LLVMTypeRef type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
 
-                LLVMValueRef current_val = LLVMBuildLoad2(builder, type, ptr, "oldval");
+                LLVMValueRef current_val = mark_access(LLVMBuildLoad2(builder, type, ptr, "oldval"), expr->unary.operand);
 
                 LLVMValueRef step;
                 if (expr->type == TYPE_FLOAT || expr->type == TYPE_DOUBLE) {
                     step = LLVMConstReal(type, 1.0);
+                } else if (expr->pointer_level == 0) {
+                    step = LLVMConstInt(type, 1, 0);
                 } else {
                     step = LLVMConstInt(LLVMInt32TypeInContext(context), 1, 0);
                 }
@@ -767,7 +3152,7 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                     new_val = is_inc ? LLVMBuildAdd(builder, current_val, step, "inc") : LLVMBuildSub(builder, current_val, step, "dec");
                 }
 
-                LLVMBuildStore(builder, new_val, ptr);
+                mark_access(LLVMBuildStore(builder, new_val, ptr), expr->unary.operand);
                 if (expr->unary.op == UNARY_PRE_INC || expr->unary.op == UNARY_PRE_DEC) {
                     return new_val;
                 } else {
@@ -781,14 +3166,24 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                 LLVMValueRef ptr = codegen_expression(expr->unary.operand);
 
                 LLVMTypeRef deref_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
-                return LLVMBuildLoad2(builder, deref_type, ptr, "deref");
+                return mark_access(LLVMBuildLoad2(builder, deref_type, ptr, "deref"), expr);
             }
 
             if (expr->unary.op == UNARY_ADDR_OF) {
+                if (expr->unary.operand->kind == EXPR_MEMBER) {
+                    return codegen_member_address(expr->unary.operand);
+                }
+
+                if (expr->unary.operand->kind == EXPR_ARRAY_INDEX && expr->unary.operand->array_index.array->is_slice) {
+                    return slice_element_address(expr->unary.operand);
+                }
+
                 if (expr->unary.operand->kind == EXPR_VAR) {
                     // Return the pointer to the variable (don't load it)
                     LLVMValueRef var = lookup_var(expr->unary.operand->text);
                     return var;
+                } else if (expr->unary.operand->kind == EXPR_ARRAY_INDEX && expr->unary.operand->array_index.array->dim_count > 0) {
+                    return multi_dim_address(expr->unary.operand);
                 } else if (expr->unary.operand->kind == EXPR_ARRAY_INDEX) {
                     // Taking address of array element: &arr[i]
                     // We need to compute the element pointer without loading the value
@@ -806,9 +3201,8 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                             exit(1);
                         }
                     } else {
-                        // array_ptr here is the alloca (value)
-                        // Should probably be handled? But context above suggests logic for simple vars.
-                        // For EXPR_ARRAY_INDEX on non-var, we probably can't take address easily unless it's an lvalue
+                        // any other expression (a field, a call) evaluates straight to the pointer
+                        array_ptr = codegen_expression(array_expr);
                     }
 
                     LLVMValueRef index_val = codegen_expression(index_expr);
@@ -837,9 +3231,11 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                         element_ptr = LLVMBuildGEP2(builder, array_type, array_ptr, indices, 2, "arrayaddr");
                     } else {
                         // Pointer - load then single-index GEP
-                        LLVMTypeRef ptr_type = get_llvm_type_with_pointers(array_expr->type, array_expr->pointer_level);
-                        LLVMValueRef loaded_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
-                        element_ptr = LLVMBuildGEP2(builder, element_type, loaded_ptr, &index_val, 1, "arrayaddr");
+                        if (array_expr->kind == EXPR_VAR) {
+                            LLVMTypeRef ptr_type = get_llvm_type_with_pointers(array_expr->type, array_expr->pointer_level);
+                            array_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
+                        }
+                        element_ptr = LLVMBuildGEP2(builder, element_type, array_ptr, &index_val, 1, "arrayaddr");
                     }
 
                     // Return the pointer (don't load the value)
@@ -862,9 +3258,13 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                 return LLVMBuildICmp(builder, LLVMIntEQ, operand, zero, "nottmp");
             }
 
+            if (expr->unary.op == UNARY_BIT_NOT) {
+                return LLVMBuildNot(builder, operand, "nottmp");
+            }
+
             if (expr->unary.op == UNARY_NEG) {
                 // check if we need float negation or integer negation
-                if (expr->type == TYPE_FLOAT || expr->type == TYPE_DOUBLE) {
+                if (is_floating_type(vector_element_type(expr->type))) {
                     return LLVMBuildFNeg(builder, operand, "negtmp");
                 }
 
@@ -874,9 +3274,14 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
             break;
         }
         case EXPR_CALL: {
+            if (expr->call.intrinsic != INTRINSIC_NONE) {
+                return codegen_intrinsic_call(expr);
+            }
+
             CodegenSymbol *sym = lookup_var_full(expr->call.function_name);
             LLVMValueRef func = NULL;
             LLVMTypeRef func_type = NULL;
+            const FunctionNode *callee = NULL;
 
             if (sym) {
                 func = sym->value;
@@ -889,22 +3294,53 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
                 }
 
                 func_type = LLVMGlobalGetValueType(func);
+
+                callee = find_function(expr->call.function_name);
+                if (callee && function_passes_structs(callee)) {
+                    return codegen_struct_abi_call(callee, func, func_type, expr);
+                }
             }
 
             LLVMValueRef *args = malloc(sizeof(LLVMValueRef) * expr->call.arg_count);
             for (int i = 0; i < expr->call.arg_count; i++) {
-                args[i] = codegen_expression(expr->call.args[i]);
+                const ExprNode *arg = expr->call.args[i];
+                args[i] = codegen_expression(arg);
+
+                // numbers convert to the parameter type the same way an assignment would
+                if (callee && arg->pointer_level == 0 && callee->params[i].pointer_level == 0 && is_numeric_type(arg->type)) {
+                    args[i] = convert_to_type(args[i], arg->type, callee->params[i].type);
+                }
             }
 
             LLVMTypeRef ret_type = LLVMGetReturnType(func_type);
             const char *call_name = (LLVMGetTypeKind(ret_type) == LLVMVoidTypeKind) ? "" : "calltmp";
 
+            // arguments may contain calls of their own, make sure this one points at its own call site
+            debug_set_location(expr->location);
             const LLVMValueRef result = LLVMBuildCall2(builder, func_type, func, args, expr->call.arg_count, call_name);
 
             free(args);
-            return result;
+            return is_string_expr(expr) ? owned_string(result) : result;
         }
         case EXPR_ARRAY_INDEX: {
+            if (is_vector_type(expr->array_index.array->type) && expr->array_index.array->pointer_level == 0) {
+                LLVMValueRef vec = codegen_expression(expr->array_index.array);
+                return LLVMBuildExtractElement(builder, vec, codegen_expression(expr->array_index.index), "lane");
+            }
+
+            if (expr->array_index.array->is_slice) {
+                LLVMTypeRef element_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
+                return mark_access(LLVMBuildLoad2(builder, element_type, slice_element_address(expr), "sliceval"), expr);
+            }
+
+            if (expr->array_index.array->dim_count > 0) {
+                LLVMValueRef address = multi_dim_address(expr);
+                if (expr->dim_count > 0) return address;
+
+                LLVMTypeRef element_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
+                return mark_access(LLVMBuildLoad2(builder, element_type, address, "gridval"), expr);
+            }
+
             LLVMValueRef array_ptr;
 
             if (expr->array_index.array->kind == EXPR_VAR) {
@@ -945,102 +3381,860 @@ static LLVMValueRef codegen_expression(const ExprNode* expr) {
 
                 element_ptr = LLVMBuildGEP2(builder, array_type, array_ptr, indices, 2, "arrayidx");
             } else {
-                LLVMTypeRef ptr_type = get_llvm_type_with_pointers(expr->array_index.array->type, expr->array_index.array->pointer_level);
-                LLVMValueRef loaded_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
-                element_ptr = LLVMBuildGEP2(builder, element_type, loaded_ptr, &index_val, 1, "arrayidx");
+                // variables hold the pointer, any other expression already evaluated to it
+                if (expr->array_index.array->kind == EXPR_VAR) {
+                    LLVMTypeRef ptr_type = get_llvm_type_with_pointers(expr->array_index.array->type, expr->array_index.array->pointer_level);
+                    array_ptr = LLVMBuildLoad2(builder, ptr_type, array_ptr, "loadptr");
+                }
+                element_ptr = LLVMBuildGEP2(builder, element_type, array_ptr, &index_val, 1, "arrayidx");
+            }
+
+            // Load the value from the computed address
+            return mark_access(LLVMBuildLoad2(builder, element_type, element_ptr, "arrayval"), expr);
+        }
+        case EXPR_MEMBER: {
+            if (expr->member.object->type == TYPE_STRING && expr->member.object->pointer_level == 0) {
+                return string_length(codegen_expression(expr->member.object));
+            }
+
+            // .ptr and .len
+            if (expr->member.object->is_slice) {
+                return LLVMBuildExtractValue(builder, codegen_expression(expr->member.object), expr->member.field_index, expr->member.field_name);
+            }
+
+            LLVMValueRef address = codegen_member_address(expr);
+            const FieldNode *field = &struct_type_def(expr->member.object->type)->fields[expr->member.field_index];
+
+            // array fields decay to a pointer to their first element
+            if (field->array_size > 0) {
+                LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0) };
+                return LLVMBuildGEP2(builder, get_llvm_field_type(field), address, indices, 2, "arraydecay");
+            }
+
+            LLVMTypeRef field_type = get_llvm_type_with_pointers(expr->type, expr->pointer_level);
+            return mark_access(LLVMBuildLoad2(builder, field_type, address, field->name), expr);
+        }
+        case EXPR_SLICE: {
+            return codegen_slice(expr);
+        }
+        case EXPR_INIT_LIST: {
+            // struct values start from their constant fields, the rest are inserted
+            if (is_struct_value(expr->type, expr->pointer_level)) {
+                const StructNode *def = struct_type_def(expr->type);
+                const StructLayout *layout = struct_layout(expr->type);
+                LLVMValueRef value = codegen_constant(expr, expr->type, 0);
+
+                for (int i = 0; i < expr->init_list.count && i < def->field_count; i++) {
+                    const ExprNode *element = expr->init_list.elements[i];
+                    const FieldNode *field = &def->fields[i];
+                    if (codegen_constant(element, field->type, field->pointer_level)) continue;
+
+                    LLVMValueRef field_value = codegen_expression(element);
+                    if (field->pointer_level == 0 && element->pointer_level == 0 && is_numeric_type(element->type)) {
+                        field_value = convert_to_type(field_value, element->type, field->type);
+                    }
+                    if (is_string_expr(element)) {
+                        field_value = take_string(field_value);
+                    }
+
+                    value = LLVMBuildInsertValue(builder, value, field_value, layout->slots[i], "structinit");
+                }
+
+                return value;
+            }
+
+            // vectors get here too, arrays are filled in place by codegen_array_initializer
+            LLVMValueRef vec = codegen_constant(expr, expr->type, 0);
+
+            for (int i = 0; i < expr->init_list.count; i++) {
+                const ExprNode *element = expr->init_list.elements[i];
+                if (codegen_constant(element, vector_element_type(expr->type), 0)) continue;
+
+                LLVMValueRef value = convert_to_type(codegen_expression(element), element->type, vector_element_type(expr->type));
+                vec = LLVMBuildInsertElement(builder, vec, value, LLVMConstInt(LLVMInt32TypeInContext(context), i, 0), "vecinit");
+            }
+
+            return vec;
+        }
+        case EXPR_CAST: {
+            LLVMValueRef operand = codegen_expression(expr->cast.operand);
+
+            TypeKind from_type = expr->cast.operand->type;
+            TypeKind to_type = expr->cast.target_type;
+            int from_ptr = expr->cast.operand->pointer_level;
+            int to_ptr = expr->cast.target_pointer_level;
+
+            // splats and lane conversions
+            if (from_ptr == 0 && to_ptr == 0 && (is_vector_type(from_type) || is_vector_type(to_type))) {
+                return convert_to_type(operand, from_type, to_type);
+            }
+
+            // a char* needs a length header to be a string
+            if (from_ptr > 0 && to_type == TYPE_STRING && to_ptr == 0) {
+                LLVMValueRef from_func = LLVMGetNamedFunction(module, "__cplus_string_from_");
+                LLVMValueRef chars = LLVMBuildBitCast(builder, operand, LLVMPointerType(LLVMInt8TypeInContext(context), 0), "chars");
+                return owned_string(LLVMBuildCall2(builder, LLVMGetElementType(LLVMTypeOf(from_func)), from_func, &chars, 1, "string"));
+            }
+
+            // nothing tracks where a char* made from a string goes, so it holds a reference that is never released
+            if (from_type == TYPE_STRING && from_ptr == 0 && to_ptr > 0) {
+                return LLVMBuildBitCast(builder, take_string(operand), get_llvm_type_with_pointers(to_type, to_ptr), "cast");
+            }
+
+            // pointer to pointer (or same type)
+            if (from_ptr > 0 && to_ptr > 0) {
+                LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
+                return LLVMBuildBitCast(builder, operand, target_llvm, "cast");
+            }
+
+            // int to pointer (inttoptr)
+            if (from_ptr == 0 && to_ptr > 0 && is_integer_type(from_type)) {
+                LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
+                return LLVMBuildIntToPtr(builder, operand, target_llvm, "cast");
+            }
+
+            // pointer to int (ptrtoint)
+            if (from_ptr > 0 && to_ptr == 0 && is_integer_type(to_type)) {
+                LLVMTypeRef target_llvm = get_llvm_type(to_type);
+                return LLVMBuildPtrToInt(builder, operand, target_llvm, "cast");
+            }
+
+            // int to int (different sizes) so truncate or extend
+            if (from_ptr == 0 && to_ptr == 0 && is_integer_type(from_type) && is_integer_type(to_type)) {
+                LLVMTypeRef from_llvm = get_llvm_type(from_type);
+                LLVMTypeRef to_llvm = get_llvm_type(to_type);
+
+                unsigned from_bits = LLVMGetIntTypeWidth(from_llvm);
+                unsigned to_bits = LLVMGetIntTypeWidth(to_llvm);
+
+                if (from_bits < to_bits) {
+                    if (is_unsigned_type(from_type)) {
+                        return LLVMBuildZExt(builder, operand, to_llvm, "cast");
+                    }
+                    return LLVMBuildSExt(builder, operand, to_llvm, "cast");
+                }
+
+                if (from_bits > to_bits) {
+                    return LLVMBuildTrunc(builder, operand, to_llvm, "cast");
+                }
+
+                return operand;
+            }
+
+            // int to float
+            if (is_integer_type(from_type) && is_floating_type(to_type)) {
+                LLVMTypeRef to_llvm = get_llvm_type(to_type);
+                if (is_unsigned_type(from_type)) {
+                    return LLVMBuildUIToFP(builder, operand, to_llvm, "cast");
+                }
+                return LLVMBuildSIToFP(builder, operand, to_llvm, "cast");
+            }
+
+            // float to int
+            if (is_floating_type(from_type) && is_integer_type(to_type)) {
+                LLVMTypeRef to_llvm = get_llvm_type(to_type);
+                if (is_unsigned_type(to_type)) {
+                    return LLVMBuildFPToUI(builder, operand, to_llvm, "cast");
+                }
+                return LLVMBuildFPToSI(builder, operand, to_llvm, "cast");
+            }
+
+            // float to float (different precision)
+            if (is_floating_type(from_type) && is_floating_type(to_type)) {
+                LLVMTypeRef to_llvm = get_llvm_type(to_type);
+                if (to_type == TYPE_DOUBLE) {
+                    return LLVMBuildFPExt(builder, operand, to_llvm, "cast");
+                }
+
+                return LLVMBuildFPTrunc(builder, operand, to_llvm, "cast");
+            }
+
+            // default bitcast (shouldnt normally reach here)
+            LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
+            fflush(stderr);  // Force output before potential hang
+            LLVMValueRef result = LLVMBuildBitCast(builder, operand, target_llvm, "cast");
+            return result;
+        }
+        default: {
+            fprintf(stderr, "Unsupported expression kind: %d\n", expr->kind);
+            exit(1);
+        }
+    }
+}
+
+// whether a local's address can get anywhere but a plain load or store, a call argument or a stored pointer
+// for example. only then could a callee see the caller's frame, which is what rules out 'tail'
+static bool pointer_escapes(LLVMValueRef pointer) {
+    for (LLVMUseRef use = LLVMGetFirstUse(pointer); use; use = LLVMGetNextUse(use)) {
+        LLVMValueRef user = LLVMGetUser(use);
+
+        switch (LLVMGetInstructionOpcode(user)) {
+            case LLVMLoad:
+                break;
+            case LLVMStore:
+                if (LLVMGetOperand(user, 0) == pointer) return true;
+                break;
+            case LLVMGetElementPtr:
+            case LLVMBitCast:
+                if (pointer_escapes(user)) return true;
+                break;
+            default:
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static bool frame_escapes(LLVMValueRef func) {
+    for (LLVMBasicBlockRef block = LLVMGetFirstBasicBlock(func); block; block = LLVMGetNextBasicBlock(block)) {
+        for (LLVMValueRef inst = LLVMGetFirstInstruction(block); inst; inst = LLVMGetNextInstruction(inst)) {
+            if (LLVMIsAAllocaInst(inst) && pointer_escapes(inst)) return true;
+        }
+    }
+
+    return false;
+}
+
+static void add_tail_call(LLVMValueRef call, const TailCallKind kind) {
+    if (tail_call_count >= tail_call_capacity) {
+        tail_call_capacity = tail_call_capacity == 0 ? 8 : tail_call_capacity * 2;
+        tail_calls = realloc(tail_calls, sizeof(TailCall) * tail_call_capacity);
+    }
+
+    tail_calls[tail_call_count++] = (TailCall){ call, kind };
+}
+
+// 'return f(...)' is marked when it is safe, 'become f(...)' has to be
+static void mark_tail_calls(const FunctionNode *func, LLVMValueRef llvm_func) {
+    if (tail_call_count == 0) return;
+
+    const bool escapes = frame_escapes(llvm_func);
+    for (int i = 0; i < tail_call_count; i++) {
+        if (escapes && tail_calls[i].kind == TAIL_CALL_BECOME) {
+            fprintf(stderr, "Codegen error: 'become' in '%s' cannot reuse the frame, the address of one of its locals escapes\n", func->name);
+            exit(1);
+        }
+
+        if (!escapes) {
+            LLVMSetTailCall(tail_calls[i].call, 1);
+        }
+    }
+
+    tail_call_count = 0;
+}
+
+// 'become' on the function itself: the new arguments replace the parameters and control goes back to the top
+static void codegen_self_become(const ExprNode *call) {
+    const FunctionNode *func = current_function;
+
+    // every argument is evaluated before any parameter is overwritten, f(b, a) swaps
+    LLVMValueRef *args = malloc(sizeof(LLVMValueRef) * (call->call.arg_count + 1));
+    for (int i = 0; i < call->call.arg_count; i++) {
+        const ExprNode *arg = call->call.args[i];
+        args[i] = codegen_expression(arg);
+        if (arg->pointer_level == 0 && func->params[i].pointer_level == 0) {
+            args[i] = convert_to_type(args[i], arg->type, func->params[i].type);
+        }
+    }
+
+    // string parameters hold a reference, the old ones are let go once the new ones are in place
+    LLVMValueRef *old_strings = calloc(call->call.arg_count + 1, sizeof(LLVMValueRef));
+    for (int i = 0; i < call->call.arg_count; i++) {
+        if (is_string_slot(param_slots[i])) {
+            args[i] = take_string(args[i]);
+            old_strings[i] = LLVMBuildLoad2(builder, LLVMTypeOf(args[i]), param_slots[i], "oldstr");
+        }
+    }
+
+    for (int i = 0; i < call->call.arg_count; i++) {
+        LLVMBuildStore(builder, args[i], param_slots[i]);
+    }
+
+    for (int i = 0; i < call->call.arg_count; i++) {
+        if (old_strings[i]) string_refcount("__cplus_string_release_", old_strings[i]);
+    }
+    release_string_temps();
+    free(old_strings);
+    free(args);
+
+    LLVMBuildBr(builder, tail_loop_block);
+
+    // Create a dummy block so subsequent code doesn't crash LLVM builder
+    LLVMValueRef llvm_func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlockInContext(context, llvm_func, "dead_after_become"));
+    LLVMBuildUnreachable(builder);
+}
+
+// whether a parallel for body refers to name, and so needs it passed in
+static bool expr_mentions(const ExprNode *expr, const char *name) {
+    if (!expr) return false;
+
+    switch (expr->kind) {
+        case EXPR_VAR:
+            return strcmp(expr->text, name) == 0;
+        case EXPR_BINOP:
+            return expr_mentions(expr->binop.left, name) || expr_mentions(expr->binop.right, name);
+        case EXPR_UNARY:
+            return expr_mentions(expr->unary.operand, name);
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                if (expr_mentions(expr->call.args[i], name)) return true;
+            }
+            return false;
+        case EXPR_ARRAY_INDEX:
+            return expr_mentions(expr->array_index.array, name) || expr_mentions(expr->array_index.index, name);
+        case EXPR_CAST:
+            return expr_mentions(expr->cast.operand, name);
+        case EXPR_MEMBER:
+            return expr_mentions(expr->member.object, name);
+        case EXPR_SLICE:
+            return expr_mentions(expr->slice.object, name) || expr_mentions(expr->slice.start, name) || expr_mentions(expr->slice.end, name);
+        case EXPR_INIT_LIST:
+            for (int i = 0; i < expr->init_list.count; i++) {
+                if (expr_mentions(expr->init_list.elements[i], name)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+static bool stmt_mentions(const StmtNode *stmt, const char *name) {
+    if (!stmt) return false;
+
+    switch (stmt->kind) {
+        case STMT_RETURN:
+            return expr_mentions(stmt->return_stmt.expr, name);
+        case STMT_IF:
+            return expr_mentions(stmt->if_stmt.condition, name) || stmt_mentions(stmt->if_stmt.then_stmt, name) ||
+                   stmt_mentions(stmt->if_stmt.else_stmt, name);
+        case STMT_WHILE:
+            return expr_mentions(stmt->while_stmt.condition, name) || stmt_mentions(stmt->while_stmt.body, name);
+        case STMT_FOR:
+            return stmt_mentions(stmt->for_stmt.init, name) || expr_mentions(stmt->for_stmt.condition, name) ||
+                   expr_mentions(stmt->for_stmt.increment, name) || expr_mentions(stmt->for_stmt.range, name) ||
+                   stmt_mentions(stmt->for_stmt.body, name);
+        case STMT_SWITCH:
+            if (expr_mentions(stmt->switch_stmt.value, name)) return true;
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    if (stmt_mentions(stmt->switch_stmt.cases[i].stmts[j], name)) return true;
+                }
+            }
+            return false;
+        case STMT_VAR_DECL:
+            return expr_mentions(stmt->var_decl.initializer, name);
+        case STMT_EXPR:
+            return expr_mentions(stmt->expr_stmt.expr, name);
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                if (stmt_mentions(stmt->compound.stmts[i], name)) return true;
+            }
+            return false;
+        case STMT_ASM:
+            for (size_t i = 0; i < stmt->asm_stmt.output_count; i++) {
+                if (expr_mentions(stmt->asm_stmt.outputs[i], name)) return true;
+            }
+            for (size_t i = 0; i < stmt->asm_stmt.input_count; i++) {
+                if (expr_mentions(stmt->asm_stmt.inputs[i], name)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// whether a loop body may change name: assigning it, stepping it, taking its address or declaring another one
+static bool expr_writes(const ExprNode *expr, const char *name) {
+    if (!expr) return false;
+
+    switch (expr->kind) {
+        case EXPR_BINOP:
+            if (is_assignment_op(expr->binop.op) && expr->binop.left->kind == EXPR_VAR && strcmp(expr->binop.left->text, name) == 0) return true;
+            return expr_writes(expr->binop.left, name) || expr_writes(expr->binop.right, name);
+        case EXPR_UNARY: {
+            const bool writes = expr->unary.op == UNARY_ADDR_OF || expr->unary.op == UNARY_PRE_INC || expr->unary.op == UNARY_PRE_DEC ||
+                                expr->unary.op == UNARY_POST_INC || expr->unary.op == UNARY_POST_DEC;
+            if (writes && expr->unary.operand->kind == EXPR_VAR && strcmp(expr->unary.operand->text, name) == 0) return true;
+            return expr_writes(expr->unary.operand, name);
+        }
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                if (expr_writes(expr->call.args[i], name)) return true;
             }
+            return false;
+        case EXPR_ARRAY_INDEX:
+            return expr_writes(expr->array_index.array, name) || expr_writes(expr->array_index.index, name);
+        case EXPR_CAST:
+            return expr_writes(expr->cast.operand, name);
+        case EXPR_MEMBER:
+            return expr_writes(expr->member.object, name);
+        case EXPR_SLICE:
+            return expr_writes(expr->slice.object, name) || expr_writes(expr->slice.start, name) || expr_writes(expr->slice.end, name);
+        case EXPR_INIT_LIST:
+            for (int i = 0; i < expr->init_list.count; i++) {
+                if (expr_writes(expr->init_list.elements[i], name)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+static bool stmt_writes(const StmtNode *stmt, const char *name) {
+    if (!stmt) return false;
+
+    switch (stmt->kind) {
+        case STMT_RETURN:
+            return expr_writes(stmt->return_stmt.expr, name);
+        case STMT_IF:
+            return expr_writes(stmt->if_stmt.condition, name) || stmt_writes(stmt->if_stmt.then_stmt, name) ||
+                   stmt_writes(stmt->if_stmt.else_stmt, name);
+        case STMT_WHILE:
+            return expr_writes(stmt->while_stmt.condition, name) || stmt_writes(stmt->while_stmt.body, name);
+        case STMT_FOR:
+            // the variable of an 'in' loop redeclares the name like an init would
+            if (stmt->for_stmt.range_var && strcmp(stmt->for_stmt.range_var, name) == 0) return true;
+            return stmt_writes(stmt->for_stmt.init, name) || expr_writes(stmt->for_stmt.condition, name) ||
+                   expr_writes(stmt->for_stmt.increment, name) || expr_writes(stmt->for_stmt.range, name) ||
+                   stmt_writes(stmt->for_stmt.body, name);
+        case STMT_SWITCH:
+            if (expr_writes(stmt->switch_stmt.value, name)) return true;
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    if (stmt_writes(stmt->switch_stmt.cases[i].stmts[j], name)) return true;
+                }
+            }
+            return false;
+        case STMT_VAR_DECL:
+            // a redeclaration would be what s[i] refers to inside its scope
+            return strcmp(stmt->var_decl.name, name) == 0 || expr_writes(stmt->var_decl.initializer, name);
+        case STMT_EXPR:
+            return expr_writes(stmt->expr_stmt.expr, name);
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                if (stmt_writes(stmt->compound.stmts[i], name)) return true;
+            }
+            return false;
+        case STMT_ASM:
+            for (size_t i = 0; i < stmt->asm_stmt.output_count; i++) {
+                if (expr_mentions(stmt->asm_stmt.outputs[i], name)) return true;
+            }
+            for (size_t i = 0; i < stmt->asm_stmt.input_count; i++) {
+                if (expr_writes(stmt->asm_stmt.inputs[i], name)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// for (long i = 0; i < s.len; i++) keeps every s[i] in its body in bounds, as long as the body leaves i and s alone.
+// i starts at a non-negative constant and only grows by one while below s.len, so it never wraps. int indices are
+// left out, they wrap to negative past INT_MAX while a longer slice still satisfies the condition
+static bool loop_proves_bounds(const StmtNode *loop, BoundsProof *proof) {
+    const StmtNode *init = loop->for_stmt.init;
+    const ExprNode *cond = loop->for_stmt.condition;
+    const ExprNode *inc = loop->for_stmt.increment;
+
+    if (!init || init->kind != STMT_VAR_DECL || init->var_decl.pointer_level != 0 || init->var_decl.array_size > 0 || init->var_decl.is_slice ||
+        (init->var_decl.type != TYPE_LONG && init->var_decl.type != TYPE_ULONG && init->var_decl.type != TYPE_UINT)) {
+        return false;
+    }
+
+    const ExprNode *start = init->var_decl.initializer;
+    if (!start || start->kind != EXPR_NUMBER || strchr(start->text, '.')) return false;
+
+    const char *index = init->var_decl.name;
+    if (!cond || cond->kind != EXPR_BINOP || cond->binop.op != BIN_LESS || cond->binop.left->kind != EXPR_VAR ||
+        strcmp(cond->binop.left->text, index) != 0) {
+        return false;
+    }
+
+    const ExprNode *limit = cond->binop.right;
+    if (limit->kind != EXPR_MEMBER || !limit->member.object->is_slice || limit->member.field_index != 1 ||
+        limit->member.object->kind != EXPR_VAR) {
+        return false;
+    }
+
+    const bool steps_by_one = inc && inc->kind == EXPR_UNARY && (inc->unary.op == UNARY_PRE_INC || inc->unary.op == UNARY_POST_INC) &&
+                              inc->unary.operand->kind == EXPR_VAR && strcmp(inc->unary.operand->text, index) == 0;
+    if (!steps_by_one) return false;
+
+    const char *slice = limit->member.object->text;
+    if (stmt_writes(loop->for_stmt.body, index) || stmt_writes(loop->for_stmt.body, slice)) return false;
+
+    proof->index = index;
+    proof->slice = slice;
+    return true;
+}
+
+static LLVMValueRef reduction_identity(const Reduction *reduction, const TypeKind type) {
+    LLVMTypeRef llvm_type = get_llvm_type(type);
+    if (is_floating_type(type)) {
+        return LLVMConstReal(llvm_type, reduction->op == BIN_MUL ? 1.0 : 0.0);
+    }
+
+    switch (reduction->op) {
+        case BIN_MUL: return LLVMConstInt(llvm_type, 1, 0);
+        case BIN_BIT_AND: return LLVMConstAllOnes(llvm_type);
+        default: return LLVMConstNull(llvm_type);
+    }
+}
+
+static LLVMValueRef reduction_combine(const Reduction *reduction, const TypeKind type, LLVMValueRef left, LLVMValueRef right) {
+    const bool is_float = is_floating_type(type);
+
+    switch (reduction->op) {
+        case BIN_MUL: return is_float ? LLVMBuildFMul(builder, left, right, "reduce") : LLVMBuildMul(builder, left, right, "reduce");
+        case BIN_BIT_AND: return LLVMBuildAnd(builder, left, right, "reduce");
+        case BIN_BIT_OR: return LLVMBuildOr(builder, left, right, "reduce");
+        case BIN_BIT_XOR: return LLVMBuildXor(builder, left, right, "reduce");
+        default: return is_float ? LLVMBuildFAdd(builder, left, right, "reduce") : LLVMBuildAdd(builder, left, right, "reduce");
+    }
+}
+
+static void codegen_statement(const StmtNode* stmt);
+
+// T[] name, an empty slice when there is no initializer
+static void codegen_slice_decl(const StmtNode *stmt) {
+    const int pointer_level = stmt->var_decl.pointer_level + 1;
+    LLVMTypeRef var_type = slice_llvm_type(stmt->var_decl.type, pointer_level);
+
+    LLVMValueRef alloca = build_entry_alloca(var_type, stmt->var_decl.name);
+    if (di_builder) {
+        debug_declare_variable(alloca, stmt->var_decl.name, debug_slice_type(stmt->var_decl.type, pointer_level), stmt->location, 0);
+    }
+
+    LLVMValueRef init_val = stmt->var_decl.initializer ? codegen_expression(stmt->var_decl.initializer) : LLVMConstNull(var_type);
+    LLVMBuildStore(builder, init_val, alloca);
+    add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, pointer_level, 0);
+}
+
+// for (x in range) is a counted loop from 0 to the length so the vectorizer and unroller take it as it is.
+// the base pointer and length are computed once and each element is one inbounds gep off the base
+static void codegen_range_for(const StmtNode *stmt) {
+    const ExprNode *range = stmt->for_stmt.range;
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+
+    LLVMValueRef elements;
+    LLVMValueRef length;
+    if (range->is_slice) {
+        LLVMValueRef slice = codegen_expression(range);
+        elements = LLVMBuildExtractValue(builder, slice, 0, "rangeptr");
+        length = LLVMBuildExtractValue(builder, slice, 1, "rangelen");
+    } else {
+        elements = codegen_expression(range);
+        length = LLVMConstInt(i64_type, fixed_array_size(range), 0);
+    }
+
+    const TypeKind type = range->type;
+    const int pointer_level = range->pointer_level - 1;
+    LLVMTypeRef element_type = get_llvm_type_with_pointers(type, pointer_level);
+
+    LLVMValueRef index_slot = build_entry_alloca(i64_type, "range_index");
+    LLVMBuildStore(builder, LLVMConstInt(i64_type, 0, 0), index_slot);
+
+    // a copy gets its own slot like an init variable, a ref is just the element's address
+    LLVMValueRef copy = NULL;
+    if (!stmt->for_stmt.is_ref) {
+        copy = build_entry_alloca(element_type, stmt->for_stmt.range_var);
+        set_storage_alignment(copy, type, pointer_level);
+        if (di_builder) {
+            debug_declare_variable(copy, stmt->for_stmt.range_var, debug_type(type, pointer_level), stmt->location, 0);
+        }
+        add_local_var(stmt->for_stmt.range_var, copy, element_type, type, pointer_level, 0);
+
+        // a string copy only needs a reference of its own when the body can replace it
+        if (type == TYPE_STRING && pointer_level == 0 && stmt_writes(stmt->for_stmt.body, stmt->for_stmt.range_var)) {
+            add_string_slot(copy);
+        }
+    }
+    release_string_temps();
+
+    LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+    LLVMBasicBlockRef cond_block = LLVMAppendBasicBlockInContext(context, func, "range_cond");
+    LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(context, func, "range_body");
+    LLVMBasicBlockRef inc_block = LLVMAppendBasicBlockInContext(context, func, "range_inc");
+    LLVMBasicBlockRef end_block = LLVMAppendBasicBlockInContext(context, func, "range_end");
+
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, cond_block);
+    LLVMValueRef index = LLVMBuildLoad2(builder, i64_type, index_slot, "index");
+    build_cond_br(LLVMBuildICmp(builder, LLVMIntULT, index, length, "inrange"), NULL, body_block, end_block);
+
+    LLVMPositionBuilderAtEnd(builder, body_block);
+    LLVMValueRef element = LLVMBuildInBoundsGEP2(builder, element_type, elements, &index, 1, "element");
+    if (copy && is_string_slot(copy)) {
+        store_owned_string(LLVMBuildLoad2(builder, element_type, element, "elementval"), copy);
+    } else if (copy) {
+        LLVMBuildStore(builder, LLVMBuildLoad2(builder, element_type, element, "elementval"), copy);
+    } else {
+        add_local_var(stmt->for_stmt.range_var, element, element_type, type, pointer_level, 0);
+    }
+
+    LLVMBasicBlockRef old_break = current_break_target;
+    LLVMBasicBlockRef old_cont = current_continue_target;
+    current_break_target = end_block;
+    current_continue_target = inc_block;
+
+    codegen_statement(stmt->for_stmt.body);
+
+    if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, inc_block);
+    }
+
+    current_break_target = old_break;
+    current_continue_target = old_cont;
+
+    // the index stops at the length so it never wraps
+    LLVMPositionBuilderAtEnd(builder, inc_block);
+    LLVMValueRef current = LLVMBuildLoad2(builder, i64_type, index_slot, "index");
+    LLVMBuildStore(builder, LLVMBuildNUWAdd(builder, current, LLVMConstInt(i64_type, 1, 0), "next"), index_slot);
+    mark_loop_latch(LLVMBuildBr(builder, cond_block), &stmt->for_stmt.hints, stmt->for_stmt.body);
+
+    LLVMPositionBuilderAtEnd(builder, end_block);
+    remove_local_var(stmt->for_stmt.range_var);
+}
+
+// the body of a parallel for is outlined into 'void body(i8 **captures, i64 begin, i64 end)' which runs
+// [begin, end) of the iterations. the runtime pool calls it with chunks of the range from several threads
+static void codegen_parallel_for(const StmtNode *stmt) {
+    static int parallel_body_count = 0;
+
+    const StmtNode *init = stmt->for_stmt.init;
+    const ExprNode *limit = stmt->for_stmt.condition->binop.right;
+    const char *index_name = init->var_decl.name;
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(context);
+    LLVMTypeRef i8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+    LLVMTypeRef void_type = LLVMVoidTypeInContext(context);
+
+    // the bounds are evaluated once, before any iteration runs
+    LLVMValueRef begin = convert_to_type(codegen_expression(init->var_decl.initializer), init->var_decl.initializer->type, TYPE_LONG);
+    LLVMValueRef end = convert_to_type(codegen_expression(limit), limit->type, TYPE_LONG);
+    if (stmt->for_stmt.condition->binop.op == BIN_LESS_EQ) {
+        end = LLVMBuildAdd(builder, end, LLVMConstInt(i64_type, 1, 0), "parend");
+    }
+    release_string_temps();
+
+    // locals the body uses are passed by address. only the innermost of locals sharing a name is visible
+    int capture_count = 0;
+    CodegenSymbol *captures = malloc(sizeof(CodegenSymbol) * (local_var_count + 1));
+    for (int i = local_var_count - 1; i >= 0; i--) {
+        const char *name = local_vars[i].name;
+        bool shadowed = strcmp(name, index_name) == 0;
+        for (int j = i + 1; j < local_var_count && !shadowed; j++) {
+            shadowed = strcmp(local_vars[j].name, name) == 0;
+        }
 
-            // Load the value from the computed address
-            return LLVMBuildLoad2(builder, element_type, element_ptr, "arrayval");
+        bool reduced = false;
+        for (int r = 0; r < stmt->for_stmt.reduction_count; r++) {
+            reduced = reduced || strcmp(stmt->for_stmt.reductions[r].name, name) == 0;
         }
-        case EXPR_CAST: {
-            LLVMValueRef operand = codegen_expression(expr->cast.operand);
 
-            TypeKind from_type = expr->cast.operand->type;
-            TypeKind to_type = expr->cast.target_type;
-            int from_ptr = expr->cast.operand->pointer_level;
-            int to_ptr = expr->cast.target_pointer_level;
+        if (!shadowed && (reduced || stmt_mentions(stmt->for_stmt.body, name))) {
+            captures[capture_count++] = local_vars[i];
+        }
+    }
 
-            // pointer to pointer (or same type)
-            if (from_ptr > 0 && to_ptr > 0) {
-                LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
-                return LLVMBuildBitCast(builder, operand, target_llvm, "cast");
-            }
+    LLVMTypeRef captures_type = LLVMArrayType(i8_ptr_type, capture_count > 0 ? capture_count : 1);
+    LLVMValueRef captures_array = build_entry_alloca(captures_type, "captures");
+    for (int i = 0; i < capture_count; i++) {
+        LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), LLVMConstInt(LLVMInt32TypeInContext(context), i, 0) };
+        LLVMValueRef slot = LLVMBuildGEP2(builder, captures_type, captures_array, indices, 2, "capture");
+        LLVMBuildStore(builder, LLVMBuildBitCast(builder, captures[i].value, i8_ptr_type, ""), slot);
+    }
 
-            // int to pointer (inttoptr)
-            if (from_ptr == 0 && to_ptr > 0 && (from_type == TYPE_INT || from_type == TYPE_LONG)) {
-                LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
-                return LLVMBuildIntToPtr(builder, operand, target_llvm, "cast");
-            }
+    char body_name[256];
+    snprintf(body_name, sizeof(body_name), "__cplus_parallel_%s_%d", current_function->name, parallel_body_count++);
+    LLVMTypeRef body_params[] = { i8_ptr_type, i64_type, i64_type };
+    LLVMTypeRef body_type = LLVMFunctionType(void_type, body_params, 3, 0);
+    LLVMValueRef body_func = LLVMAddFunction(module, body_name, body_type);
+    LLVMSetLinkage(body_func, LLVMInternalLinkage);
+
+    // everything per function is switched over to the body and put back afterwards
+    LLVMBasicBlockRef caller_block = LLVMGetInsertBlock(builder);
+    LLVMMetadataRef caller_scope = di_scope;
+    LLVMBasicBlockRef old_break = current_break_target;
+    LLVMBasicBlockRef old_cont = current_continue_target;
+    const int caller_local_count = local_var_count;
+    const int caller_string_slots = string_slot_count;
+    const int caller_string_exits = string_exit_count;
+
+    if (di_builder) {
+        LLVMMetadataRef file = debug_file(stmt->location.filename);
+        LLVMMetadataRef subroutine_type = LLVMDIBuilderCreateSubroutineType(di_builder, file, NULL, 0, LLVMDIFlagZero);
+        di_scope = LLVMDIBuilderCreateFunction(di_builder, file, body_name, strlen(body_name), body_name, strlen(body_name), file,
+                                               stmt->location.line, subroutine_type, 1, 1, stmt->location.line,
+                                               LLVMDIFlagArtificial, options.opt_level > 0);
+        LLVMSetSubprogram(body_func, di_scope);
+    }
 
-            // pointer to int (ptrtoint)
-            if (from_ptr > 0 && to_ptr == 0 && (to_type == TYPE_INT || to_type == TYPE_LONG)) {
-                LLVMTypeRef target_llvm = get_llvm_type(to_type);
-                return LLVMBuildPtrToInt(builder, operand, target_llvm, "cast");
-            }
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlockInContext(context, body_func, "entry"));
+    LLVMSetCurrentDebugLocation2(builder, NULL);
+    debug_set_location(stmt->location);
+    fast_math_begin_function(current_function, body_func);
 
-            // int to int (different sizes) so truncate or extend
-            if (from_ptr == 0 && to_ptr == 0 && is_integer_type(from_type) && is_integer_type(to_type)) {
-                LLVMTypeRef from_llvm = get_llvm_type(from_type);
-                LLVMTypeRef to_llvm = get_llvm_type(to_type);
+    LLVMValueRef captured = LLVMBuildBitCast(builder, LLVMGetParam(body_func, 0), LLVMPointerType(captures_type, 0), "captures");
+    for (int i = 0; i < capture_count; i++) {
+        LLVMValueRef indices[2] = { LLVMConstInt(LLVMInt32TypeInContext(context), 0, 0), LLVMConstInt(LLVMInt32TypeInContext(context), i, 0) };
+        LLVMValueRef slot = LLVMBuildGEP2(builder, captures_type, captured, indices, 2, "capture");
+        LLVMValueRef address = LLVMBuildBitCast(builder, LLVMBuildLoad2(builder, i8_ptr_type, slot, ""), LLVMTypeOf(captures[i].value), captures[i].name);
 
-                unsigned from_bits = LLVMGetIntTypeWidth(from_llvm);
-                unsigned to_bits = LLVMGetIntTypeWidth(to_llvm);
+        add_local_var(captures[i].name, address, captures[i].llvm_type, captures[i].type, captures[i].pointer_level, captures[i].array_size);
+        local_vars[local_var_count - 1].alias_scope = captures[i].alias_scope;
+    }
 
-                if (from_bits < to_bits) {
-                    return LLVMBuildSExt(builder, operand, to_llvm, "cast");
-                }
+    // reduced variables get a private accumulator, the shared one is only touched once per chunk
+    const int reduction_count = stmt->for_stmt.reduction_count;
+    LLVMValueRef *shared = malloc(sizeof(LLVMValueRef) * (reduction_count + 1));
+    TypeKind *reduced_types = malloc(sizeof(TypeKind) * (reduction_count + 1));
+    for (int i = 0; i < reduction_count; i++) {
+        const Reduction *reduction = &stmt->for_stmt.reductions[i];
+        const CodegenSymbol *sym = lookup_var_full(reduction->name);
+        shared[i] = sym->value;
+        reduced_types[i] = sym->type;
+
+        LLVMValueRef private = build_entry_alloca(get_llvm_type(sym->type), reduction->name);
+        LLVMBuildStore(builder, reduction_identity(reduction, sym->type), private);
+        add_local_var(reduction->name, private, get_llvm_type(sym->type), sym->type, 0, 0);
+    }
 
-                if (from_bits > to_bits) {
-                    return LLVMBuildTrunc(builder, operand, to_llvm, "cast");
-                }
+    LLVMTypeRef index_type = get_llvm_type(init->var_decl.type);
+    LLVMValueRef index = build_entry_alloca(index_type, index_name);
+    LLVMBuildStore(builder, LLVMBuildTrunc(builder, LLVMGetParam(body_func, 1), index_type, ""), index);
+    add_local_var(index_name, index, index_type, init->var_decl.type, 0, 0);
+
+    LLVMBasicBlockRef cond_block = LLVMAppendBasicBlockInContext(context, body_func, "for_cond");
+    LLVMBasicBlockRef loop_block = LLVMAppendBasicBlockInContext(context, body_func, "for_body");
+    LLVMBasicBlockRef inc_block = LLVMAppendBasicBlockInContext(context, body_func, "for_inc");
+    LLVMBasicBlockRef end_block = LLVMAppendBasicBlockInContext(context, body_func, "for_end");
+    LLVMBuildBr(builder, cond_block);
+
+    LLVMPositionBuilderAtEnd(builder, cond_block);
+    LLVMValueRef current = convert_to_type(LLVMBuildLoad2(builder, index_type, index, "loadtmp"), init->var_decl.type, TYPE_LONG);
+    LLVMValueRef in_range = LLVMBuildICmp(builder, LLVMIntSLT, current, LLVMGetParam(body_func, 2), "cmptmp");
+    build_cond_br(in_range, stmt->for_stmt.condition, loop_block, end_block);
+
+    LLVMPositionBuilderAtEnd(builder, loop_block);
+    current_break_target = NULL;
+    current_continue_target = inc_block;
+    codegen_statement(stmt->for_stmt.body);
+    if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        LLVMBuildBr(builder, inc_block);
+    }
 
-                return operand;
-            }
+    LLVMPositionBuilderAtEnd(builder, inc_block);
+    LLVMValueRef next = LLVMBuildAdd(builder, LLVMBuildLoad2(builder, index_type, index, "loadtmp"), LLVMConstInt(index_type, 1, 0), "inctmp");
+    LLVMBuildStore(builder, next, index);
+    mark_loop_latch(LLVMBuildBr(builder, cond_block), &stmt->for_stmt.hints, stmt->for_stmt.body);
 
-            // int to float
-            if (is_integer_type(from_type) && is_floating_type(to_type)) {
-                LLVMTypeRef to_llvm = get_llvm_type(to_type);
-                return LLVMBuildSIToFP(builder, operand, to_llvm, "cast");
-            }
+    LLVMPositionBuilderAtEnd(builder, end_block);
+    if (reduction_count > 0) {
+        LLVMTypeRef lock_type = LLVMFunctionType(void_type, NULL, 0, 0);
+        LLVMBuildCall2(builder, lock_type, LLVMGetNamedFunction(module, "__cplus_parallel_lock_"), NULL, 0, "");
 
-            // float to int
-            if (is_floating_type(from_type) && is_integer_type(to_type)) {
-                LLVMTypeRef to_llvm = get_llvm_type(to_type);
-                return LLVMBuildFPToSI(builder, operand, to_llvm, "cast");
-            }
+        for (int i = 0; i < reduction_count; i++) {
+            const Reduction *reduction = &stmt->for_stmt.reductions[i];
+            LLVMTypeRef value_type = get_llvm_type(reduced_types[i]);
 
-            // float to float (different precision)
-            if (is_floating_type(from_type) && is_floating_type(to_type)) {
-                LLVMTypeRef to_llvm = get_llvm_type(to_type);
-                if (to_type == TYPE_DOUBLE) {
-                    return LLVMBuildFPExt(builder, operand, to_llvm, "cast");
-                }
+            LLVMValueRef total = LLVMBuildLoad2(builder, value_type, shared[i], "shared");
+            LLVMValueRef partial = LLVMBuildLoad2(builder, value_type, lookup_local_var(reduction->name), "partial");
+            LLVMBuildStore(builder, reduction_combine(reduction, reduced_types[i], total, partial), shared[i]);
+        }
 
-                return LLVMBuildFPTrunc(builder, operand, to_llvm, "cast");
-            }
+        LLVMBuildCall2(builder, lock_type, LLVMGetNamedFunction(module, "__cplus_parallel_unlock_"), NULL, 0, "");
+    }
+    add_string_exit(LLVMBuildRetVoid(builder), NULL);
+    release_string_slots(caller_string_slots, caller_string_exits);
 
-            // default bitcast (shouldnt normally reach here)
-            LLVMTypeRef target_llvm = get_llvm_type_with_pointers(to_type, to_ptr);
-            fflush(stderr);  // Force output before potential hang
-            LLVMValueRef result = LLVMBuildBitCast(builder, operand, target_llvm, "cast");
-            return result;
-        }
-        default: {
-            fprintf(stderr, "Unsupported expression kind: %d\n", expr->kind);
-            exit(1);
-        }
+    // back to the caller
+    for (int i = caller_local_count; i < local_var_count; i++) {
+        free(local_vars[i].name);
     }
+    local_var_count = caller_local_count;
+    current_break_target = old_break;
+    current_continue_target = old_cont;
+    di_scope = caller_scope;
+
+    LLVMPositionBuilderAtEnd(builder, caller_block);
+    debug_set_location(stmt->location);
+
+    LLVMValueRef parallel_func = LLVMGetNamedFunction(module, "__cplus_parallel_for_");
+    LLVMValueRef args[] = { body_func, LLVMBuildBitCast(builder, captures_array, i8_ptr_type, ""), begin, end };
+    LLVMBuildCall2(builder, LLVMGlobalGetValueType(parallel_func), parallel_func, args, 4, "");
+
+    free(captures);
+    free(shared);
+    free(reduced_types);
 }
 
 static void codegen_statement(const StmtNode* stmt) {
+    debug_set_location(stmt->location);
+
     switch (stmt->kind) {
         case STMT_RETURN: {
-            if (stmt->return_stmt.expr) {
+            if (stmt->return_stmt.expr && is_struct_value(current_function->return_type, current_function->return_pointer_level)) {
                 const LLVMValueRef ret_val = codegen_expression(stmt->return_stmt.expr);
-                LLVMBuildRet(builder, ret_val);
+                const StructAbi abi = struct_abi(current_function->return_type);
+
+                release_string_temps();
+                if (abi.in_memory) {
+                    LLVMBuildStore(builder, ret_val, current_sret);
+                    add_string_exit(LLVMBuildRetVoid(builder), NULL);
+                } else {
+                    add_string_exit(LLVMBuildRet(builder, coerce_through_memory(ret_val, struct_abi_register_type(&abi))), NULL);
+                }
+            } else if (stmt->return_stmt.expr && stmt->return_stmt.expr->kind == EXPR_CALL && stmt->return_stmt.expr->call.tail_call != TAIL_CALL_NONE) {
+                const ExprNode *call = stmt->return_stmt.expr;
+                if (call->call.tail_call == TAIL_CALL_BECOME && strcmp(call->call.function_name, current_function->name) == 0) {
+                    codegen_self_become(call);
+                    break;
+                }
+
+                const LLVMValueRef ret_val = codegen_expression(call);
+                if (LLVMIsACallInst(ret_val)) {
+                    add_tail_call(ret_val, call->call.tail_call);
+                }
+
+                // the call result is the caller's reference. nothing may run between a 'become' call and its
+                // ret, so the strings of the locals are not released there
+                if (is_string_expr(call)) take_string(ret_val);
+                if (call->call.tail_call != TAIL_CALL_BECOME) release_string_temps();
+
+                LLVMValueRef ret;
+                if (LLVMGetTypeKind(LLVMTypeOf(ret_val)) == LLVMVoidTypeKind) {
+                    ret = LLVMBuildRetVoid(builder);
+                } else {
+                    ret = LLVMBuildRet(builder, ret_val);
+                }
+
+                if (call->call.tail_call != TAIL_CALL_BECOME) {
+                    add_string_exit(ret, NULL);
+                }
+            } else if (stmt->return_stmt.expr) {
+                const ExprNode *value = stmt->return_stmt.expr;
+                LLVMValueRef ret_val = codegen_expression(value);
+                if (value->pointer_level == 0 && current_function->return_pointer_level == 0 && is_numeric_type(value->type)) {
+                    ret_val = convert_to_type(ret_val, value->type, current_function->return_type);
+                }
+
+                // returning a local hands its reference to the caller instead of retaining and releasing it
+                LLVMValueRef moved = NULL;
+                if (is_string_expr(value)) {
+                    if (value->kind == EXPR_VAR && is_string_slot(lookup_var(value->text))) {
+                        moved = lookup_var(value->text);
+                    } else {
+                        take_string(ret_val);
+                    }
+                }
+
+                release_string_temps();
+                add_string_exit(LLVMBuildRet(builder, ret_val), moved);
             } else {
-                LLVMBuildRetVoid(builder);
+                add_string_exit(LLVMBuildRetVoid(builder), NULL);
             }
 
             break;
@@ -1060,16 +4254,17 @@ static void codegen_statement(const StmtNode* stmt) {
 
             // conditional branch
             if (else_block) {
-                LLVMBuildCondBr(builder, cond_val, then_block, else_block);
+                build_cond_br(cond_val, stmt->if_stmt.condition, then_block, else_block);
             } else {
-                LLVMBuildCondBr(builder, cond_val, then_block, merge_block);
+                build_cond_br(cond_val, stmt->if_stmt.condition, then_block, merge_block);
             }
 
             // generate 'then' block
             LLVMPositionBuilderAtEnd(builder, then_block);
             codegen_statement(stmt->if_stmt.then_stmt);
-            // Only add branch if block is not already terminated
-            if (!LLVMGetBasicBlockTerminator(then_block)) {
+            // Only add branch if block is not already terminated. nested ifs, loops and bounds checks leave the
+            // builder in a later block than the one the branch started in
+            if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
                 LLVMBuildBr(builder, merge_block);
             }
 
@@ -1078,7 +4273,7 @@ static void codegen_statement(const StmtNode* stmt) {
                 LLVMPositionBuilderAtEnd(builder, else_block);
                 codegen_statement(stmt->if_stmt.else_stmt);
                 // Only add branch if block is not already terminated
-                if (!LLVMGetBasicBlockTerminator(else_block)) {
+                if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
                     LLVMBuildBr(builder, merge_block);
                 }
             }
@@ -1099,10 +4294,11 @@ static void codegen_statement(const StmtNode* stmt) {
 
             // Condition Block
             LLVMPositionBuilderAtEnd(builder, cond_block);
+            debug_set_location(stmt->while_stmt.condition->location);
             LLVMValueRef cond_val = codegen_expression(stmt->while_stmt.condition);
             // Ensure i1
             cond_val = LLVMBuildTrunc(builder, cond_val, LLVMInt1TypeInContext(context), "booltmp");
-            LLVMBuildCondBr(builder, cond_val, body_block, end_block);
+            build_cond_br(cond_val, stmt->while_stmt.condition, body_block, end_block);
 
             // Body Block
             LLVMPositionBuilderAtEnd(builder, body_block);
@@ -1117,7 +4313,7 @@ static void codegen_statement(const StmtNode* stmt) {
 
             // Loop back if not terminated
             if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
-                LLVMBuildBr(builder, cond_block);
+                mark_loop_latch(LLVMBuildBr(builder, cond_block), &stmt->while_stmt.hints, stmt->while_stmt.body);
             }
 
             // Restore targets
@@ -1129,6 +4325,27 @@ static void codegen_statement(const StmtNode* stmt) {
             break;
         }
         case STMT_FOR: {
+            if (stmt->for_stmt.range) {
+                codegen_range_for(stmt);
+                break;
+            }
+
+            const int proof_count = bounds_proof_count;
+            BoundsProof proof;
+            if (options.bounds_check && loop_proves_bounds(stmt, &proof)) {
+                if (bounds_proof_count >= bounds_proof_capacity) {
+                    bounds_proof_capacity = bounds_proof_capacity == 0 ? 8 : bounds_proof_capacity * 2;
+                    bounds_proofs = realloc(bounds_proofs, sizeof(BoundsProof) * bounds_proof_capacity);
+                }
+                bounds_proofs[bounds_proof_count++] = proof;
+            }
+
+            if (stmt->for_stmt.is_parallel) {
+                codegen_parallel_for(stmt);
+                bounds_proof_count = proof_count;
+                break;
+            }
+
             LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
 
             // IMPORTANT: If init is a variable declaration, we need to hoist the
@@ -1136,7 +4353,9 @@ static void codegen_statement(const StmtNode* stmt) {
             LLVMValueRef init_alloca = NULL;
             StmtNode *init_stmt = stmt->for_stmt.init;
 
-            if (init_stmt && init_stmt->kind == STMT_VAR_DECL) {
+            if (init_stmt && init_stmt->kind == STMT_VAR_DECL && init_stmt->var_decl.is_slice) {
+                codegen_slice_decl(init_stmt);
+            } else if (init_stmt && init_stmt->kind == STMT_VAR_DECL) {
                 // Allocate the variable in the current block (before loop)
                 LLVMTypeRef var_type;
 
@@ -1147,7 +4366,12 @@ static void codegen_statement(const StmtNode* stmt) {
                     );
                     var_type = LLVMArrayType(element_type, init_stmt->var_decl.array_size);
 
-                    init_alloca = LLVMBuildAlloca(builder, var_type, init_stmt->var_decl.name);
+                    init_alloca = build_entry_alloca(var_type, init_stmt->var_decl.name);
+                    if (di_builder) {
+                        debug_declare_variable(init_alloca, init_stmt->var_decl.name,
+                                               debug_array_type(init_stmt->var_decl.type, init_stmt->var_decl.pointer_level, init_stmt->var_decl.array_size, var_type),
+                                               init_stmt->location, 0);
+                    }
                     // Note: Arrays decay to pointers, so store with pointer_level + 1
                     add_local_var(init_stmt->var_decl.name, init_alloca, var_type, init_stmt->var_decl.type, init_stmt->var_decl.pointer_level + 1, init_stmt->var_decl.array_size);
                 } else {
@@ -1155,28 +4379,39 @@ static void codegen_statement(const StmtNode* stmt) {
                        init_stmt->var_decl.type,
                        init_stmt->var_decl.pointer_level
                     );
-                    init_alloca = LLVMBuildAlloca(builder, var_type, init_stmt->var_decl.name);
+                    init_alloca = build_entry_alloca(var_type, init_stmt->var_decl.name);
+                    if (di_builder) {
+                        debug_declare_variable(init_alloca, init_stmt->var_decl.name,
+                                               debug_type(init_stmt->var_decl.type, init_stmt->var_decl.pointer_level),
+                                               init_stmt->location, 0);
+                    }
                     add_local_var(init_stmt->var_decl.name, init_alloca, var_type, init_stmt->var_decl.type, init_stmt->var_decl.pointer_level, 0);
+                    local_vars[local_var_count - 1].alias_scope = restrict_scope_of(init_stmt);
                 }
 
                 // Initialize the variable if there's an initializer
-                if (init_stmt->var_decl.initializer) {
-                    if (init_stmt->var_decl.array_size > 0) {
-                        fprintf(stderr, "Array initializers not yet supported in for-loop\n");
-                        exit(1);
-                    }
-
+                if (init_stmt->var_decl.initializer && init_stmt->var_decl.array_size > 0) {
+                    codegen_array_initializer(init_alloca, var_type, init_stmt->var_decl.name, init_stmt->var_decl.type,
+                                              init_stmt->var_decl.pointer_level, init_stmt->var_decl.array_size,
+                                              init_stmt->var_decl.initializer);
+                } else if (init_stmt->var_decl.initializer) {
                     LLVMValueRef init_val = codegen_expression(init_stmt->var_decl.initializer);
                     if (init_stmt->var_decl.pointer_level == 0) {
                         init_val = convert_to_type(init_val, init_stmt->var_decl.initializer->type, init_stmt->var_decl.type);
                     }
 
-                    LLVMBuildStore(builder, init_val, init_alloca);
+                    if (is_string_expr(init_stmt->var_decl.initializer)) {
+                        add_string_slot(init_alloca);
+                        init_string_local(init_val, init_alloca, false);
+                    } else {
+                        LLVMBuildStore(builder, init_val, init_alloca);
+                    }
                 }
             } else if (init_stmt) {
                 // Regular statement (like expression statement)
                 codegen_statement(init_stmt);
             }
+            release_string_temps();
 
             LLVMBasicBlockRef cond_block = LLVMAppendBasicBlockInContext(context, func, "for_cond");
             LLVMBasicBlockRef body_block = LLVMAppendBasicBlockInContext(context, func, "for_body");
@@ -1188,9 +4423,10 @@ static void codegen_statement(const StmtNode* stmt) {
             // Condition
             LLVMPositionBuilderAtEnd(builder, cond_block);
             if (stmt->for_stmt.condition) {
+                debug_set_location(stmt->for_stmt.condition->location);
                 LLVMValueRef cond_val = codegen_expression(stmt->for_stmt.condition);
                 cond_val = LLVMBuildTrunc(builder, cond_val, LLVMInt1TypeInContext(context), "booltmp");
-                LLVMBuildCondBr(builder, cond_val, body_block, end_block);
+                build_cond_br(cond_val, stmt->for_stmt.condition, body_block, end_block);
             } else {
                 LLVMBuildBr(builder, body_block);
             }
@@ -1211,34 +4447,82 @@ static void codegen_statement(const StmtNode* stmt) {
 
             current_break_target = old_break;
             current_continue_target = old_cont;
+            bounds_proof_count = proof_count;
 
             // Increment
             LLVMPositionBuilderAtEnd(builder, inc_block);
             if (stmt->for_stmt.increment) {
+                debug_set_location(stmt->for_stmt.increment->location);
                 codegen_expression(stmt->for_stmt.increment);
+                release_string_temps();
             }
-            LLVMBuildBr(builder, cond_block);
+            mark_loop_latch(LLVMBuildBr(builder, cond_block), &stmt->for_stmt.hints, stmt->for_stmt.body);
 
             // End
             LLVMPositionBuilderAtEnd(builder, end_block);
 
             // Remove the loop variable from local_vars if it was declared in init
             if (stmt->for_stmt.init && stmt->for_stmt.init->kind == STMT_VAR_DECL) {
-                const char *var_name = stmt->for_stmt.init->var_decl.name;
-                // Find and remove this variable
-                for (int i = local_var_count - 1; i >= 0; i--) {
-                    if (strcmp(local_vars[i].name, var_name) == 0) {
-                        free(local_vars[i].name);
-                        // Shift remaining variables down
-                        for (int j = i; j < local_var_count - 1; j++) {
-                            local_vars[j] = local_vars[j + 1];
-                        }
-                        local_var_count--;
+                remove_local_var(stmt->for_stmt.init->var_decl.name);
+            }
+
+            break;
+        }
+        case STMT_SWITCH: {
+            LLVMValueRef func = LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder));
+            const int case_count = stmt->switch_stmt.case_count;
+
+            debug_set_location(stmt->switch_stmt.value->location);
+            LLVMValueRef value = codegen_expression(stmt->switch_stmt.value);
+            LLVMTypeRef value_type = LLVMTypeOf(value);
+
+            LLVMBasicBlockRef *case_blocks = malloc(sizeof(LLVMBasicBlockRef) * (case_count + 1));
+            LLVMBasicBlockRef default_block = NULL;
+            for (int i = 0; i < case_count; i++) {
+                case_blocks[i] = LLVMAppendBasicBlockInContext(context, func, stmt->switch_stmt.cases[i].value ? "switch_case" : "switch_default");
+                if (!stmt->switch_stmt.cases[i].value) {
+                    default_block = case_blocks[i];
+                }
+            }
+
+            LLVMBasicBlockRef end_block = LLVMAppendBasicBlockInContext(context, func, "switch_end");
+            case_blocks[case_count] = end_block;
+
+            // llvm picks a jump table, bit test or binary search from the case density
+            release_string_temps();
+            LLVMValueRef switch_inst = LLVMBuildSwitch(builder, value, default_block ? default_block : end_block, case_count);
+            for (int i = 0; i < case_count; i++) {
+                const SwitchCase *c = &stmt->switch_stmt.cases[i];
+                if (c->value) {
+                    LLVMAddCase(switch_inst, LLVMConstInt(value_type, (unsigned long long)c->constant, 1), case_blocks[i]);
+                }
+            }
+
+            // break leaves the switch, continue still belongs to the enclosing loop
+            LLVMBasicBlockRef old_break = current_break_target;
+            current_break_target = end_block;
+
+            for (int i = 0; i < case_count; i++) {
+                const SwitchCase *c = &stmt->switch_stmt.cases[i];
+                LLVMPositionBuilderAtEnd(builder, case_blocks[i]);
+
+                for (int j = 0; j < c->count; j++) {
+                    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
                         break;
                     }
+                    codegen_statement(c->stmts[j]);
+                }
+
+                // fall through into the next case
+                if (!LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+                    LLVMBuildBr(builder, case_blocks[i + 1]);
                 }
             }
 
+            current_break_target = old_break;
+            free(case_blocks);
+
+            LLVMPositionBuilderAtEnd(builder, end_block);
             break;
         }
         case STMT_BREAK: {
@@ -1446,7 +4730,38 @@ static void codegen_statement(const StmtNode* stmt) {
             LLVMValueRef alloca;
             LLVMTypeRef var_type;
 
-            if (stmt->var_decl.array_size > 0) {
+            if (stmt->var_decl.is_slice) {
+                codegen_slice_decl(stmt);
+            } else if (stmt->var_decl.is_soa) {
+                var_type = soa_llvm_type(stmt->var_decl.type, stmt->var_decl.array_size);
+                alloca = build_entry_alloca(var_type, stmt->var_decl.name);
+                set_storage_alignment(alloca, stmt->var_decl.type, stmt->var_decl.pointer_level);
+                set_declared_alignment(alloca, stmt->var_decl.alignment);
+                add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, stmt->var_decl.pointer_level + 1, stmt->var_decl.array_size);
+            } else if (stmt->var_decl.dim_count > 0) {
+                // int[H][W] grid, one contiguous block in row-major order
+                LLVMTypeRef element_type = get_llvm_type_with_pointers(stmt->var_decl.type, stmt->var_decl.pointer_level);
+                var_type = nested_array_type(element_type, stmt->var_decl.dims, stmt->var_decl.dim_count);
+
+                alloca = lookup_var(stmt->var_decl.name);
+                if (!alloca) {
+                    alloca = build_entry_alloca(var_type, stmt->var_decl.name);
+                    set_storage_alignment(alloca, stmt->var_decl.type, stmt->var_decl.pointer_level);
+                    set_declared_alignment(alloca, stmt->var_decl.alignment);
+                    if (di_builder) {
+                        debug_declare_variable(alloca, stmt->var_decl.name,
+                                               debug_nested_array_type(stmt->var_decl.type, stmt->var_decl.pointer_level, stmt->var_decl.dims, stmt->var_decl.dim_count, var_type),
+                                               stmt->location, 0);
+                    }
+
+                    add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, stmt->var_decl.pointer_level + stmt->var_decl.dim_count, stmt->var_decl.array_size);
+                }
+
+                if (stmt->var_decl.initializer) {
+                    codegen_array_initializer(alloca, var_type, stmt->var_decl.name, stmt->var_decl.type, stmt->var_decl.pointer_level,
+                                              stmt->var_decl.initializer->init_list.count, stmt->var_decl.initializer);
+                }
+            } else if (stmt->var_decl.array_size > 0) {
                 // Array declaration: int[5] arr;
                 LLVMTypeRef element_type = get_llvm_type_with_pointers(
                     stmt->var_decl.type,
@@ -1460,7 +4775,14 @@ static void codegen_statement(const StmtNode* stmt) {
                 if (existing) {
                     alloca = existing;
                 } else {
-                    alloca = LLVMBuildAlloca(builder, var_type, stmt->var_decl.name);
+                    alloca = build_entry_alloca(var_type, stmt->var_decl.name);
+                    set_storage_alignment(alloca, stmt->var_decl.type, stmt->var_decl.pointer_level);
+                    set_declared_alignment(alloca, stmt->var_decl.alignment);
+                    if (di_builder) {
+                        debug_declare_variable(alloca, stmt->var_decl.name,
+                                               debug_array_type(stmt->var_decl.type, stmt->var_decl.pointer_level, stmt->var_decl.array_size, var_type),
+                                               stmt->location, 0);
+                    }
 
                     if (stmt->var_decl.array_size > 0) {
                         add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, stmt->var_decl.pointer_level + 1, stmt->var_decl.array_size);
@@ -1469,12 +4791,10 @@ static void codegen_statement(const StmtNode* stmt) {
                     }
                 }
 
-                // Array initializer support (if provided)
                 if (stmt->var_decl.initializer) {
-                    // For now, we'll handle simple cases
-                    // You could extend this to handle initializer lists
-                    fprintf(stderr, "Array initializers not yet supported\n");
-                    exit(1);
+                    codegen_array_initializer(alloca, var_type, stmt->var_decl.name, stmt->var_decl.type,
+                                              stmt->var_decl.pointer_level, stmt->var_decl.array_size,
+                                              stmt->var_decl.initializer);
                 }
             } else {
                 // Regular variable declaration
@@ -1486,15 +4806,28 @@ static void codegen_statement(const StmtNode* stmt) {
                 if (existing) {
                     alloca = existing;
                 } else {
-                    alloca = LLVMBuildAlloca(builder, var_type, stmt->var_decl.name);
+                    alloca = build_entry_alloca(var_type, stmt->var_decl.name);
+                    set_storage_alignment(alloca, stmt->var_decl.type, stmt->var_decl.pointer_level);
+                    set_declared_alignment(alloca, stmt->var_decl.alignment);
+                    if (di_builder) {
+                        debug_declare_variable(alloca, stmt->var_decl.name,
+                                               debug_type(stmt->var_decl.type, stmt->var_decl.pointer_level),
+                                               stmt->location, 0);
+                    }
 
                     if (stmt->var_decl.array_size > 0) {
                         add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, stmt->var_decl.pointer_level + 1, stmt->var_decl.array_size);
                     } else {
                         add_local_var(stmt->var_decl.name, alloca, var_type, stmt->var_decl.type, stmt->var_decl.pointer_level, 0);
                     }
+
+                    if (stmt->var_decl.type == TYPE_STRING && stmt->var_decl.pointer_level == 0) {
+                        add_string_slot(alloca);
+                    }
                 }
 
+                lookup_var_full(stmt->var_decl.name)->alias_scope = restrict_scope_of(stmt);
+
                 if (stmt->var_decl.initializer) {
                     LLVMValueRef init_val = codegen_expression(stmt->var_decl.initializer);
 
@@ -1502,7 +4835,11 @@ static void codegen_statement(const StmtNode* stmt) {
                         init_val = convert_to_type(init_val, stmt->var_decl.initializer->type, stmt->var_decl.type);
                     }
 
-                    LLVMBuildStore(builder, init_val, alloca);
+                    if (is_string_slot(alloca)) {
+                        init_string_local(init_val, alloca, existing != NULL);
+                    } else {
+                        LLVMBuildStore(builder, init_val, alloca);
+                    }
                 }
             }
 
@@ -1513,6 +4850,12 @@ static void codegen_statement(const StmtNode* stmt) {
             break;
         }
         case STMT_COMPOUND: {
+            LLVMMetadataRef outer_scope = di_scope;
+            if (di_builder && di_scope) {
+                di_scope = LLVMDIBuilderCreateLexicalBlock(di_builder, di_scope, debug_file(stmt->location.filename),
+                                                           stmt->location.line, stmt->location.column);
+            }
+
             for (int i = 0; i < stmt->compound.count; i++) {
                 // Check if current block is already terminated (e.g., by return)
                 LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
@@ -1523,6 +4866,8 @@ static void codegen_statement(const StmtNode* stmt) {
 
                 codegen_statement(stmt->compound.stmts[i]);
             }
+
+            di_scope = outer_scope;
             break;
         }
         default: {
@@ -1530,18 +4875,19 @@ static void codegen_statement(const StmtNode* stmt) {
             exit(1);
         }
     }
-}
 
-static void codegen_function(const FunctionNode* func) {
-    // build parameter types array
-    LLVMTypeRef *param_types = malloc(sizeof(LLVMTypeRef) * func->param_count);
-    for (int i = 0; i < func->param_count; i++) {
-        param_types[i] = get_llvm_type_with_pointers(func->params[i].type, func->params[i].pointer_level);
+    // temporaries the statement didnt keep die with it
+    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(builder))) {
+        string_temp_count = 0;
+    } else {
+        release_string_temps();
     }
+}
 
-    // function type
-    const LLVMTypeRef ret_type = get_llvm_type_with_pointers(func->return_type, func->return_pointer_level);
-    const LLVMTypeRef func_type = LLVMFunctionType(ret_type, param_types, func->param_count, 0);
+static void codegen_function(const FunctionNode* func) {
+    // function type, after struct lowering
+    const LLVMTypeRef func_type = function_llvm_type(func);
+    const LLVMTypeRef ret_type = LLVMGetReturnType(func_type);
 
     const LLVMValueRef llvm_func = LLVMGetNamedFunction(module, func->name);
     if (!llvm_func) {
@@ -1549,21 +4895,105 @@ static void codegen_function(const FunctionNode* func) {
         exit(1);
     }
 
+    if (di_builder) {
+        LLVMMetadataRef file = debug_file(func->location.filename);
+
+        LLVMMetadataRef *debug_types = malloc(sizeof(LLVMMetadataRef) * (func->param_count + 1));
+        debug_types[0] = debug_type(func->return_type, func->return_pointer_level);
+        for (int i = 0; i < func->param_count; i++) {
+            debug_types[i + 1] = debug_type(func->params[i].type, func->params[i].pointer_level);
+        }
+
+        LLVMMetadataRef subroutine_type = LLVMDIBuilderCreateSubroutineType(di_builder, file, debug_types, func->param_count + 1, LLVMDIFlagZero);
+        free(debug_types);
+
+        const size_t name_len = strlen(func->name);
+        di_scope = LLVMDIBuilderCreateFunction(di_builder, file, func->name, name_len, func->name, name_len, file,
+                                               func->location.line, subroutine_type, 0, 1, func->location.line,
+                                               LLVMDIFlagPrototyped, options.opt_level > 0);
+        LLVMSetSubprogram(llvm_func, di_scope);
+    }
+
     // entry block
     const LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(context, llvm_func, "entry");
     LLVMPositionBuilderAtEnd(builder, entry);
+    debug_set_location(func->location);
+    profile_begin_function(func, llvm_func);
+    fast_math_begin_function(func, llvm_func);
+    restrict_begin_function(func);
+
+    current_function = func;
+    current_sret = NULL;
+
+    // struct parameters and return values may take a different number of llvm parameters, see function_llvm_type
+    unsigned llvm_index = 0;
+    if (is_struct_value(func->return_type, func->return_pointer_level) && struct_abi(func->return_type).in_memory) {
+        current_sret = LLVMGetParam(llvm_func, llvm_index++);
+        LLVMSetValueName(current_sret, "sret");
+    }
 
     // add parameters as local variables
     clear_local_vars();
+    string_temp_count = 0;
+    string_slot_count = 0;
+    string_exit_count = 0;
+    param_slots = malloc(sizeof(LLVMValueRef) * (func->param_count + 1));
     for (int i = 0; i < func->param_count; i++) {
-        LLVMValueRef param = LLVMGetParam(llvm_func, i);
-        LLVMSetValueName(param, func->params[i].name);
+        LLVMTypeRef param_type = param_llvm_type(&func->params[i]);
+        LLVMValueRef alloca;
+
+        if (!is_struct_value(func->params[i].type, func->params[i].pointer_level)) {
+            LLVMValueRef param = LLVMGetParam(llvm_func, llvm_index++);
+            LLVMSetValueName(param, func->params[i].name);
+
+            alloca = build_entry_alloca(param_type, func->params[i].name);
+            LLVMBuildStore(builder, param, alloca);
+
+            // the caller's reference is only borrowed, a parameter that can be replaced needs one of its own
+            if (func->params[i].type == TYPE_STRING && func->params[i].pointer_level == 0 && !func->params[i].is_slice &&
+                (func->has_self_become || stmt_writes(func->body, func->params[i].name))) {
+                add_string_slot(alloca);
+                string_refcount("__cplus_string_retain_", param);
+            }
+        } else {
+            const StructAbi abi = struct_abi(func->params[i].type);
+
+            if (abi.in_memory) {
+                // byval already made a private copy for us
+                alloca = LLVMGetParam(llvm_func, llvm_index++);
+                LLVMSetValueName(alloca, func->params[i].name);
+            } else {
+                LLVMValueRef parts = LLVMGetParam(llvm_func, llvm_index++);
+                if (abi.part_count > 1) {
+                    LLVMValueRef high = LLVMGetParam(llvm_func, llvm_index++);
+                    parts = LLVMBuildInsertValue(builder, LLVMGetUndef(struct_abi_register_type(&abi)), parts, 0, "");
+                    parts = LLVMBuildInsertValue(builder, parts, high, 1, "");
+                }
+
+                alloca = build_struct_slot(func->params[i].type, func->params[i].name);
+                LLVMBuildStore(builder, coerce_through_memory(parts, param_type), alloca);
+            }
+        }
+
+        if (di_builder) {
+            LLVMMetadataRef param_debug_type = func->params[i].is_slice ? debug_slice_type(func->params[i].type, func->params[i].pointer_level)
+                                                                        : debug_type(func->params[i].type, func->params[i].pointer_level);
+            debug_declare_variable(alloca, func->params[i].name, param_debug_type, func->params[i].location, i + 1);
+        }
 
-        LLVMTypeRef param_type = get_llvm_type_with_pointers(func->params[i].type, func->params[i].pointer_level);
-        LLVMValueRef alloca = LLVMBuildAlloca(builder, param_type, func->params[i].name);
-        LLVMBuildStore(builder, param, alloca);
+        if (func->params[i].alignment > 0 && func->params[i].is_slice) {
+            assume_aligned(LLVMBuildExtractValue(builder, LLVMGetParam(llvm_func, llvm_index - 1), 0, "sliceptr"), func->params[i].alignment);
+        }
 
         add_local_var(func->params[i].name, alloca, param_type, func->params[i].type, func->params[i].pointer_level, 0);
+        param_slots[i] = alloca;
+    }
+
+    tail_loop_block = NULL;
+    if (func->has_self_become) {
+        tail_loop_block = LLVMAppendBasicBlockInContext(context, llvm_func, "tailrecurse");
+        LLVMBuildBr(builder, tail_loop_block);
+        LLVMPositionBuilderAtEnd(builder, tail_loop_block);
     }
 
     codegen_statement(func->body);
@@ -1571,19 +5001,64 @@ static void codegen_function(const FunctionNode* func) {
     // Add default return if block is not terminated
     LLVMBasicBlockRef current_block = LLVMGetInsertBlock(builder);
     if (!LLVMGetBasicBlockTerminator(current_block)) {
-        if (func->return_type == TYPE_VOID && func->return_pointer_level == 0) {
-            LLVMBuildRetVoid(builder);
+        if (LLVMGetTypeKind(ret_type) == LLVMVoidTypeKind) {
+            add_string_exit(LLVMBuildRetVoid(builder), NULL);
         } else {
             // Return default value (0 for int, nullptr for pointers, etc.)
             LLVMValueRef default_val = LLVMConstNull(ret_type);
-            LLVMBuildRet(builder, default_val);
+            add_string_exit(LLVMBuildRet(builder, default_val), NULL);
         }
     }
 
-    free(param_types);
+    release_string_slots(0, 0);
+    mark_tail_calls(func, llvm_func);
+    free(param_slots);
+    param_slots = NULL;
+
+    di_scope = NULL;
+    current_function = NULL;
+    LLVMSetCurrentDebugLocation2(builder, NULL);
+}
+
+static LLVMCodeGenOptLevel codegen_opt_level(void) {
+    switch (options.opt_level) {
+        case 0:  return LLVMCodeGenLevelNone;
+        case 1:  return LLVMCodeGenLevelLess;
+        case 3:  return LLVMCodeGenLevelAggressive;
+        default: return LLVMCodeGenLevelDefault;
+    }
 }
 
-void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
+static void debug_init(void) {
+    di_builder = LLVMCreateDIBuilder(module);
+
+    const char *producer = "C+ compiler";
+    di_compile_unit = LLVMDIBuilderCreateCompileUnit(
+        di_builder,
+        LLVMDWARFSourceLanguageC,
+        debug_file(options.source_file),
+        producer, strlen(producer),
+        options.opt_level > 0,
+        "", 0,
+        0,
+        "", 0,
+        LLVMDWARFEmissionFull,
+        0,
+        0,
+        0,
+        "", 0,
+        "", 0
+    );
+
+    LLVMValueRef debug_version = LLVMConstInt(LLVMInt32TypeInContext(context), LLVMDebugMetadataVersion(), 0);
+    LLVMValueRef dwarf_version = LLVMConstInt(LLVMInt32TypeInContext(context), 4, 0);
+    LLVMAddModuleFlag(module, LLVMModuleFlagBehaviorWarning, "Debug Info Version", strlen("Debug Info Version"), LLVMValueAsMetadata(debug_version));
+    LLVMAddModuleFlag(module, LLVMModuleFlagBehaviorWarning, "Dwarf Version", strlen("Dwarf Version"), LLVMValueAsMetadata(dwarf_version));
+}
+
+void codegen_program_llvm(const ProgramNode* program, const char* output_file, const CodegenOptions *codegen_options) {
+    options = *codegen_options;
+
     // init
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
@@ -1594,14 +5069,55 @@ void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
     module = LLVMModuleCreateWithNameInContext("my_module", context);
     builder = LLVMCreateBuilderInContext(context);
 
+    // target machine, the module needs the triple and data layout up front for the optimiser
+    char *error = NULL;
+    char *triple = LLVMGetDefaultTargetTriple();
+    LLVMTargetRef target;
+    if (LLVMGetTargetFromTriple(triple, &target, &error) != 0) {
+        fprintf(stderr, "Error getting target: %s\n", error);
+        LLVMDisposeMessage(error);
+        exit(1);
+    }
+
+    const LLVMTargetMachineRef machine = LLVMCreateTargetMachine(
+        target,
+        triple,
+        "generic",
+        "",
+        codegen_opt_level(),
+        LLVMRelocPIC,  // Change this from LLVMRelocDefault to LLVMRelocPIC
+        LLVMCodeModelDefault
+    );
+
+    LLVMSetTarget(module, triple);
+    LLVMTargetDataRef data_layout = LLVMCreateTargetDataLayout(machine);
+    LLVMSetModuleDataLayout(module, data_layout);
+    LLVMDisposeTargetData(data_layout);
+    LLVMDisposeMessage(triple);
+
+    if (options.debug_info) {
+        debug_init();
+    }
+
+    if (options.profile_use) {
+        profile_load(options.profile_use);
+    }
+
     codegen_declare_builtins();
 
+    current_program = program;
+    struct_layouts = calloc(program->struct_count, sizeof(StructLayout));
+
     // global variables
     for (int i = 0; i < program->global_count; ++i) {
         const GlobalVarNode *global_var = program->globals[i];
 
         LLVMTypeRef var_type;
-        if (global_var->array_size > 0) {
+        if (global_var->is_soa) {
+            var_type = soa_llvm_type(global_var->kind, global_var->array_size);
+        } else if (global_var->dim_count > 0) {
+            var_type = nested_array_type(get_llvm_type_with_pointers(global_var->kind, global_var->pointer_level), global_var->dims, global_var->dim_count);
+        } else if (global_var->array_size > 0) {
             LLVMTypeRef element_type = get_llvm_type_with_pointers(global_var->kind, global_var->pointer_level);
             var_type = LLVMArrayType(element_type, global_var->array_size);
         } else {
@@ -1611,16 +5127,51 @@ void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
         // Create the global variable in the module
         LLVMValueRef llvm_global = LLVMAddGlobal(module, var_type, global_var->name);
 
+        set_storage_alignment(llvm_global, global_var->kind, global_var->pointer_level);
+        set_declared_alignment(llvm_global, global_var->alignment);
+
         LLVMValueRef init_value;
-        if (global_var->initializer) {
+        if (global_var->initializer && global_var->dim_count > 0) {
+            // the initializer was flattened by semantic, rows of it become the nested constant
+            const ExprNode *init = global_var->initializer;
+            LLVMTypeRef element_type = get_llvm_type_with_pointers(global_var->kind, global_var->pointer_level);
+            LLVMValueRef *values = malloc(sizeof(LLVMValueRef) * init->init_list.count);
+
+            for (int j = 0; j < init->init_list.count; j++) {
+                values[j] = init->init_list.elements[j] ? codegen_constant(init->init_list.elements[j], global_var->kind, global_var->pointer_level) : NULL;
+                if (!values[j]) {
+                    values[j] = LLVMConstNull(element_type);
+                }
+            }
+
+            init_value = nested_array_constant(element_type, global_var->dims, global_var->dim_count, values);
+            free(values);
+        } else if (global_var->initializer && global_var->array_size > 0) {
+            // constant array data, emitted straight into .data (or .rodata when const)
+            LLVMTypeRef element_type = get_llvm_type_with_pointers(global_var->kind, global_var->pointer_level);
+            LLVMValueRef *values = malloc(sizeof(LLVMValueRef) * global_var->array_size);
+
+            for (int j = 0; j < global_var->array_size; j++) {
+                values[j] = NULL;
+                if (j < global_var->initializer->init_list.count) {
+                    values[j] = codegen_constant(global_var->initializer->init_list.elements[j], global_var->kind, global_var->pointer_level);
+                }
+
+                if (!values[j]) {
+                    values[j] = LLVMConstNull(element_type);
+                }
+            }
+
+            init_value = LLVMConstArray(element_type, values, global_var->array_size);
+            free(values);
+        } else if (global_var->initializer) {
             // for now, only handle constant expressions
-            if (global_var->initializer->kind == EXPR_NUMBER) {
-                // It's a number literal
-                int value = atoi(global_var->initializer->text);
-                init_value = LLVMConstInt(var_type, value, 0);
+            if (global_var->initializer->kind == EXPR_NUMBER || global_var->initializer->kind == EXPR_INIT_LIST) {
+                // It's a number literal (or the lanes of a vector)
+                init_value = codegen_constant(global_var->initializer, global_var->kind, global_var->pointer_level);
             } else if (global_var->initializer->kind == EXPR_STRING_LITERAL) {
-                // It's a string literal
-                init_value = LLVMConstString(global_var->initializer->text, strlen(global_var->initializer->text), 0);
+                // It's a string literal, laid out with its header like any other
+                init_value = codegen_constant(global_var->initializer, global_var->kind, global_var->pointer_level);
             } else {
                 // Non-constant initializer - error for now
                 fprintf(stderr, "Error: Global variable '%s' has non-constant initializer\n", global_var->name);
@@ -1640,31 +5191,56 @@ void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
         add_global_var(global_var->name, llvm_global, var_type, global_var->kind, global_var->pointer_level, global_var->array_size);
     }
 
+    bool has_always_inline = false;
     for (int i = 0; i < program->function_count; i++) {
         FunctionNode *func = program->functions[i];
-
-        LLVMTypeRef *param_types = malloc(sizeof(LLVMTypeRef) * func->param_count);
-        for (int j = 0; j < func->param_count; j++) {
-            param_types[j] = get_llvm_type_with_pointers(func->params[j].type, func->params[j].pointer_level);
-        }
-
-        LLVMTypeRef ret_type = get_llvm_type_with_pointers(func->return_type, func->return_pointer_level);
-        LLVMTypeRef func_type = LLVMFunctionType(ret_type, param_types, func->param_count, 0);
+        if (!func->is_reachable) continue;
 
         // Add to module
-        LLVMAddFunction(module, func->name, func_type);
-
-        free(param_types);
+        LLVMValueRef llvm_func = LLVMAddFunction(module, func->name, function_llvm_type(func));
+        add_param_attributes(llvm_func, func, false);
+        add_function_attributes(llvm_func, func);
+        has_always_inline = has_always_inline || (func->attributes & FUNC_ATTR_ALWAYS_INLINE);
     }
 
     // code for each function
     for (int i = 0; i < program->function_count; i++) {
+        if (!program->functions[i]->is_reachable) continue;
         codegen_function(program->functions[i]);
     }
 
-    char *error = NULL;
+    if (options.profile_generate) {
+        profile_emit_registration();
+    }
+
+    if (di_builder) {
+        LLVMDIBuilderFinalize(di_builder);
+    }
+
     LLVMVerifyModule(module, LLVMAbortProcessAction, &error);
     LLVMDisposeMessage(error);
+    error = NULL;
+
+    // always_inline is honoured at -O0 too, the same way clang runs just the always inliner there
+    if (options.opt_level > 0 || has_always_inline) {
+        char pipeline[32];
+        if (options.opt_level > 0) {
+            snprintf(pipeline, sizeof(pipeline), "default<O%d>", options.opt_level);
+        } else {
+            snprintf(pipeline, sizeof(pipeline), "always-inline");
+        }
+
+        LLVMPassBuilderOptionsRef pass_options = LLVMCreatePassBuilderOptions();
+        LLVMErrorRef pass_error = LLVMRunPasses(module, pipeline, machine, pass_options);
+        LLVMDisposePassBuilderOptions(pass_options);
+
+        if (pass_error) {
+            char *message = LLVMGetErrorMessage(pass_error);
+            fprintf(stderr, "Error running optimisation passes: %s\n", message);
+            LLVMDisposeErrorMessage(message);
+            exit(1);
+        }
+    }
 
     // print LLVM IR to file (for debugging)
     char ir_file[256];
@@ -1675,23 +5251,6 @@ void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
     }
 
     // write object file
-    LLVMTargetRef target;
-    if (LLVMGetTargetFromTriple(LLVMGetDefaultTargetTriple(), &target, &error) != 0) {
-        fprintf(stderr, "Error getting target: %s\n", error);
-        LLVMDisposeMessage(error);
-        exit(1);
-    }
-
-    const LLVMTargetMachineRef machine = LLVMCreateTargetMachine(
-        target,
-        LLVMGetDefaultTargetTriple(),
-        "generic",
-        "",
-        LLVMCodeGenLevelDefault,
-        LLVMRelocPIC,  // Change this from LLVMRelocDefault to LLVMRelocPIC
-        LLVMCodeModelDefault
-    );
-
     if (LLVMTargetMachineEmitToFile(machine, module, (char*)output_file, LLVMObjectFile, &error) != 0) {
         fprintf(stderr, "Error writing object file: %s\n", error);
         LLVMDisposeMessage(error);
@@ -1699,6 +5258,11 @@ void codegen_program_llvm(const ProgramNode* program, const char* output_file) {
     }
 
     // cleanup
+    if (di_builder) {
+        LLVMDisposeDIBuilder(di_builder);
+        di_builder = NULL;
+    }
+
     LLVMDisposeTargetMachine(machine);
     LLVMDisposeBuilder(builder);
     LLVMDisposeModule(module);
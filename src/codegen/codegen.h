@@ -3,6 +3,17 @@
 
 #include "../ast/ast.h"
 
-void codegen_program_llvm(const ProgramNode* program, const char* output_file);
+typedef struct CodegenOptions {
+    const char *source_file;  // main source file, used as the debug info compile unit
+    int opt_level;            // 0-3, selects the LLVM pass pipeline and backend optimisation level
+    bool debug_info;          // emit DWARF line tables and variable info
+    bool profile_generate;    // instrument functions and branches with counters the runtime dumps at exit
+    const char *profile_use;  // profile file whose counts become entry counts and branch weights, or NULL
+    bool fast_math;           // relax IEEE semantics in every function, as 'fastmath' does for one
+    bool fp_contract;         // fuse a*b+c into llvm.fmuladd
+    bool bounds_check;        // check slice indexing and slicing against the length
+} CodegenOptions;
+
+void codegen_program_llvm(const ProgramNode* program, const char* output_file, const CodegenOptions *options);
 
 #endif //C__CODEGEN_H
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "codegen_cat.h"
+#include "../util/map.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -80,12 +81,23 @@ void expr_in_reg(ExprNode* expr, FILE* file, const int reg) {
                         case BIN_DIV:
                             op_instr = "udiv";
                             break;
+                        case BIN_BIT_AND:
                         case BIN_LOGICAL_AND:
                             op_instr = "and";
                             break;
+                        case BIN_BIT_OR:
                         case BIN_LOGICAL_OR:
                             op_instr = "or";
                             break;
+                        case BIN_BIT_XOR:
+                            op_instr = "xor";
+                            break;
+                        case BIN_SHL:
+                            op_instr = "shl";
+                            break;
+                        case BIN_SHR:
+                            op_instr = "shr";
+                            break;
                         default:
                             fprintf(stderr, "Error: Invalid OP, was one added without me knowing?");
                             exit(1);
@@ -215,6 +227,12 @@ void expr_in_reg(ExprNode* expr, FILE* file, const int reg) {
             break;
         }
         case EXPR_CALL: {
+            // cat has no branch weights, the hint is just the condition
+            if (expr->call.intrinsic == INTRINSIC_LIKELY || expr->call.intrinsic == INTRINSIC_UNLIKELY) {
+                expr_in_reg(expr->call.args[0], file, reg);
+                break;
+            }
+
             codegen_call(expr, file);  // returns in r0
             if (reg != 0) {
                 fprintf(file, "    mov r%d, r0\n", reg);
@@ -229,6 +247,11 @@ void expr_in_reg(ExprNode* expr, FILE* file, const int reg) {
                     fprintf(file, "    add r%d, 1\n", reg);
                     break;
                 }
+                case UNARY_BIT_NOT: {
+                    expr_in_reg(expr->unary.operand, file, reg);
+                    fprintf(file, "    not r%d\n", reg);
+                    break;
+                }
                 case UNARY_NOT: {
                     expr_in_reg(expr->unary.operand, file, reg);
                     fprintf(file, "    cmp r%d, 0\n", reg);
@@ -284,6 +307,10 @@ void expr_in_reg(ExprNode* expr, FILE* file, const int reg) {
             fprintf(file, "    mov r%d, @r%d\n", reg, reg);
             break;
         }
+        case EXPR_MEMBER: {
+            fprintf(stderr, "Error: field '%s' accessed, cat has no struct support", expr->member.field_name);
+            exit(1);
+        }
         default: {
             fprintf(stderr, "Error: invalid expression type: %d.", expr->kind);
             exit(1);
@@ -293,6 +320,11 @@ void expr_in_reg(ExprNode* expr, FILE* file, const int reg) {
 
 // causes r0 override
 void codegen_call(const ExprNode* expr, FILE* file) {
+    if (expr->call.intrinsic != INTRINSIC_NONE) {
+        fprintf(stderr, "Error: intrinsic %s is not supported by cat", expr->call.function_name);
+        exit(1);
+    }
+
     // preserve the arg registers just in case of nested call
     fprintf(file, "\n    ; calling %s\n"
                   "    push r1\n"
@@ -322,6 +354,29 @@ void codegen_call(const ExprNode* expr, FILE* file) {
                   "    sub sp, 12\n");
 }
 
+int case_compare(const void* a, const void* b) {
+    const long long left = (*(const SwitchCase**)a)->constant;
+    const long long right = (*(const SwitchCase**)b)->constant;
+    return (left > right) - (left < right);
+}
+
+// binary search over the sorted labels, r1 holds the value minus the smallest label so unsigned compares keep the order
+void switch_compare_tree(const StmtNode* stmt, SwitchCase** sorted, const int low, const int high, const long long bias, const int branch, FILE* file) {
+    if (low > high) {
+        fprintf(file, "    jmp .switchdefault%d\n", branch);
+        return;
+    }
+
+    const int mid = (low + high) / 2;
+    const int index = (int)(sorted[mid] - stmt->switch_stmt.cases);
+    fprintf(file, "    cmp r1, %lld\n", sorted[mid]->constant - bias);
+    fprintf(file, "    je .switchcase%d_%d\n", branch, index);
+    fprintf(file, "    jul .switchlow%d_%d\n", branch, mid);
+    switch_compare_tree(stmt, sorted, mid + 1, high, bias, branch, file);
+    fprintf(file, ".switchlow%d_%d:\n", branch, mid);
+    switch_compare_tree(stmt, sorted, low, mid - 1, bias, branch, file);
+}
+
 void codegen_statement(const StmtNode* stmt, FILE* file, const int loop) {
     switch (stmt->kind) {
         case STMT_RETURN: {
@@ -356,8 +411,28 @@ void codegen_statement(const StmtNode* stmt, FILE* file, const int loop) {
             }
             
             if (stmt->var_decl.array_size != 0) {
-                fprintf(stderr, "Error: array initialisation is not supported.");
-                exit(1);
+                // store each element through the array pointer, anything not listed is zeroed
+                const ExprNode* init = stmt->var_decl.initializer;
+                if (init->kind != EXPR_INIT_LIST) {
+                    fprintf(stderr, "Error: array %s must be initialised with an initialiser list.", stmt->var_decl.name);
+                    exit(1);
+                }
+
+                fprintf(file, "    ; initialising %s\n", stmt->var_decl.name);
+                for (int i = 0; i < stmt->var_decl.array_size; ++i) {
+                    if (i < init->init_list.count) {
+                        expr_in_reg(init->init_list.elements[i], file, 1);
+                    } else {
+                        fprintf(file, "    mov r1, 0\n");
+                    }
+
+                    fprintf(file, "    mov r2, r7\n");
+                    fprintf(file, "    sub r2, %d\n", varOffset);
+                    fprintf(file, "    mov r2, @r2\n");
+                    fprintf(file, "    add r2, %d\n", i * 4);
+                    fprintf(file, "    mov @r2, r1\n");
+                }
+                break;
             }
             
             // actually set value
@@ -483,6 +558,60 @@ void codegen_statement(const StmtNode* stmt, FILE* file, const int loop) {
             fprintf(file, ".doneloop%d:\n", branch);
             break;
         }
+        case STMT_SWITCH: {
+            const int branch = branch_num++;
+            const int case_count = stmt->switch_stmt.case_count;
+
+            SwitchCase** sorted = malloc(sizeof(SwitchCase*) * (case_count + 1));
+            int label_count = 0;
+            bool has_default = false;
+            for (int i = 0; i < case_count; ++i) {
+                if (stmt->switch_stmt.cases[i].value) {
+                    sorted[label_count++] = &stmt->switch_stmt.cases[i];
+                } else {
+                    has_default = true;
+                }
+            }
+            qsort(sorted, label_count, sizeof(SwitchCase*), case_compare);
+
+            expr_in_reg(stmt->switch_stmt.value, file, 1);
+            if (label_count > 0) {
+                const long long bias = sorted[0]->constant;
+                if (bias > 0) fprintf(file, "    sub r1, %lld\n", bias);
+                if (bias < 0) fprintf(file, "    add r1, %lld\n", -bias);
+                switch_compare_tree(stmt, sorted, 0, label_count - 1, bias, branch, file);
+            } else {
+                fprintf(file, "    jmp .switchdefault%d\n", branch);
+            }
+            free(sorted);
+
+            // break jumps to .doneloop like in a loop, cases fall through into each other
+            for (int i = 0; i < case_count; ++i) {
+                const SwitchCase* c = &stmt->switch_stmt.cases[i];
+                if (c->value) {
+                    fprintf(file, ".switchcase%d_%d:\n", branch, i);
+                } else {
+                    fprintf(file, ".switchdefault%d:\n", branch);
+                }
+
+                for (int j = 0; j < c->count; ++j) {
+                    codegen_statement(c->stmts[j], file, branch);
+                }
+            }
+
+            if (!has_default) {
+                fprintf(file, ".switchdefault%d:\n", branch);
+            }
+
+            // continue inside the switch still targets the enclosing loop
+            if (loop != -1) {
+                fprintf(file, "    jmp .doneloop%d\n", branch);
+                fprintf(file, ".continueloop%d:\n", branch);
+                fprintf(file, "    jmp .continueloop%d\n", loop);
+            }
+            fprintf(file, ".doneloop%d:\n", branch);
+            break;
+        }
         case STMT_BREAK: {
             if (loop == -1) {
                 fprintf(stderr, "Error: no loop to break from.\n");
@@ -553,6 +682,8 @@ void codegen_program_cat(const ProgramNode* program, const char* output_file) {
     variables = &varMap;
 
     for (int i = 0; i < program->function_count; i++) {
+        if (!program->functions[i]->is_reachable) continue;
+
         fprintf(output, "\n");
         codegen_function(program->functions[i], output);
         fprintf(output, "\n");
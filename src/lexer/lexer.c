@@ -18,14 +18,42 @@ static const struct {
     {"string", TOK_STRING_KW},
     {"bool", TOK_BOOL},
     {"void", TOK_VOID},
+    {"uint", TOK_UINT},
+    {"ulong", TOK_ULONG},
+    {"byte", TOK_BYTE},
+    {"float4", TOK_FLOAT4},
+    {"float8", TOK_FLOAT8},
+    {"int4", TOK_INT4},
+    {"int8", TOK_INT8},
     {"const", TOK_CONST},
+    {"export", TOK_EXPORT},
+    {"fastmath", TOK_FASTMATH},
+    {"inline", TOK_INLINE},
+    {"always_inline", TOK_ALWAYS_INLINE},
+    {"noinline", TOK_NOINLINE},
+    {"hot", TOK_HOT},
+    {"cold", TOK_COLD},
+    {"struct", TOK_STRUCT},
+    {"packed", TOK_PACKED},
+    {"align", TOK_ALIGN},
+    {"reorder", TOK_REORDER},
+    {"soa", TOK_SOA},
+    {"restrict", TOK_RESTRICT},
     {"return", TOK_RETURN},
+    {"become", TOK_BECOME},
     {"if", TOK_IF},
     {"else", TOK_ELSE},
     {"while", TOK_WHILE},
     {"for", TOK_FOR},
+    {"parallel", TOK_PARALLEL},
+    {"reduce", TOK_REDUCE},
+    {"in", TOK_IN},
+    {"ref", TOK_REF},
     {"break", TOK_BREAK},
     {"continue", TOK_CONTINUE},
+    {"switch", TOK_SWITCH},
+    {"case", TOK_CASE},
+    {"default", TOK_DEFAULT},
     {"asm", TOK_ASM},
     {NULL, TOK_INVALID}
 };
@@ -35,6 +63,16 @@ static const char* operator_strings[] = {
     [TOK_SUBTRACT] = "-",
     [TOK_ASTERISK] = "*",
     [TOK_AMPERSAND] = "&",
+    [TOK_AMPERSAND_EQUALS] = "&=",
+    [TOK_PIPE] = "|",
+    [TOK_PIPE_EQUALS] = "|=",
+    [TOK_CARET] = "^",
+    [TOK_CARET_EQUALS] = "^=",
+    [TOK_TILDE] = "~",
+    [TOK_SHIFT_LEFT] = "<<",
+    [TOK_SHIFT_LEFT_EQUALS] = "<<=",
+    [TOK_SHIFT_RIGHT] = ">>",
+    [TOK_SHIFT_RIGHT_EQUALS] = ">>=",
     [TOK_DIVIDE] = "/",
     [TOK_MODULO] = "%",
     [TOK_ASSIGN] = "=",
@@ -53,6 +91,8 @@ static const char* operator_strings[] = {
     [TOK_RBRACE] = "}",
     [TOK_LSQUARE] = "[",
     [TOK_RSQUARE] = "]",
+    [TOK_ARROW] = "->",
+    [TOK_DOT] = ".",
     [TOK_COMMA] = ",",
     [TOK_COLON] = ":",
     [TOK_SEMI] = ";",
@@ -90,6 +130,7 @@ Token lexer_next_token(Lexer *lexer) {
 
         if (c == EOF) { return (Token){TOK_EOF, NULL, make_location(lexer)}; }
         if (c == '"') { return lex_string_literal(lexer); }
+        if (c == '#') { return lex_pragma(lexer); }
         if (isdigit(c)) { return lex_number_literal(lexer, c); }
         if (isalpha(c) || c == '_') { return lex_identifier_or_keyword(lexer, c); }
 
@@ -121,6 +162,7 @@ const char* token_type_to_string(TokenType type) {
         case TOK_STRING_LITERAL: return "string literal";
         case TOK_NUMBER: return "number";
         case TOK_DECI_NUMBER: return "decimal number";
+        case TOK_PRAGMA: return "#pragma";
         case TOK_EOF: return "end of file";
         case TOK_INVALID: return "invalid token";
         default: return "unknown token";
@@ -132,7 +174,7 @@ void token_free_lexeme(Token *token) {
 
     // identifiers and string literals are copied so ignore them
     if (token->type == TOK_IDENTIFIER || token->type == TOK_STRING_LITERAL ||
-        token->type == TOK_NUMBER || token->type == TOK_DECI_NUMBER) {
+        token->type == TOK_NUMBER || token->type == TOK_DECI_NUMBER || token->type == TOK_PRAGMA) {
         free(token->lexeme);
         token->lexeme = NULL;
     }
@@ -196,10 +238,79 @@ static void skip_line_comment(Lexer *lex) {
     while ((c = next_char(lex)) != EOF && c != '\n') {}
 }
 
+// '#line N "file"' markers left by the preprocessor around included files
+static void skip_line_marker(Lexer *lex) {
+    const SourceLocation loc = make_last_location(lex);
+
+    char buffer[1024];
+    size_t length = 0;
+    int c;
+    while ((c = next_char(lex)) != EOF && c != '\n') {
+        if (length < sizeof(buffer) - 1) buffer[length++] = (char)c;
+    }
+    buffer[length] = '\0';
+
+    int line;
+    char filename[1024];
+    if (sscanf(buffer, "line %d \"%1023[^\"]\"", &line, filename) != 2) {
+        report_error(loc, "Invalid line marker '#%s'", buffer);
+        return;
+    }
+
+    lex->current_line = line;
+    lex->current_column = 1;
+    if (strcmp(filename, lex->filename) != 0) {
+        lex->filename = strdup(filename);  // locations keep pointing at this for the rest of compilation
+    }
+}
+
+static Token lex_pragma(Lexer *lex) {
+    SourceLocation start = make_location(lex);
+    start.column = 1;  // only a '#' at the start of a line gets here
+
+    Vector buffer = create_vector(32, sizeof(char));
+    int c;
+    while ((c = next_char(lex)) != EOF && c != '\n') {
+        const char ch = (char)c;
+        vector_push(&buffer, &ch);
+    }
+
+    const char terminator = '\0';
+    vector_push(&buffer, &terminator);
+
+    const char *text = buffer.elements;
+    if (strncmp(text, "pragma", 6) != 0 || (text[6] != '\0' && !isspace((unsigned char)text[6]))) {
+        report_error(start, "Unknown directive '#%s'", text);
+        vector_destroy(&buffer);
+        return (Token){TOK_INVALID, NULL, start};
+    }
+
+    text += 6;
+    while (isspace((unsigned char)*text)) text++;
+
+    const Token tok = {
+        .type = TOK_PRAGMA,
+        .lexeme = strdup(text),
+        .location = start
+    };
+
+    vector_destroy(&buffer);
+    return tok;
+}
+
 static int skip_whitespace(Lexer *lex) {
     int c;
     while ((c = next_char(lex)) != EOF) {
         if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+        if (c == '#' && lex->last_column == 1) {
+            // '#pragma' is a token for the parser, anything else is a line marker
+            const int next = next_char(lex);
+            unread_char(lex, next);
+            if (next == 'p') return c;
+
+            skip_line_marker(lex);
+            continue;
+        }
         return c;
 
     }
@@ -261,6 +372,37 @@ static Token lex_number_literal(Lexer *lex, const int first_char) {
     vector_push(&buf, &ch);
     int c = next_char(lex);
 
+    // hex literal, normalised to a decimal lexeme so later stages dont care
+    if (first_char == '0' && (c == 'x' || c == 'X')) {
+        unsigned long long value = 0;
+        int digits = 0;
+        int overflow = 0;
+
+        c = next_char(lex);
+        while (c != EOF && isxdigit(c)) {
+            overflow |= value >> 60 != 0;
+            value = value * 16 + (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+            digits++;
+            c = next_char(lex);
+        }
+        unread_char(lex, c);
+        vector_destroy(&buf);
+
+        if (digits == 0) {
+            report_error(start, "Invalid hex literal: expected digits after '0x'");
+            return (Token){TOK_INVALID, NULL, start};
+        }
+
+        if (overflow) {
+            report_error(start, "Invalid hex literal: does not fit in 64 bits");
+            return (Token){TOK_INVALID, NULL, start};
+        }
+
+        char text[32];
+        snprintf(text, sizeof(text), "%llu", value);
+        return (Token){TOK_NUMBER, strdup(text), start};
+    }
+
     // read digits
     while (c != EOF && (isdigit(c) || c == '.')) {
         if (c == '.') {
@@ -371,6 +513,13 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
         case '>': {
             next = next_char(lex);
             if (next == '=') return (Token){TOK_GREATER_EQUALS, .lexeme =">=", loc };
+            if (next == '>') {
+                next = next_char(lex);
+                if (next == '=') return (Token){TOK_SHIFT_RIGHT_EQUALS, .lexeme = ">>=", loc };
+                unread_char(lex, next);
+
+                return (Token){TOK_SHIFT_RIGHT, .lexeme = ">>", loc };
+            }
             unread_char(lex, next);
 
             return (Token){TOK_GREATER, .lexeme = ">", loc };
@@ -378,6 +527,13 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
         case '<': {
             next = next_char(lex);
             if (next == '=') return (Token){TOK_LESS_EQUALS, .lexeme = "<=", loc };
+            if (next == '<') {
+                next = next_char(lex);
+                if (next == '=') return (Token){TOK_SHIFT_LEFT_EQUALS, .lexeme = "<<=", loc };
+                unread_char(lex, next);
+
+                return (Token){TOK_SHIFT_LEFT, .lexeme = "<<", loc };
+            }
             unread_char(lex, next);
 
             return (Token){TOK_LESS, .lexeme = "<", loc};
@@ -385,6 +541,7 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
         case '&': {
             next = next_char(lex);
             if (next == '&') return (Token){TOK_AND, .lexeme = "&&", loc };
+            if (next == '=') return (Token){TOK_AMPERSAND_EQUALS, .lexeme = "&=", loc };
             unread_char(lex, next);
 
             return (Token){TOK_AMPERSAND, .lexeme = "&", loc};
@@ -392,12 +549,19 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
         case '|': {
             next = next_char(lex);
             if (next == '|') return (Token){TOK_OR, .lexeme = "||", loc };
+            if (next == '=') return (Token){TOK_PIPE_EQUALS, .lexeme = "|=", loc };
             unread_char(lex, next);
 
-            // maybe add bitwise OR later?
-            report_error(loc, "Unexpected character '|'. Did you mean '||'?");
-            return (Token){TOK_INVALID, NULL, loc};
+            return (Token){TOK_PIPE, .lexeme = "|", loc};
         }
+        case '^': {
+            next = next_char(lex);
+            if (next == '=') return (Token){TOK_CARET_EQUALS, .lexeme = "^=", loc };
+            unread_char(lex, next);
+
+            return (Token){TOK_CARET, .lexeme = "^", loc};
+        }
+        case '~': return (Token){TOK_TILDE, .lexeme = "~", loc};
         case '!': {
             next = next_char(lex);
             if (next == '=') return (Token){TOK_NOT_EQUAL, .lexeme = "!=", loc };
@@ -442,6 +606,10 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
                 return (Token){TOK_SUBTRACT_EQUALS, .lexeme = "-=", loc};
             }
 
+            if (next == '>') {
+                return (Token){TOK_ARROW, .lexeme = "->", loc};
+            }
+
             unread_char(lex, next);
             return (Token){TOK_SUBTRACT, .lexeme = "-", loc};
         }
@@ -474,6 +642,7 @@ static Token lex_operator_or_punct(Lexer *lex, const int c) {
         case '[': return (Token){TOK_LSQUARE, .lexeme = "[", loc};
         case ']': return (Token){TOK_RSQUARE, .lexeme = "]", loc};
         case ':': return (Token){TOK_COLON, .lexeme = ":", loc};
+        case '.': return (Token){TOK_DOT, .lexeme = ".", loc};
         case ',': return (Token){TOK_COMMA, .lexeme = ",", loc};
         case ';': return (Token){TOK_SEMI, .lexeme = ";", loc};
 
@@ -19,6 +19,7 @@ struct Lexer {
 };
 
 static void skip_line_comment(Lexer *lex);
+static void skip_line_marker(Lexer *lex);
 static int skip_whitespace(Lexer *lex);
 
 static int next_char(Lexer *lex);
@@ -31,5 +32,6 @@ static Token lex_identifier_or_keyword(Lexer *lex, int first_char);
 static Token lex_number_literal(Lexer *lex, int first_char);
 static Token lex_string_literal(Lexer *lex);
 static Token lex_operator_or_punct(Lexer *lex, int c);
+static Token lex_pragma(Lexer *lex);
 
 #endif // C__LEXER_INTERNAL_H
@@ -16,15 +16,43 @@ typedef enum {
     TOK_BOOL,
 
     TOK_VOID,
+    TOK_UINT,
+    TOK_ULONG,
+    TOK_BYTE,
+    TOK_FLOAT4,
+    TOK_FLOAT8,
+    TOK_INT4,
+    TOK_INT8,
     TOK_CONST,
+    TOK_EXPORT,
+    TOK_FASTMATH,
+    TOK_INLINE,
+    TOK_ALWAYS_INLINE,
+    TOK_NOINLINE,
+    TOK_HOT,
+    TOK_COLD,
+    TOK_STRUCT,
+    TOK_PACKED,
+    TOK_ALIGN,
+    TOK_REORDER,
+    TOK_SOA,
+    TOK_RESTRICT,
 
     TOK_RETURN,
+    TOK_BECOME,
     TOK_IF,
     TOK_ELSE,
     TOK_WHILE,
     TOK_FOR,
+    TOK_PARALLEL,
+    TOK_REDUCE,
+    TOK_IN,
+    TOK_REF,
     TOK_BREAK,
     TOK_CONTINUE,
+    TOK_SWITCH,
+    TOK_CASE,
+    TOK_DEFAULT,
     TOK_ASM,
 
     // identifiers & literals
@@ -32,6 +60,7 @@ typedef enum {
     TOK_STRING_LITERAL,
     TOK_NUMBER,
     TOK_DECI_NUMBER,
+    TOK_PRAGMA,  // '#pragma text', the lexeme is the text
 
     // operators
     TOK_PLUS,
@@ -51,6 +80,20 @@ typedef enum {
     TOK_ASTERISK,
     TOK_ASTERISK_EQUALS,
     TOK_AMPERSAND,
+    TOK_AMPERSAND_EQUALS,
+
+    TOK_PIPE,
+    TOK_PIPE_EQUALS,
+
+    TOK_CARET,
+    TOK_CARET_EQUALS,
+
+    TOK_TILDE,
+
+    TOK_SHIFT_LEFT,
+    TOK_SHIFT_LEFT_EQUALS,
+    TOK_SHIFT_RIGHT,
+    TOK_SHIFT_RIGHT_EQUALS,
 
     TOK_ASSIGN,
     TOK_EQUAL_EQUAL,
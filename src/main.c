@@ -17,8 +17,59 @@ int main(const int argc, char *argv[]) {
     }
 
     int useLLvm = 1;
+    CodegenOptions options = { .source_file = argv[1], .opt_level = 0, .debug_info = false, .profile_generate = false, .profile_use = NULL,
+                               .fast_math = false, .fp_contract = false, .bounds_check = false };
     for (int i = 2; i < argc; ++i) {
         const char* token = argv[i];
+
+        if (strcmp(token, "-g") == 0) {
+            options.debug_info = true;
+            continue;
+        }
+
+        if (strcmp(token, "-ffast-math") == 0) {
+            options.fast_math = true;
+            options.fp_contract = true;
+            continue;
+        }
+
+        if (strncmp(token, "-ffp-contract=", 14) == 0) {
+            const char *mode = token + 14;
+            if (strcmp(mode, "fast") == 0) {
+                options.fp_contract = true;
+            } else if (strcmp(mode, "off") == 0) {
+                options.fp_contract = false;
+            } else {
+                printf("Invalid -ffp-contract mode, must be one of: 'fast', 'off'\n");
+                return 1;
+            }
+            continue;
+        }
+
+        if (strcmp(token, "-fbounds-check") == 0) {
+            options.bounds_check = true;
+            continue;
+        }
+
+        if (strcmp(token, "-fprofile-generate") == 0) {
+            options.profile_generate = true;
+            continue;
+        }
+
+        if (strncmp(token, "-fprofile-use=", 14) == 0) {
+            options.profile_use = token + 14;
+            continue;
+        }
+
+        if (strncmp(token, "-O", 2) == 0) {
+            if (strlen(token) != 3 || token[2] < '0' || token[2] > '3') {
+                printf("Invalid optimisation level, must be one of: -O0, -O1, -O2, -O3\n");
+                return 1;
+            }
+
+            options.opt_level = token[2] - '0';
+            continue;
+        }
         
         if (strcmp(token, "--codegen") == 0) {
             if (i + 1 >= argc) {
@@ -115,10 +166,15 @@ int main(const int argc, char *argv[]) {
 
     semantic_destroy(semantic);
 
+    // nothing failed, but warnings from every stage so far are still worth showing
+    if (diag_has_warnings(diag)) {
+        diag_print_all(diag);
+    }
+
     printf("Generating code...\n");
 
     if (useLLvm && !diag_has_errors(diag)) {
-        codegen_program_llvm(program, "output.o");
+        codegen_program_llvm(program, "output.o", &options);
         printf("Finished generating code.\n");
     }
     //else {
@@ -3,12 +3,20 @@
 #include <string.h>
 
 GlobalVarNode* parse_global_var(Parser *p) {
+    const int alignment = parse_alignment(p);
+
     int is_const = 0;
     if (parser_current_token(p).type == TOK_CONST) {
         is_const = 1;
         parser_advance(p);
     }
 
+    bool is_soa = false;
+    if (parser_current_token(p).type == TOK_SOA) {
+        is_soa = true;
+        parser_advance(p);
+    }
+
     const Token type_tok = parser_current_token(p);
     const SourceLocation loc = type_tok.location;
     const TypeKind type = token_to_typekind(p, type_tok.type);
@@ -27,6 +35,9 @@ GlobalVarNode* parse_global_var(Parser *p) {
         parser_expect(p, TOK_RSQUARE);
     }
 
+    int dim_count = 0;
+    int *dims = parse_array_dims(p, array_size, &dim_count);
+
     int pointer_level = 0;
     while (parser_current_token(p).type == TOK_ASTERISK) {
         pointer_level++;
@@ -40,7 +51,7 @@ GlobalVarNode* parse_global_var(Parser *p) {
     ExprNode *initializer = NULL;
     if (parser_current_token(p).type == TOK_ASSIGN) {
         parser_advance(p);
-        initializer = parse_expression(p);
+        initializer = parse_initializer(p);
     }
 
     parser_expect(p, TOK_SEMI);
@@ -53,6 +64,10 @@ GlobalVarNode* parse_global_var(Parser *p) {
     global->array_size = array_size;
     global->initializer = initializer;
     global->is_const = is_const;
+    global->is_soa = is_soa;
+    global->dims = dims;
+    global->dim_count = dim_count;
+    global->alignment = alignment;
 
     return global;
 }
@@ -70,6 +85,8 @@ void parse_parameter_list(Parser *p, ParamNode **params_out, int *count_out) {
     Vector params = create_vector(4, sizeof(ParamNode));
 
     do {
+        const int alignment = parse_alignment(p);
+
         int param_is_const = 0;
         if (parser_current_token(p).type == TOK_CONST) {
             param_is_const = 1;
@@ -83,22 +100,40 @@ void parse_parameter_list(Parser *p, ParamNode **params_out, int *count_out) {
 
         int pointer_level = 0;
         int array_size = 0;
+        bool is_slice = false;
         if (parser_current_token(p).type == TOK_LSQUARE) {
             parser_advance(p);
             if (parser_current_token(p).type == TOK_NUMBER) {
                 array_size = atoi(parser_current_token(p).lexeme);
                 parser_advance(p);
+            } else {
+                // T[] carries its length, T[N] decays to a pointer like in c
+                is_slice = true;
             }
 
             pointer_level++;
             parser_expect(p, TOK_RSQUARE);
         }
 
+        // int[H][W] and int[][W] are both a pointer to rows of W
+        int dim_count = 0;
+        int *dims = parse_array_dims(p, array_size, &dim_count);
+        if (dims) {
+            is_slice = false;
+            pointer_level += dim_count - 1;
+        }
+
         while (parser_current_token(p).type == TOK_ASTERISK) {
             pointer_level++;
             parser_advance(p);
         }
 
+        bool is_restrict = false;
+        if (parser_current_token(p).type == TOK_RESTRICT) {
+            is_restrict = true;
+            parser_advance(p);
+        }
+
         const Token name_tok = parser_current_token(p);
         parser_expect(p, TOK_IDENTIFIER);
 
@@ -108,6 +143,11 @@ void parse_parameter_list(Parser *p, ParamNode **params_out, int *count_out) {
             .array_size = array_size,
             .name = strdup(name_tok.lexeme),
             .is_const = param_is_const,
+            .is_restrict = is_restrict,
+            .is_slice = is_slice,
+            .dims = dims,
+            .dim_count = dim_count,
+            .alignment = alignment,
             .location = type_tok.location
         };
 
@@ -127,12 +167,207 @@ void parse_parameter_list(Parser *p, ParamNode **params_out, int *count_out) {
     *count_out = params.length;
 }
 
+bool is_struct_qualifier(const TokenType type) {
+    return type == TOK_STRUCT || type == TOK_PACKED || type == TOK_ALIGN || type == TOK_REORDER;
+}
+
+// align(N) in front of a struct or a declaration, 0 when there is none
+int parse_alignment(Parser *p) {
+    if (parser_current_token(p).type != TOK_ALIGN) return 0;
+
+    parser_advance(p);
+    parser_expect(p, TOK_LPAREN);
+
+    int alignment = 0;
+    if (parser_current_token(p).type == TOK_NUMBER) {
+        alignment = atoi(parser_current_token(p).lexeme);
+        if (alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+            diag_error(p->diagnostics, parser_current_token(p).location, "Alignment must be a power of two, got %d", alignment);
+            alignment = 0;
+        }
+        parser_advance(p);
+    } else {
+        diag_error(p->diagnostics, parser_current_token(p).location, "Expected alignment");
+    }
+
+    parser_expect(p, TOK_RPAREN);
+    return alignment;
+}
+
+// [packed] [reorder] [align(N)] struct Name { type field; ... }
+StructNode* parse_struct(Parser *p) {
+    int attributes = 0;
+    int alignment = 0;
+    while (parser_current_token(p).type != TOK_STRUCT && is_struct_qualifier(parser_current_token(p).type)) {
+        switch (parser_current_token(p).type) {
+            case TOK_PACKED: attributes |= STRUCT_ATTR_PACKED; parser_advance(p); break;
+            case TOK_REORDER: attributes |= STRUCT_ATTR_REORDER; parser_advance(p); break;
+            case TOK_ALIGN: alignment = parse_alignment(p); break;
+            default: parser_advance(p); break;
+        }
+    }
+
+    const SourceLocation loc = parser_current_token(p).location;
+    parser_expect(p, TOK_STRUCT);
+
+    const Token name_token = parser_current_token(p);
+    parser_expect(p, TOK_IDENTIFIER);
+
+    StructNode *def = malloc(sizeof(StructNode));
+    def->name = strdup(name_token.type == TOK_IDENTIFIER ? name_token.lexeme : "<error>");
+    def->attributes = attributes;
+    def->alignment = alignment;
+    def->location = loc;
+    def->fields = NULL;
+    def->field_count = 0;
+
+    if (is_type_name(p, name_token)) {
+        diag_error(p->diagnostics, name_token.location, "Struct '%s' already declared", def->name);
+    }
+
+    // registered before the body so fields can point back at the struct
+    vector_push(&p->structs, &def);
+
+    Vector fields = create_vector(8, sizeof(FieldNode));
+    parser_expect(p, TOK_LBRACE);
+
+    while (parser_current_token(p).type != TOK_RBRACE && parser_current_token(p).type != TOK_EOF) {
+        const Token type_tok = parser_current_token(p);
+        const TypeKind type = token_to_typekind(p, type_tok.type);
+        parser_advance(p);
+
+        int array_size = 0;
+        if (parser_current_token(p).type == TOK_LSQUARE) {
+            parser_advance(p);
+            if (parser_current_token(p).type == TOK_NUMBER) {
+                array_size = atoi(parser_current_token(p).lexeme);
+                parser_advance(p);
+            } else {
+                diag_error(p->diagnostics, parser_current_token(p).location, "Expected array size");
+            }
+
+            parser_expect(p, TOK_RSQUARE);
+        }
+
+        int pointer_level = 0;
+        while (parser_current_token(p).type == TOK_ASTERISK) {
+            pointer_level++;
+            parser_advance(p);
+        }
+
+        const Token field_tok = parser_current_token(p);
+        parser_expect(p, TOK_IDENTIFIER);
+        parser_expect(p, TOK_SEMI);
+
+        if (field_tok.type != TOK_IDENTIFIER) {
+            // error recovery, skip to the next field
+            while (parser_current_token(p).type != TOK_SEMI && parser_current_token(p).type != TOK_RBRACE && parser_current_token(p).type != TOK_EOF) {
+                parser_advance(p);
+            }
+
+            if (parser_current_token(p).type == TOK_SEMI) {
+                parser_advance(p);
+            }
+            continue;
+        }
+
+        FieldNode field = {
+            .type = type,
+            .pointer_level = pointer_level,
+            .array_size = array_size,
+            .name = strdup(field_tok.lexeme),
+            .location = type_tok.location
+        };
+
+        vector_push(&fields, &field);
+    }
+
+    parser_expect(p, TOK_RBRACE);
+
+    // optional, for people used to c
+    if (parser_current_token(p).type == TOK_SEMI) {
+        parser_advance(p);
+    }
+
+    def->fields = (FieldNode*)fields.elements;
+    def->field_count = fields.length;
+
+    return def;
+}
+
+bool is_function_qualifier(const TokenType type) {
+    return type == TOK_EXPORT || type == TOK_FASTMATH || type == TOK_INLINE || type == TOK_ALWAYS_INLINE ||
+           type == TOK_NOINLINE || type == TOK_HOT || type == TOK_COLD;
+}
+
 FunctionNode* parse_function(Parser *p) {
+    bool is_exported = false;
+    int attributes = 0;
+    while (is_function_qualifier(parser_current_token(p).type)) {
+        switch (parser_current_token(p).type) {
+            case TOK_EXPORT: is_exported = true; break;
+            case TOK_FASTMATH: attributes |= FUNC_ATTR_FASTMATH; break;
+            case TOK_INLINE: attributes |= FUNC_ATTR_INLINE; break;
+            case TOK_ALWAYS_INLINE: attributes |= FUNC_ATTR_ALWAYS_INLINE; break;
+            case TOK_NOINLINE: attributes |= FUNC_ATTR_NOINLINE; break;
+            case TOK_HOT: attributes |= FUNC_ATTR_HOT; break;
+            case TOK_COLD: attributes |= FUNC_ATTR_COLD; break;
+            default: break;
+        }
+        parser_advance(p);
+    }
+
+    // the return type can already use the type parameters, so they are read ahead of it
+    Vector type_params = create_vector(2, sizeof(char*));
+    int lookahead_pos = 1;
+    if (parser_peek_token(p, lookahead_pos).type == TOK_LSQUARE) {
+        lookahead_pos += 2;
+    }
+
+    while (parser_peek_token(p, lookahead_pos).type == TOK_ASTERISK) {
+        lookahead_pos++;
+    }
+
+    if (parser_peek_token(p, lookahead_pos + 1).type == TOK_LESS) {
+        lookahead_pos += 2;
+
+        while (parser_peek_token(p, lookahead_pos).type == TOK_IDENTIFIER) {
+            const Token param_tok = parser_peek_token(p, lookahead_pos);
+            if (type_params.length == MAX_TYPE_PARAMS) {
+                diag_error(p->diagnostics, param_tok.location, "A function can have at most %d type parameters", MAX_TYPE_PARAMS);
+                break;
+            }
+
+            for (int i = 0; i < type_params.length; i++) {
+                if (strcmp(*(char**)vector_get(&type_params, i), param_tok.lexeme) == 0) {
+                    diag_error(p->diagnostics, param_tok.location, "Duplicate type parameter '%s'", param_tok.lexeme);
+                }
+            }
+
+            char *param_name = strdup(param_tok.lexeme);
+            vector_push(&type_params, &param_name);
+
+            if (parser_peek_token(p, lookahead_pos + 1).type != TOK_COMMA) break;
+            lookahead_pos += 2;
+        }
+    }
+
+    p->type_params = (char**)type_params.elements;
+    p->type_param_count = type_params.length;
+
     const Token type_token = parser_current_token(p);
     const TypeKind return_type = token_to_typekind(p, type_token.type);
     parser_advance(p);
 
     int return_pointer_level = 0;
+    bool returns_slice = false;
+    if (parser_current_token(p).type == TOK_LSQUARE) {
+        parser_advance(p);
+        parser_expect(p, TOK_RSQUARE);
+        returns_slice = true;
+        return_pointer_level++;
+    }
+
     while (parser_current_token(p).type == TOK_ASTERISK) {
         return_pointer_level++;
         parser_advance(p);
@@ -141,20 +376,43 @@ FunctionNode* parse_function(Parser *p) {
     const Token name_token = parser_current_token(p);
     parser_expect(p, TOK_IDENTIFIER);
 
+    // <T, U>, already collected above
+    if (parser_current_token(p).type == TOK_LESS) {
+        parser_advance(p);
+
+        while (true) {
+            parser_expect(p, TOK_IDENTIFIER);
+            if (parser_current_token(p).type != TOK_COMMA) break;
+            parser_advance(p);
+        }
+
+        parser_expect(p, TOK_GREATER);
+    }
+
     ParamNode *params;
     int param_count = 0;
     parse_parameter_list(p, &params, &param_count);
 
     StmtNode *body = parse_compound_stmt(p);
 
+    p->type_params = NULL;
+    p->type_param_count = 0;
+
     FunctionNode *func = malloc(sizeof(FunctionNode));
     func->name = strdup(name_token.lexeme);
     func->return_type = return_type;
     func->return_pointer_level = return_pointer_level;
+    func->returns_slice = returns_slice;
     func->params = params;
     func->param_count = param_count;
     func->body = body;
     func->location = type_token.location;
+    func->attributes = attributes;
+    func->is_exported = is_exported;
+    func->is_reachable = true;
+    func->has_self_become = false;
+    func->type_params = (char**)type_params.elements;
+    func->type_param_count = type_params.length;
 
     return func;
 }
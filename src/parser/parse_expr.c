@@ -6,17 +6,23 @@
  * grammar implemented:
  *
  * expression  -> assignment
- * assignment  -> logical_or (= assignment)?
+ * assignment  -> logical_or ((= | += | -= | *= | /= | %= | &= | |= | ^= | <<= | >>=) assignment)?
  * logical_or  -> logical_and (|| logical_and)*
- * logical_and -> equality (&& equality)*
+ * logical_and -> bit_or (&& bit_or)*
+ * bit_or      -> bit_xor (| bit_xor)*
+ * bit_xor     -> bit_and (^ bit_and)*
+ * bit_and     -> equality (& equality)*
  * equality    -> relational ((== | !=) relational)*
- * relational  -> additive ((< | > | <= | >=) additive)*
+ * relational  -> shift ((< | > | <= | >=) shift)*
+ * shift       -> additive ((<< | >>) additive)*
  * additive    -> term ((+ | -) term)*
  * term        -> factor ((* | / | %) factor)*
  * factor      -> unary
- * unary       -> (* | & | - | !)* postfix
- * postfix     -> primary ('[' expression ']')*
+ * unary       -> (* | & | - | ! | ~)* postfix
+ * postfix     -> primary ('[' expression ']' | '.' IDENTIFIER | '->' IDENTIFIER)*
  * primary     -> NUMBER | STRING | IDENTIFIER | call | '(' expression ')'
+ *
+ * initializer -> '{' (expression (',' expression)* ','?)? '}' | expression
  */
 ExprNode* parse_expression(Parser *p) {
     return parse_assignment(p);
@@ -30,12 +36,17 @@ ExprNode* parse_assignment(Parser *p) {
     bool is_assign = true;
 
     switch (t.type) {
-        case TOK_ASSIGN:          op = BIN_ASSIGN; break;
-        case TOK_PLUS_EQUALS:     op = BIN_ADD_ASSIGN; break;
-        case TOK_SUBTRACT_EQUALS: op = BIN_SUB_ASSIGN; break;
-        case TOK_ASTERISK_EQUALS: op = BIN_MUL_ASSIGN; break;
-        case TOK_DIVIDE_EQUALS:   op = BIN_DIV_ASSIGN; break;
-        case TOK_MODULO_EQUALS:   op = BIN_MOD_ASSIGN; break;
+        case TOK_ASSIGN:             op = BIN_ASSIGN; break;
+        case TOK_PLUS_EQUALS:        op = BIN_ADD_ASSIGN; break;
+        case TOK_SUBTRACT_EQUALS:    op = BIN_SUB_ASSIGN; break;
+        case TOK_ASTERISK_EQUALS:    op = BIN_MUL_ASSIGN; break;
+        case TOK_DIVIDE_EQUALS:      op = BIN_DIV_ASSIGN; break;
+        case TOK_MODULO_EQUALS:      op = BIN_MOD_ASSIGN; break;
+        case TOK_AMPERSAND_EQUALS:   op = BIN_AND_ASSIGN; break;
+        case TOK_PIPE_EQUALS:        op = BIN_OR_ASSIGN; break;
+        case TOK_CARET_EQUALS:       op = BIN_XOR_ASSIGN; break;
+        case TOK_SHIFT_LEFT_EQUALS:  op = BIN_SHL_ASSIGN; break;
+        case TOK_SHIFT_RIGHT_EQUALS: op = BIN_SHR_ASSIGN; break;
         default: is_assign = false; break;
     }
 
@@ -51,6 +62,9 @@ ExprNode* parse_assignment(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         return expr;
     }
@@ -73,6 +87,9 @@ ExprNode* parse_logical_or(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -81,12 +98,12 @@ ExprNode* parse_logical_or(Parser *p) {
 }
 
 ExprNode* parse_logical_and(Parser *p) {
-    ExprNode *left = parse_equality(p);
+    ExprNode *left = parse_bit_or(p);
 
     while (parser_current_token(p).type == TOK_AND) {
         const SourceLocation loc = parser_current_token(p).location;
         parser_advance(p);
-        ExprNode *right = parse_equality(p);
+        ExprNode *right = parse_bit_or(p);
 
         ExprNode *expr = malloc(sizeof(ExprNode));
         expr->kind = EXPR_BINOP;
@@ -95,6 +112,84 @@ ExprNode* parse_logical_and(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
+
+        left = expr;
+    }
+
+    return left;
+}
+
+ExprNode* parse_bit_or(Parser *p) {
+    ExprNode *left = parse_bit_xor(p);
+
+    while (parser_current_token(p).type == TOK_PIPE) {
+        const SourceLocation loc = parser_current_token(p).location;
+        parser_advance(p);
+        ExprNode *right = parse_bit_xor(p);
+
+        ExprNode *expr = malloc(sizeof(ExprNode));
+        expr->kind = EXPR_BINOP;
+        expr->location = loc;
+        expr->binop.op = BIN_BIT_OR;
+        expr->binop.left = left;
+        expr->binop.right = right;
+        expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
+
+        left = expr;
+    }
+
+    return left;
+}
+
+ExprNode* parse_bit_xor(Parser *p) {
+    ExprNode *left = parse_bit_and(p);
+
+    while (parser_current_token(p).type == TOK_CARET) {
+        const SourceLocation loc = parser_current_token(p).location;
+        parser_advance(p);
+        ExprNode *right = parse_bit_and(p);
+
+        ExprNode *expr = malloc(sizeof(ExprNode));
+        expr->kind = EXPR_BINOP;
+        expr->location = loc;
+        expr->binop.op = BIN_BIT_XOR;
+        expr->binop.left = left;
+        expr->binop.right = right;
+        expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
+
+        left = expr;
+    }
+
+    return left;
+}
+
+ExprNode* parse_bit_and(Parser *p) {
+    ExprNode *left = parse_equality(p);
+
+    while (parser_current_token(p).type == TOK_AMPERSAND) {
+        const SourceLocation loc = parser_current_token(p).location;
+        parser_advance(p);
+        ExprNode *right = parse_equality(p);
+
+        ExprNode *expr = malloc(sizeof(ExprNode));
+        expr->kind = EXPR_BINOP;
+        expr->location = loc;
+        expr->binop.op = BIN_BIT_AND;
+        expr->binop.left = left;
+        expr->binop.right = right;
+        expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -119,6 +214,9 @@ ExprNode* parse_equality(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -127,7 +225,7 @@ ExprNode* parse_equality(Parser *p) {
 }
 
 ExprNode* parse_relational(Parser *p) {
-    ExprNode *left = parse_additive(p);
+    ExprNode *left = parse_shift(p);
 
     while (parser_current_token(p).type == TOK_LESS || parser_current_token(p).type == TOK_GREATER ||
            parser_current_token(p).type == TOK_LESS_EQUALS || parser_current_token(p).type == TOK_GREATER_EQUALS) {
@@ -135,7 +233,7 @@ ExprNode* parse_relational(Parser *p) {
         const TokenType op_tok = parser_current_token(p).type;
 
         parser_advance(p);
-        ExprNode *right = parse_additive(p);
+        ExprNode *right = parse_shift(p);
 
         BinaryOp op;
         switch (op_tok) {
@@ -153,6 +251,35 @@ ExprNode* parse_relational(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
+
+        left = expr;
+    }
+
+    return left;
+}
+
+ExprNode* parse_shift(Parser *p) {
+    ExprNode *left = parse_additive(p);
+
+    while (parser_current_token(p).type == TOK_SHIFT_LEFT || parser_current_token(p).type == TOK_SHIFT_RIGHT) {
+        const SourceLocation loc = parser_current_token(p).location;
+        const BinaryOp op = (parser_current_token(p).type == TOK_SHIFT_LEFT) ? BIN_SHL : BIN_SHR;
+        parser_advance(p);
+        ExprNode *right = parse_additive(p);
+
+        ExprNode *expr = malloc(sizeof(ExprNode));
+        expr->kind = EXPR_BINOP;
+        expr->location = loc;
+        expr->binop.op = op;
+        expr->binop.left = left;
+        expr->binop.right = right;
+        expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -176,6 +303,9 @@ ExprNode* parse_additive(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -207,6 +337,9 @@ ExprNode* parse_term(Parser *p) {
         expr->binop.left = left;
         expr->binop.right = right;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         left = expr;
     }
@@ -233,6 +366,9 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_PRE_INC;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -246,6 +382,9 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_PRE_DEC;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -259,6 +398,9 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_DEREF;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -272,6 +414,9 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_ADDR_OF;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -285,6 +430,9 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_NEG;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -298,6 +446,25 @@ ExprNode* parse_unary(Parser *p) {
         expr->unary.op = UNARY_NOT;
         expr->unary.operand = operand;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
+        return expr;
+    }
+
+    if (parser_current_token(p).type == TOK_TILDE) {
+        parser_advance(p);
+        ExprNode *operand = parse_unary(p);
+
+        ExprNode *expr = malloc(sizeof(ExprNode));
+        expr->kind = EXPR_UNARY;
+        expr->location = loc;
+        expr->unary.op = UNARY_BIT_NOT;
+        expr->unary.operand = operand;
+        expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
         return expr;
     }
 
@@ -327,6 +494,9 @@ ExprNode* parse_cast(Parser *p) {
     expr->location = loc;
     expr->type = target_type;
     expr->pointer_level = target_pointer_level;
+    expr->is_slice = false;
+    expr->dims = NULL;
+    expr->dim_count = 0;
     expr->cast.target_type = target_type;
     expr->cast.target_pointer_level = target_pointer_level;
     expr->cast.operand = operand;
@@ -346,6 +516,9 @@ ExprNode* parse_postfix(Parser *p) {
         expr->text = strdup(t.lexeme);
         expr->location = t.location;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
     } else if (t.type == TOK_STRING_LITERAL) {
         parser_advance(p);
         expr = malloc(sizeof(ExprNode));
@@ -353,10 +526,40 @@ ExprNode* parse_postfix(Parser *p) {
         expr->text = strdup(t.lexeme);
         expr->location = t.location;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
     } else if (t.type == TOK_IDENTIFIER) {
         const Token name_tok = t;
         parser_advance(p);
 
+        // explicit type arguments, max<int>(a, b). a type cant start an operand so this never takes a comparison
+        Vector type_args = create_vector(2, sizeof(TypeArg));
+        const Token after_less = parser_peek_token(p, 1);
+        if (parser_current_token(p).type == TOK_LESS && (is_type_token(after_less.type) || is_type_name(p, after_less))) {
+            parser_advance(p);
+
+            while (true) {
+                TypeArg arg = { token_to_typekind(p, parser_current_token(p).type), 0 };
+                parser_advance(p);
+
+                while (parser_current_token(p).type == TOK_ASTERISK) {
+                    arg.pointer_level++;
+                    parser_advance(p);
+                }
+
+                vector_push(&type_args, &arg);
+                if (parser_current_token(p).type != TOK_COMMA) break;
+                parser_advance(p);
+            }
+
+            parser_expect(p, TOK_GREATER);
+
+            if (parser_current_token(p).type != TOK_LPAREN) {
+                diag_error(p->diagnostics, parser_current_token(p).location, "Expected '(' after the type arguments of '%s'", name_tok.lexeme);
+            }
+        }
+
         // check for function call
         if (parser_current_token(p).type == TOK_LPAREN) {
             parser_advance(p);
@@ -382,15 +585,27 @@ ExprNode* parse_postfix(Parser *p) {
             expr->call.function_name = strdup(name_tok.lexeme);
             expr->call.args = (ExprNode**)args.elements;
             expr->call.arg_count = args.length;
+            expr->call.intrinsic = INTRINSIC_NONE;
+            expr->call.tail_call = TAIL_CALL_NONE;
+            expr->call.type_args = (TypeArg*)type_args.elements;
+            expr->call.type_arg_count = type_args.length;
             expr->location = name_tok.location;
             expr->pointer_level = 0;
+            expr->is_slice = false;
+            expr->dims = NULL;
+            expr->dim_count = 0;
         } else {
+            vector_destroy(&type_args);
+
             // variable
             expr = malloc(sizeof(ExprNode));
             expr->kind = EXPR_VAR;
             expr->text = strdup(name_tok.lexeme);
             expr->location = name_tok.location;
             expr->pointer_level = 0;
+            expr->is_slice = false;
+            expr->dims = NULL;
+            expr->dim_count = 0;
         }
     } else if (t.type == TOK_LPAREN) {
         parser_advance(p);
@@ -405,6 +620,9 @@ ExprNode* parse_postfix(Parser *p) {
         expr->text = strdup("0");
         expr->location = t.location;
         expr->pointer_level = 0;
+        expr->is_slice = false;
+        expr->dims = NULL;
+        expr->dim_count = 0;
 
         parser_advance(p);
         return expr;
@@ -413,7 +631,27 @@ ExprNode* parse_postfix(Parser *p) {
     while (true) {
         if (parser_current_token(p).type == TOK_LSQUARE) {
             parser_advance(p);
-            ExprNode *index = parse_expression(p);
+            ExprNode *index = parser_current_token(p).type == TOK_COLON ? NULL : parse_expression(p);
+
+            // a[start:end], either bound can be left out
+            if (parser_current_token(p).type == TOK_COLON) {
+                parser_advance(p);
+                ExprNode *end = parser_current_token(p).type == TOK_RSQUARE ? NULL : parse_expression(p);
+                parser_expect(p, TOK_RSQUARE);
+
+                ExprNode *slice = malloc(sizeof(ExprNode));
+                slice->kind = EXPR_SLICE;
+                slice->slice.object = expr;
+                slice->slice.start = index;
+                slice->slice.end = end;
+                slice->location = expr->location;
+                slice->pointer_level = 0;
+                slice->is_slice = true;
+
+                expr = slice;
+                continue;
+            }
+
             parser_expect(p, TOK_RSQUARE);
 
             ExprNode *array_expr = malloc(sizeof(ExprNode));
@@ -422,11 +660,38 @@ ExprNode* parse_postfix(Parser *p) {
             array_expr->array_index.index = index;
             array_expr->location = expr->location;
             array_expr->pointer_level = 0;
+            array_expr->is_slice = false;
+            array_expr->dims = NULL;
+            array_expr->dim_count = 0;
 
             expr = array_expr;
             continue;
         }
 
+        if (parser_current_token(p).type == TOK_DOT || parser_current_token(p).type == TOK_ARROW) {
+            const bool through_pointer = parser_current_token(p).type == TOK_ARROW;
+            parser_advance(p);
+
+            const Token field_tok = parser_current_token(p);
+            parser_expect(p, TOK_IDENTIFIER);
+
+            ExprNode *member = malloc(sizeof(ExprNode));
+            member->kind = EXPR_MEMBER;
+            member->location = expr->location;
+            member->member.object = expr;
+            member->member.field_name = strdup(field_tok.type == TOK_IDENTIFIER ? field_tok.lexeme : "<error>");
+            member->member.field_index = -1;
+            member->member.through_pointer = through_pointer;
+            member->member.is_soa = false;
+            member->pointer_level = 0;
+            member->is_slice = false;
+            member->dims = NULL;
+            member->dim_count = 0;
+
+            expr = member;
+            continue;
+        }
+
         if (parser_current_token(p).type == TOK_PLUS_PLUS) {
             parser_advance(p);
 
@@ -436,6 +701,9 @@ ExprNode* parse_postfix(Parser *p) {
             post_inc->unary.op = UNARY_POST_INC;
             post_inc->unary.operand = expr;
             post_inc->pointer_level = 0;
+            post_inc->is_slice = false;
+            post_inc->dims = NULL;
+            post_inc->dim_count = 0;
 
             expr = post_inc;
             continue;
@@ -450,6 +718,9 @@ ExprNode* parse_postfix(Parser *p) {
             post_dec->unary.op = UNARY_POST_DEC;
             post_dec->unary.operand = expr;
             post_dec->pointer_level = 0;
+            post_dec->is_slice = false;
+            post_dec->dims = NULL;
+            post_dec->dim_count = 0;
 
             expr = post_dec;
             continue;
@@ -458,5 +729,43 @@ ExprNode* parse_postfix(Parser *p) {
         break;
     }
 
+    return expr;
+}
+
+ExprNode* parse_initializer(Parser *p) {
+    if (parser_current_token(p).type != TOK_LBRACE) {
+        return parse_expression(p);
+    }
+
+    const SourceLocation loc = parser_current_token(p).location;
+    parser_advance(p);
+
+    Vector elements = create_vector(8, sizeof(ExprNode*));
+
+    while (parser_current_token(p).type != TOK_RBRACE && parser_current_token(p).type != TOK_EOF) {
+        // rows of a multi-dimensional array are nested lists
+        ExprNode *element = parse_initializer(p);
+        vector_push(&elements, &element);
+
+        // trailing comma is allowed
+        if (parser_current_token(p).type == TOK_COMMA) {
+            parser_advance(p);
+        } else {
+            break;
+        }
+    }
+
+    parser_expect(p, TOK_RBRACE);
+
+    ExprNode *expr = malloc(sizeof(ExprNode));
+    expr->kind = EXPR_INIT_LIST;
+    expr->location = loc;
+    expr->init_list.elements = (ExprNode**)elements.elements;
+    expr->init_list.count = elements.length;
+    expr->pointer_level = 0;
+    expr->is_slice = false;
+    expr->dims = NULL;
+    expr->dim_count = 0;
+
     return expr;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "parser_internal.h"
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -7,16 +9,22 @@ StmtNode* parse_statement(Parser *p) {
 
     switch (t.type) {
         case TOK_RETURN: return parse_return_stmt(p);
+        case TOK_BECOME: return parse_become_stmt(p);
         case TOK_IF: return parse_if_stmt(p);
         case TOK_WHILE: return parse_while_stmt(p);
-        case TOK_FOR: return parse_for_stmt(p);
+        case TOK_FOR:
+        case TOK_PARALLEL: return parse_for_stmt(p);
+        case TOK_SWITCH: return parse_switch_stmt(p);
         case TOK_BREAK: return parse_break_stmt(p);
         case TOK_CONTINUE: return parse_continue_stmt(p);
         case TOK_ASM: return parse_asm_stmt(p);
+        case TOK_PRAGMA: return parse_pragma_stmt(p);
         case TOK_LBRACE: return parse_compound_stmt(p);
 
         // type keywords indicate variable declaration
+        case TOK_ALIGN:
         case TOK_CONST:
+        case TOK_SOA:
         case TOK_INT:
         case TOK_LONG:
         case TOK_CHAR:
@@ -24,9 +32,21 @@ StmtNode* parse_statement(Parser *p) {
         case TOK_DOUBLE:
         case TOK_STRING_KW:
         case TOK_BOOL:
-        case TOK_VOID: return parse_var_decl(p);
+        case TOK_VOID:
+        case TOK_UINT:
+        case TOK_ULONG:
+        case TOK_BYTE:
+        case TOK_FLOAT4:
+        case TOK_FLOAT8:
+        case TOK_INT4:
+        case TOK_INT8: return parse_var_decl(p);
+
+        default:
+            if (is_type_name(p, t)) {
+                return parse_var_decl(p);
+            }
 
-        default: return parse_expr_stmt(p);
+            return parse_expr_stmt(p);
     }
 }
 
@@ -49,6 +69,26 @@ StmtNode* parse_return_stmt(Parser *p) {
     return stmt;
 }
 
+// become f(args); is a return of the call that must be able to reuse the caller's frame
+StmtNode* parse_become_stmt(Parser *p) {
+    const SourceLocation loc = parser_current_token(p).location;
+    parser_expect(p, TOK_BECOME);
+
+    StmtNode *stmt = malloc(sizeof(StmtNode));
+    stmt->kind = STMT_RETURN;
+    stmt->location = loc;
+    stmt->return_stmt.expr = parse_expression(p);
+
+    if (stmt->return_stmt.expr->kind == EXPR_CALL) {
+        stmt->return_stmt.expr->call.tail_call = TAIL_CALL_BECOME;
+    } else {
+        diag_error(p->diagnostics, stmt->return_stmt.expr->location, "Expected a function call after 'become'");
+    }
+
+    parser_expect(p, TOK_SEMI);
+    return stmt;
+}
+
 StmtNode* parse_if_stmt(Parser *p) {
     const SourceLocation loc = parser_current_token(p).location;
     parser_expect(p, TOK_IF);
@@ -85,14 +125,135 @@ StmtNode* parse_while_stmt(Parser *p) {
     stmt->location = loc;
     stmt->while_stmt.condition = cond;
     stmt->while_stmt.body = body;
+    stmt->while_stmt.hints = (LoopHints){0, 0, 0};
     return stmt;
 }
 
+// reads one pragma into the hints, 'unroll(4)', 'nounroll', 'vectorize(width: 8)', 'novector' or 'interleave(2)'
+static void parse_loop_hint(Parser *p, const Token pragma, LoopHints *hints) {
+    // spacing inside the pragma doesn't matter
+    char *text = malloc(strlen(pragma.lexeme) + 1);
+    size_t length = 0;
+    for (const char *c = pragma.lexeme; *c; c++) {
+        if (!isspace((unsigned char)*c)) text[length++] = *c;
+    }
+    text[length] = '\0';
+
+    int count = 0;
+    int end = -1;
+    int *hint = NULL;
+
+    if (strcmp(text, "unroll") == 0) {
+        hints->unroll = LOOP_HINT_ON;
+    } else if (strcmp(text, "nounroll") == 0) {
+        hints->unroll = LOOP_HINT_OFF;
+    } else if (strcmp(text, "vectorize") == 0) {
+        hints->vectorize = LOOP_HINT_ON;
+    } else if (strcmp(text, "novector") == 0 || strcmp(text, "novectorize") == 0) {
+        hints->vectorize = LOOP_HINT_OFF;
+    } else if (strcmp(text, "nointerleave") == 0) {
+        hints->interleave = LOOP_HINT_OFF;
+    } else if (sscanf(text, "unroll(%d)%n", &count, &end) == 1 && end == (int)length) {
+        hint = &hints->unroll;
+    } else if (sscanf(text, "vectorize(width:%d)%n", &count, &end) == 1 && end == (int)length) {
+        hint = &hints->vectorize;
+        if (count > 0 && (count & (count - 1)) != 0) {
+            diag_error(p->diagnostics, pragma.location, "Vectorize width must be a power of two, got %d", count);
+        }
+    } else if (sscanf(text, "interleave(%d)%n", &count, &end) == 1 && end == (int)length) {
+        hint = &hints->interleave;
+    } else {
+        diag_warning(p->diagnostics, pragma.location,
+                    "Ignoring unknown pragma '%s', loop pragmas are unroll, nounroll, vectorize, novector, interleave and nointerleave",
+                    pragma.lexeme);
+    }
+
+    if (hint && count <= 0) {
+        diag_error(p->diagnostics, pragma.location, "'#pragma %s' needs a count above 0", pragma.lexeme);
+    } else if (hint) {
+        *hint = count;
+    }
+
+    free(text);
+}
+
+// loop pragmas apply to the for or while loop right after them
+StmtNode* parse_pragma_stmt(Parser *p) {
+    LoopHints hints = {0, 0, 0};
+    while (parser_current_token(p).type == TOK_PRAGMA) {
+        parse_loop_hint(p, parser_current_token(p), &hints);
+        parser_advance(p);
+    }
+
+    const Token t = parser_current_token(p);
+    if (t.type != TOK_FOR && t.type != TOK_PARALLEL && t.type != TOK_WHILE) {
+        diag_error(p->diagnostics, t.location, "Expected a 'for' or 'while' loop after a loop pragma, got '%s'",
+                  token_type_to_string(t.type));
+        return parse_statement(p);
+    }
+
+    StmtNode *stmt = parse_statement(p);
+    if (stmt->kind == STMT_WHILE) {
+        stmt->while_stmt.hints = hints;
+    } else {
+        stmt->for_stmt.hints = hints;
+    }
+
+    return stmt;
+}
+
+// reduce(+: a, b) after the header of a parallel for, one clause per operator
+static void parse_reductions(Parser *p, Vector *reductions) {
+    while (parser_current_token(p).type == TOK_REDUCE) {
+        parser_advance(p);
+        parser_expect(p, TOK_LPAREN);
+
+        const Token op_token = parser_current_token(p);
+        BinaryOp op = BIN_ADD;
+        switch (op_token.type) {
+            case TOK_PLUS: op = BIN_ADD; break;
+            case TOK_ASTERISK: op = BIN_MUL; break;
+            case TOK_AMPERSAND: op = BIN_BIT_AND; break;
+            case TOK_PIPE: op = BIN_BIT_OR; break;
+            case TOK_CARET: op = BIN_BIT_XOR; break;
+            default:
+                diag_error(p->diagnostics, op_token.location, "Expected one of + * & | ^ in 'reduce', got '%s'", op_token.lexeme);
+                break;
+        }
+
+        parser_advance(p);
+        parser_expect(p, TOK_COLON);
+
+        while (true) {
+            const Token name = parser_current_token(p);
+            parser_expect(p, TOK_IDENTIFIER);
+
+            Reduction reduction = { op, strdup(name.lexeme), name.location };
+            vector_push(reductions, &reduction);
+
+            if (parser_current_token(p).type != TOK_COMMA) break;
+            parser_advance(p);
+        }
+
+        parser_expect(p, TOK_RPAREN);
+    }
+}
+
 StmtNode* parse_for_stmt(Parser *p) {
     const SourceLocation loc = parser_current_token(p).location;
+    const bool is_parallel = parser_current_token(p).type == TOK_PARALLEL;
+    if (is_parallel) {
+        parser_advance(p);
+    }
+
     parser_expect(p, TOK_FOR);
     parser_expect(p, TOK_LPAREN);
 
+    const bool is_ref = parser_current_token(p).type == TOK_REF;
+    if (is_ref || (parser_current_token(p).type == TOK_IDENTIFIER && parser_peek_token(p, 1).type == TOK_IN)) {
+        return parse_range_for(p, loc, is_parallel, is_ref);
+    }
+
     StmtNode *init = NULL;
     if (parser_current_token(p).type == TOK_SEMI) {
         parser_advance(p);
@@ -116,6 +277,11 @@ StmtNode* parse_for_stmt(Parser *p) {
 
     parser_expect(p, TOK_RPAREN);
 
+    Vector reductions = create_vector(2, sizeof(Reduction));
+    if (is_parallel) {
+        parse_reductions(p, &reductions);
+    }
+
     StmtNode *body = parse_statement(p);
 
     StmtNode *stmt = malloc(sizeof(StmtNode));
@@ -125,6 +291,100 @@ StmtNode* parse_for_stmt(Parser *p) {
     stmt->for_stmt.condition = cond;
     stmt->for_stmt.increment = incr;
     stmt->for_stmt.body = body;
+    stmt->for_stmt.is_parallel = is_parallel;
+    stmt->for_stmt.reductions = (Reduction*)reductions.elements;
+    stmt->for_stmt.reduction_count = reductions.length;
+    stmt->for_stmt.range = NULL;
+    stmt->for_stmt.range_var = NULL;
+    stmt->for_stmt.is_ref = false;
+    stmt->for_stmt.hints = (LoopHints){0, 0, 0};
+    return stmt;
+}
+
+// for ([ref] x in range) body, the 'for (' is already consumed
+StmtNode* parse_range_for(Parser *p, const SourceLocation loc, const bool is_parallel, const bool is_ref) {
+    if (is_parallel) {
+        diag_error(p->diagnostics, loc, "'parallel for' needs an index, 'in' loops cannot be parallel");
+    }
+
+    if (is_ref) {
+        parser_advance(p);
+    }
+
+    const Token name_token = parser_current_token(p);
+    parser_expect(p, TOK_IDENTIFIER);
+    parser_expect(p, TOK_IN);
+
+    ExprNode *range = parse_expression(p);
+    parser_expect(p, TOK_RPAREN);
+
+    StmtNode *body = parse_statement(p);
+
+    StmtNode *stmt = malloc(sizeof(StmtNode));
+    stmt->kind = STMT_FOR;
+    stmt->location = loc;
+    stmt->for_stmt.init = NULL;
+    stmt->for_stmt.condition = NULL;
+    stmt->for_stmt.increment = NULL;
+    stmt->for_stmt.body = body;
+    stmt->for_stmt.is_parallel = false;
+    stmt->for_stmt.reductions = NULL;
+    stmt->for_stmt.reduction_count = 0;
+    stmt->for_stmt.range = range;
+    stmt->for_stmt.range_var = strdup(name_token.lexeme);
+    stmt->for_stmt.is_ref = is_ref;
+    stmt->for_stmt.hints = (LoopHints){0, 0, 0};
+    return stmt;
+}
+
+StmtNode* parse_switch_stmt(Parser *p) {
+    const SourceLocation loc = parser_current_token(p).location;
+    parser_expect(p, TOK_SWITCH);
+    parser_expect(p, TOK_LPAREN);
+    ExprNode *value = parse_expression(p);
+    parser_expect(p, TOK_RPAREN);
+    parser_expect(p, TOK_LBRACE);
+
+    Vector cases = create_vector(8, sizeof(SwitchCase));
+
+    while (parser_current_token(p).type != TOK_RBRACE && parser_current_token(p).type != TOK_EOF) {
+        SwitchCase c = {0};
+        c.location = parser_current_token(p).location;
+
+        if (parser_current_token(p).type == TOK_CASE) {
+            parser_advance(p);
+            c.value = parse_expression(p);
+        } else if (parser_current_token(p).type == TOK_DEFAULT) {
+            parser_advance(p);
+        } else {
+            diag_error(p->diagnostics, c.location, "Expected 'case' or 'default' in switch, got '%s'", parser_current_token(p).lexeme);
+            parser_advance(p);
+            continue;
+        }
+
+        parser_expect(p, TOK_COLON);
+
+        // everything up to the next label belongs to this case
+        Vector stmts = create_vector(4, sizeof(StmtNode*));
+        while (parser_current_token(p).type != TOK_CASE && parser_current_token(p).type != TOK_DEFAULT &&
+               parser_current_token(p).type != TOK_RBRACE && parser_current_token(p).type != TOK_EOF) {
+            StmtNode *s = parse_statement(p);
+            vector_push(&stmts, &s);
+        }
+
+        c.stmts = (StmtNode**)stmts.elements;
+        c.count = stmts.length;
+        vector_push(&cases, &c);
+    }
+
+    parser_expect(p, TOK_RBRACE);
+
+    StmtNode *stmt = malloc(sizeof(StmtNode));
+    stmt->kind = STMT_SWITCH;
+    stmt->location = loc;
+    stmt->switch_stmt.value = value;
+    stmt->switch_stmt.cases = (SwitchCase*)cases.elements;
+    stmt->switch_stmt.case_count = cases.length;
     return stmt;
 }
 
@@ -151,23 +411,34 @@ StmtNode* parse_continue_stmt(Parser *p) {
 }
 
 StmtNode* parse_var_decl(Parser *p) {
+    const int alignment = parse_alignment(p);
+
     int is_const = 0;
     if (parser_current_token(p).type == TOK_CONST) {
         is_const = 1;
         parser_advance(p);
     }
 
+    bool is_soa = false;
+    if (parser_current_token(p).type == TOK_SOA) {
+        is_soa = true;
+        parser_advance(p);
+    }
+
     const Token type_tok = parser_current_token(p);
     const SourceLocation loc = type_tok.location;
     const TypeKind type = token_to_typekind(p, type_tok.type);
     parser_advance(p);
 
     int array_size = 0;
+    bool is_slice = false;
     if (parser_current_token(p).type == TOK_LSQUARE) {
         parser_advance(p);
         if (parser_current_token(p).type == TOK_NUMBER) {
             array_size = atoi(parser_current_token(p).lexeme);
             parser_advance(p);
+        } else if (parser_current_token(p).type == TOK_RSQUARE) {
+            is_slice = true;
         } else {
             diag_error(p->diagnostics, parser_current_token(p).location, "Expected array size");
         }
@@ -175,19 +446,32 @@ StmtNode* parse_var_decl(Parser *p) {
         parser_expect(p, TOK_RSQUARE);
     }
 
+    int dim_count = 0;
+    int *dims = parse_array_dims(p, array_size, &dim_count);
+    if (dims && is_slice) {
+        diag_error(p->diagnostics, loc, "Only parameters can leave the outer extent of an array out");
+        is_slice = false;
+    }
+
     int pointer_level = 0;
     while (parser_current_token(p).type == TOK_ASTERISK) {
         pointer_level++;
         parser_advance(p);
     }
 
+    bool is_restrict = false;
+    if (parser_current_token(p).type == TOK_RESTRICT) {
+        is_restrict = true;
+        parser_advance(p);
+    }
+
     const Token name_token = parser_current_token(p);
     parser_expect(p, TOK_IDENTIFIER);
 
     ExprNode *initializer = NULL;
     if (parser_current_token(p).type == TOK_ASSIGN) {
         parser_advance(p);
-        initializer = parse_expression(p);
+        initializer = parse_initializer(p);
     }
 
     parser_expect(p, TOK_SEMI);
@@ -201,6 +485,12 @@ StmtNode* parse_var_decl(Parser *p) {
     stmt->var_decl.name = strdup(name_token.lexeme);
     stmt->var_decl.initializer = initializer;
     stmt->var_decl.is_const = is_const;
+    stmt->var_decl.is_soa = is_soa;
+    stmt->var_decl.is_restrict = is_restrict;
+    stmt->var_decl.is_slice = is_slice;
+    stmt->var_decl.dims = dims;
+    stmt->var_decl.dim_count = dim_count;
+    stmt->var_decl.alignment = alignment;
 
     return stmt;
 }
@@ -10,6 +10,9 @@ Parser* parser_create(Lexer *lexer, DiagnosticEngine *diagnostics) {
     p->lexer = lexer;
     p->diagnostics = diagnostics;
     p->retired_tokens = create_vector(128, sizeof(Token));
+    p->structs = create_vector(8, sizeof(StructNode*));
+    p->type_params = NULL;
+    p->type_param_count = 0;
 
     parser_init_token_buffer(p);
     return p;
@@ -38,15 +41,35 @@ ProgramNode* parser_parse_program(Parser *parser) {
     Vector functions = create_vector(16, sizeof(FunctionNode*));
 
     while (parser_current_token(parser).type != TOK_EOF) {
-        if (parser_current_token(parser).type == TOK_CONST) {
+        // align(N) starts an aligned global as well, a struct has its keyword or another qualifier after it
+        const TokenType first = parser_current_token(parser).type;
+        if (first == TOK_PRAGMA) {
+            diag_warning(parser->diagnostics, parser_current_token(parser).location, "Ignoring '#pragma %s' outside a function",
+                        parser_current_token(parser).lexeme);
+            parser_advance(parser);
+            continue;
+        }
+
+        if (is_struct_qualifier(first) && (first != TOK_ALIGN || is_struct_qualifier(parser_peek_token(parser, 4).type))) {
+            parse_struct(parser);
+            continue;
+        }
+
+        if (first == TOK_CONST || first == TOK_SOA || first == TOK_ALIGN) {
             GlobalVarNode *global = parse_global_var(parser);
             vector_push(&global_vars, &global);
             continue;
         }
 
+        if (is_function_qualifier(parser_current_token(parser).type)) {
+            FunctionNode *fn = parse_function(parser);
+            vector_push(&functions, &fn);
+            continue;
+        }
+
         int lookahead_pos = 1;
 
-        if (parser_peek_token(parser, lookahead_pos).type == TOK_LSQUARE) {
+        while (parser_peek_token(parser, lookahead_pos).type == TOK_LSQUARE) {
             lookahead_pos++;
 
             while (parser_peek_token(parser, lookahead_pos).type != TOK_RSQUARE) {
@@ -63,7 +86,7 @@ ProgramNode* parser_parse_program(Parser *parser) {
         lookahead_pos++;
 
         const TokenType next = parser_peek_token(parser, lookahead_pos).type;
-        if (next == TOK_LPAREN) {
+        if (next == TOK_LPAREN || next == TOK_LESS) {
             // function decl
             FunctionNode *fn = parse_function(parser);
             vector_push(&functions, &fn);
@@ -92,6 +115,8 @@ ProgramNode* parser_parse_program(Parser *parser) {
     program->function_count = functions.length;
     program->globals = (GlobalVarNode**)global_vars.elements;
     program->global_count = global_vars.length;
+    program->structs = (StructNode**)parser->structs.elements;
+    program->struct_count = parser->structs.length;
 
     return program;
 }
@@ -153,12 +178,64 @@ TypeKind token_to_typekind(const Parser *p, const TokenType token) {
         case TOK_STRING_KW: return TYPE_STRING;
         case TOK_BOOL: return TYPE_BOOLEAN;
         case TOK_VOID: return TYPE_VOID;
+        case TOK_UINT: return TYPE_UINT;
+        case TOK_ULONG: return TYPE_ULONG;
+        case TOK_BYTE: return TYPE_BYTE;
+        case TOK_FLOAT4: return TYPE_FLOAT4;
+        case TOK_FLOAT8: return TYPE_FLOAT8;
+        case TOK_INT4: return TYPE_INT4;
+        case TOK_INT8: return TYPE_INT8;
+        case TOK_IDENTIFIER: {
+            // every caller passes the current token, so its lexeme names the struct or type parameter
+            for (int i = 0; i < p->type_param_count; i++) {
+                if (strcmp(p->type_params[i], parser_current_token(p).lexeme) == 0) {
+                    return TYPE_PARAM + i;
+                }
+            }
+
+            for (int i = 0; i < p->structs.length; i++) {
+                const StructNode *def = *(StructNode**)vector_get(&p->structs, i);
+                if (strcmp(def->name, parser_current_token(p).lexeme) == 0) {
+                    return TYPE_STRUCT + i;
+                }
+            }
+
+            diag_error(p->diagnostics, parser_current_token(p).location, "Unknown type '%s'", parser_current_token(p).lexeme);
+            return TYPE_INT;
+        }
         default:
             diag_error(p->diagnostics, parser_current_token(p).location, "Invalid type token: %s", token_type_to_string(token));
             return TYPE_INT;  // error recovery, default to int
     }
 }
 
+// the [W]... after a declaration's first [H], returns {H, W, ...} or nullptr when there is only the one
+int* parse_array_dims(Parser *p, const int outer, int *count_out) {
+    *count_out = 0;
+    if (parser_current_token(p).type != TOK_LSQUARE) return NULL;
+
+    Vector dims = create_vector(4, sizeof(int));
+    vector_push(&dims, &outer);
+
+    while (parser_current_token(p).type == TOK_LSQUARE) {
+        parser_advance(p);
+
+        int extent = 0;
+        if (parser_current_token(p).type == TOK_NUMBER) {
+            extent = atoi(parser_current_token(p).lexeme);
+            parser_advance(p);
+        } else {
+            diag_error(p->diagnostics, parser_current_token(p).location, "Expected array size, only the outer extent can be left out");
+        }
+
+        vector_push(&dims, &extent);
+        parser_expect(p, TOK_RSQUARE);
+    }
+
+    *count_out = dims.length;
+    return (int*)dims.elements;
+}
+
 bool is_type_token(const TokenType type) {
     switch (type) {
         case TOK_INT:
@@ -168,12 +245,39 @@ bool is_type_token(const TokenType type) {
         case TOK_DOUBLE:
         case TOK_STRING_KW:
         case TOK_BOOL:
-        case TOK_VOID: return true;
+        case TOK_VOID:
+        case TOK_UINT:
+        case TOK_ULONG:
+        case TOK_BYTE:
+        case TOK_FLOAT4:
+        case TOK_FLOAT8:
+        case TOK_INT4:
+        case TOK_INT8: return true;
         default: return false;
     }
 }
 
+// a struct, or a type parameter of the generic function being parsed
+bool is_type_name(const Parser *p, const Token token) {
+    if (token.type != TOK_IDENTIFIER) return false;
+
+    for (int i = 0; i < p->type_param_count; i++) {
+        if (strcmp(p->type_params[i], token.lexeme) == 0) {
+            return true;
+        }
+    }
+
+    for (int i = 0; i < p->structs.length; i++) {
+        const StructNode *def = *(StructNode**)vector_get(&p->structs, i);
+        if (strcmp(def->name, token.lexeme) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool is_next_token_a_type(const Parser *p) {
     const Token next = parser_peek_token(p, 1);
-    return is_type_token(next.type);
+    return is_type_token(next.type) || is_type_name(p, next);
 }
@@ -13,6 +13,9 @@ struct Parser {
     DiagnosticEngine *diagnostics;
     Token token_buffer[TOKEN_BUFFER_SIZE];
     Vector retired_tokens;
+    Vector structs;  // StructNode*, handed to the ProgramNode once parsing is done
+    char **type_params;    // of the generic function being parsed, they name TYPE_PARAM + their index
+    int type_param_count;
 };
 
 void parser_init_token_buffer(Parser *p);
@@ -26,7 +29,9 @@ void parser_expect(Parser *p, TokenType type);
 TypeKind token_to_typekind(const Parser *p, TokenType token);
 
 bool is_type_token(TokenType type);
+bool is_type_name(const Parser *p, Token token);
 bool is_next_token_a_type(const Parser *p);
+int* parse_array_dims(Parser *p, int outer, int *count_out);
 
 // forward decl, implemented in different files but shared internally
 
@@ -35,28 +40,41 @@ ExprNode* parse_expression(Parser *p);
 ExprNode* parse_assignment(Parser *p);
 ExprNode* parse_logical_or(Parser *p);
 ExprNode* parse_logical_and(Parser *p);
+ExprNode* parse_bit_or(Parser *p);
+ExprNode* parse_bit_xor(Parser *p);
+ExprNode* parse_bit_and(Parser *p);
 ExprNode* parse_equality(Parser *p);
 ExprNode* parse_relational(Parser *p);
+ExprNode* parse_shift(Parser *p);
 ExprNode* parse_additive(Parser *p);
 ExprNode* parse_term(Parser *p);
 ExprNode* parse_unary(Parser *p);
 ExprNode* parse_cast(Parser *p);
 ExprNode* parse_postfix(Parser *p);
+ExprNode* parse_initializer(Parser *p);
 
 // from parse_stmt.c
 StmtNode* parse_statement(Parser *p);
 StmtNode* parse_return_stmt(Parser *p);
+StmtNode* parse_become_stmt(Parser *p);
 StmtNode* parse_if_stmt(Parser *p);
 StmtNode* parse_while_stmt(Parser *p);
 StmtNode* parse_for_stmt(Parser *p);
+StmtNode* parse_switch_stmt(Parser *p);
 StmtNode* parse_break_stmt(Parser *p);
 StmtNode* parse_continue_stmt(Parser *p);
 StmtNode* parse_asm_stmt(Parser *p);
 StmtNode* parse_var_decl(Parser *p);
+StmtNode* parse_range_for(Parser *p, SourceLocation loc, bool is_parallel, bool is_ref);
+StmtNode* parse_pragma_stmt(Parser *p);
 StmtNode* parse_expr_stmt(Parser *p);
 StmtNode* parse_compound_stmt(Parser *p);
 
 // from parse_decl.c
+bool is_function_qualifier(TokenType type);
+bool is_struct_qualifier(TokenType type);
+int parse_alignment(Parser *p);
+StructNode* parse_struct(Parser *p);
 FunctionNode* parse_function(Parser *p);
 GlobalVarNode* parse_global_var(Parser *p);
 void parse_parameter_list(Parser *p, ParamNode **params_out, int *count_out);
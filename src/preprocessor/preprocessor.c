@@ -132,17 +132,24 @@ static char* process_line(Preprocessor *prep, const char *line) {
     while (isspace(*line)) line++;
 
     if (*line == '#') {
+        const char *directive = line;
         line++; // skip the '#'
         while (isspace(*line)) line++;
 
+        // pragmas are for the parser, passed through as they are without expanding macros
+        if (strncmp(line, "pragma", 6) == 0) {
+            return strdup(directive);
+        }
+
+        // directives are replaced by empty lines so the lexer's line numbers stay in sync with the source
         if (strncmp(line, "define", 6) == 0) {
             parse_define_directive(prep, line + 6);
-            return NULL;
+            return strdup("");
         }
 
         if (strncmp(line, "undef", 5) == 0) {
             // TODO: Parse undef
-            return NULL;
+            return strdup("");
         }
 
         if (strncmp(line, "include", 7) == 0) {
@@ -202,9 +209,25 @@ static char* process_include(Preprocessor *prep, const char *filename, const boo
     content[size] = '\0';
     fclose(f);
 
-    char *preprocessed = preprocessor_process(prep, content);
+    char *body = preprocessor_process(prep, content);
     free(content);
 
+    // wrap the included text in line markers so locations point back into the right file
+    StringBuilder *sb = sb_create(strlen(body) + 64);
+    sb_append(sb, "#line 1 \"");
+    sb_append(sb, filepath);
+    sb_append(sb, "\"\n");
+    sb_append(sb, body);
+
+    char marker[64];
+    snprintf(marker, sizeof(marker), "\n#line %d \"", saved_line + 1);
+    sb_append(sb, marker);
+    sb_append(sb, saved_filename);
+    sb_append(sb, "\"");
+
+    char *preprocessed = sb_to_string(sb);
+    free(body);
+
     free((char*)prep->current_dir);
     prep->filename = saved_filename;
     prep->current_dir = saved_dir;
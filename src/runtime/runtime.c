@@ -4,38 +4,106 @@
 
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+
+// a string points at its characters, which are null terminated so it is still a char* for C.
+// the header in front of them keeps the reference count and the length. literals live in the binary
+// with a count of -1 and a capacity of 0
+typedef struct {
+    long long refs;
+    long long length;
+    long long capacity;
+} StringHeader;
+
+static StringHeader* string_header(const char *s) {
+    return (StringHeader*)s - 1;
+}
+
+static size_t string_length(const char *s) {
+    return s ? (size_t)string_header(s)->length : 0;
+}
+
+// room for capacity characters and the terminator, the caller fills in the characters and the length
+static char* string_alloc(const size_t capacity) {
+    StringHeader *header = malloc(sizeof(StringHeader) + capacity + 1);
+    if (!header) return NULL;
+
+    header->refs = 1;
+    header->length = 0;
+    header->capacity = (long long)capacity;
+    return (char*)(header + 1);
+}
+
+static char* string_from(const char *chars, const size_t length) {
+    char *out = string_alloc(length);
+    if (!out) return NULL;
+
+    memcpy(out, chars, length);
+    out[length] = '\0';
+    string_header(out)->length = (long long)length;
+    return out;
+}
+
+// the compiler retains a string for every variable holding it and releases it when the variable lets go.
+// strings can be shared between threads, so the count is atomic
+void __cplus_string_retain_(char *s) {
+    if (!s || string_header(s)->refs < 0) return;
+    __atomic_fetch_add(&string_header(s)->refs, 1, __ATOMIC_RELAXED);
+}
+
+void __cplus_string_release_(char *s) {
+    if (!s || string_header(s)->refs < 0) return;
+    if (__atomic_sub_fetch(&string_header(s)->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(string_header(s));
+    }
+}
+
+// a char* from C becomes a string by copying it behind a header
+char* __cplus_string_from_(const char *s) {
+    if (!s) return NULL;
+    return string_from(s, strlen(s));
+}
 
 // input and conversion
 char* __cplus_input_() {
     size_t size = 128;
     size_t len = 0;
-    char *buf = malloc(size);
+    char *buf = string_alloc(size);
     if (!buf) return NULL;
 
+    // one lock for the whole line, so lines read by different threads dont interleave
+    flockfile(stdin);
+
     int c;
-    while ((c = getchar()) != EOF && c != '\n') {
-        if (len + 1 >= size) {
+    while ((c = getc_unlocked(stdin)) != EOF && c != '\n') {
+        if (len >= size) {
             size *= 2;
-            char *tmp = realloc(buf, size);
+            StringHeader *tmp = realloc(string_header(buf), sizeof(StringHeader) + size + 1);
             if (!tmp) {
-                free(buf);
+                funlockfile(stdin);
+                free(string_header(buf));
                 return NULL;
             }
-            buf = tmp;
+            tmp->capacity = (long long)size;
+            buf = (char*)(tmp + 1);
         }
         buf[len++] = (char)c;
     }
 
+    funlockfile(stdin);
+
     if (c == EOF && len == 0) {
-        free(buf);
+        free(string_header(buf));
         return NULL;
     }
 
     buf[len] = '\0';
+    string_header(buf)->length = (long long)len;
     return buf;
 }
 
@@ -68,65 +136,110 @@ float __cplus_to_float_(char* s) {
 }
 
 char* __cplus_int_to_string_(const int i) {
-    char *buf = malloc(32);
-    if (!buf) return NULL;
-    snprintf(buf, 32, "%d", i);
-    return buf;
+    char digits[32];
+    const int len = snprintf(digits, sizeof(digits), "%d", i);
+    return string_from(digits, len);
 }
 
 char* __cplus_float_to_string_(const float f) {
     const int len = snprintf(NULL, 0, "%f", f);
     if (len < 0) return NULL;
 
-    char *buf = malloc(len + 1);
+    char *buf = string_alloc(len);
     if (!buf) return NULL;
 
     snprintf(buf, len + 1, "%f", f);
+    string_header(buf)->length = len;
     return buf;
 }
 
-// string manipulation
+// string manipulation, lengths come from the header so none of these walk the string to find its end
 void __cplus_print_(char* msg) {
-    printf("%s", msg);
+    if (!msg) {
+        printf("(null)");
+        return;
+    }
+
+    fwrite(msg, 1, string_length(msg), stdout);
 }
 
 char* __cplus_str_concat(const char *s1, const char *s2) {
-    const size_t len1 = strlen(s1);
-    const size_t len2 = strlen(s2);
+    const size_t len1 = string_length(s1);
+    const size_t len2 = string_length(s2);
 
-    char *out = malloc(len1 + len2 + 1);
+    char *out = string_alloc(len1 + len2);
     if (!out) return NULL;
 
     memcpy(out, s1, len1);
-    memcpy(out + len1, s2, len2 + 1);
+    memcpy(out + len1, s2, len2);
+    out[len1 + len2] = '\0';
+    string_header(out)->length = (long long)(len1 + len2);
+    return out;
+}
+
+// s + piece for code that gives up its reference to s. a string nobody else holds is appended to in place and
+// its capacity doubles when it runs out, so appending in a loop is amortized linear. one that is shared or
+// lives in the binary is copied first, with room to grow
+char* __cplus_string_append_(char *s, const char *piece) {
+    const size_t len = string_length(s);
+    const size_t piece_len = string_length(piece);
+    const size_t total = len + piece_len;
+
+    if (s && string_header(s)->refs == 1) {
+        StringHeader *header = string_header(s);
+
+        if ((size_t)header->capacity < total) {
+            const bool self = piece == s;
+            size_t capacity = (size_t)header->capacity * 2;
+            if (capacity < total) capacity = total;
+
+            header = realloc(header, sizeof(StringHeader) + capacity + 1);
+            if (!header) return NULL;
+
+            header->capacity = (long long)capacity;
+            s = (char*)(header + 1);
+            if (self) piece = s;
+        }
+
+        if (piece_len > 0) memcpy(s + len, piece, piece_len);
+        s[total] = '\0';
+        header->length = (long long)total;
+        return s;
+    }
+
+    char *out = string_alloc(total * 2);
+    if (!out) return NULL;
+
+    if (len > 0) memcpy(out, s, len);
+    if (piece_len > 0) memcpy(out + len, piece, piece_len);
+    out[total] = '\0';
+    string_header(out)->length = (long long)total;
+
+    __cplus_string_release_(s);
     return out;
 }
 
+// strings of different lengths are never equal, so only equal lengths get their bytes compared
 bool __cplus_strcmp_(const char *s1, const char *s2) {
-    return strcmp(s1, s2) == 0;
+    const size_t len1 = string_length(s1);
+    if (len1 != string_length(s2)) return false;
+    if (s1 == s2 || len1 == 0) return true;
+    return memcmp(s1, s2, len1) == 0;
 }
 
 char* __cplus_substr_(const char *s1, const int start, int len) {
-    size_t slen = strlen(s1);
-    if (start >= slen) return strdup("");
+    const size_t slen = string_length(s1);
+    if (start < 0 || len < 0 || (size_t)start >= slen) return string_from("", 0);
 
-    if (start + len > slen) {
-        len = slen - start;
+    if ((size_t)start + len > slen) {
+        len = (int)(slen - start);
     }
 
-    char *out = malloc(len + 1);
-    memcpy(out, s1 + start, len);
-    out[len] = '\0';
-    return out;
+    return string_from(s1 + start, len);
 }
 
 char __cplus_char_at_(const char *s1, const int index) {
-    if (index < 0) {
-        fprintf(stderr, "char_at: index out of bounds: %d\n", index);
-        abort();
-    }
-
-    if (index >= strlen(s1)) {
+    if (index < 0 || (size_t)index >= string_length(s1)) {
         fprintf(stderr, "char_at: index out of bounds: %d\n", index);
         abort();
     }
@@ -147,13 +260,24 @@ void* __cplus_realloc_(void* ptr, const int size) {
     return realloc(ptr, size);
 }
 
-// math and randomness
+// posix_memalign rather than aligned_alloc, which the stdlib.hp wrapper of the same name would replace.
+// the block is freed like any other
+void* __cplus_aligned_alloc_(const int alignment, const int size) {
+    void *ptr = NULL;
+    const size_t min_alignment = alignment < (int)sizeof(void*) ? sizeof(void*) : (size_t)alignment;
+    if (posix_memalign(&ptr, min_alignment, size) != 0) return NULL;
+    return ptr;
+}
+
+// math and randomness. every thread has its own generator, seeded like rand() until seed is called
+static _Thread_local unsigned int random_state = 1;
+
 int __cplus_random_() {
-    return rand();
+    return rand_r(&random_state);
 }
 
 void __cplus_seed_(const int s) {
-    srand(s);
+    random_state = (unsigned int)s;
 }
 
 float __cplus_sqrt_(const float f) {
@@ -173,7 +297,292 @@ int __cplus_system_(const char* cmd) {
     return system(cmd);
 }
 
+// threads and mutexes, handed to the program as opaque longs
+long __cplus_spawn_(void *(*entry)(void *), void *arg) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, entry, arg) != 0) {
+        fprintf(stderr, "spawn: cannot create thread\n");
+        abort();
+    }
+
+    return (long)thread;
+}
+
+void __cplus_join_(const long thread) {
+    pthread_join((pthread_t)thread, NULL);
+}
+
+long __cplus_mutex_new_() {
+    pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+    if (!mutex) return 0;
+
+    pthread_mutex_init(mutex, NULL);
+    return (long)mutex;
+}
+
+void __cplus_mutex_lock_(const long mutex) {
+    pthread_mutex_lock((pthread_mutex_t*)mutex);
+}
+
+void __cplus_mutex_unlock_(const long mutex) {
+    pthread_mutex_unlock((pthread_mutex_t*)mutex);
+}
+
+void __cplus_mutex_free_(const long mutex) {
+    pthread_mutex_destroy((pthread_mutex_t*)mutex);
+    free((pthread_mutex_t*)mutex);
+}
+
+// parallel for. a pool with a worker per extra core, where every thread (the caller included) owns a slice
+// of the iteration range. owners take chunks from the front of their slice, and a thread that runs out steals
+// the back half of the largest slice left, so iterations of uneven cost still keep every core busy
+typedef void (*ParallelBody)(void *captures, long begin, long end);
+
+typedef struct ParallelSlice {
+    pthread_mutex_t lock;
+    long begin;
+    long end;
+} ParallelSlice;
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t job_lock;   // one parallel for at a time, others run inline
+    pthread_mutex_t lock;       // guards the job fields below
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+    int worker_count;
+    ParallelSlice *slices;      // worker_count + 1, the calling thread uses the last one
+    ParallelBody body;
+    void *captures;
+    long grain;
+    unsigned long generation;
+    int active;
+} pool = {
+    .once = PTHREAD_ONCE_INIT,
+    .job_lock = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .job_ready = PTHREAD_COND_INITIALIZER,
+    .job_done = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_mutex_t reduce_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local bool in_parallel = false;
+
+static bool parallel_take(ParallelSlice *slice, long *begin, long *end) {
+    pthread_mutex_lock(&slice->lock);
+    const bool found = slice->begin < slice->end;
+    if (found) {
+        *begin = slice->begin;
+        *end = slice->end - slice->begin > pool.grain ? slice->begin + pool.grain : slice->end;
+        slice->begin = *end;
+    }
+    pthread_mutex_unlock(&slice->lock);
+    return found;
+}
+
+static bool parallel_steal(const int self) {
+    const int count = pool.worker_count + 1;
+
+    for (;;) {
+        // the size check is racy, it is only a guess that is confirmed under the victim's lock
+        int victim = -1;
+        long most = 0;
+        for (int i = 0; i < count; i++) {
+            const long left = pool.slices[i].end - pool.slices[i].begin;
+            if (i != self && left > most) {
+                victim = i;
+                most = left;
+            }
+        }
+
+        if (victim < 0) return false;
+
+        ParallelSlice *slice = &pool.slices[victim];
+        pthread_mutex_lock(&slice->lock);
+        const long left = slice->end - slice->begin;
+        if (left <= 0) {
+            pthread_mutex_unlock(&slice->lock);
+            continue;
+        }
+
+        const long split = slice->end - (left + 1) / 2;
+        const long stolen_end = slice->end;
+        slice->end = split;
+        pthread_mutex_unlock(&slice->lock);
+
+        ParallelSlice *own = &pool.slices[self];
+        pthread_mutex_lock(&own->lock);
+        own->begin = split;
+        own->end = stolen_end;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+}
+
+static void parallel_run(const int self) {
+    long begin, end;
+    do {
+        while (parallel_take(&pool.slices[self], &begin, &end)) {
+            pool.body(pool.captures, begin, end);
+        }
+    } while (parallel_steal(self));
+}
+
+static void *parallel_worker(void *arg) {
+    const int self = (int)(long)arg;
+    unsigned long seen = 0;
+    in_parallel = true;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen) {
+            pthread_cond_wait(&pool.job_ready, &pool.lock);
+        }
+        seen = pool.generation;
+        pthread_mutex_unlock(&pool.lock);
+
+        parallel_run(self);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.active == 0) {
+            pthread_cond_signal(&pool.job_done);
+        }
+    }
+
+    return NULL;
+}
+
+// CPLUS_THREADS overrides the number of threads, which defaults to one per online core
+static void parallel_init() {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *env = getenv("CPLUS_THREADS");
+    if (env) threads = strtol(env, NULL, 10);
+    if (threads < 1) threads = 1;
+
+    pool.slices = calloc(threads, sizeof(ParallelSlice));
+    for (long i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool.slices[i].lock, NULL);
+    }
+
+    for (long i = 0; i < threads - 1; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, parallel_worker, (void*)i) != 0) break;
+        pthread_detach(thread);
+        pool.worker_count++;
+    }
+}
+
+void __cplus_parallel_for_(const ParallelBody body, void *captures, const long begin, const long end) {
+    if (begin >= end) return;
+
+    // nested parallel loops, and ones started while another thread has the pool, run on the calling thread
+    if (in_parallel || pthread_mutex_trylock(&pool.job_lock) != 0) {
+        body(captures, begin, end);
+        return;
+    }
+
+    pthread_once(&pool.once, parallel_init);
+
+    const int count = pool.worker_count + 1;
+    const long total = end - begin;
+    const long share = total / count;
+    const long extra = total % count;
+
+    // a few chunks per thread, so there is something left to steal when the split was uneven
+    long grain = total / (count * 8L);
+    if (grain < 1) grain = 1;
+
+    long next = begin;
+    for (int i = 0; i < count; i++) {
+        pool.slices[i].begin = next;
+        next += share + (i < extra ? 1 : 0);
+        pool.slices[i].end = next;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.body = body;
+    pool.captures = captures;
+    pool.grain = grain;
+    pool.active = pool.worker_count;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.job_ready);
+    pthread_mutex_unlock(&pool.lock);
+
+    in_parallel = true;
+    parallel_run(count - 1);
+    in_parallel = false;
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active > 0) {
+        pthread_cond_wait(&pool.job_done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    pthread_mutex_unlock(&pool.job_lock);
+}
+
+void __cplus_parallel_lock_() {
+    pthread_mutex_lock(&reduce_lock);
+}
+
+void __cplus_parallel_unlock_() {
+    pthread_mutex_unlock(&reduce_lock);
+}
+
+// profiling, used by programs built with -fprofile-generate
+typedef struct ProfileCounters {
+    const char *name;
+    long long *counters;
+    int count;
+    struct ProfileCounters *next;
+} ProfileCounters;
+
+static ProfileCounters *profile_counters = NULL;
+
+// appends one "<name> <count> <counters...>" line per function, so profiles from several runs add up
+static void __cplus_prof_dump() {
+    const char *path = getenv("CPLUS_PROFILE_FILE");
+    if (!path) path = "default.cpprof";
+
+    FILE *f = fopen(path, "a");
+    if (!f) {
+        fprintf(stderr, "profile: cannot open '%s'\n", path);
+        return;
+    }
+
+    for (const ProfileCounters *p = profile_counters; p; p = p->next) {
+        fprintf(f, "%s %d", p->name, p->count);
+        for (int i = 0; i < p->count; i++) {
+            fprintf(f, " %lld", p->counters[i]);
+        }
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+}
+
+void __cplus_prof_register_(const char *name, long long *counters, const int count) {
+    if (!profile_counters) {
+        atexit(__cplus_prof_dump);
+    }
+
+    ProfileCounters *p = malloc(sizeof(ProfileCounters));
+    if (!p) return;
+
+    p->name = name;
+    p->counters = counters;
+    p->count = count;
+    p->next = profile_counters;
+    profile_counters = p;
+}
+
 void __cplus_panic_(char* cmd) {
     fprintf(stderr, "panic: %s\n", cmd);
     abort();
+}
+
+// a slice index or bound that failed -fbounds-check
+void __cplus_bounds_fail_(const long index, const long length) {
+    fprintf(stderr, "index out of bounds: %ld, length %ld\n", index, length);
+    abort();
 }
\ No newline at end of file
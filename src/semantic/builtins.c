@@ -4,12 +4,54 @@
 #include <stdlib.h>
 #include <string.h>
 
+static const struct {
+    const char *name;
+    IntrinsicKind kind;
+} intrinsics[] = {
+    {"shuffle", INTRINSIC_SHUFFLE},
+    {"select", INTRINSIC_SELECT},
+    {"hsum", INTRINSIC_HSUM},
+    {"hmin", INTRINSIC_HMIN},
+    {"hmax", INTRINSIC_HMAX},
+    {"vload", INTRINSIC_VLOAD},
+    {"vload_aligned", INTRINSIC_VLOAD_ALIGNED},
+    {"vstore", INTRINSIC_VSTORE},
+    {"vstore_aligned", INTRINSIC_VSTORE_ALIGNED},
+    {"likely", INTRINSIC_LIKELY},
+    {"unlikely", INTRINSIC_UNLIKELY},
+    {"popcount", INTRINSIC_POPCOUNT},
+    {"clz", INTRINSIC_CLZ},
+    {"ctz", INTRINSIC_CTZ},
+    {"bswap", INTRINSIC_BSWAP},
+    {"rotl", INTRINSIC_ROTL},
+    {"rotr", INTRINSIC_ROTR},
+    {"add_overflow", INTRINSIC_ADD_OVERFLOW},
+    {"sub_overflow", INTRINSIC_SUB_OVERFLOW},
+    {"mul_overflow", INTRINSIC_MUL_OVERFLOW},
+    {"spawn", INTRINSIC_SPAWN},
+    {"atomic_load", INTRINSIC_ATOMIC_LOAD},
+    {"atomic_store", INTRINSIC_ATOMIC_STORE},
+    {"atomic_add", INTRINSIC_ATOMIC_ADD},
+    {"atomic_sub", INTRINSIC_ATOMIC_SUB},
+    {"atomic_exchange", INTRINSIC_ATOMIC_EXCHANGE},
+    {"cas", INTRINSIC_CAS},
+    {"fence", INTRINSIC_FENCE},
+    {NULL, INTRINSIC_NONE}
+};
+
 static void add_builtin(Scope *scope, const char *name, TypeKind ret_type, int ret_ptr, int param_count, ...) {
     Symbol *sym = malloc(sizeof(Symbol));
     sym->name = strdup(name);
     sym->kind = SYM_FUNCTION;
     sym->type = ret_type;
     sym->pointer_level = ret_ptr;
+    sym->is_soa = false;
+    sym->is_restrict = false;
+    sym->is_slice = false;
+    sym->array_size = 0;
+    sym->dims = NULL;
+    sym->dim_count = 0;
+    sym->generic = NULL;
     sym->parameters = create_vector(param_count, sizeof(Symbol*));
 
     va_list args;
@@ -25,6 +67,13 @@ static void add_builtin(Scope *scope, const char *name, TypeKind ret_type, int r
         param->type = p_type;
         param->pointer_level = p_ptr;
         param->is_const = 1;
+        param->is_soa = false;
+        param->is_restrict = false;
+        param->is_slice = false;
+        param->array_size = 0;
+        param->dims = NULL;
+        param->dim_count = 0;
+        param->generic = NULL;
 
         vector_push(&sym->parameters, &param);
     }
@@ -50,6 +99,7 @@ void register_builtins(Scope *global_scope) {
     add_builtin(global_scope, "__cplus_memcpy_", TYPE_VOID, 0, 3, TYPE_VOID, 1, TYPE_VOID, 1, TYPE_INT, 0);
     add_builtin(global_scope, "__cplus_memset_", TYPE_VOID, 0, 3, TYPE_VOID, 1, TYPE_INT, 0, TYPE_INT, 0);
     add_builtin(global_scope, "__cplus_realloc_", TYPE_VOID, 1, 2, TYPE_VOID, 1, TYPE_INT, 0);
+    add_builtin(global_scope, "__cplus_aligned_alloc_", TYPE_VOID, 1, 2, TYPE_INT, 0, TYPE_INT, 0);
 
     add_builtin(global_scope, "__cplus_random_", TYPE_INT, 0, 0);
     add_builtin(global_scope, "__cplus_seed_", TYPE_VOID, 0, 1, TYPE_INT, 0);
@@ -59,4 +109,23 @@ void register_builtins(Scope *global_scope) {
     add_builtin(global_scope, "__cplus_time_", TYPE_INT, 0, 0);
     add_builtin(global_scope, "__cplus_system_", TYPE_INT, 0, 1, TYPE_STRING, 0);
     add_builtin(global_scope, "__cplus_panic_", TYPE_VOID, 0, 1, TYPE_STRING, 0);
+
+    // thread and mutex handles are opaque longs
+    add_builtin(global_scope, "__cplus_join_", TYPE_VOID, 0, 1, TYPE_LONG, 0);
+    add_builtin(global_scope, "__cplus_mutex_new_", TYPE_LONG, 0, 0);
+    add_builtin(global_scope, "__cplus_mutex_lock_", TYPE_VOID, 0, 1, TYPE_LONG, 0);
+    add_builtin(global_scope, "__cplus_mutex_unlock_", TYPE_VOID, 0, 1, TYPE_LONG, 0);
+    add_builtin(global_scope, "__cplus_mutex_free_", TYPE_VOID, 0, 1, TYPE_LONG, 0);
 }
+
+
+// user functions win, so this is only consulted when the name isnt declared
+IntrinsicKind lookup_intrinsic(const char *name) {
+    for (int i = 0; intrinsics[i].name != NULL; i++) {
+        if (strcmp(intrinsics[i].name, name) == 0) {
+            return intrinsics[i].kind;
+        }
+    }
+
+    return INTRINSIC_NONE;
+}
\ No newline at end of file
@@ -6,5 +6,6 @@
 
 void register_builtins(Scope *global_scope);
 Symbol* create_print_func();
+IntrinsicKind lookup_intrinsic(const char *name);
 
 #endif //C__BUILTINS_H
\ No newline at end of file
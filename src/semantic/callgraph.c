@@ -0,0 +1,166 @@
+#include "callgraph.h"
+
+#include "../util/map.h"
+#include "../util/vector.h"
+
+#include <string.h>
+
+typedef struct CallGraph {
+    ProgramNode *program;
+    Map function_indices;  // function name -> index into program->functions
+    Vector worklist;       // indices of functions whose bodies still need walking
+} CallGraph;
+
+static void visit_stmt(CallGraph *graph, const StmtNode *stmt);
+
+static void mark_function(CallGraph *graph, const char *name) {
+    const int index = map_get(&graph->function_indices, name);
+    if (index == -1) return;  // builtin or runtime function
+
+    FunctionNode *func = graph->program->functions[index];
+    if (func->is_reachable) return;
+
+    func->is_reachable = true;
+    vector_push(&graph->worklist, &index);
+}
+
+static void visit_expr(CallGraph *graph, const ExprNode *expr) {
+    if (!expr) return;
+
+    switch (expr->kind) {
+        case EXPR_NUMBER:
+        case EXPR_STRING_LITERAL:
+            break;
+        case EXPR_VAR:
+            // a function named without being called still has to be kept around
+            mark_function(graph, expr->text);
+            break;
+        case EXPR_BINOP:
+            visit_expr(graph, expr->binop.left);
+            visit_expr(graph, expr->binop.right);
+            break;
+        case EXPR_UNARY:
+            visit_expr(graph, expr->unary.operand);
+            break;
+        case EXPR_CALL:
+            mark_function(graph, expr->call.function_name);
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                visit_expr(graph, expr->call.args[i]);
+            }
+            break;
+        case EXPR_ARRAY_INDEX:
+            visit_expr(graph, expr->array_index.array);
+            visit_expr(graph, expr->array_index.index);
+            break;
+        case EXPR_CAST:
+            visit_expr(graph, expr->cast.operand);
+            break;
+        case EXPR_MEMBER:
+            visit_expr(graph, expr->member.object);
+            break;
+        case EXPR_SLICE:
+            visit_expr(graph, expr->slice.object);
+            visit_expr(graph, expr->slice.start);
+            visit_expr(graph, expr->slice.end);
+            break;
+        case EXPR_INIT_LIST:
+            for (int i = 0; i < expr->init_list.count; i++) {
+                visit_expr(graph, expr->init_list.elements[i]);
+            }
+            break;
+    }
+}
+
+static void visit_stmt(CallGraph *graph, const StmtNode *stmt) {
+    if (!stmt) return;
+
+    switch (stmt->kind) {
+        case STMT_RETURN:
+            visit_expr(graph, stmt->return_stmt.expr);
+            break;
+        case STMT_IF:
+            visit_expr(graph, stmt->if_stmt.condition);
+            visit_stmt(graph, stmt->if_stmt.then_stmt);
+            visit_stmt(graph, stmt->if_stmt.else_stmt);
+            break;
+        case STMT_WHILE:
+            visit_expr(graph, stmt->while_stmt.condition);
+            visit_stmt(graph, stmt->while_stmt.body);
+            break;
+        case STMT_FOR:
+            visit_stmt(graph, stmt->for_stmt.init);
+            visit_expr(graph, stmt->for_stmt.condition);
+            visit_expr(graph, stmt->for_stmt.increment);
+            visit_expr(graph, stmt->for_stmt.range);
+            visit_stmt(graph, stmt->for_stmt.body);
+            break;
+        case STMT_SWITCH:
+            visit_expr(graph, stmt->switch_stmt.value);
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    visit_stmt(graph, stmt->switch_stmt.cases[i].stmts[j]);
+                }
+            }
+            break;
+        case STMT_VAR_DECL:
+            visit_expr(graph, stmt->var_decl.initializer);
+            break;
+        case STMT_EXPR:
+            visit_expr(graph, stmt->expr_stmt.expr);
+            break;
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                visit_stmt(graph, stmt->compound.stmts[i]);
+            }
+            break;
+        case STMT_ASM:
+            for (size_t i = 0; i < stmt->asm_stmt.output_count; i++) {
+                visit_expr(graph, stmt->asm_stmt.outputs[i]);
+            }
+            for (size_t i = 0; i < stmt->asm_stmt.input_count; i++) {
+                visit_expr(graph, stmt->asm_stmt.inputs[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+void callgraph_mark_reachable(ProgramNode *program) {
+    CallGraph graph = {
+        .program = program,
+        .function_indices = create_map(program->function_count * 2 + 1),
+        .worklist = create_vector(16, sizeof(int)),
+    };
+
+    bool has_main = false;
+    for (int i = 0; i < program->function_count; i++) {
+        FunctionNode *func = program->functions[i];
+        func->is_reachable = false;
+        map_add(&graph.function_indices, func->name, i);
+
+        if (strcmp(func->name, "main") == 0) {
+            has_main = true;
+        }
+    }
+
+    for (int i = 0; i < program->function_count; i++) {
+        const FunctionNode *func = program->functions[i];
+        if (func->type_param_count > 0) continue;  // only its instances are emitted
+
+        if (!has_main || func->is_exported || strcmp(func->name, "main") == 0) {
+            mark_function(&graph, func->name);
+        }
+    }
+
+    while (graph.worklist.length > 0) {
+        const int index = *(int*)vector_get(&graph.worklist, graph.worklist.length - 1);
+        vector_pop(&graph.worklist);
+
+        visit_stmt(&graph, program->functions[index]->body);
+    }
+
+    vector_destroy(&graph.worklist);
+    map_destroy(&graph.function_indices);
+}
\ No newline at end of file
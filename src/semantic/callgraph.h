@@ -0,0 +1,10 @@
+#ifndef C__SEMANTIC_CALLGRAPH_H
+#define C__SEMANTIC_CALLGRAPH_H
+
+#include "../ast/ast.h"
+
+// walks the call graph from main and any exported functions and sets is_reachable on every function
+// that can be called from them. a program without main is treated as a library so everything is kept
+void callgraph_mark_reachable(ProgramNode *program);
+
+#endif //C__SEMANTIC_CALLGRAPH_H
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "generics.h"
+#include "typecheck.h"
+
+#include "../util/string_builder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static StmtNode* clone_stmt(const StmtNode *stmt, const TypeArg *args);
+
+bool is_type_param(const TypeKind type) {
+    return type >= TYPE_PARAM && type < TYPE_PARAM + MAX_TYPE_PARAMS;
+}
+
+// T* with T = int* becomes int**
+static void substitute(const TypeArg *args, TypeKind *type, int *pointer_level) {
+    if (!is_type_param(*type)) return;
+
+    const TypeArg *arg = &args[*type - TYPE_PARAM];
+    *type = arg->type;
+    *pointer_level += arg->pointer_level;
+}
+
+char* generic_instance_name(const char *name, const TypeArg *args, const int count) {
+    StringBuilder *sb = sb_create(strlen(name) + 16);
+    sb_append(sb, name);
+    sb_append_char(sb, '<');
+
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            sb_append(sb, ", ");
+        }
+
+        sb_append(sb, type_to_string(args[i].type));
+        for (int j = 0; j < args[i].pointer_level; j++) {
+            sb_append_char(sb, '*');
+        }
+    }
+
+    sb_append_char(sb, '>');
+
+    char *result = sb_to_string(sb);
+    sb_destroy(sb);
+    return result;
+}
+
+static ExprNode* clone_expr(const ExprNode *expr, const TypeArg *args) {
+    if (!expr) return NULL;
+
+    // names and literal text are never written to after parsing, so the copy shares them
+    ExprNode *copy = malloc(sizeof(ExprNode));
+    *copy = *expr;
+
+    switch (expr->kind) {
+        case EXPR_NUMBER:
+        case EXPR_STRING_LITERAL:
+        case EXPR_VAR:
+            break;
+        case EXPR_BINOP:
+            copy->binop.left = clone_expr(expr->binop.left, args);
+            copy->binop.right = clone_expr(expr->binop.right, args);
+            break;
+        case EXPR_UNARY:
+            copy->unary.operand = clone_expr(expr->unary.operand, args);
+            break;
+        case EXPR_CALL: {
+            // semantic renames calls to generic functions after their instantiation
+            copy->call.function_name = strdup(expr->call.function_name);
+
+            copy->call.args = malloc(sizeof(ExprNode*) * (expr->call.arg_count + 1));
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                copy->call.args[i] = clone_expr(expr->call.args[i], args);
+            }
+
+            copy->call.type_args = malloc(sizeof(TypeArg) * (expr->call.type_arg_count + 1));
+            for (int i = 0; i < expr->call.type_arg_count; i++) {
+                copy->call.type_args[i] = expr->call.type_args[i];
+                substitute(args, &copy->call.type_args[i].type, &copy->call.type_args[i].pointer_level);
+            }
+            break;
+        }
+        case EXPR_ARRAY_INDEX:
+            copy->array_index.array = clone_expr(expr->array_index.array, args);
+            copy->array_index.index = clone_expr(expr->array_index.index, args);
+            break;
+        case EXPR_CAST:
+            substitute(args, &copy->type, &copy->pointer_level);
+            substitute(args, &copy->cast.target_type, &copy->cast.target_pointer_level);
+            copy->cast.operand = clone_expr(expr->cast.operand, args);
+            break;
+        case EXPR_INIT_LIST:
+            copy->init_list.elements = malloc(sizeof(ExprNode*) * (expr->init_list.count + 1));
+            for (int i = 0; i < expr->init_list.count; i++) {
+                copy->init_list.elements[i] = clone_expr(expr->init_list.elements[i], args);
+            }
+            break;
+        case EXPR_MEMBER:
+            copy->member.object = clone_expr(expr->member.object, args);
+            break;
+        case EXPR_SLICE:
+            copy->slice.object = clone_expr(expr->slice.object, args);
+            copy->slice.start = clone_expr(expr->slice.start, args);
+            copy->slice.end = clone_expr(expr->slice.end, args);
+            break;
+    }
+
+    return copy;
+}
+
+static ExprNode** clone_expr_list(ExprNode **exprs, const size_t count, const TypeArg *args) {
+    ExprNode **copy = malloc(sizeof(ExprNode*) * (count + 1));
+    for (size_t i = 0; i < count; i++) {
+        copy[i] = clone_expr(exprs[i], args);
+    }
+
+    return copy;
+}
+
+static StmtNode** clone_stmt_list(StmtNode **stmts, const int count, const TypeArg *args) {
+    StmtNode **copy = malloc(sizeof(StmtNode*) * (count + 1));
+    for (int i = 0; i < count; i++) {
+        copy[i] = clone_stmt(stmts[i], args);
+    }
+
+    return copy;
+}
+
+static StmtNode* clone_stmt(const StmtNode *stmt, const TypeArg *args) {
+    if (!stmt) return NULL;
+
+    StmtNode *copy = malloc(sizeof(StmtNode));
+    *copy = *stmt;
+
+    switch (stmt->kind) {
+        case STMT_RETURN:
+            copy->return_stmt.expr = clone_expr(stmt->return_stmt.expr, args);
+            break;
+        case STMT_IF:
+            copy->if_stmt.condition = clone_expr(stmt->if_stmt.condition, args);
+            copy->if_stmt.then_stmt = clone_stmt(stmt->if_stmt.then_stmt, args);
+            copy->if_stmt.else_stmt = clone_stmt(stmt->if_stmt.else_stmt, args);
+            break;
+        case STMT_WHILE:
+            copy->while_stmt.condition = clone_expr(stmt->while_stmt.condition, args);
+            copy->while_stmt.body = clone_stmt(stmt->while_stmt.body, args);
+            break;
+        case STMT_FOR:
+            copy->for_stmt.init = clone_stmt(stmt->for_stmt.init, args);
+            copy->for_stmt.condition = clone_expr(stmt->for_stmt.condition, args);
+            copy->for_stmt.increment = clone_expr(stmt->for_stmt.increment, args);
+            copy->for_stmt.body = clone_stmt(stmt->for_stmt.body, args);
+            copy->for_stmt.range = clone_expr(stmt->for_stmt.range, args);
+            break;
+        case STMT_SWITCH:
+            copy->switch_stmt.value = clone_expr(stmt->switch_stmt.value, args);
+            copy->switch_stmt.cases = malloc(sizeof(SwitchCase) * (stmt->switch_stmt.case_count + 1));
+
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                const SwitchCase *original = &stmt->switch_stmt.cases[i];
+                copy->switch_stmt.cases[i] = *original;
+                copy->switch_stmt.cases[i].value = clone_expr(original->value, args);
+                copy->switch_stmt.cases[i].stmts = clone_stmt_list(original->stmts, original->count, args);
+            }
+            break;
+        case STMT_VAR_DECL:
+            substitute(args, &copy->var_decl.type, &copy->var_decl.pointer_level);
+            copy->var_decl.initializer = clone_expr(stmt->var_decl.initializer, args);
+            break;
+        case STMT_EXPR:
+            copy->expr_stmt.expr = clone_expr(stmt->expr_stmt.expr, args);
+            break;
+        case STMT_COMPOUND:
+            copy->compound.stmts = clone_stmt_list(stmt->compound.stmts, stmt->compound.count, args);
+            break;
+        case STMT_ASM:
+            copy->asm_stmt.outputs = clone_expr_list(stmt->asm_stmt.outputs, stmt->asm_stmt.output_count, args);
+            copy->asm_stmt.inputs = clone_expr_list(stmt->asm_stmt.inputs, stmt->asm_stmt.input_count, args);
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+
+    return copy;
+}
+
+FunctionNode* generic_instantiate(const FunctionNode *generic, const TypeArg *args, const char *name) {
+    FunctionNode *func = malloc(sizeof(FunctionNode));
+    *func = *generic;
+    func->name = strdup(name);
+    func->type_params = NULL;
+    func->type_param_count = 0;
+    func->is_exported = false;
+    func->has_self_become = false;
+
+    substitute(args, &func->return_type, &func->return_pointer_level);
+
+    func->params = malloc(sizeof(ParamNode) * (generic->param_count + 1));
+    for (int i = 0; i < generic->param_count; i++) {
+        func->params[i] = generic->params[i];
+        substitute(args, &func->params[i].type, &func->params[i].pointer_level);
+    }
+
+    func->body = clone_stmt(generic->body, args);
+    return func;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef C__SEMANTIC_GENERICS_H
+#define C__SEMANTIC_GENERICS_H
+
+#include "../ast/ast.h"
+
+bool is_type_param(TypeKind type);
+
+// name of one instantiation, as in max<int> or pair<float*, long>. unique per (function, type arguments)
+char* generic_instance_name(const char *name, const TypeArg *args, int count);
+
+// copies the generic function with every type parameter replaced by its argument, the copy is analysed like any other function
+FunctionNode* generic_instantiate(const FunctionNode *generic, const TypeArg *args, const char *name);
+
+#endif //C__SEMANTIC_GENERICS_H
\ No newline at end of file
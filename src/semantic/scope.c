@@ -62,7 +62,7 @@ Symbol* scope_lookup_recursive(const Scope *scope, const char *name) {
 bool scope_in_loop(const Scope *scope) {
     if (!scope) return false;
 
-    if (scope->scope_type == SCOPE_LOOP) {
+    if (scope->scope_type == SCOPE_LOOP || scope->scope_type == SCOPE_PARALLEL_LOOP) {
         return true;
     }
 
@@ -73,6 +73,55 @@ bool scope_in_loop(const Scope *scope) {
     return false;
 }
 
+// break also leaves a switch, continue only a loop
+bool scope_in_breakable(const Scope *scope) {
+    if (!scope) return false;
+
+    if (scope->scope_type == SCOPE_LOOP || scope->scope_type == SCOPE_PARALLEL_LOOP || scope->scope_type == SCOPE_SWITCH) {
+        return true;
+    }
+
+    if (scope->parent) {
+        return scope_in_breakable(scope->parent);
+    }
+
+    return false;
+}
+
+// the body of a parallel for runs as separate chunks, so nothing in it can return from the function
+bool scope_in_parallel_loop(const Scope *scope) {
+    if (!scope) return false;
+
+    if (scope->scope_type == SCOPE_PARALLEL_LOOP) {
+        return true;
+    }
+
+    if (scope->parent) {
+        return scope_in_parallel_loop(scope->parent);
+    }
+
+    return false;
+}
+
+// true when the innermost loop or switch around a break is a parallel for
+bool scope_break_leaves_parallel(const Scope *scope) {
+    if (!scope) return false;
+
+    if (scope->scope_type == SCOPE_LOOP || scope->scope_type == SCOPE_SWITCH) {
+        return false;
+    }
+
+    if (scope->scope_type == SCOPE_PARALLEL_LOOP) {
+        return true;
+    }
+
+    if (scope->parent) {
+        return scope_break_leaves_parallel(scope->parent);
+    }
+
+    return false;
+}
+
 Scope* scope_find_function(const Scope *scope) {
     if (!scope) return NULL;
 
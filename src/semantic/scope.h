@@ -21,6 +21,13 @@ typedef struct Symbol {
     Vector parameters;
     int pointer_level;
     bool is_const;
+    bool is_soa;  // soa struct array, only reachable as name[i].field
+    bool is_restrict;
+    bool is_slice;
+    int array_size;  // fixed arrays only, they convert to slices
+    const int *dims;  // multi-dimensional arrays and parameters pointing at rows, see ExprNode.dims
+    int dim_count;
+    const FunctionNode *generic;  // generic function a call instantiates, nullptr otherwise
     SourceLocation location;
 } Symbol;
 
@@ -29,6 +36,8 @@ typedef enum {
     SCOPE_FUNCTION,
     SCOPE_BLOCK,
     SCOPE_LOOP,
+    SCOPE_PARALLEL_LOOP,
+    SCOPE_SWITCH,
 } ScopeType;
 
 typedef struct Scope {
@@ -45,6 +54,9 @@ Symbol* scope_lookup(const Scope *scope, const char *name);
 Symbol* scope_lookup_recursive(const Scope *scope, const char *name);
 
 bool scope_in_loop(const Scope *scope);
+bool scope_in_breakable(const Scope *scope);
+bool scope_in_parallel_loop(const Scope *scope);
+bool scope_break_leaves_parallel(const Scope *scope);
 Scope* scope_find_function(const Scope *scope);
 
 
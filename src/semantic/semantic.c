@@ -1,11 +1,16 @@
 
 #include "semantic.h"
 #include "typecheck.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "scope.h"
 #include "builtins.h"
+#include "callgraph.h"
+#include "generics.h"
 
 // internal state
 struct SemanticAnalyzer {
@@ -14,11 +19,39 @@ struct SemanticAnalyzer {
 
     TypeKind current_function_return_type;
     int current_function_return_ptr_level;
+    FunctionNode *current_function;
+
+    // generic instantiations are appended to the program and declared globally as they are found
+    ProgramNode *program;
+    Scope *global_scope;
 };
 
 static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr);
 static bool analyze_statement(SemanticAnalyzer *analyzer, StmtNode *stmt, TypeKind expected_ret_type, int expected_ret_ptr_level);
-static void analyze_function(SemanticAnalyzer *analyzer, const FunctionNode *func, Scope *global);
+static void analyze_function(SemanticAnalyzer *analyzer, FunctionNode *func, Scope *global);
+static void analyze_array_initializer(SemanticAnalyzer *analyzer, const char *name, TypeKind type, int pointer_level, int array_size, ExprNode *init, bool is_global, SourceLocation loc);
+static void analyze_vector_binop(SemanticAnalyzer *analyzer, ExprNode *expr);
+static bool analyze_intrinsic_call(SemanticAnalyzer *analyzer, ExprNode *expr);
+static void analyze_struct(SemanticAnalyzer *analyzer, const StructNode *def, TypeKind type);
+static void analyze_member(SemanticAnalyzer *analyzer, ExprNode *expr);
+static void analyze_struct_initializer(SemanticAnalyzer *analyzer, const char *name, TypeKind type, ExprNode *init, bool is_global);
+static void analyze_soa_declaration(SemanticAnalyzer *analyzer, const char *name, TypeKind type, int pointer_level, int array_size, const ExprNode *init, SourceLocation loc);
+static bool is_lvalue(const ExprNode *expr);
+static const char* same_address(const ExprNode *a, const ExprNode *b);
+static bool is_fixed_array(const SemanticAnalyzer *analyzer, const ExprNode *expr);
+static bool reject_aggregate(SemanticAnalyzer *analyzer, const ExprNode *expr);
+static bool coerce_to_slice(SemanticAnalyzer *analyzer, ExprNode **slot, bool target_is_slice, TypeKind type, int pointer_level);
+static void coerce_string(ExprNode **slot, TypeKind type, int pointer_level);
+static void fold_self_append(ExprNode *expr);
+static void match_float_literal(ExprNode *literal, const ExprNode *other);
+static bool reject_dims_mismatch(SemanticAnalyzer *analyzer, const ExprNode *value, const int *dims, int dim_count);
+static void reject_constant_overflow(SemanticAnalyzer *analyzer, const ExprNode *value, TypeKind type, int pointer_level);
+static ExprNode* flatten_initializer(SemanticAnalyzer *analyzer, const char *name, const int *dims, int dim_count, ExprNode *init);
+static Symbol* declare_function(Scope *global, const FunctionNode *func);
+static Symbol* instantiate_generic(SemanticAnalyzer *analyzer, ExprNode *expr, const Symbol *func_sym);
+
+// deeper type arguments only come from a generic that keeps instantiating itself with a bigger one
+#define MAX_GENERIC_POINTER_LEVEL 16
 
 SemanticAnalyzer* semantic_create(DiagnosticEngine *diagnostics) {
     SemanticAnalyzer *analyzer = malloc(sizeof(SemanticAnalyzer));
@@ -28,6 +61,9 @@ SemanticAnalyzer* semantic_create(DiagnosticEngine *diagnostics) {
     analyzer->current_scope = NULL;
     analyzer->current_function_return_type = TYPE_VOID;
     analyzer->current_function_return_ptr_level = 0;
+    analyzer->current_function = NULL;
+    analyzer->program = NULL;
+    analyzer->global_scope = NULL;
 
     return analyzer;
 }
@@ -42,9 +78,16 @@ bool semantic_analyze_program(SemanticAnalyzer *analyzer, ProgramNode *program)
 
     Scope *global = scope_create(NULL, SCOPE_GLOBAL);
     analyzer->current_scope = global;
+    analyzer->program = program;
+    analyzer->global_scope = global;
 
     register_builtins(global);
 
+    register_struct_types(program->structs, program->struct_count);
+    for (int i = 0; i < program->struct_count; i++) {
+        analyze_struct(analyzer, program->structs[i], TYPE_STRUCT + i);
+    }
+
     for (int i = 0; i < program->function_count; i++) {
         const FunctionNode *func = program->functions[i];
 
@@ -53,19 +96,11 @@ bool semantic_analyze_program(SemanticAnalyzer *analyzer, ProgramNode *program)
             continue;
         }
 
-        Symbol *sym = malloc(sizeof(Symbol));
-        sym->name = strdup(func->name);
-        sym->kind = SYM_FUNCTION;
-        sym->type = func->return_type;
-        sym->pointer_level = func->return_pointer_level;
-        sym->is_const = false;
-        sym->location = func->location;
-
-        scope_add_symbol(global, sym);
+        declare_function(global, func);
     }
 
     for (int i = 0; i < program->global_count; i++) {
-        const GlobalVarNode *global_var = program->globals[i];
+        GlobalVarNode *global_var = program->globals[i];
 
         if (scope_lookup(global, global_var->name)) {
             diag_error(analyzer->diagnostics, global_var->location, "Global variable '%s' already declared", global_var->name);
@@ -77,16 +112,45 @@ bool semantic_analyze_program(SemanticAnalyzer *analyzer, ProgramNode *program)
         sym->kind = SYM_VARIABLE;
         sym->type = global_var->kind;
         sym->is_const = global_var->is_const;
+        sym->is_soa = global_var->is_soa;
+        sym->is_restrict = false;
+        sym->is_slice = false;
+        sym->array_size = global_var->array_size;
+        sym->dims = global_var->dims;
+        sym->dim_count = global_var->dim_count;
+        sym->generic = NULL;
         sym->location = global_var->location;
 
-        if (global_var->array_size > 0) {
+        if (global_var->dim_count > 0) {
+            sym->pointer_level = global_var->pointer_level + global_var->dim_count;
+        } else if (global_var->array_size > 0) {
             sym->pointer_level = global_var->pointer_level + 1;
         } else {
             sym->pointer_level = global_var->pointer_level;
         }
 
         // Analyze initializer if present
-        if (global_var->initializer) {
+        if (global_var->is_soa) {
+            analyze_soa_declaration(analyzer, global_var->name, global_var->kind, global_var->pointer_level,
+                                    global_var->array_size, global_var->initializer, global_var->location);
+        } else if (global_var->dim_count > 0) {
+            if (global_var->initializer) {
+                ExprNode *flat = flatten_initializer(analyzer, global_var->name, global_var->dims, global_var->dim_count, global_var->initializer);
+                if (flat) {
+                    global_var->initializer = flat;
+                    analyze_array_initializer(analyzer, global_var->name, global_var->kind, global_var->pointer_level,
+                                              flat->init_list.count, flat, true, global_var->location);
+                }
+            }
+        } else if (is_struct_type(global_var->kind) && global_var->pointer_level == 0 && global_var->array_size <= 0 &&
+                   global_var->initializer && global_var->initializer->kind == EXPR_INIT_LIST) {
+            analyze_struct_initializer(analyzer, global_var->name, global_var->kind, global_var->initializer, true);
+        } else if (global_var->array_size > 0 || (global_var->initializer && global_var->initializer->kind == EXPR_INIT_LIST)) {
+            if (global_var->initializer) {
+                analyze_array_initializer(analyzer, global_var->name, global_var->kind, global_var->pointer_level,
+                                          global_var->array_size, global_var->initializer, true, global_var->location);
+            }
+        } else if (global_var->initializer) {
             analyze_expression(analyzer, global_var->initializer);
 
             if (!types_compatible_with_pointers(global_var->kind, global_var->pointer_level,
@@ -101,27 +165,95 @@ bool semantic_analyze_program(SemanticAnalyzer *analyzer, ProgramNode *program)
                           global_var->initializer->pointer_level > 0 ? "*" : ""
                 );
             }
+
+            reject_constant_overflow(analyzer, global_var->initializer, global_var->kind, global_var->pointer_level);
         }
 
         scope_add_symbol(global, sym);
     }
 
+    // instantiations found along the way are appended, so the count is read every iteration
+    const int declared_count = program->function_count;
     for (int i = 0; i < program->function_count; i++) {
+        if (program->functions[i]->type_param_count > 0) continue;  // only checked once instantiated
+
+        const int error_count = diag_get_error_count(analyzer->diagnostics);
         analyze_function(analyzer, program->functions[i], global);
+
+        if (i >= declared_count && diag_get_error_count(analyzer->diagnostics) > error_count) {
+            diag_note(analyzer->diagnostics, program->functions[i]->location, "In instantiation '%s'", program->functions[i]->name);
+        }
     }
 
+    callgraph_mark_reachable(program);
+
     scope_destroy(global);
     analyzer->current_scope = NULL;
 
     return !diag_has_errors(analyzer->diagnostics);
 }
 
+static Symbol* declare_function(Scope *global, const FunctionNode *func) {
+    Symbol *sym = malloc(sizeof(Symbol));
+    sym->name = strdup(func->name);
+    sym->kind = SYM_FUNCTION;
+    sym->type = func->return_type;
+    sym->pointer_level = func->return_pointer_level;
+    sym->is_const = false;
+    sym->is_soa = false;
+    sym->is_restrict = false;
+    sym->is_slice = func->returns_slice;
+    sym->array_size = 0;
+    sym->dims = NULL;
+    sym->dim_count = 0;
+    sym->generic = func->type_param_count > 0 ? func : NULL;
+    sym->location = func->location;
+
+    // the signature is known before any body is analysed, so calls can go to functions declared further down
+    sym->parameters = create_vector(func->param_count, sizeof(Symbol*));
+    for (int j = 0; j < func->param_count; j++) {
+        const ParamNode *param = &func->params[j];
+
+        Symbol *sig_sym = malloc(sizeof(Symbol));
+        sig_sym->name = strdup(param->name);
+        sig_sym->kind = SYM_PARAMETER;
+        sig_sym->type = param->type;
+        sig_sym->pointer_level = param->pointer_level;
+        sig_sym->is_const = param->is_const;
+        sig_sym->is_soa = false;
+        sig_sym->is_restrict = param->is_restrict;
+        sig_sym->is_slice = param->is_slice;
+        sig_sym->array_size = 0;
+        sig_sym->dims = param->dims;
+        sig_sym->dim_count = param->dim_count;
+        sig_sym->generic = NULL;
+        sig_sym->location = param->location;
+
+        vector_push(&sym->parameters, &sig_sym);
+    }
+
+    scope_add_symbol(global, sym);
+    return sym;
+}
+
 static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
     if (!expr) return;
 
     switch (expr->kind) {
         case EXPR_NUMBER: {
-            expr->type = TYPE_INT;
+            // decimals are double (next to a float they become float, see match_float_literal), literals that
+            // dont fit in an int (mostly hex masks) are long
+            if (strchr(expr->text, '.')) {
+                expr->type = TYPE_DOUBLE;
+            } else {
+                // literals past the long range (0xFFFFFFFFFFFFFFFF) are ulong
+                errno = 0;
+                const unsigned long long value = strtoull(expr->text, NULL, 10);
+                if (errno == ERANGE) {
+                    diag_error(analyzer->diagnostics, expr->location, "Integer literal '%s' does not fit in 64 bits", expr->text);
+                }
+                expr->type = value > INT64_MAX ? TYPE_ULONG : value > INT32_MAX ? TYPE_LONG : TYPE_INT;
+            }
             expr->pointer_level = 0;
             break;
         }
@@ -139,13 +271,22 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 break;
             }
 
+            if (sym->is_soa) {
+                diag_error(analyzer->diagnostics, expr->location, "soa array '%s' can only be accessed one field at a time, as '%s[i].field'", expr->text, expr->text);
+            }
+
             expr->type = sym->type;
             expr->pointer_level = sym->pointer_level;
+            expr->is_slice = sym->is_slice;
+            expr->dims = sym->dims;
+            expr->dim_count = sym->dim_count;
             break;
         }
         case EXPR_UNARY: {
             analyze_expression(analyzer, expr->unary.operand);
 
+            reject_aggregate(analyzer, expr->unary.operand);
+
             switch (expr->unary.op) {
                 case UNARY_NOT: {
                     if (expr->unary.operand->type == TYPE_VOID || expr->unary.operand->type == TYPE_STRING) {
@@ -156,13 +297,21 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                     break;
                 }
                 case UNARY_NEG: {
-                    if (!is_numeric_type(expr->unary.operand->type)) {
+                    if (!is_numeric_type(expr->unary.operand->type) && !is_vector_type(expr->unary.operand->type)) {
                         diag_error(analyzer->diagnostics, expr->location, "Invalid type '%s' for unary '-' operator", type_to_string(expr->unary.operand->type));
                     }
                     expr->type = expr->unary.operand->type;
                     expr->pointer_level = expr->unary.operand->pointer_level;
                     break;
                 }
+                case UNARY_BIT_NOT: {
+                    if (!is_integer_type(vector_element_type(expr->unary.operand->type)) || expr->unary.operand->pointer_level > 0) {
+                        diag_error(analyzer->diagnostics, expr->location, "Invalid type '%s' for '~' operator", type_to_string(expr->unary.operand->type));
+                    }
+                    expr->type = expr->unary.operand->type;
+                    expr->pointer_level = 0;
+                    break;
+                }
                 case UNARY_DEREF: {
                     if (expr->unary.operand->pointer_level == 0) {
                         diag_error(analyzer->diagnostics, expr->location, "Cannot dereference non-pointer type '%s'", type_to_string(expr->unary.operand->type));
@@ -173,7 +322,9 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 }
                 case UNARY_ADDR_OF: {
                     // check if operand is an lvalue
-                    if (expr->unary.operand->kind != EXPR_VAR && !(expr->unary.operand->kind == EXPR_UNARY &&  expr->unary.operand->unary.op == UNARY_DEREF) && expr->unary.operand->kind != EXPR_ARRAY_INDEX) {
+                    if (expr->unary.operand->dim_count > 0) {
+                        diag_error(analyzer->diagnostics, expr->location, "Cannot take the address of a row, use the address of its first element instead");
+                    } else if (!is_lvalue(expr->unary.operand)) {
                         diag_error(analyzer->diagnostics, expr->location, "Cannot take address of non-lvalue");
                     }
                     expr->type = expr->unary.operand->type;
@@ -184,8 +335,7 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 case UNARY_PRE_DEC:
                 case UNARY_POST_INC:
                 case UNARY_POST_DEC: {
-                    if (expr->unary.operand->kind != EXPR_VAR && !(expr->unary.operand->kind == EXPR_UNARY && expr->unary.operand->unary.op == UNARY_DEREF) &&
-                        expr->unary.operand->kind != EXPR_ARRAY_INDEX) {
+                    if (!is_lvalue(expr->unary.operand)) {
                         diag_error(analyzer->diagnostics, expr->location, "Expression is not assignable");
                     }
 
@@ -212,10 +362,23 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
         case EXPR_BINOP: {
             analyze_expression(analyzer, expr->binop.left);
             analyze_expression(analyzer, expr->binop.right);
+            match_float_literal(expr->binop.left, expr->binop.right);
+            match_float_literal(expr->binop.right, expr->binop.left);
 
             const TypeKind lhs = expr->binop.left->type;
             const TypeKind rhs = expr->binop.right->type;
 
+            if (expr->binop.op != BIN_ASSIGN && (reject_aggregate(analyzer, expr->binop.left) || reject_aggregate(analyzer, expr->binop.right))) {
+                expr->type = lhs;
+                expr->pointer_level = 0;
+                break;
+            }
+
+            if ((is_vector_type(lhs) || is_vector_type(rhs)) && !is_assignment_op(expr->binop.op)) {
+                analyze_vector_binop(analyzer, expr);
+                break;
+            }
+
             if (is_arithmetic_op(expr->binop.op)) {
                 if (expr->binop.left->pointer_level > 0 && is_numeric_type(rhs)) {
                     expr->type = lhs;
@@ -233,6 +396,8 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 const bool r_is_str = (rhs == TYPE_STRING) || (rhs == TYPE_CHAR && expr->binop.right->pointer_level == 1);
 
                 if (expr->binop.op == BIN_ADD && l_is_str && r_is_str) {
+                    coerce_string(&expr->binop.left, TYPE_STRING, 0);
+                    coerce_string(&expr->binop.right, TYPE_STRING, 0);
                     expr->type = TYPE_STRING;
                     expr->pointer_level = 0;
                     break;
@@ -243,20 +408,54 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                               "Arithmetic operator requires numeric types. Got '%s' and '%s'",
                               type_to_string(lhs), type_to_string(rhs)
                     );
+                    expr->type = lhs;
+                } else {
+                    expr->type = arithmetic_common_type(lhs, rhs);
+                }
+
+                expr->pointer_level = 0;
+                break;
+            }
+
+            if (is_bitwise_op(expr->binop.op)) {
+                const bool is_shift = expr->binop.op == BIN_SHL || expr->binop.op == BIN_SHR;
+                const bool both_bool = !is_shift && lhs == TYPE_BOOLEAN && rhs == TYPE_BOOLEAN;
+
+                if ((!both_bool && (!is_integer_type(lhs) || !is_integer_type(rhs))) || expr->binop.left->pointer_level > 0 || expr->binop.right->pointer_level > 0) {
+                    diag_error(analyzer->diagnostics, expr->location,
+                              "Bitwise operator requires integer types. Got '%s' and '%s'",
+                              type_to_string(lhs), type_to_string(rhs)
+                    );
                 }
 
-                expr->type = lhs;
+                // a shift keeps the type of the value being shifted
+                if (both_bool || !is_integer_type(lhs) || !is_integer_type(rhs)) {
+                    expr->type = lhs;
+                } else {
+                    expr->type = is_shift ? promote_integer_type(lhs) : arithmetic_common_type(lhs, rhs);
+                }
                 expr->pointer_level = 0;
                 break;
             }
 
             if (is_comparison_op(expr->binop.op)) {
-                if (!types_compatible_with_pointers(lhs, expr->binop.left->pointer_level,
+                if ((is_struct_type(lhs) && expr->binop.left->pointer_level == 0) || (is_struct_type(rhs) && expr->binop.right->pointer_level == 0)) {
+                    diag_error(analyzer->diagnostics, expr->location, "Cannot compare struct values, compare their fields instead");
+                } else if (!types_compatible_with_pointers(lhs, expr->binop.left->pointer_level,
                                                     rhs, expr->binop.right->pointer_level)) {
                     diag_error(analyzer->diagnostics, expr->location,
                               "Type mismatch in comparison: '%s' vs '%s'",
                               type_to_string(lhs), type_to_string(rhs));
                 }
+
+                // strings and char* compare by their contents
+                const bool l_is_str = lhs == TYPE_STRING || (lhs == TYPE_CHAR && expr->binop.left->pointer_level == 1);
+                const bool r_is_str = rhs == TYPE_STRING || (rhs == TYPE_CHAR && expr->binop.right->pointer_level == 1);
+                if ((expr->binop.op == BIN_EQUAL || expr->binop.op == BIN_NOT_EQUAL) && l_is_str && r_is_str) {
+                    coerce_string(&expr->binop.left, TYPE_STRING, 0);
+                    coerce_string(&expr->binop.right, TYPE_STRING, 0);
+                }
+
                 expr->type = TYPE_BOOLEAN;
                 expr->pointer_level = 0;
                 break;
@@ -264,17 +463,26 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
 
             if (is_assignment_op(expr->binop.op)) {
                 // Check if left side is an lvalue
-                if (expr->binop.left->kind != EXPR_VAR && !(expr->binop.left->kind == EXPR_UNARY &&
-                      expr->binop.left->unary.op == UNARY_DEREF) && expr->binop.left->kind != EXPR_ARRAY_INDEX) {
-                    diag_error(analyzer->diagnostics, expr->location, "Left-hand side of assignment must be a variable, dereferenced pointer, or array element");
+                if (!is_lvalue(expr->binop.left)) {
+                    diag_error(analyzer->diagnostics, expr->location, "Left-hand side of assignment must be a variable, dereferenced pointer, array element or field");
                 }
 
-                if (expr->binop.op != BIN_ASSIGN) {
-                    if (!is_numeric_type(lhs) && expr->binop.left->pointer_level == 0) {
+                const bool string_append = expr->binop.op == BIN_ADD_ASSIGN && lhs == TYPE_STRING &&
+                                           expr->binop.left->pointer_level == 0 && !expr->binop.left->is_slice;
+                if (expr->binop.op != BIN_ASSIGN && !string_append) {
+                    if (!is_numeric_type(lhs) && !is_vector_type(lhs) && expr->binop.left->pointer_level == 0) {
                         diag_error(analyzer->diagnostics, expr->location, "Invalid types for compound assignment");
                     }
                 }
 
+                if (is_bitwise_assignment_op(expr->binop.op)) {
+                    if (!is_integer_type(vector_element_type(lhs)) || !is_integer_type(vector_element_type(rhs)) || expr->binop.left->pointer_level > 0) {
+                        diag_error(analyzer->diagnostics, expr->location,
+                                  "Bitwise assignment requires integer types. Got '%s' and '%s'",
+                                  type_to_string(lhs), type_to_string(rhs));
+                    }
+                }
+
                 // Check for const assignment
                 if (expr->binop.left->kind == EXPR_VAR) {
                     Symbol *sym = scope_lookup_recursive(analyzer->current_scope,
@@ -287,7 +495,9 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 }
 
                 // Check type compatibility
-                if (!types_compatible_with_pointers(lhs, expr->binop.left->pointer_level,
+                if (!reject_dims_mismatch(analyzer, expr->binop.right, NULL, 0) &&
+                    !coerce_to_slice(analyzer, &expr->binop.right, expr->binop.left->is_slice, lhs, expr->binop.left->pointer_level) &&
+                    !types_compatible_with_pointers(lhs, expr->binop.left->pointer_level,
                                                     rhs, expr->binop.right->pointer_level)) {
                     diag_error(analyzer->diagnostics, expr->location,
                               "Type mismatch in assignment. Cannot assign '%s%s' to '%s%s'",
@@ -297,8 +507,16 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                               expr->binop.left->pointer_level > 0 ? "*" : "");
                 }
 
+                if (expr->binop.op == BIN_ASSIGN || string_append) {
+                    coerce_string(&expr->binop.right, lhs, expr->binop.left->pointer_level);
+                }
+                if (expr->binop.op == BIN_ASSIGN) {
+                    fold_self_append(expr);
+                }
+
                 expr->type = lhs;
                 expr->pointer_level = expr->binop.left->pointer_level;
+                expr->is_slice = expr->binop.left->is_slice;
                 break;
             }
 
@@ -317,6 +535,10 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
         }
         case EXPR_CALL: {
             Symbol *func_sym = scope_lookup_recursive(analyzer->current_scope, expr->call.function_name);
+            if (!func_sym && analyze_intrinsic_call(analyzer, expr)) {
+                break;
+            }
+
             if (!func_sym) {
                 diag_error(analyzer->diagnostics, expr->location, "Undefined function '%s'", expr->call.function_name);
                 expr->type = TYPE_INT;
@@ -338,13 +560,33 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                 break;
             }
 
+            // a generic call goes to the instance for its type arguments, which needs the arguments analysed first
+            const bool args_analyzed = func_sym->generic != NULL;
+            if (func_sym->generic) {
+                func_sym = instantiate_generic(analyzer, expr, func_sym);
+                if (!func_sym) {
+                    expr->type = TYPE_INT;
+                    expr->pointer_level = 0;
+                    break;
+                }
+            } else if (expr->call.type_arg_count > 0) {
+                diag_error(analyzer->diagnostics, expr->location, "'%s' is not generic but was given type arguments", expr->call.function_name);
+            }
+
             for (int i = 0; i < expr->call.arg_count; i++) {
                 ExprNode *arg_expr = expr->call.args[i];
-                analyze_expression(analyzer, arg_expr);
+                if (!args_analyzed) {
+                    analyze_expression(analyzer, arg_expr);
+                }
 
                 const Symbol **param_ptr = vector_get(&func_sym->parameters, i);
                 const Symbol *param_sym = *param_ptr;
 
+                if (reject_dims_mismatch(analyzer, arg_expr, param_sym->dims, param_sym->dim_count) ||
+                    coerce_to_slice(analyzer, &expr->call.args[i], param_sym->is_slice, param_sym->type, param_sym->pointer_level)) {
+                    continue;
+                }
+
                 if (!types_compatible_with_pointers(param_sym->type, param_sym->pointer_level, arg_expr->type, arg_expr->pointer_level)) {
                     diag_error(analyzer->diagnostics, arg_expr->location, "%s function argument %d mismatch: Expected '%s%d', got '%s%d'",
                         func_sym->name,
@@ -356,16 +598,50 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
                     );
                     break;
                 }
+
+                coerce_string(&expr->call.args[i], param_sym->type, param_sym->pointer_level);
+            }
+
+            // the same pointer passed to a restrict parameter and any other parameter breaks the promise codegen makes to llvm
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                const Symbol *param_sym = *(const Symbol**)vector_get(&func_sym->parameters, i);
+                if (param_sym->pointer_level == 0) continue;
+
+                for (int j = i + 1; j < expr->call.arg_count; j++) {
+                    const Symbol *other = *(const Symbol**)vector_get(&func_sym->parameters, j);
+                    const char *name = same_address(expr->call.args[i], expr->call.args[j]);
+                    if ((param_sym->is_restrict || other->is_restrict) && other->pointer_level > 0 && name) {
+                        diag_warning(analyzer->diagnostics, expr->call.args[j]->location,
+                                    "'%s' is passed to parameters %d and %d of '%s' but one of them is restrict",
+                                    name, i + 1, j + 1, func_sym->name);
+                    }
+                }
             }
 
             expr->type = func_sym->type;
             expr->pointer_level = func_sym->pointer_level;
+            expr->is_slice = func_sym->is_slice;
             break;
         }
         case EXPR_ARRAY_INDEX: {
             analyze_expression(analyzer, expr->array_index.array);
             analyze_expression(analyzer, expr->array_index.index);
 
+            // lane access on a simd vector
+            if (is_vector_type(expr->array_index.array->type) && expr->array_index.array->pointer_level == 0) {
+                if (!is_integer_type(expr->array_index.index->type)) {
+                    diag_error(analyzer->diagnostics, expr->location, "Vector lane index must be an integer type, got '%s'", type_to_string(expr->array_index.index->type));
+                }
+
+                if (expr->array_index.index->kind == EXPR_NUMBER && atoi(expr->array_index.index->text) >= vector_lane_count(expr->array_index.array->type)) {
+                    diag_error(analyzer->diagnostics, expr->location, "Lane %s is out of range for '%s'", expr->array_index.index->text, type_to_string(expr->array_index.array->type));
+                }
+
+                expr->type = vector_element_type(expr->array_index.array->type);
+                expr->pointer_level = 0;
+                break;
+            }
+
             if (expr->array_index.array->pointer_level == 0) {
                 diag_error(analyzer->diagnostics, expr->location, "Cannot index non-pointer/non-array type '%s'", type_to_string(expr->array_index.array->type));
             }
@@ -376,177 +652,1740 @@ static void analyze_expression(SemanticAnalyzer *analyzer, ExprNode *expr) {
 
             expr->type = expr->array_index.array->type;
             expr->pointer_level = expr->array_index.array->pointer_level - 1;
+
+            // a row of a multi-dimensional array keeps the extents below it
+            const ExprNode *array = expr->array_index.array;
+            if (array->dim_count > 0) {
+                const ExprNode *index = expr->array_index.index;
+                if (index->kind == EXPR_NUMBER && array->dims[0] > 0 && atoi(index->text) >= array->dims[0]) {
+                    diag_error(analyzer->diagnostics, index->location, "Index %s is out of range for an extent of %d", index->text, array->dims[0]);
+                }
+
+                if (array->dim_count > 1) {
+                    expr->dims = array->dims + 1;
+                    expr->dim_count = array->dim_count - 1;
+                }
+            }
             break;
         }
         case EXPR_CAST: {
             analyze_expression(analyzer, expr->cast.operand);
 
+            if (expr->cast.operand->is_slice) {
+                diag_error(analyzer->diagnostics, expr->location, "Cannot cast a slice, cast its '.ptr' instead");
+            }
+
             expr->type = expr->cast.target_type;
             expr->pointer_level = expr->cast.target_pointer_level;
 
+            if (expr->pointer_level == 0 && expr->cast.operand->pointer_level == 0 && is_vector_type(expr->cast.operand->type) &&
+                (!is_vector_type(expr->type) || vector_lane_count(expr->type) != vector_lane_count(expr->cast.operand->type))) {
+                diag_error(analyzer->diagnostics, expr->location, "Cannot cast '%s' to '%s'",
+                          type_to_string(expr->cast.operand->type), type_to_string(expr->type));
+            }
+
             if (expr->cast.operand->pointer_level > 0 && expr->pointer_level == 0) {
-                if (expr->type != TYPE_INT && expr->type != TYPE_LONG) {
+                if (expr->type != TYPE_INT && expr->type != TYPE_LONG && expr->type != TYPE_ULONG) {
                     diag_warning(analyzer->diagnostics, expr->location, "Cast from pointer to non-integer type");
                 }
             }
 
             break;
         }
-    }
-}
-
+        case EXPR_MEMBER: {
+            analyze_member(analyzer, expr);
+            break;
+        }
+        case EXPR_SLICE: {
+            ExprNode *object = expr->slice.object;
+            analyze_expression(analyzer, object);
 
-static bool analyze_statement(SemanticAnalyzer *analyzer, StmtNode *stmt, const TypeKind expected_ret_type, const int expected_ret_ptr_level) {
-    if (!stmt) return false;
+            ExprNode *bounds[2] = { expr->slice.start, expr->slice.end };
+            for (int i = 0; i < 2; i++) {
+                if (!bounds[i]) continue;
 
-    switch (stmt->kind) {
-        case STMT_RETURN: {
-            if (stmt->return_stmt.expr) {
-                if (expected_ret_type == TYPE_VOID && expected_ret_ptr_level == 0) {
-                    diag_error(analyzer->diagnostics, stmt->location, "Void function cannot return a value");
+                analyze_expression(analyzer, bounds[i]);
+                if (!is_integer_type(bounds[i]->type) || bounds[i]->pointer_level > 0 || bounds[i]->is_slice) {
+                    diag_error(analyzer->diagnostics, bounds[i]->location, "Slice bounds must be integers, got '%s'", type_to_string(bounds[i]->type));
                 }
+            }
 
-                analyze_expression(analyzer, stmt->return_stmt.expr);
-
-                if (!types_compatible_with_pointers(expected_ret_type, expected_ret_ptr_level,
-                                                    stmt->return_stmt.expr->type,
-                                                    stmt->return_stmt.expr->pointer_level)) {
-                    diag_error(analyzer->diagnostics, stmt->location,
-                              "Return type mismatch. Expected '%s%s', got '%s%s'",
-                              type_to_string(expected_ret_type),
-                              expected_ret_ptr_level > 0 ? "*" : "",
-                              type_to_string(stmt->return_stmt.expr->type),
-                              stmt->return_stmt.expr->pointer_level > 0 ? "*" : ""
-                    );
-                }
-            } else {
-                if (expected_ret_type != TYPE_VOID || expected_ret_ptr_level > 0) {
-                    diag_error(analyzer->diagnostics, stmt->location,
-                              "Non-void function must return a value of type '%s%s'",
-                              type_to_string(expected_ret_type),
-                              expected_ret_ptr_level > 0 ? "*" : ""
-                    );
+            if (!object->is_slice && !is_fixed_array(analyzer, object)) {
+                if (object->pointer_level == 0) {
+                    diag_error(analyzer->diagnostics, expr->location, "Cannot slice '%s', only slices, fixed arrays and pointers can be sliced", type_to_string(object->type));
+                } else if (!expr->slice.end) {
+                    diag_error(analyzer->diagnostics, expr->location, "A pointer has no length, slicing it needs an end as in p[start:end]");
                 }
             }
-            return true;
+
+            // a bad object still yields a slice of its type so callers dont report it twice
+            expr->type = object->type;
+            expr->pointer_level = object->pointer_level > 0 ? object->pointer_level : 1;
+            expr->is_slice = true;
+            break;
         }
-        case STMT_IF: {
-            analyze_expression(analyzer, stmt->if_stmt.condition);
+        case EXPR_INIT_LIST: {
+            diag_error(analyzer->diagnostics, expr->location, "Initializer list is only allowed in array, vector and struct declarations");
 
-            if (stmt->if_stmt.condition->type != TYPE_BOOLEAN &&
-                !is_numeric_type(stmt->if_stmt.condition->type)) {
-                diag_warning(analyzer->diagnostics, stmt->location, "If condition should be boolean or numeric. Got '%s'", type_to_string(stmt->if_stmt.condition->type));
+            for (int i = 0; i < expr->init_list.count; i++) {
+                analyze_expression(analyzer, expr->init_list.elements[i]);
             }
 
-            const bool then_returns = analyze_statement(analyzer, stmt->if_stmt.then_stmt, expected_ret_type, expected_ret_ptr_level);
+            expr->type = TYPE_INT;
+            expr->pointer_level = 0;
+            break;
+        }
+    }
+}
 
-            bool else_returns = false;
-            if (stmt->if_stmt.else_stmt) {
-                else_returns = analyze_statement(analyzer, stmt->if_stmt.else_stmt, expected_ret_type, expected_ret_ptr_level);
+static bool is_lvalue(const ExprNode *expr) {
+    switch (expr->kind) {
+        case EXPR_VAR:
+        case EXPR_ARRAY_INDEX: return expr->dim_count == 0;  // rows of a multi-dimensional array are not assignable
+        case EXPR_UNARY: return expr->unary.op == UNARY_DEREF;
+        case EXPR_MEMBER: {
+            // a slice's length and pointer and a string's length are read only, assign a new one instead
+            if (expr->member.object->is_slice || (expr->member.object->type == TYPE_STRING && expr->member.object->pointer_level == 0)) {
+                return false;
             }
 
-            return then_returns && else_returns;
+            // array fields decay to a pointer, like array variables
+            const StructNode *def = struct_type_def(expr->member.object->type);
+            if (def && expr->member.field_index >= 0 && def->fields[expr->member.field_index].array_size > 0) {
+                return false;
+            }
+
+            return expr->member.through_pointer || expr->member.is_soa || is_lvalue(expr->member.object);
         }
-        case STMT_WHILE: {
-            analyze_expression(analyzer, stmt->while_stmt.condition);
+        default: return false;
+    }
+}
 
-            if (stmt->while_stmt.condition->type != TYPE_BOOLEAN && !is_numeric_type(stmt->while_stmt.condition->type)) {
-                diag_warning(analyzer->diagnostics, stmt->location, "While condition should be boolean or numeric");
-            }
+static bool same_expr(const ExprNode *a, const ExprNode *b) {
+    if (!a || !b) return a == b;
+    if (a->kind != b->kind) return false;
+
+    switch (a->kind) {
+        case EXPR_NUMBER:
+        case EXPR_VAR: return strcmp(a->text, b->text) == 0;
+        case EXPR_BINOP: return a->binop.op == b->binop.op && same_expr(a->binop.left, b->binop.left) && same_expr(a->binop.right, b->binop.right);
+        case EXPR_UNARY: return a->unary.op == b->unary.op && same_expr(a->unary.operand, b->unary.operand);
+        case EXPR_CAST: return same_expr(a->cast.operand, b->cast.operand);
+        case EXPR_ARRAY_INDEX: return same_expr(a->array_index.array, b->array_index.array) && same_expr(a->array_index.index, b->array_index.index);
+        case EXPR_MEMBER: return a->member.field_index == b->member.field_index && same_expr(a->member.object, b->member.object);
+        default: return false;
+    }
+}
 
-            Scope *loop_scope = scope_create(analyzer->current_scope, SCOPE_LOOP);
-            Scope *old_scope = analyzer->current_scope;
-            analyzer->current_scope = loop_scope;
+// splits a pointer into the variable it points into and an element offset, nullptr for an offset of 0.
+// a, &a[0], &a[i], p + i, (T*)p and p[i:] are understood, anything else has no base
+static const ExprNode* pointer_base(const ExprNode *expr, const ExprNode **offset) {
+    while (expr->kind == EXPR_CAST) {
+        expr = expr->cast.operand;
+    }
 
-            analyze_statement(analyzer, stmt->while_stmt.body, expected_ret_type, expected_ret_ptr_level);
+    *offset = NULL;
+    const ExprNode *object = NULL;
+    const ExprNode *index = NULL;
 
-            analyzer->current_scope = old_scope;
-            scope_destroy(loop_scope);
+    switch (expr->kind) {
+        case EXPR_VAR: return expr;
+        case EXPR_BINOP: {
+            if (expr->binop.op != BIN_ADD || expr->binop.left->pointer_level == 0) return NULL;
+            object = expr->binop.left;
+            index = expr->binop.right;
+            break;
+        }
+        case EXPR_SLICE: {
+            object = expr->slice.object;
+            index = expr->slice.start;
+            break;
+        }
+        case EXPR_UNARY: {
+            const ExprNode *target = expr->unary.operand;
+            if (expr->unary.op != UNARY_ADDR_OF) return NULL;
+            if (target->kind == EXPR_VAR) return target;
+            if (target->kind != EXPR_ARRAY_INDEX) return NULL;
 
-            return false;
+            object = target->array_index.array;
+            index = target->array_index.index;
+            break;
         }
-        case STMT_FOR: {
-            Scope *loop_scope = scope_create(analyzer->current_scope, SCOPE_LOOP);
-            Scope *old_scope = analyzer->current_scope;
-            analyzer->current_scope = loop_scope;
+        default: return NULL;
+    }
 
-            if (stmt->for_stmt.init) {
-                analyze_statement(analyzer, stmt->for_stmt.init, expected_ret_type, expected_ret_ptr_level);
-            }
+    // p + i + j and friends are left alone
+    const ExprNode *inner_offset = NULL;
+    const ExprNode *base = pointer_base(object, &inner_offset);
+    if (!base || inner_offset) return NULL;
 
-            // condition
-            if (stmt->for_stmt.condition) {
-                analyze_expression(analyzer, stmt->for_stmt.condition);
-                if (stmt->for_stmt.condition->type != TYPE_BOOLEAN && !is_numeric_type(stmt->for_stmt.condition->type)) {
-                    diag_warning(analyzer->diagnostics, stmt->location, "For condition should be boolean or numeric");
-                }
-            }
+    const bool is_zero = index && index->kind == EXPR_NUMBER && strcmp(index->text, "0") == 0;
+    *offset = is_zero ? NULL : index;
+    return base;
+}
 
-            // increment
-            if (stmt->for_stmt.increment) {
-                analyze_expression(analyzer, stmt->for_stmt.increment);
-            }
+// the name of the variable two pointer arguments both point at, when they point at the same element of it
+static const char* same_address(const ExprNode *a, const ExprNode *b) {
+    const ExprNode *a_offset = NULL;
+    const ExprNode *b_offset = NULL;
+    const ExprNode *a_base = pointer_base(a, &a_offset);
+    const ExprNode *b_base = pointer_base(b, &b_offset);
 
-            // body
-            analyze_statement(analyzer, stmt->for_stmt.body, expected_ret_type, expected_ret_ptr_level);
+    if (!a_base || !b_base || a->pointer_level != b->pointer_level) return NULL;
+    if (strcmp(a_base->text, b_base->text) != 0 || !same_expr(a_offset, b_offset)) return NULL;
+    return a_base->text;
+}
 
-            analyzer->current_scope = old_scope;
-            scope_destroy(loop_scope);
+static bool reject_aggregate(SemanticAnalyzer *analyzer, const ExprNode *expr) {
+    if (expr->is_slice) {
+        diag_error(analyzer->diagnostics, expr->location, "Slices only support indexing, slicing, '.len' and '.ptr'");
+        return true;
+    }
 
-            return false;
-        }
-        case STMT_BREAK:
-        case STMT_CONTINUE: {
-            if (!scope_in_loop(analyzer->current_scope)) {
-                diag_error(analyzer->diagnostics, stmt->location, "'%s' statement can only be used inside a loop", stmt->kind == STMT_BREAK ? "break" : "continue");
-            }
-            return false;
-        }
-        case STMT_ASM: {
-            for (int i = 0; i < stmt->asm_stmt.output_count; i++) {
-                analyze_expression(analyzer, stmt->asm_stmt.outputs[i]);
-            }
+    if (expr->dim_count > 1) {
+        diag_error(analyzer->diagnostics, expr->location, "Multi-dimensional arrays only support indexing and being passed to a parameter with the same inner extents");
+        return true;
+    }
 
-            for (int i = 0; i < stmt->asm_stmt.input_count; i++) {
-                analyze_expression(analyzer, stmt->asm_stmt.inputs[i]);
-            }
+    return false;
+}
 
-            return false;
-        }
-        case STMT_VAR_DECL: {
-            if (stmt->var_decl.type == TYPE_VOID && stmt->var_decl.pointer_level == 0) {
-                diag_error(analyzer->diagnostics, stmt->location,
-                          "Variable '%s' declared as void. Variables cannot be void (did you mean 'void*'?)",
-                          stmt->var_decl.name);
-            }
+// [H][W], with [] for an outer extent that was left out
+static void format_dims(char *buffer, const size_t size, const int *dims, const int dim_count) {
+    size_t length = 0;
+    buffer[0] = '\0';
 
-            // check if variable already exists in current scope
-            const Symbol *existing = scope_lookup(analyzer->current_scope, stmt->var_decl.name);
-            if (existing) {
-                diag_error(analyzer->diagnostics, stmt->location,
-                          "Variable '%s' already declared in this scope (previous declaration at line %d)",
-                          stmt->var_decl.name, existing->location.line);
-            }
+    for (int i = 0; i < dim_count && length < size; i++) {
+        length += dims[i] > 0 ? snprintf(buffer + length, size - length, "[%d]", dims[i]) : snprintf(buffer + length, size - length, "[]");
+    }
+}
 
-            Symbol *sym = malloc(sizeof(Symbol));
-            sym->name = strdup(stmt->var_decl.name);
-            sym->kind = SYM_VARIABLE;
-            sym->type = stmt->var_decl.type;
-            sym->is_const = stmt->var_decl.is_const;
+// a multi-dimensional array only goes to a parameter pointing at the same rows, one of its rows decays to a pointer
+static bool reject_dims_mismatch(SemanticAnalyzer *analyzer, const ExprNode *value, const int *dims, const int dim_count) {
+    bool matches = value->dim_count == dim_count;
+    for (int i = 1; matches && i < dim_count; i++) {
+        matches = value->dims[i] == dims[i];
+    }
 
-            if (stmt->var_decl.array_size > 0) {
-                sym->pointer_level = stmt->var_decl.pointer_level + 1;
-            } else {
-                sym->pointer_level = stmt->var_decl.pointer_level;
-            }
+    if (matches || (dim_count == 0 && value->dim_count < 2)) return false;
 
-            sym->location = stmt->location;
+    if (dim_count == 0) {
+        diag_error(analyzer->diagnostics, value->location, "Multi-dimensional arrays only decay to a pointer one row at a time, index it first");
+        return true;
+    }
+
+    char expected[128];
+    char actual[128] = "*";
+    format_dims(expected, sizeof(expected), dims, dim_count);
+    if (value->dim_count > 0) format_dims(actual, sizeof(actual), value->dims, value->dim_count);
+
+    diag_error(analyzer->diagnostics, value->location, "Expected '%s%s', got '%s%s'. Arrays only convert to a pointer to their rows when the inner extents match",
+              type_to_string(value->type), expected, type_to_string(value->type), actual);
+    return true;
+}
+
+// an integer literal initializing an integer variable has to fit its width. the bit pattern is what counts, so
+// uint x = -1 and int mask = 0xFFFFFFFF are fine, but byte b = 300 and ulong m = 0x1FFFFFFFFFFFFFFFF are not
+static void reject_constant_overflow(SemanticAnalyzer *analyzer, const ExprNode *value, const TypeKind type, const int pointer_level) {
+    if (pointer_level > 0 || !is_integer_type(type)) return;
+
+    const bool negate = value->kind == EXPR_UNARY && value->unary.op == UNARY_NEG;
+    const ExprNode *number = negate ? value->unary.operand : value;
+    if (number->kind != EXPR_NUMBER || strchr(number->text, '.')) return;
+
+    const int bits = integer_type_bits(type);
+    const unsigned long long magnitude = strtoull(number->text, NULL, 10);
+    const unsigned long long limit = negate ? 1ULL << (bits - 1) : (bits == 64 ? UINT64_MAX : (1ULL << bits) - 1);
+
+    if (magnitude > limit) {
+        diag_error(analyzer->diagnostics, value->location, "Constant '%s%s' does not fit in '%s'", negate ? "-" : "", number->text, type_to_string(type));
+    }
+}
+
+// arrays whose length is known here, they convert to slices of the whole array
+static bool is_fixed_array(const SemanticAnalyzer *analyzer, const ExprNode *expr) {
+    // the last row of a multi-dimensional array
+    if (expr->dim_count == 1) return expr->dims[0] > 0;
+    if (expr->dim_count > 1) return false;
+
+    if (expr->kind == EXPR_VAR) {
+        const Symbol *sym = scope_lookup_recursive(analyzer->current_scope, expr->text);
+        return sym && sym->array_size > 0 && !sym->is_soa;
+    }
+
+    if (expr->kind == EXPR_MEMBER && !expr->member.object->is_slice) {
+        const StructNode *def = struct_type_def(expr->member.object->type);
+        return def && expr->member.field_index >= 0 && def->fields[expr->member.field_index].array_size > 0;
+    }
+
+    return false;
+}
+
+// checks a value going into a slice, or a slice going anywhere else. fixed arrays are wrapped in a[:] so codegen
+// only ever sees slices where slices are expected. false when neither side is a slice, the caller checks those
+static bool coerce_to_slice(SemanticAnalyzer *analyzer, ExprNode **slot, const bool target_is_slice, const TypeKind type, const int pointer_level) {
+    ExprNode *value = *slot;
+    if (!target_is_slice && !value->is_slice) {
+        return false;
+    }
+
+    if (!target_is_slice) {
+        diag_error(analyzer->diagnostics, value->location, "Expected '%s%s', got a slice. Use '.ptr' for its pointer",
+                  type_to_string(type), pointer_level > 0 ? "*" : "");
+        return true;
+    }
+
+    const bool is_array = !value->is_slice && is_fixed_array(analyzer, value);
+    if (!value->is_slice && !is_array) {
+        diag_error(analyzer->diagnostics, value->location, "Expected a '%s[]' slice, got '%s%s'. Only fixed arrays convert to slices, use p[start:end] for a pointer",
+                  type_to_string(type), type_to_string(value->type), value->pointer_level > 0 ? "*" : "");
+        return true;
+    }
+
+    if (value->type != type || value->pointer_level != pointer_level) {
+        diag_error(analyzer->diagnostics, value->location, "Expected a '%s[]' slice, got '%s[]'", type_to_string(type), type_to_string(value->type));
+        return true;
+    }
+
+    if (is_array) {
+        ExprNode *whole = malloc(sizeof(ExprNode));
+        whole->kind = EXPR_SLICE;
+        whole->location = value->location;
+        whole->type = value->type;
+        whole->pointer_level = value->pointer_level;
+        whole->is_slice = true;
+        whole->dims = NULL;
+        whole->dim_count = 0;
+        whole->slice.object = value;
+        whole->slice.start = NULL;
+        whole->slice.end = NULL;
+        *slot = whole;
+    }
+
+    return true;
+}
+
+// string values point just past a counted header, so a char* from C is copied into a string where one is
+// expected, and a string used as a char* keeps a reference for as long as the char* may live. both are made
+// explicit casts for codegen
+static void coerce_string(ExprNode **slot, const TypeKind type, const int pointer_level) {
+    ExprNode *value = *slot;
+    const bool to_string = type == TYPE_STRING && pointer_level == 0 && value->type == TYPE_CHAR && value->pointer_level == 1;
+    const bool to_chars = type == TYPE_CHAR && pointer_level == 1 && value->type == TYPE_STRING && value->pointer_level == 0 && !value->is_slice;
+    if (!to_string && !to_chars) {
+        return;
+    }
+
+    ExprNode *cast = malloc(sizeof(ExprNode));
+    cast->kind = EXPR_CAST;
+    cast->location = value->location;
+    cast->type = type;
+    cast->pointer_level = pointer_level;
+    cast->is_slice = false;
+    cast->dims = NULL;
+    cast->dim_count = 0;
+    cast->cast.target_type = type;
+    cast->cast.target_pointer_level = pointer_level;
+    cast->cast.operand = value;
+    *slot = cast;
+}
+
+// 2.0 is a double, but next to a float (or float vector) it is a float so float code stays single precision
+static void match_float_literal(ExprNode *literal, const ExprNode *other) {
+    if (other->pointer_level > 0 || vector_element_type(other->type) != TYPE_FLOAT) return;
+
+    ExprNode *number = literal;
+    if (number->kind == EXPR_UNARY && number->unary.op == UNARY_NEG) {
+        number = number->unary.operand;
+    }
+    if (number->kind != EXPR_NUMBER || number->type != TYPE_DOUBLE) return;
+
+    number->type = TYPE_FLOAT;
+    literal->type = TYPE_FLOAT;
+}
+
+// 's = s + a + b' is 's += a + b', which codegen can turn into an append to s instead of a copy of all of it.
+// concatenation is associative, so the pieces after s are joined first
+static void fold_self_append(ExprNode *expr) {
+    const ExprNode *target = expr->binop.left;
+    if (target->kind != EXPR_VAR || target->type != TYPE_STRING || target->pointer_level != 0 || target->is_slice) {
+        return;
+    }
+
+    // walk down the left operands to the concatenation that starts with s
+    ExprNode **slot = &expr->binop.right;
+    while ((*slot)->kind == EXPR_BINOP && (*slot)->binop.op == BIN_ADD && (*slot)->type == TYPE_STRING) {
+        const ExprNode *left = (*slot)->binop.left;
+        if (left->kind == EXPR_VAR && strcmp(left->text, target->text) == 0) {
+            *slot = (*slot)->binop.right;
+            expr->binop.op = BIN_ADD_ASSIGN;
+            return;
+        }
+
+        slot = &(*slot)->binop.left;
+    }
+}
+
+// infers the type arguments a call doesnt spell out and returns the instance it should call, generating it on first use
+static Symbol* instantiate_generic(SemanticAnalyzer *analyzer, ExprNode *expr, const Symbol *func_sym) {
+    const FunctionNode *generic = func_sym->generic;
+    TypeArg args[MAX_TYPE_PARAMS];
+    bool bound[MAX_TYPE_PARAMS] = {false};
+
+    if (expr->call.type_arg_count > 0) {
+        if (expr->call.type_arg_count != generic->type_param_count) {
+            diag_error(analyzer->diagnostics, expr->location, "'%s' takes %d type arguments, got %d",
+                      generic->name, generic->type_param_count, expr->call.type_arg_count);
+            return NULL;
+        }
+
+        for (int i = 0; i < generic->type_param_count; i++) {
+            args[i] = expr->call.type_args[i];
+            bound[i] = true;
+        }
+    }
+
+    bool failed = false;
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        ExprNode *arg = expr->call.args[i];
+        analyze_expression(analyzer, arg);
+
+        const ParamNode *param = &generic->params[i];
+        if (expr->call.type_arg_count > 0 || !is_type_param(param->type)) continue;
+
+        // T* given an int** binds T to int*
+        const int index = param->type - TYPE_PARAM;
+        const TypeArg inferred = { arg->type, arg->pointer_level - param->pointer_level };
+
+        if (inferred.pointer_level < 0 || (arg->is_slice && !param->is_slice)) {
+            diag_error(analyzer->diagnostics, arg->location, "Cannot infer '%s' of '%s' from a '%s%s%s' argument",
+                      generic->type_params[index], generic->name, type_to_string(arg->type),
+                      arg->is_slice ? "[]" : "", arg->pointer_level > (arg->is_slice ? 1 : 0) ? "*" : "");
+            failed = true;
+            continue;
+        }
+
+        if (bound[index] && (args[index].type != inferred.type || args[index].pointer_level != inferred.pointer_level)) {
+            diag_error(analyzer->diagnostics, arg->location, "'%s' of '%s' is inferred as both '%s%s' and '%s%s', pass it explicitly as %s<...>(...)",
+                      generic->type_params[index], generic->name,
+                      type_to_string(args[index].type), args[index].pointer_level > 0 ? "*" : "",
+                      type_to_string(inferred.type), inferred.pointer_level > 0 ? "*" : "",
+                      generic->name);
+            failed = true;
+            continue;
+        }
+
+        args[index] = inferred;
+        bound[index] = true;
+    }
+
+    for (int i = 0; i < generic->type_param_count && !failed; i++) {
+        if (!bound[i]) {
+            diag_error(analyzer->diagnostics, expr->location, "Cannot infer '%s' of '%s', pass it explicitly as %s<...>(...)",
+                      generic->type_params[i], generic->name, generic->name);
+            failed = true;
+        } else if (args[i].type == TYPE_VOID && args[i].pointer_level == 0) {
+            diag_error(analyzer->diagnostics, expr->location, "'%s' of '%s' cannot be 'void'", generic->type_params[i], generic->name);
+            failed = true;
+        } else if (args[i].pointer_level > MAX_GENERIC_POINTER_LEVEL) {
+            diag_error(analyzer->diagnostics, expr->location, "Instantiating '%s' does not terminate, '%s' keeps growing",
+                      generic->name, generic->type_params[i]);
+            failed = true;
+        }
+    }
+
+    if (failed) return NULL;
+
+    // the name is unique per (function, type arguments) so the global scope doubles as the instantiation cache
+    char *name = generic_instance_name(generic->name, args, generic->type_param_count);
+    Symbol *instance = scope_lookup(analyzer->global_scope, name);
+
+    if (!instance) {
+        FunctionNode *func = generic_instantiate(generic, args, name);
+
+        ProgramNode *program = analyzer->program;
+        program->functions = realloc(program->functions, sizeof(FunctionNode*) * (program->function_count + 1));
+        program->functions[program->function_count++] = func;
+
+        instance = declare_function(analyzer->global_scope, func);
+    }
+
+    free(expr->call.function_name);
+    expr->call.function_name = name;
+    return instance;
+}
+
+static void analyze_struct(SemanticAnalyzer *analyzer, const StructNode *def, const TypeKind type) {
+    if (def->field_count == 0) {
+        diag_error(analyzer->diagnostics, def->location, "Struct '%s' has no fields", def->name);
+    }
+
+    for (int i = 0; i < def->field_count; i++) {
+        const FieldNode *field = &def->fields[i];
+
+        if (struct_field_index(def, field->name) != i) {
+            diag_error(analyzer->diagnostics, field->location, "Field '%s' already declared in struct '%s'", field->name, def->name);
+        }
+
+        if (field->type == TYPE_VOID && field->pointer_level == 0) {
+            diag_error(analyzer->diagnostics, field->location, "Field '%s' declared as void", field->name);
+        }
+
+        if (field->type == type && field->pointer_level == 0) {
+            diag_error(analyzer->diagnostics, field->location, "Struct '%s' cannot contain itself, did you mean '%s*'?", def->name, def->name);
+        }
+    }
+}
+
+// s.field, p->field and soa[i].field
+static void analyze_member(SemanticAnalyzer *analyzer, ExprNode *expr) {
+    ExprNode *object = expr->member.object;
+    expr->type = TYPE_INT;
+    expr->pointer_level = 0;
+
+    // an element of a soa array has no storage of its own, only the index is evaluated
+    const Symbol *soa_sym = NULL;
+    if (!expr->member.through_pointer && object->kind == EXPR_ARRAY_INDEX && object->array_index.array->kind == EXPR_VAR) {
+        const Symbol *sym = scope_lookup_recursive(analyzer->current_scope, object->array_index.array->text);
+        if (sym && sym->is_soa) {
+            soa_sym = sym;
+        }
+    }
+
+    if (soa_sym) {
+        analyze_expression(analyzer, object->array_index.index);
+        if (!is_integer_type(object->array_index.index->type) || object->array_index.index->pointer_level > 0) {
+            diag_error(analyzer->diagnostics, object->location, "Array index must be an integer type, got '%s'", type_to_string(object->array_index.index->type));
+        }
+
+        object->array_index.array->type = soa_sym->type;
+        object->array_index.array->pointer_level = soa_sym->pointer_level;
+        object->type = soa_sym->type;
+        object->pointer_level = 0;
+        expr->member.is_soa = true;
+    } else {
+        analyze_expression(analyzer, object);
+    }
+
+    // the length is kept in the string's header
+    if (object->type == TYPE_STRING && object->pointer_level == 0 && !expr->member.through_pointer) {
+        if (strcmp(expr->member.field_name, "len") != 0) {
+            diag_error(analyzer->diagnostics, expr->location, "Strings only have 'len', not '%s'", expr->member.field_name);
+        }
+
+        expr->member.field_index = 0;
+        expr->type = TYPE_LONG;
+        return;
+    }
+
+    if (object->is_slice && !expr->member.through_pointer) {
+        if (strcmp(expr->member.field_name, "len") == 0) {
+            expr->member.field_index = 1;
+            expr->type = TYPE_LONG;
+        } else if (strcmp(expr->member.field_name, "ptr") == 0) {
+            expr->member.field_index = 0;
+            expr->type = object->type;
+            expr->pointer_level = object->pointer_level;
+        } else {
+            diag_error(analyzer->diagnostics, expr->location, "Slices only have 'len' and 'ptr', not '%s'", expr->member.field_name);
+        }
+        return;
+    }
+
+    const int expected_pointer_level = expr->member.through_pointer ? 1 : 0;
+    if (!is_struct_type(object->type) || object->pointer_level != expected_pointer_level) {
+        if (is_struct_type(object->type) && object->pointer_level == 1) {
+            diag_error(analyzer->diagnostics, expr->location, "'%s*' is a pointer, use '->' to access field '%s'", type_to_string(object->type), expr->member.field_name);
+        } else if (is_struct_type(object->type) && object->pointer_level == 0) {
+            diag_error(analyzer->diagnostics, expr->location, "'%s' is not a pointer, use '.' to access field '%s'", type_to_string(object->type), expr->member.field_name);
+        } else {
+            diag_error(analyzer->diagnostics, expr->location, "Cannot access field '%s' of non-struct type '%s%s'",
+                      expr->member.field_name, type_to_string(object->type), object->pointer_level > 0 ? "*" : "");
+        }
+        return;
+    }
+
+    const StructNode *def = struct_type_def(object->type);
+    const int index = struct_field_index(def, expr->member.field_name);
+    if (index < 0) {
+        diag_error(analyzer->diagnostics, expr->location, "Struct '%s' has no field '%s'", def->name, expr->member.field_name);
+        return;
+    }
+
+    const FieldNode *field = &def->fields[index];
+    expr->member.field_index = index;
+    expr->type = field->type;
+    expr->pointer_level = field->array_size > 0 ? field->pointer_level + 1 : field->pointer_level;
+}
+
+static bool is_constant_initializer(const ExprNode *expr) {
+    if (expr->kind == EXPR_NUMBER || expr->kind == EXPR_STRING_LITERAL) {
+        return true;
+    }
+
+    return expr->kind == EXPR_UNARY && expr->unary.op == UNARY_NEG && expr->unary.operand->kind == EXPR_NUMBER;
+}
+
+static bool expect_vector_arg(SemanticAnalyzer *analyzer, const ExprNode *call, const ExprNode *arg, const int pointer_level) {
+    if (!is_vector_type(arg->type) || arg->pointer_level != pointer_level) {
+        diag_error(analyzer->diagnostics, arg->location, "'%s' expects a vector%s argument, got '%s%s'",
+                  call->call.function_name, pointer_level > 0 ? " pointer" : "",
+                  type_to_string(arg->type), arg->pointer_level > 0 ? "*" : "");
+        return false;
+    }
+
+    return true;
+}
+
+static bool expect_integer_arg(SemanticAnalyzer *analyzer, const ExprNode *call, const ExprNode *arg) {
+    if (!is_integer_type(arg->type) || arg->pointer_level != 0) {
+        diag_error(analyzer->diagnostics, arg->location, "'%s' expects an integer argument, got '%s%s'",
+                  call->call.function_name, type_to_string(arg->type), arg->pointer_level > 0 ? "*" : "");
+        return false;
+    }
+
+    return true;
+}
+
+// memory orders are the constants 0 to 4, relaxed, acquire, release, acq_rel and seq_cst, named in stdlib.hp
+static void check_memory_order(SemanticAnalyzer *analyzer, const ExprNode *call, const ExprNode *order) {
+    if (order->kind != EXPR_NUMBER || atoi(order->text) < 0 || atoi(order->text) > 4) {
+        diag_error(analyzer->diagnostics, order->location, "'%s' memory order must be a constant from 0 (relaxed) to 4 (seq_cst)", call->call.function_name);
+        return;
+    }
+
+    const int value = atoi(order->text);
+    const IntrinsicKind kind = call->call.intrinsic;
+    if ((kind == INTRINSIC_ATOMIC_LOAD && (value == 2 || value == 3)) ||
+        (kind == INTRINSIC_ATOMIC_STORE && (value == 1 || value == 3)) ||
+        (kind == INTRINSIC_FENCE && value == 0)) {
+        static const char *names[] = {"relaxed", "acquire", "release", "acq_rel", "seq_cst"};
+        diag_error(analyzer->diagnostics, order->location, "'%s' cannot use the %s memory order", call->call.function_name, names[value]);
+    }
+}
+
+// returns false when the name is not an intrinsic, so the caller reports an undefined function
+static bool analyze_intrinsic_call(SemanticAnalyzer *analyzer, ExprNode *expr) {
+    const IntrinsicKind kind = lookup_intrinsic(expr->call.function_name);
+    if (kind == INTRINSIC_NONE) {
+        return false;
+    }
+
+    expr->call.intrinsic = kind;
+    expr->type = TYPE_VOID;
+    expr->pointer_level = 0;
+
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        // spawn's first argument names a function rather than being a value
+        if (kind == INTRINSIC_SPAWN && i == 0) continue;
+        analyze_expression(analyzer, expr->call.args[i]);
+        if (reject_aggregate(analyzer, expr->call.args[i])) return true;
+    }
+
+    ExprNode **args = expr->call.args;
+    const int count = expr->call.arg_count;
+
+    // atomics take an optional memory order as their last argument
+    int expected = 1;
+    int optional = 0;
+    switch (kind) {
+        case INTRINSIC_SELECT: expected = 3; break;
+        case INTRINSIC_VSTORE:
+        case INTRINSIC_VSTORE_ALIGNED:
+        case INTRINSIC_ROTL:
+        case INTRINSIC_ROTR: expected = 2; break;
+        case INTRINSIC_ADD_OVERFLOW:
+        case INTRINSIC_SUB_OVERFLOW:
+        case INTRINSIC_MUL_OVERFLOW: expected = 3; break;
+        case INTRINSIC_SPAWN:
+        case INTRINSIC_ATOMIC_LOAD: optional = 1; break;
+        case INTRINSIC_ATOMIC_STORE:
+        case INTRINSIC_ATOMIC_ADD:
+        case INTRINSIC_ATOMIC_SUB:
+        case INTRINSIC_ATOMIC_EXCHANGE: expected = 2; optional = 1; break;
+        case INTRINSIC_CAS: expected = 3; optional = 1; break;
+        case INTRINSIC_FENCE: expected = 0; optional = 1; break;
+        default: break;
+    }
+
+    if (kind != INTRINSIC_SHUFFLE && (count < expected || count > expected + optional)) {
+        diag_error(analyzer->diagnostics, expr->location, "'%s' has incorrect number of parameters", expr->call.function_name);
+        return true;
+    }
+
+    switch (kind) {
+        case INTRINSIC_SHUFFLE: {
+            // shuffle(v, lanes...) or shuffle(a, b, lanes...) where b's lanes follow a's
+            if (count < 1 || !expect_vector_arg(analyzer, expr, args[0], 0)) {
+                return true;
+            }
+
+            const TypeKind vec_type = args[0]->type;
+            const int lanes = vector_lane_count(vec_type);
+            const int sources = (count > 1 && args[1]->type == vec_type && args[1]->pointer_level == 0) ? 2 : 1;
+
+            if (count - sources != lanes) {
+                diag_error(analyzer->diagnostics, expr->location, "'shuffle' of '%s' needs %d lane indices, got %d",
+                          type_to_string(vec_type), lanes, count - sources);
+                return true;
+            }
+
+            for (int i = sources; i < count; i++) {
+                if (args[i]->kind != EXPR_NUMBER || atoi(args[i]->text) >= lanes * sources) {
+                    diag_error(analyzer->diagnostics, args[i]->location, "'shuffle' lane index must be a constant below %d", lanes * sources);
+                }
+            }
+
+            expr->type = vec_type;
+            return true;
+        }
+        case INTRINSIC_SELECT: {
+            // select(mask, a, b) takes a where the mask lane is set, b elsewhere
+            if (!expect_vector_arg(analyzer, expr, args[0], 0) || !expect_vector_arg(analyzer, expr, args[1], 0)) {
+                return true;
+            }
+
+            if (!is_integer_type(vector_element_type(args[0]->type)) || vector_lane_count(args[0]->type) != vector_lane_count(args[1]->type)) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'select' mask must be an int vector with the same lane count as '%s'", type_to_string(args[1]->type));
+            }
+
+            if (!types_compatible_with_pointers(args[1]->type, 0, args[2]->type, args[2]->pointer_level)) {
+                diag_error(analyzer->diagnostics, args[2]->location, "'select' operands must match. Got '%s' and '%s'",
+                          type_to_string(args[1]->type), type_to_string(args[2]->type));
+            }
+
+            expr->type = args[1]->type;
+            return true;
+        }
+        case INTRINSIC_HSUM:
+        case INTRINSIC_HMIN:
+        case INTRINSIC_HMAX: {
+            if (expect_vector_arg(analyzer, expr, args[0], 0)) {
+                expr->type = vector_element_type(args[0]->type);
+            }
+            return true;
+        }
+        case INTRINSIC_VLOAD:
+        case INTRINSIC_VLOAD_ALIGNED: {
+            if (expect_vector_arg(analyzer, expr, args[0], 1)) {
+                expr->type = args[0]->type;
+            }
+            return true;
+        }
+        case INTRINSIC_VSTORE:
+        case INTRINSIC_VSTORE_ALIGNED: {
+            if (expect_vector_arg(analyzer, expr, args[0], 1) &&
+                !types_compatible_with_pointers(args[0]->type, 0, args[1]->type, args[1]->pointer_level)) {
+                diag_error(analyzer->diagnostics, args[1]->location, "'%s' cannot store '%s' through a '%s*'",
+                          expr->call.function_name, type_to_string(args[1]->type), type_to_string(args[0]->type));
+            }
+            return true;
+        }
+        case INTRINSIC_LIKELY:
+        case INTRINSIC_UNLIKELY: {
+            // likely(cond) is cond, with a hint about which way it usually goes
+            if (args[0]->pointer_level != 0 || (args[0]->type != TYPE_BOOLEAN && !is_integer_type(args[0]->type))) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'%s' expects a bool or integer condition, got '%s%s'",
+                          expr->call.function_name, type_to_string(args[0]->type), args[0]->pointer_level > 0 ? "*" : "");
+            }
+
+            expr->type = TYPE_BOOLEAN;
+            return true;
+        }
+        case INTRINSIC_POPCOUNT:
+        case INTRINSIC_CLZ:
+        case INTRINSIC_CTZ:
+        case INTRINSIC_BSWAP:
+        case INTRINSIC_ROTL:
+        case INTRINSIC_ROTR: {
+            for (int i = 0; i < count; i++) {
+                expect_integer_arg(analyzer, expr, args[i]);
+            }
+
+            if (kind == INTRINSIC_BSWAP && (args[0]->type == TYPE_CHAR || args[0]->type == TYPE_BYTE)) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'bswap' needs an integer wider than a byte, got '%s'", type_to_string(args[0]->type));
+            }
+
+            // the result has the width of the operand, the rotate amount is taken modulo that width
+            expr->type = args[0]->type;
+            return true;
+        }
+        case INTRINSIC_ADD_OVERFLOW:
+        case INTRINSIC_SUB_OVERFLOW:
+        case INTRINSIC_MUL_OVERFLOW: {
+            // add_overflow(a, b, &result) stores the wrapped result and returns whether it overflowed
+            expect_integer_arg(analyzer, expr, args[0]);
+            expect_integer_arg(analyzer, expr, args[1]);
+
+            if (args[2]->pointer_level != 1 || !is_integer_type(args[2]->type)) {
+                diag_error(analyzer->diagnostics, args[2]->location, "'%s' expects an integer pointer for the result, got '%s%s'",
+                          expr->call.function_name, type_to_string(args[2]->type), args[2]->pointer_level > 0 ? "*" : "");
+            }
+
+            expr->type = TYPE_BOOLEAN;
+            return true;
+        }
+        case INTRINSIC_SPAWN: {
+            // spawn(f) or spawn(f, arg) runs f on a new thread and returns the handle to join
+            expr->type = TYPE_LONG;
+
+            const Symbol *target = args[0]->kind == EXPR_VAR ? scope_lookup_recursive(analyzer->current_scope, args[0]->text) : NULL;
+            if (!target || target->kind != SYM_FUNCTION) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'spawn' expects the name of a function");
+                return true;
+            }
+
+            if (target->parameters.length != count - 1) {
+                diag_error(analyzer->diagnostics, expr->location, "'spawn' target '%s' takes %d parameters, spawn passes %d",
+                          target->name, target->parameters.length, count - 1);
+                return true;
+            }
+
+            if (count == 2) {
+                const Symbol *param = *(const Symbol**)vector_get(&target->parameters, 0);
+                if (param->pointer_level == 0 && !is_integer_type(param->type)) {
+                    diag_error(analyzer->diagnostics, args[1]->location, "'spawn' can only pass an integer or a pointer to '%s'", target->name);
+                } else if (!types_compatible_with_pointers(param->type, param->pointer_level, args[1]->type, args[1]->pointer_level)) {
+                    diag_error(analyzer->diagnostics, args[1]->location, "'spawn' argument does not match '%s'. Expected '%s%s', got '%s%s'",
+                              target->name, type_to_string(param->type), param->pointer_level > 0 ? "*" : "",
+                              type_to_string(args[1]->type), args[1]->pointer_level > 0 ? "*" : "");
+                }
+            }
+
+            if (is_struct_type(target->type) && target->pointer_level == 0) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'spawn' target '%s' cannot return a struct", target->name);
+            }
+            return true;
+        }
+        case INTRINSIC_ATOMIC_LOAD:
+        case INTRINSIC_ATOMIC_STORE:
+        case INTRINSIC_ATOMIC_ADD:
+        case INTRINSIC_ATOMIC_SUB:
+        case INTRINSIC_ATOMIC_EXCHANGE:
+        case INTRINSIC_CAS: {
+            if (args[0]->pointer_level != 1 || !is_integer_type(args[0]->type)) {
+                diag_error(analyzer->diagnostics, args[0]->location, "'%s' expects a pointer to an integer, got '%s%s'",
+                          expr->call.function_name, type_to_string(args[0]->type), args[0]->pointer_level > 0 ? "*" : "");
+                return true;
+            }
+
+            for (int i = 1; i < expected; i++) {
+                expect_integer_arg(analyzer, expr, args[i]);
+            }
+
+            if (count > expected) {
+                check_memory_order(analyzer, expr, args[expected]);
+            }
+
+            // the read-modify-writes return the value that was there before
+            switch (kind) {
+                case INTRINSIC_ATOMIC_STORE: expr->type = TYPE_VOID; break;
+                case INTRINSIC_CAS: expr->type = TYPE_BOOLEAN; break;
+                default: expr->type = args[0]->type; break;
+            }
+            return true;
+        }
+        case INTRINSIC_FENCE: {
+            if (count > 0) {
+                check_memory_order(analyzer, expr, args[0]);
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+// {a, b, c, d} for a vector, missing lanes are zero
+static void analyze_vector_initializer(SemanticAnalyzer *analyzer, const char *name, const TypeKind type, ExprNode *init, const bool is_global) {
+    const int lanes = vector_lane_count(type);
+
+    if (init->init_list.count > lanes) {
+        diag_error(analyzer->diagnostics, init->location,
+                  "Too many initializers for vector '%s' (got %d, %s has %d lanes)",
+                  name, init->init_list.count, type_to_string(type), lanes);
+    }
+
+    for (int i = 0; i < init->init_list.count; i++) {
+        ExprNode *element = init->init_list.elements[i];
+        analyze_expression(analyzer, element);
+
+        if (!is_numeric_type(element->type) || element->pointer_level > 0) {
+            diag_error(analyzer->diagnostics, element->location,
+                      "Type mismatch in initializer element %d of '%s'. Expected '%s', got '%s'",
+                      i + 1, name, type_to_string(vector_element_type(type)), type_to_string(element->type));
+        }
+
+        if (is_global && !is_constant_initializer(element)) {
+            diag_error(analyzer->diagnostics, element->location, "Initializer element %d of global vector '%s' is not a constant", i + 1, name);
+        }
+    }
+
+    init->type = type;
+    init->pointer_level = 0;
+}
+
+// element-wise ops on simd vectors. a scalar operand is splat across the lanes
+static void analyze_vector_binop(SemanticAnalyzer *analyzer, ExprNode *expr) {
+    const ExprNode *left = expr->binop.left;
+    const ExprNode *right = expr->binop.right;
+    const TypeKind vec_type = is_vector_type(left->type) ? left->type : right->type;
+
+    expr->type = vec_type;
+    expr->pointer_level = 0;
+
+    const bool left_ok = left->pointer_level == 0 && (left->type == vec_type || is_numeric_type(left->type));
+    const bool right_ok = right->pointer_level == 0 && (right->type == vec_type || is_numeric_type(right->type));
+    if (!left_ok || !right_ok) {
+        diag_error(analyzer->diagnostics, expr->location,
+                  "Vector operator requires matching vector types or a scalar. Got '%s' and '%s'",
+                  type_to_string(left->type), type_to_string(right->type));
+        return;
+    }
+
+    if (is_logical_op(expr->binop.op)) {
+        diag_error(analyzer->diagnostics, expr->location, "Logical operators are not defined for '%s', use '&' and '|' on masks", type_to_string(vec_type));
+        return;
+    }
+
+    if (is_bitwise_op(expr->binop.op) && !is_integer_type(vector_element_type(vec_type))) {
+        diag_error(analyzer->diagnostics, expr->location, "Bitwise operator requires an integer vector, got '%s'", type_to_string(vec_type));
+        return;
+    }
+
+    if (is_comparison_op(expr->binop.op)) {
+        expr->type = vector_mask_type(vec_type);
+    }
+}
+
+// {a, b, c} for a struct fills the fields in declaration order, missing fields are zero
+static void analyze_struct_initializer(SemanticAnalyzer *analyzer, const char *name, const TypeKind type, ExprNode *init, const bool is_global) {
+    const StructNode *def = struct_type_def(type);
+
+    if (init->init_list.count > def->field_count) {
+        diag_error(analyzer->diagnostics, init->location,
+                  "Too many initializers for struct '%s' (got %d, %s has %d fields)",
+                  name, init->init_list.count, def->name, def->field_count);
+    }
+
+    for (int i = 0; i < init->init_list.count; i++) {
+        ExprNode *element = init->init_list.elements[i];
+        analyze_expression(analyzer, element);
+
+        if (i >= def->field_count) continue;
+
+        const FieldNode *field = &def->fields[i];
+        if (field->array_size > 0) {
+            diag_error(analyzer->diagnostics, element->location, "Array field '%s' of '%s' cannot be set from an initializer list", field->name, name);
+            continue;
+        }
+
+        if (!types_compatible_with_pointers(field->type, field->pointer_level, element->type, element->pointer_level)) {
+            diag_error(analyzer->diagnostics, element->location,
+                      "Type mismatch in initializer of field '%s'. Expected '%s%s', got '%s%s'",
+                      field->name,
+                      type_to_string(field->type),
+                      field->pointer_level > 0 ? "*" : "",
+                      type_to_string(element->type),
+                      element->pointer_level > 0 ? "*" : ""
+            );
+        }
+
+        if (is_global && !is_constant_initializer(element)) {
+            diag_error(analyzer->diagnostics, element->location, "Initializer of field '%s' in global '%s' is not a constant", field->name, name);
+        }
+
+        coerce_string(&init->init_list.elements[i], field->type, field->pointer_level);
+    }
+
+    init->type = type;
+    init->pointer_level = 0;
+}
+
+// soa Type[N] name; keeps each field of Type in its own array
+static void analyze_soa_declaration(SemanticAnalyzer *analyzer, const char *name, const TypeKind type, const int pointer_level, const int array_size, const ExprNode *init, const SourceLocation loc) {
+    if (!is_struct_type(type) || pointer_level > 0 || array_size <= 0) {
+        diag_error(analyzer->diagnostics, loc, "'soa' needs a struct array, as in 'soa %s[N] %s'", is_struct_type(type) ? type_to_string(type) : "Name", name);
+        return;
+    }
+
+    if (init) {
+        diag_error(analyzer->diagnostics, init->location, "soa array '%s' cannot have an initializer", name);
+    }
+}
+
+static void analyze_array_initializer(SemanticAnalyzer *analyzer, const char *name, const TypeKind type, const int pointer_level, const int array_size, ExprNode *init, const bool is_global, const SourceLocation loc) {
+    if (array_size <= 0 && is_vector_type(type) && pointer_level == 0) {
+        analyze_vector_initializer(analyzer, name, type, init, is_global);
+        return;
+    }
+
+    if (array_size <= 0) {
+        diag_error(analyzer->diagnostics, loc, "Initializer list used for non-array variable '%s'", name);
+        for (int i = 0; i < init->init_list.count; i++) {
+            analyze_expression(analyzer, init->init_list.elements[i]);
+        }
+        return;
+    }
+
+    if (init->kind != EXPR_INIT_LIST) {
+        diag_error(analyzer->diagnostics, loc, "Array '%s' must be initialized with an initializer list", name);
+        return;
+    }
+
+    if (init->init_list.count > array_size) {
+        diag_error(analyzer->diagnostics, init->location,
+                  "Too many initializers for array '%s' (got %d, array holds %d)",
+                  name, init->init_list.count, array_size);
+    }
+
+    for (int i = 0; i < init->init_list.count; i++) {
+        ExprNode *element = init->init_list.elements[i];
+        if (!element) continue;  // padding from a shorter row of a multi-dimensional initializer
+
+        analyze_expression(analyzer, element);
+
+        if (!types_compatible_with_pointers(type, pointer_level, element->type, element->pointer_level)) {
+            diag_error(analyzer->diagnostics, element->location,
+                      "Type mismatch in initializer element %d of '%s'. Expected '%s%s', got '%s%s'",
+                      i + 1,
+                      name,
+                      type_to_string(type),
+                      pointer_level > 0 ? "*" : "",
+                      type_to_string(element->type),
+                      element->pointer_level > 0 ? "*" : ""
+            );
+        }
+
+        if (is_global && !is_constant_initializer(element)) {
+            diag_error(analyzer->diagnostics, element->location, "Initializer element %d of global array '%s' is not a constant", i + 1, name);
+        }
+
+        coerce_string(&init->init_list.elements[i], type, pointer_level);
+    }
+
+    init->type = type;
+    init->pointer_level = pointer_level + 1;
+}
+
+static bool flatten_rows(SemanticAnalyzer *analyzer, const char *name, const int *dims, const int dim_count, const ExprNode *list, ExprNode **out, const int stride) {
+    if (list->kind != EXPR_INIT_LIST) {
+        diag_error(analyzer->diagnostics, list->location, "Expected a nested initializer list for each row of '%s'", name);
+        return false;
+    }
+
+    if (list->init_list.count > dims[0]) {
+        diag_error(analyzer->diagnostics, list->location, "Too many initializers for a row of '%s' (got %d, row holds %d)", name, list->init_list.count, dims[0]);
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < list->init_list.count; i++) {
+        ExprNode *element = list->init_list.elements[i];
+        if (dim_count == 1) {
+            out[i] = element;
+        } else {
+            ok &= flatten_rows(analyzer, name, dims + 1, dim_count - 1, element, out + i * stride / dims[0], stride / dims[0]);
+        }
+    }
+
+    return ok;
+}
+
+// {{1, 2}, {3}} for int[2][2] becomes {1, 2, 3, _} in row-major order, the gaps are zeroed
+static ExprNode* flatten_initializer(SemanticAnalyzer *analyzer, const char *name, const int *dims, const int dim_count, ExprNode *init) {
+    if (init->kind != EXPR_INIT_LIST) {
+        diag_error(analyzer->diagnostics, init->location, "Array '%s' must be initialized with an initializer list", name);
+        return NULL;
+    }
+
+    int total = 1;
+    for (int i = 0; i < dim_count; i++) {
+        total *= dims[i];
+    }
+
+    ExprNode **elements = calloc(total + 1, sizeof(ExprNode*));
+    if (!flatten_rows(analyzer, name, dims, dim_count, init, elements, total)) {
+        free(elements);
+        return NULL;
+    }
+
+    ExprNode *flat = malloc(sizeof(ExprNode));
+    *flat = *init;
+    flat->init_list.elements = elements;
+    flat->init_list.count = total;
+    return flat;
+}
+
+
+// for (x in range) declares x as a copy of each element, or as the element itself with ref
+static void analyze_range_for(SemanticAnalyzer *analyzer, const StmtNode *stmt) {
+    ExprNode *range = stmt->for_stmt.range;
+    analyze_expression(analyzer, range);
+
+    const bool is_array = range->is_slice || is_fixed_array(analyzer, range);
+    if (!is_array) {
+        diag_error(analyzer->diagnostics, range->location, "'in' loops go over a fixed array or a slice, got '%s%s'",
+                  type_to_string(range->type), range->pointer_level > 0 ? "*" : "");
+    }
+
+    Symbol *sym = malloc(sizeof(Symbol));
+    sym->name = strdup(stmt->for_stmt.range_var);
+    sym->kind = SYM_VARIABLE;
+    sym->type = range->type;
+    sym->pointer_level = is_array ? range->pointer_level - 1 : 0;
+    sym->is_const = false;
+    sym->is_soa = false;
+    sym->is_restrict = false;
+    sym->is_slice = false;
+    sym->array_size = 0;
+    sym->dims = NULL;
+    sym->dim_count = 0;
+    sym->generic = NULL;
+    sym->location = stmt->location;
+    scope_add_symbol(analyzer->current_scope, sym);
+}
+
+// 'become f(...)' reuses the caller's frame, which needs f to take and return exactly what the caller does
+static void analyze_become(SemanticAnalyzer *analyzer, ExprNode *call) {
+    analyze_expression(analyzer, call);
+
+    const FunctionNode *caller = analyzer->current_function;
+    const Symbol *callee = scope_lookup_recursive(analyzer->current_scope, call->call.function_name);
+    if (!callee || callee->kind != SYM_FUNCTION) {
+        if (call->call.intrinsic != INTRINSIC_NONE) {
+            diag_error(analyzer->diagnostics, call->location, "'become' needs a function, '%s' is an intrinsic", call->call.function_name);
+        }
+        return;
+    }
+
+    bool matches = callee->type == caller->return_type && callee->pointer_level == caller->return_pointer_level && callee->is_slice == caller->returns_slice &&
+                   callee->parameters.length == caller->param_count;
+    for (int i = 0; matches && i < caller->param_count; i++) {
+        const Symbol *param = *(const Symbol**)vector_get(&callee->parameters, i);
+        matches = param->type == caller->params[i].type && param->pointer_level == caller->params[i].pointer_level &&
+                  param->is_slice == caller->params[i].is_slice && param->dim_count == caller->params[i].dim_count &&
+                  (param->dim_count == 0 || memcmp(param->dims + 1, caller->params[i].dims + 1, sizeof(int) * (param->dim_count - 1)) == 0);
+    }
+
+    if (!matches) {
+        diag_error(analyzer->diagnostics, call->location, "'become' target '%s' must take the same parameters and return the same type as '%s'",
+                  call->call.function_name, caller->name);
+        return;
+    }
+
+    if (is_struct_type(caller->return_type) && caller->return_pointer_level == 0) {
+        diag_error(analyzer->diagnostics, call->location, "'become' cannot return a struct by value");
+        return;
+    }
+
+    for (int i = 0; i < call->call.arg_count; i++) {
+        const ExprNode *arg = call->call.args[i];
+        if (is_struct_type(arg->type) && arg->pointer_level == 0) {
+            diag_error(analyzer->diagnostics, arg->location, "'become' cannot pass a struct by value");
+        } else if (arg->kind == EXPR_UNARY && arg->unary.op == UNARY_ADDR_OF) {
+            // the address may point into the frame that is being replaced
+            diag_error(analyzer->diagnostics, arg->location, "'become' cannot pass an address taken with '&'");
+        }
+    }
+
+    if (strcmp(call->call.function_name, caller->name) == 0) {
+        analyzer->current_function->has_self_become = true;
+    }
+}
+
+// 'return f(...)' where f returns exactly the caller's type is a tail call, codegen decides if it can be marked
+static void mark_tail_call(const SemanticAnalyzer *analyzer, ExprNode *expr) {
+    if (expr->kind != EXPR_CALL || expr->call.intrinsic != INTRINSIC_NONE) return;
+
+    const Symbol *callee = scope_lookup_recursive(analyzer->current_scope, expr->call.function_name);
+    if (!callee || callee->kind != SYM_FUNCTION) return;
+
+    if (callee->type != analyzer->current_function_return_type || callee->pointer_level != analyzer->current_function_return_ptr_level ||
+        (is_struct_type(callee->type) && callee->pointer_level == 0)) {
+        return;
+    }
+
+    for (int i = 0; i < expr->call.arg_count; i++) {
+        if (is_struct_type(expr->call.args[i]->type) && expr->call.args[i]->pointer_level == 0) return;
+    }
+
+    expr->call.tail_call = TAIL_CALL_TAIL;
+}
+
+// true when a break inside stmt leaves the enclosing switch, breaks in nested loops and switches dont count
+static bool breaks_out(const StmtNode *stmt) {
+    if (!stmt) return false;
+
+    switch (stmt->kind) {
+        case STMT_BREAK:
+            return true;
+        case STMT_IF:
+            return breaks_out(stmt->if_stmt.then_stmt) || breaks_out(stmt->if_stmt.else_stmt);
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                if (breaks_out(stmt->compound.stmts[i])) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+static bool analyze_switch(SemanticAnalyzer *analyzer, StmtNode *stmt, const TypeKind expected_ret_type, const int expected_ret_ptr_level) {
+    ExprNode *value = stmt->switch_stmt.value;
+    analyze_expression(analyzer, value);
+
+    if (!is_integer_type(value->type) || value->pointer_level != 0) {
+        diag_error(analyzer->diagnostics, value->location, "Switch value must be an integer, got '%s%s'",
+                  type_to_string(value->type), value->pointer_level > 0 ? "*" : "");
+    }
+
+    Scope *switch_scope = scope_create(analyzer->current_scope, SCOPE_SWITCH);
+    Scope *old_scope = analyzer->current_scope;
+    analyzer->current_scope = switch_scope;
+
+    bool has_default = false;
+    bool has_break = false;
+    bool last_returns = false;
+
+    for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+        SwitchCase *c = &stmt->switch_stmt.cases[i];
+
+        if (!c->value) {
+            if (has_default) {
+                diag_error(analyzer->diagnostics, c->location, "Multiple default labels in one switch");
+            }
+            has_default = true;
+        } else {
+            analyze_expression(analyzer, c->value);
+
+            if (!is_constant_initializer(c->value) || !is_integer_type(c->value->type)) {
+                diag_error(analyzer->diagnostics, c->value->location, "Case label must be an integer constant");
+            } else {
+                const bool negative = c->value->kind == EXPR_UNARY;
+                const ExprNode *number = negative ? c->value->unary.operand : c->value;
+                c->constant = strtoll(number->text, NULL, 10);
+                if (negative) c->constant = -c->constant;
+
+                for (int j = 0; j < i; j++) {
+                    const SwitchCase *prev = &stmt->switch_stmt.cases[j];
+                    if (prev->value && prev->constant == c->constant) {
+                        diag_error(analyzer->diagnostics, c->value->location, "Duplicate case value %lld (previous label at line %d)",
+                                  c->constant, prev->location.line);
+                        break;
+                    }
+                }
+            }
+        }
+
+        bool case_returns = false;
+        for (int j = 0; j < c->count; j++) {
+            if (analyze_statement(analyzer, c->stmts[j], expected_ret_type, expected_ret_ptr_level)) {
+                case_returns = true;
+            }
+            has_break = has_break || breaks_out(c->stmts[j]);
+        }
+
+        last_returns = case_returns;
+    }
+
+    analyzer->current_scope = old_scope;
+    scope_destroy(switch_scope);
+
+    // every entry falls through to the end, so it returns when the tail does and nothing breaks out early
+    return has_default && last_returns && !has_break;
+}
+
+// a parallel for has to be 'for (int i = a; i < b; i++)' so the runtime can split [a, b) into chunks
+static void analyze_parallel_header(SemanticAnalyzer *analyzer, const StmtNode *stmt) {
+    const StmtNode *init = stmt->for_stmt.init;
+    const ExprNode *cond = stmt->for_stmt.condition;
+    const ExprNode *incr = stmt->for_stmt.increment;
+
+    const bool init_ok = init && init->kind == STMT_VAR_DECL && init->var_decl.initializer && init->var_decl.array_size <= 0 &&
+                         init->var_decl.pointer_level == 0 && is_integer_type(init->var_decl.type);
+    const char *index = init_ok ? init->var_decl.name : "";
+
+    const bool cond_ok = cond && cond->kind == EXPR_BINOP && (cond->binop.op == BIN_LESS || cond->binop.op == BIN_LESS_EQ) &&
+                         cond->binop.left->kind == EXPR_VAR && strcmp(cond->binop.left->text, index) == 0 &&
+                         is_integer_type(cond->binop.right->type) && cond->binop.right->pointer_level == 0;
+
+    const ExprNode *stepped = NULL;
+    if (incr && incr->kind == EXPR_UNARY && (incr->unary.op == UNARY_POST_INC || incr->unary.op == UNARY_PRE_INC)) {
+        stepped = incr->unary.operand;
+    } else if (incr && incr->kind == EXPR_BINOP && incr->binop.op == BIN_ADD_ASSIGN &&
+               incr->binop.right->kind == EXPR_NUMBER && strcmp(incr->binop.right->text, "1") == 0) {
+        stepped = incr->binop.left;
+    }
+    const bool incr_ok = stepped && stepped->kind == EXPR_VAR && strcmp(stepped->text, index) == 0;
+
+    if (!init_ok || !cond_ok || !incr_ok) {
+        diag_error(analyzer->diagnostics, stmt->location, "'parallel for' needs the form 'for (int i = a; i < b; i++)'");
+    }
+
+    for (int i = 0; i < stmt->for_stmt.reduction_count; i++) {
+        const Reduction *reduction = &stmt->for_stmt.reductions[i];
+        const Symbol *sym = scope_lookup_recursive(analyzer->current_scope, reduction->name);
+
+        if (!sym || (sym->kind != SYM_VARIABLE && sym->kind != SYM_PARAMETER)) {
+            diag_error(analyzer->diagnostics, reduction->location, "Undefined variable '%s' in 'reduce'", reduction->name);
+        } else if (strcmp(reduction->name, index) == 0) {
+            diag_error(analyzer->diagnostics, reduction->location, "The loop index '%s' cannot be reduced", reduction->name);
+        } else if (sym->pointer_level != 0 || !is_numeric_type(sym->type) ||
+                   (reduction->op != BIN_ADD && reduction->op != BIN_MUL && !is_integer_type(sym->type))) {
+            diag_error(analyzer->diagnostics, reduction->location, "Cannot reduce '%s' of type '%s%s' with that operator",
+                      reduction->name, type_to_string(sym->type), sym->pointer_level > 0 ? "*" : "");
+        } else if (sym->is_const) {
+            diag_error(analyzer->diagnostics, reduction->location, "Cannot reduce const variable '%s'", reduction->name);
+        }
+    }
+}
+
+// chunks of a parallel for run at the same time, so the body may only write memory no other iteration touches:
+// its own locals, a[i] at the loop index, and reduce(...) variables through their operator. only the body itself
+// is checked, what a called function does with a pointer it is passed is not
+typedef struct {
+    SemanticAnalyzer *analyzer;
+    const StmtNode *loop;
+    const char *index;
+    Vector locals;        // names declared inside the body
+    Vector local_arrays;  // the fixed size arrays among them, pointers declared in the body still point at shared memory
+} ParallelBody;
+
+static bool parallel_is_local(const ParallelBody *body, const char *name) {
+    for (int i = 0; i < body->locals.length; i++) {
+        if (strcmp(*(char**)vector_get(&body->locals, i), name) == 0) return true;
+    }
+
+    return false;
+}
+
+static bool parallel_is_local_array(const ParallelBody *body, const char *name) {
+    for (int i = 0; i < body->local_arrays.length; i++) {
+        if (strcmp(*(char**)vector_get(&body->local_arrays, i), name) == 0) return true;
+    }
+
+    return false;
+}
+
+static bool reduction_allows(const BinaryOp reduction_op, const BinaryOp assign_op) {
+    switch (reduction_op) {
+        case BIN_ADD: return assign_op == BIN_ADD_ASSIGN || assign_op == BIN_SUB_ASSIGN;
+        case BIN_MUL: return assign_op == BIN_MUL_ASSIGN;
+        case BIN_BIT_AND: return assign_op == BIN_AND_ASSIGN;
+        case BIN_BIT_OR: return assign_op == BIN_OR_ASSIGN;
+        case BIN_BIT_XOR: return assign_op == BIN_XOR_ASSIGN;
+        default: return false;
+    }
+}
+
+// op is the assignment operator, increments and decrements count as += and -=
+static void parallel_check_write(ParallelBody *body, const ExprNode *target, const BinaryOp op) {
+    // a field is written wherever the struct holding it lives
+    while (target->kind == EXPR_MEMBER && !target->member.through_pointer) {
+        target = target->member.object;
+    }
+
+    if (target->kind == EXPR_VAR) {
+        if (parallel_is_local(body, target->text)) return;
+
+        if (strcmp(target->text, body->index) == 0) {
+            diag_error(body->analyzer->diagnostics, target->location, "'parallel for' body cannot modify the loop index '%s'", target->text);
+            return;
+        }
+
+        for (int i = 0; i < body->loop->for_stmt.reduction_count; i++) {
+            const Reduction *reduction = &body->loop->for_stmt.reductions[i];
+            if (strcmp(reduction->name, target->text) != 0) continue;
+
+            if (!reduction_allows(reduction->op, op)) {
+                diag_error(body->analyzer->diagnostics, target->location, "'%s' is reduced, it can only be updated with its reduce operator", target->text);
+            }
+            return;
+        }
+
+        diag_error(body->analyzer->diagnostics, target->location,
+                  "'parallel for' body writes '%s', which every iteration shares. Declare it inside the loop or use reduce(...)", target->text);
+        return;
+    }
+
+    if (target->kind == EXPR_ARRAY_INDEX) {
+        const ExprNode *array = target->array_index.array;
+        const ExprNode *index = target->array_index.index;
+
+        // grid[i][j] of a local int[H][W] grid is still the local array
+        const ExprNode *root = array;
+        while (root->kind == EXPR_ARRAY_INDEX) {
+            root = root->array_index.array;
+        }
+
+        if (root->kind == EXPR_VAR && parallel_is_local_array(body, root->text)) return;
+        if (index->kind == EXPR_VAR && strcmp(index->text, body->index) == 0) return;
+
+        diag_error(body->analyzer->diagnostics, target->location, "'parallel for' body can only write arrays at the loop index, as 'a[%s]'", body->index);
+        return;
+    }
+
+    diag_error(body->analyzer->diagnostics, target->location, "'parallel for' body cannot write through a pointer, only to a[%s] or reduce(...) variables", body->index);
+}
+
+static void parallel_check_stmt(ParallelBody *body, const StmtNode *stmt);
+
+static void parallel_check_expr(ParallelBody *body, const ExprNode *expr) {
+    if (!expr) return;
+
+    switch (expr->kind) {
+        case EXPR_BINOP:
+            if (is_assignment_op(expr->binop.op)) {
+                parallel_check_write(body, expr->binop.left, expr->binop.op);
+            }
+            parallel_check_expr(body, expr->binop.left);
+            parallel_check_expr(body, expr->binop.right);
+            break;
+        case EXPR_UNARY:
+            if (expr->unary.op == UNARY_PRE_INC || expr->unary.op == UNARY_POST_INC) {
+                parallel_check_write(body, expr->unary.operand, BIN_ADD_ASSIGN);
+            } else if (expr->unary.op == UNARY_PRE_DEC || expr->unary.op == UNARY_POST_DEC) {
+                parallel_check_write(body, expr->unary.operand, BIN_SUB_ASSIGN);
+            }
+            parallel_check_expr(body, expr->unary.operand);
+            break;
+        case EXPR_CALL:
+            for (int i = 0; i < expr->call.arg_count; i++) {
+                parallel_check_expr(body, expr->call.args[i]);
+            }
+            break;
+        case EXPR_ARRAY_INDEX:
+            parallel_check_expr(body, expr->array_index.array);
+            parallel_check_expr(body, expr->array_index.index);
+            break;
+        case EXPR_CAST:
+            parallel_check_expr(body, expr->cast.operand);
+            break;
+        case EXPR_MEMBER:
+            parallel_check_expr(body, expr->member.object);
+            break;
+        case EXPR_SLICE:
+            parallel_check_expr(body, expr->slice.object);
+            parallel_check_expr(body, expr->slice.start);
+            parallel_check_expr(body, expr->slice.end);
+            break;
+        case EXPR_INIT_LIST:
+            for (int i = 0; i < expr->init_list.count; i++) {
+                parallel_check_expr(body, expr->init_list.elements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void parallel_check_stmt(ParallelBody *body, const StmtNode *stmt) {
+    if (!stmt) return;
+
+    switch (stmt->kind) {
+        case STMT_RETURN:
+            parallel_check_expr(body, stmt->return_stmt.expr);
+            break;
+        case STMT_IF:
+            parallel_check_expr(body, stmt->if_stmt.condition);
+            parallel_check_stmt(body, stmt->if_stmt.then_stmt);
+            parallel_check_stmt(body, stmt->if_stmt.else_stmt);
+            break;
+        case STMT_WHILE:
+            parallel_check_expr(body, stmt->while_stmt.condition);
+            parallel_check_stmt(body, stmt->while_stmt.body);
+            break;
+        case STMT_FOR:
+            parallel_check_stmt(body, stmt->for_stmt.init);
+            parallel_check_expr(body, stmt->for_stmt.condition);
+            parallel_check_expr(body, stmt->for_stmt.increment);
+            parallel_check_expr(body, stmt->for_stmt.range);
+
+            // a copy is private to the iteration, writing through a ref writes the shared array
+            if (stmt->for_stmt.range && !stmt->for_stmt.is_ref) {
+                vector_push(&body->locals, &stmt->for_stmt.range_var);
+            }
+
+            parallel_check_stmt(body, stmt->for_stmt.body);
+            break;
+        case STMT_SWITCH:
+            parallel_check_expr(body, stmt->switch_stmt.value);
+            for (int i = 0; i < stmt->switch_stmt.case_count; i++) {
+                for (int j = 0; j < stmt->switch_stmt.cases[i].count; j++) {
+                    parallel_check_stmt(body, stmt->switch_stmt.cases[i].stmts[j]);
+                }
+            }
+            break;
+        case STMT_VAR_DECL:
+            parallel_check_expr(body, stmt->var_decl.initializer);
+            vector_push(&body->locals, &stmt->var_decl.name);
+            if (stmt->var_decl.pointer_level == 0 && !stmt->var_decl.is_slice && stmt->var_decl.array_size > 0) {
+                vector_push(&body->local_arrays, &stmt->var_decl.name);
+            }
+            break;
+        case STMT_EXPR:
+            parallel_check_expr(body, stmt->expr_stmt.expr);
+            break;
+        case STMT_COMPOUND:
+            for (int i = 0; i < stmt->compound.count; i++) {
+                parallel_check_stmt(body, stmt->compound.stmts[i]);
+            }
+            break;
+        case STMT_ASM:
+            if (stmt->asm_stmt.output_count > 0) {
+                diag_error(body->analyzer->diagnostics, stmt->location, "'parallel for' body cannot write asm outputs");
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static bool analyze_statement(SemanticAnalyzer *analyzer, StmtNode *stmt, const TypeKind expected_ret_type, const int expected_ret_ptr_level) {
+    if (!stmt) return false;
+
+    switch (stmt->kind) {
+        case STMT_RETURN: {
+            if (scope_in_parallel_loop(analyzer->current_scope)) {
+                diag_error(analyzer->diagnostics, stmt->location, "'return' cannot leave a parallel for");
+            }
+
+            if (stmt->return_stmt.expr && stmt->return_stmt.expr->kind == EXPR_CALL && stmt->return_stmt.expr->call.tail_call == TAIL_CALL_BECOME) {
+                analyze_become(analyzer, stmt->return_stmt.expr);
+                return true;
+            }
+
+            if (stmt->return_stmt.expr) {
+                if (expected_ret_type == TYPE_VOID && expected_ret_ptr_level == 0) {
+                    diag_error(analyzer->diagnostics, stmt->location, "Void function cannot return a value");
+                }
+
+                analyze_expression(analyzer, stmt->return_stmt.expr);
+
+                if (!reject_dims_mismatch(analyzer, stmt->return_stmt.expr, NULL, 0) &&
+                    !coerce_to_slice(analyzer, &stmt->return_stmt.expr, analyzer->current_function->returns_slice, expected_ret_type, expected_ret_ptr_level) &&
+                    !types_compatible_with_pointers(expected_ret_type, expected_ret_ptr_level,
+                                                    stmt->return_stmt.expr->type,
+                                                    stmt->return_stmt.expr->pointer_level)) {
+                    diag_error(analyzer->diagnostics, stmt->location,
+                              "Return type mismatch. Expected '%s%s', got '%s%s'",
+                              type_to_string(expected_ret_type),
+                              expected_ret_ptr_level > 0 ? "*" : "",
+                              type_to_string(stmt->return_stmt.expr->type),
+                              stmt->return_stmt.expr->pointer_level > 0 ? "*" : ""
+                    );
+                }
+
+                coerce_string(&stmt->return_stmt.expr, expected_ret_type, expected_ret_ptr_level);
+
+                mark_tail_call(analyzer, stmt->return_stmt.expr);
+            } else {
+                if (expected_ret_type != TYPE_VOID || expected_ret_ptr_level > 0) {
+                    diag_error(analyzer->diagnostics, stmt->location,
+                              "Non-void function must return a value of type '%s%s'",
+                              type_to_string(expected_ret_type),
+                              expected_ret_ptr_level > 0 ? "*" : ""
+                    );
+                }
+            }
+            return true;
+        }
+        case STMT_IF: {
+            analyze_expression(analyzer, stmt->if_stmt.condition);
+            reject_aggregate(analyzer, stmt->if_stmt.condition);
+
+            if (stmt->if_stmt.condition->type != TYPE_BOOLEAN &&
+                !is_numeric_type(stmt->if_stmt.condition->type)) {
+                diag_warning(analyzer->diagnostics, stmt->location, "If condition should be boolean or numeric. Got '%s'", type_to_string(stmt->if_stmt.condition->type));
+            }
+
+            const bool then_returns = analyze_statement(analyzer, stmt->if_stmt.then_stmt, expected_ret_type, expected_ret_ptr_level);
+
+            bool else_returns = false;
+            if (stmt->if_stmt.else_stmt) {
+                else_returns = analyze_statement(analyzer, stmt->if_stmt.else_stmt, expected_ret_type, expected_ret_ptr_level);
+            }
+
+            return then_returns && else_returns;
+        }
+        case STMT_WHILE: {
+            analyze_expression(analyzer, stmt->while_stmt.condition);
+            reject_aggregate(analyzer, stmt->while_stmt.condition);
+
+            if (stmt->while_stmt.condition->type != TYPE_BOOLEAN && !is_numeric_type(stmt->while_stmt.condition->type)) {
+                diag_warning(analyzer->diagnostics, stmt->location, "While condition should be boolean or numeric");
+            }
+
+            Scope *loop_scope = scope_create(analyzer->current_scope, SCOPE_LOOP);
+            Scope *old_scope = analyzer->current_scope;
+            analyzer->current_scope = loop_scope;
+
+            analyze_statement(analyzer, stmt->while_stmt.body, expected_ret_type, expected_ret_ptr_level);
+
+            analyzer->current_scope = old_scope;
+            scope_destroy(loop_scope);
+
+            return false;
+        }
+        case STMT_FOR: {
+            Scope *loop_scope = scope_create(analyzer->current_scope, stmt->for_stmt.is_parallel ? SCOPE_PARALLEL_LOOP : SCOPE_LOOP);
+            Scope *old_scope = analyzer->current_scope;
+            analyzer->current_scope = loop_scope;
+
+            if (stmt->for_stmt.init) {
+                analyze_statement(analyzer, stmt->for_stmt.init, expected_ret_type, expected_ret_ptr_level);
+            }
+
+            if (stmt->for_stmt.range) {
+                analyze_range_for(analyzer, stmt);
+            }
+
+            // condition
+            if (stmt->for_stmt.condition) {
+                analyze_expression(analyzer, stmt->for_stmt.condition);
+                reject_aggregate(analyzer, stmt->for_stmt.condition);
+                if (stmt->for_stmt.condition->type != TYPE_BOOLEAN && !is_numeric_type(stmt->for_stmt.condition->type)) {
+                    diag_warning(analyzer->diagnostics, stmt->location, "For condition should be boolean or numeric");
+                }
+            }
+
+            // increment
+            if (stmt->for_stmt.increment) {
+                analyze_expression(analyzer, stmt->for_stmt.increment);
+            }
+
+            if (stmt->for_stmt.is_parallel) {
+                analyze_parallel_header(analyzer, stmt);
+            }
+
+            // body
+            analyze_statement(analyzer, stmt->for_stmt.body, expected_ret_type, expected_ret_ptr_level);
+
+            if (stmt->for_stmt.is_parallel) {
+                ParallelBody body = { analyzer, stmt, "", create_vector(8, sizeof(char*)), create_vector(8, sizeof(char*)) };
+                if (stmt->for_stmt.init && stmt->for_stmt.init->kind == STMT_VAR_DECL) {
+                    body.index = stmt->for_stmt.init->var_decl.name;
+                }
+
+                parallel_check_stmt(&body, stmt->for_stmt.body);
+                vector_destroy(&body.locals);
+                vector_destroy(&body.local_arrays);
+            }
+
+            analyzer->current_scope = old_scope;
+            scope_destroy(loop_scope);
+
+            return false;
+        }
+        case STMT_SWITCH:
+            return analyze_switch(analyzer, stmt, expected_ret_type, expected_ret_ptr_level);
+        case STMT_BREAK: {
+            if (!scope_in_breakable(analyzer->current_scope)) {
+                diag_error(analyzer->diagnostics, stmt->location, "'break' statement can only be used inside a loop or switch");
+            } else if (scope_break_leaves_parallel(analyzer->current_scope)) {
+                diag_error(analyzer->diagnostics, stmt->location, "'break' cannot leave a parallel for, every iteration runs");
+            }
+            return false;
+        }
+        case STMT_CONTINUE: {
+            if (!scope_in_loop(analyzer->current_scope)) {
+                diag_error(analyzer->diagnostics, stmt->location, "'continue' statement can only be used inside a loop");
+            }
+            return false;
+        }
+        case STMT_ASM: {
+            for (int i = 0; i < stmt->asm_stmt.output_count; i++) {
+                analyze_expression(analyzer, stmt->asm_stmt.outputs[i]);
+            }
+
+            for (int i = 0; i < stmt->asm_stmt.input_count; i++) {
+                analyze_expression(analyzer, stmt->asm_stmt.inputs[i]);
+            }
+
+            return false;
+        }
+        case STMT_VAR_DECL: {
+            if (stmt->var_decl.type == TYPE_VOID && stmt->var_decl.pointer_level == 0) {
+                diag_error(analyzer->diagnostics, stmt->location,
+                          "Variable '%s' declared as void. Variables cannot be void (did you mean 'void*'?)",
+                          stmt->var_decl.name);
+            }
+
+            // check if variable already exists in current scope
+            const Symbol *existing = scope_lookup(analyzer->current_scope, stmt->var_decl.name);
+            if (existing) {
+                diag_error(analyzer->diagnostics, stmt->location,
+                          "Variable '%s' already declared in this scope (previous declaration at line %d)",
+                          stmt->var_decl.name, existing->location.line);
+            }
+
+            Symbol *sym = malloc(sizeof(Symbol));
+            sym->name = strdup(stmt->var_decl.name);
+            sym->kind = SYM_VARIABLE;
+            sym->type = stmt->var_decl.type;
+            sym->is_const = stmt->var_decl.is_const;
+            sym->is_soa = stmt->var_decl.is_soa;
+            sym->is_restrict = stmt->var_decl.is_restrict;
+            sym->is_slice = stmt->var_decl.is_slice;
+            sym->array_size = stmt->var_decl.array_size;
+            sym->dims = stmt->var_decl.dims;
+            sym->dim_count = stmt->var_decl.dim_count;
+            sym->generic = NULL;
+
+            if (stmt->var_decl.dim_count > 0) {
+                sym->pointer_level = stmt->var_decl.pointer_level + stmt->var_decl.dim_count;
+            } else if (stmt->var_decl.array_size > 0 || stmt->var_decl.is_slice) {
+                sym->pointer_level = stmt->var_decl.pointer_level + 1;
+            } else {
+                sym->pointer_level = stmt->var_decl.pointer_level;
+            }
+
+            sym->location = stmt->location;
             scope_add_symbol(analyzer->current_scope, sym);
 
-            if (stmt->var_decl.initializer) {
+            if (stmt->var_decl.is_restrict && (stmt->var_decl.pointer_level == 0 || stmt->var_decl.array_size > 0)) {
+                diag_error(analyzer->diagnostics, stmt->location, "Variable '%s' is restrict but not a pointer", stmt->var_decl.name);
+            }
+
+            if (stmt->var_decl.alignment > 0 && stmt->var_decl.is_slice) {
+                diag_error(analyzer->diagnostics, stmt->location, "Slice '%s' cannot be aligned, align the array it views instead", stmt->var_decl.name);
+            }
+
+            if (stmt->var_decl.is_soa && stmt->var_decl.dim_count > 0) {
+                diag_error(analyzer->diagnostics, stmt->location, "soa array '%s' cannot have more than one dimension", stmt->var_decl.name);
+            } else if (stmt->var_decl.is_soa) {
+                analyze_soa_declaration(analyzer, stmt->var_decl.name, stmt->var_decl.type, stmt->var_decl.pointer_level,
+                                        stmt->var_decl.array_size, stmt->var_decl.initializer, stmt->location);
+            } else if (stmt->var_decl.dim_count > 0) {
+                if (stmt->var_decl.initializer) {
+                    ExprNode *flat = flatten_initializer(analyzer, stmt->var_decl.name, stmt->var_decl.dims, stmt->var_decl.dim_count, stmt->var_decl.initializer);
+                    if (flat) {
+                        stmt->var_decl.initializer = flat;
+                        analyze_array_initializer(analyzer, stmt->var_decl.name, stmt->var_decl.type, stmt->var_decl.pointer_level,
+                                                  flat->init_list.count, flat, false, stmt->location);
+                    }
+                }
+            } else if (is_struct_type(stmt->var_decl.type) && stmt->var_decl.pointer_level == 0 && stmt->var_decl.array_size <= 0 &&
+                       stmt->var_decl.initializer && stmt->var_decl.initializer->kind == EXPR_INIT_LIST) {
+                analyze_struct_initializer(analyzer, stmt->var_decl.name, stmt->var_decl.type, stmt->var_decl.initializer, false);
+            } else if (stmt->var_decl.is_slice) {
+                if (stmt->var_decl.initializer && stmt->var_decl.initializer->kind == EXPR_INIT_LIST) {
+                    diag_error(analyzer->diagnostics, stmt->location, "Slice '%s' cannot be initialized with a list, slice an array instead", stmt->var_decl.name);
+                } else if (stmt->var_decl.initializer) {
+                    analyze_expression(analyzer, stmt->var_decl.initializer);
+                    coerce_to_slice(analyzer, &stmt->var_decl.initializer, true, sym->type, sym->pointer_level);
+                }
+            } else if (stmt->var_decl.initializer && (stmt->var_decl.array_size > 0 || stmt->var_decl.initializer->kind == EXPR_INIT_LIST)) {
+                analyze_array_initializer(analyzer, stmt->var_decl.name, stmt->var_decl.type, stmt->var_decl.pointer_level,
+                                          stmt->var_decl.array_size, stmt->var_decl.initializer, false, stmt->location);
+            } else if (stmt->var_decl.initializer) {
                 analyze_expression(analyzer, stmt->var_decl.initializer);
 
-                if (!types_compatible_with_pointers(stmt->var_decl.type,
+                if (!reject_dims_mismatch(analyzer, stmt->var_decl.initializer, NULL, 0) &&
+                    !coerce_to_slice(analyzer, &stmt->var_decl.initializer, false, sym->type, sym->pointer_level) &&
+                    !types_compatible_with_pointers(stmt->var_decl.type,
                                                     stmt->var_decl.pointer_level,
                                                     stmt->var_decl.initializer->type,
                                                     stmt->var_decl.initializer->pointer_level)) {
@@ -559,6 +2398,9 @@ static bool analyze_statement(SemanticAnalyzer *analyzer, StmtNode *stmt, const
                               stmt->var_decl.initializer->pointer_level > 0 ? "*" : ""
                     );
                 }
+
+                reject_constant_overflow(analyzer, stmt->var_decl.initializer, stmt->var_decl.type, stmt->var_decl.pointer_level);
+                coerce_string(&stmt->var_decl.initializer, stmt->var_decl.type, stmt->var_decl.pointer_level);
             }
 
             return false;
@@ -594,15 +2436,22 @@ static bool analyze_statement(SemanticAnalyzer *analyzer, StmtNode *stmt, const
     return false;
 }
 
-static void analyze_function(SemanticAnalyzer *analyzer, const FunctionNode *func, Scope *global) {
-    Symbol *func_sym = scope_lookup(global, func->name);
-    func_sym->parameters = create_vector(func->param_count, sizeof(Symbol*));
+static void analyze_function(SemanticAnalyzer *analyzer, FunctionNode *func, Scope *global) {
+    if ((func->attributes & FUNC_ATTR_NOINLINE) && (func->attributes & (FUNC_ATTR_INLINE | FUNC_ATTR_ALWAYS_INLINE))) {
+        diag_error(analyzer->diagnostics, func->location, "Function '%s' cannot be both noinline and %s",
+                  func->name, (func->attributes & FUNC_ATTR_ALWAYS_INLINE) ? "always_inline" : "inline");
+    }
+
+    if ((func->attributes & FUNC_ATTR_HOT) && (func->attributes & FUNC_ATTR_COLD)) {
+        diag_error(analyzer->diagnostics, func->location, "Function '%s' cannot be both hot and cold", func->name);
+    }
 
     Scope *func_scope = scope_create(global, SCOPE_FUNCTION);
     analyzer->current_scope = func_scope;
 
     analyzer->current_function_return_type = func->return_type;
     analyzer->current_function_return_ptr_level = func->return_pointer_level;
+    analyzer->current_function = func;
 
     for (int i = 0; i < func->param_count; i++) {
         const ParamNode *param = &func->params[i];
@@ -612,25 +2461,30 @@ static void analyze_function(SemanticAnalyzer *analyzer, const FunctionNode *fun
             continue;
         }
 
+        if (param->is_restrict && (param->pointer_level == 0 || param->is_slice)) {
+            diag_error(analyzer->diagnostics, param->location, "Parameter '%s' is restrict but not a pointer", param->name);
+        }
+
+        if (param->alignment > 0 && param->pointer_level == 0) {
+            diag_error(analyzer->diagnostics, param->location, "Parameter '%s' is aligned but not a pointer", param->name);
+        }
+
         Symbol *scope_sym = malloc(sizeof(Symbol));
         scope_sym->name = strdup(param->name);
         scope_sym->kind = SYM_PARAMETER;
         scope_sym->type = param->type;
         scope_sym->pointer_level = param->pointer_level;
         scope_sym->is_const = param->is_const;
+        scope_sym->is_soa = false;
+        scope_sym->is_restrict = param->is_restrict;
+        scope_sym->is_slice = param->is_slice;
+        scope_sym->array_size = 0;
+        scope_sym->dims = param->dims;
+        scope_sym->dim_count = param->dim_count;
+        scope_sym->generic = NULL;
         scope_sym->location = param->location;
 
         scope_add_symbol(func_scope, scope_sym);
-
-        Symbol *sig_sym = malloc(sizeof(Symbol));
-        sig_sym->name = strdup(param->name);
-        sig_sym->kind = SYM_PARAMETER;
-        sig_sym->type = param->type;
-        sig_sym->pointer_level = param->pointer_level;
-        sig_sym->is_const = param->is_const;
-        sig_sym->location = param->location;
-
-        vector_push(&func_sym->parameters, &sig_sym);
     }
 
     const bool returns_value = analyze_statement(analyzer, func->body, func->return_type, func->return_pointer_level);
@@ -1,7 +1,17 @@
 #include "typecheck.h"
 #include "../ast/ast.h"
 
+#include <string.h>
+
+// struct definitions of the program being compiled, TYPE_STRUCT + i is structs[i]
+static StructNode **struct_types = NULL;
+static int struct_type_count = 0;
+
 const char* type_to_string(TypeKind type) {
+    if (is_struct_type(type)) {
+        return struct_type_def(type)->name;
+    }
+
     switch (type) {
         case TYPE_INT: return "int";
         case TYPE_LONG: return "long";
@@ -11,25 +21,127 @@ const char* type_to_string(TypeKind type) {
         case TYPE_STRING: return "string";
         case TYPE_BOOLEAN: return "bool";
         case TYPE_VOID: return "void";
+        case TYPE_UINT: return "uint";
+        case TYPE_ULONG: return "ulong";
+        case TYPE_BYTE: return "byte";
+        case TYPE_FLOAT4: return "float4";
+        case TYPE_FLOAT8: return "float8";
+        case TYPE_INT4: return "int4";
+        case TYPE_INT8: return "int8";
         default: return "unknown";
     }
 }
 
 bool is_numeric_type(const TypeKind type) {
-    return type == TYPE_INT || type == TYPE_LONG || type == TYPE_FLOAT || type == TYPE_DOUBLE || type == TYPE_CHAR;
+    return is_integer_type(type) || is_floating_type(type);
 }
 
 bool is_integer_type(const TypeKind type) {
-    return type == TYPE_INT || type == TYPE_LONG || type == TYPE_CHAR;
+    return type == TYPE_INT || type == TYPE_LONG || type == TYPE_CHAR || is_unsigned_type(type);
+}
+
+bool is_unsigned_type(const TypeKind type) {
+    return type == TYPE_UINT || type == TYPE_ULONG || type == TYPE_BYTE;
 }
 
 bool is_floating_type(const TypeKind type) {
     return type == TYPE_FLOAT || type == TYPE_DOUBLE;
 }
 
+int integer_type_bits(const TypeKind type) {
+    switch (type) {
+        case TYPE_CHAR:
+        case TYPE_BYTE:
+        case TYPE_BOOLEAN: return 8;
+        case TYPE_LONG:
+        case TYPE_ULONG: return 64;
+        default: return 32;
+    }
+}
+
+// char, byte and bool are widened to int before any arithmetic, like C's integer promotions
+TypeKind promote_integer_type(const TypeKind type) {
+    return integer_type_bits(type) < 32 ? TYPE_INT : type;
+}
+
+// the usual arithmetic conversions: the wider floating type if either side is floating, otherwise both sides are
+// promoted and the wider one wins, unsigned when the unsigned side is at least as wide as the signed one
+TypeKind arithmetic_common_type(const TypeKind left, const TypeKind right) {
+    if (left == TYPE_DOUBLE || right == TYPE_DOUBLE) return TYPE_DOUBLE;
+    if (left == TYPE_FLOAT || right == TYPE_FLOAT) return TYPE_FLOAT;
+
+    const TypeKind l = promote_integer_type(left);
+    const TypeKind r = promote_integer_type(right);
+    if (l == r) return l;
+
+    const int l_bits = integer_type_bits(l);
+    const int r_bits = integer_type_bits(r);
+    if (l_bits != r_bits) return l_bits > r_bits ? l : r;
+
+    return is_unsigned_type(l) ? l : r;
+}
+
+bool is_vector_type(const TypeKind type) {
+    return type == TYPE_FLOAT4 || type == TYPE_FLOAT8 || type == TYPE_INT4 || type == TYPE_INT8;
+}
+
+// lane type of a vector, scalars are returned unchanged
+TypeKind vector_element_type(const TypeKind type) {
+    switch (type) {
+        case TYPE_FLOAT4:
+        case TYPE_FLOAT8: return TYPE_FLOAT;
+        case TYPE_INT4:
+        case TYPE_INT8: return TYPE_INT;
+        default: return type;
+    }
+}
+
+int vector_lane_count(const TypeKind type) {
+    switch (type) {
+        case TYPE_FLOAT4:
+        case TYPE_INT4: return 4;
+        case TYPE_FLOAT8:
+        case TYPE_INT8: return 8;
+        default: return 1;
+    }
+}
+
+// comparisons on vectors give an all-ones / all-zeros int lane per element, like sse/avx masks
+TypeKind vector_mask_type(const TypeKind type) {
+    return vector_lane_count(type) == 8 ? TYPE_INT8 : TYPE_INT4;
+}
+
+void register_struct_types(StructNode **structs, const int count) {
+    struct_types = structs;
+    struct_type_count = count;
+}
+
+bool is_struct_type(const TypeKind type) {
+    return (int)type >= TYPE_STRUCT && (int)type < TYPE_STRUCT + struct_type_count;
+}
+
+const StructNode* struct_type_def(const TypeKind type) {
+    return is_struct_type(type) ? struct_types[type - TYPE_STRUCT] : NULL;
+}
+
+int struct_field_index(const StructNode *def, const char *name) {
+    for (int i = 0; i < def->field_count; i++) {
+        if (strcmp(def->fields[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 bool types_compatible(const TypeKind target, const TypeKind source) {
     if (target == source) return true;
 
+    // scalars splat across every lane
+    if (is_vector_type(target) && is_numeric_type(source)) {
+        return true;
+    }
+
     if (is_numeric_type(target) && is_numeric_type(source)) {
         return true;
     }
@@ -73,6 +185,10 @@ bool is_arithmetic_op(const BinaryOp op) {
     return op == BIN_ADD || op == BIN_SUB || op == BIN_MUL || op == BIN_DIV || op == BIN_MOD;
 }
 
+bool is_bitwise_op(const BinaryOp op) {
+    return op == BIN_BIT_AND || op == BIN_BIT_OR || op == BIN_BIT_XOR || op == BIN_SHL || op == BIN_SHR;
+}
+
 bool is_comparison_op(const BinaryOp op) {
     return op == BIN_EQUAL || op == BIN_GREATER || op == BIN_LESS || op == BIN_GREATER_EQ || op == BIN_LESS_EQ || op == BIN_NOT_EQUAL;
 }
@@ -82,5 +198,10 @@ bool is_logical_op(const BinaryOp op) {
 }
 
 bool is_assignment_op(const BinaryOp op) {
-    return op == BIN_ASSIGN || op == BIN_ADD_ASSIGN || op == BIN_SUB_ASSIGN || op == BIN_MUL_ASSIGN || op == BIN_DIV_ASSIGN;
+    return op == BIN_ASSIGN || op == BIN_ADD_ASSIGN || op == BIN_SUB_ASSIGN || op == BIN_MUL_ASSIGN || op == BIN_DIV_ASSIGN ||
+           op == BIN_MOD_ASSIGN || is_bitwise_assignment_op(op);
+}
+
+bool is_bitwise_assignment_op(const BinaryOp op) {
+    return op == BIN_AND_ASSIGN || op == BIN_OR_ASSIGN || op == BIN_XOR_ASSIGN || op == BIN_SHL_ASSIGN || op == BIN_SHR_ASSIGN;
 }
\ No newline at end of file
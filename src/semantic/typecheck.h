@@ -8,13 +8,29 @@ const char* type_to_string(TypeKind type);
 bool is_numeric_type(TypeKind type);
 bool is_integer_type(TypeKind type);
 bool is_floating_type(TypeKind type);
+bool is_unsigned_type(TypeKind type);
+int integer_type_bits(TypeKind type);
+TypeKind promote_integer_type(TypeKind type);
+TypeKind arithmetic_common_type(TypeKind left, TypeKind right);
+
+bool is_vector_type(TypeKind type);
+TypeKind vector_element_type(TypeKind type);
+int vector_lane_count(TypeKind type);
+TypeKind vector_mask_type(TypeKind type);
+
+void register_struct_types(StructNode **structs, int count);
+bool is_struct_type(TypeKind type);
+const StructNode* struct_type_def(TypeKind type);
+int struct_field_index(const StructNode *def, const char *name);
 
 bool types_compatible(TypeKind target, TypeKind source);
 bool types_compatible_with_pointers(TypeKind target_type, int target_ptr_level, TypeKind source_type, int source_ptr_level);
 
 bool is_arithmetic_op(BinaryOp op);
+bool is_bitwise_op(BinaryOp op);
 bool is_comparison_op(BinaryOp op);
 bool is_logical_op(BinaryOp op);
 bool is_assignment_op(BinaryOp op);
+bool is_bitwise_assignment_op(BinaryOp op);
 
 #endif //C__SEMANTIC_TYPECHECK_H
\ No newline at end of file